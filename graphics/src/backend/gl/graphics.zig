@@ -12,6 +12,7 @@ pub const SwapChain = @import("swapchain.zig").SwapChain;
 pub const Shader = @import("shader.zig").Shader;
 pub const Renderer = @import("renderer.zig").Renderer;
 pub const SlaveRenderer = @import("renderer.zig").SlaveRenderer;
+pub const TexShader = @import("shaders.zig").TexShader;
 const TexShaderVertex = gpu.TexShaderVertex;
 const log = stdx.log.scoped(.gl_graphics);
 
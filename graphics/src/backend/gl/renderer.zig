@@ -13,6 +13,7 @@ const gpu = graphics.gpu;
 const TexShaderVertex = gpu.TexShaderVertex;
 const TextureId = gpu.TextureId;
 const Mesh = gpu.Mesh;
+const mesh_ = @import("../gpu/mesh.zig");
 const shaders = @import("shaders.zig");
 const log = stdx.log.scoped(.gl_renderer);
 
@@ -22,6 +23,11 @@ const MatBufferInitialSizeBytes = MatBufferInitialSize * @sizeOf(Mat4);
 const MaterialBufferInitialSize = 100;
 const MaterialBufferInitialSizeBytes = MaterialBufferInitialSize * @sizeOf(graphics.Material);
 
+/// The mapped vertex and index buffers are split into regions. A frame writes into one region while the gpu can still be reading from the previous ones.
+const NumMeshRegions = 3;
+const RegionVerts = mesh_.MaxVertexBufferSize;
+const RegionIndexes = mesh_.MaxIndexBufferSize;
+
 pub const SlaveRenderer = struct {
     dummy: bool,
 
@@ -44,7 +50,13 @@ pub const Renderer = struct {
     materials_buf_id: gl.GLuint,
     materials_buf: []graphics.Material,
     mesh: Mesh,
+    /// Null if persistently mapped buffers aren't supported. The mesh is then uploaded with bufferData on each draw.
+    mesh_ring: ?MeshRing,
+    /// Index of the first mesh index and vertex that haven't been drawn.
+    mesh_draw_start: u32,
+    mesh_draw_vert_start: u32,
     image_store: *graphics.gpu.ImageStore,
+    stats: *graphics.FrameStats,
 
     /// Pipelines.
     pipelines: Pipelines,
@@ -65,8 +77,12 @@ pub const Renderer = struct {
             .depth_test = undefined,
             .scissor_test = undefined,
             .mesh = undefined,
+            .mesh_ring = null,
+            .mesh_draw_start = 0,
+            .mesh_draw_vert_start = 0,
             .pipelines = undefined,
             .image_store = undefined,
+            .stats = undefined,
             .binded_draw_framebuffer = 0,
         };
         const max_total_textures = gl.getMaxTotalTextures();
@@ -89,11 +105,19 @@ pub const Renderer = struct {
         // Initialize pipelines.
         self.pipelines = .{
             .tex = try shaders.TexShader.init(self.vert_buf_id),
+            .sdf = try shaders.TexShader.initSdf(self.vert_buf_id),
             .gradient = try shaders.GradientShader.init(self.vert_buf_id),
             .plane = try shaders.PlaneShader.init(self.vert_buf_id),
             .tex_pbr = try shaders.TexPbrShader.init(alloc, self.vert_buf_id),
         };
 
+        // WebGL doesn't support mapping buffers.
+        if (!IsWasm) {
+            if (gl.isExtensionSupported("GL_ARB_buffer_storage")) {
+                self.initMeshRing();
+            }
+        }
+
         // Enable blending by default.
         gl.enable(gl.GL_BLEND);
 
@@ -111,7 +135,48 @@ pub const Renderer = struct {
         gl.disable(gl.GL_POLYGON_OFFSET_FILL);
     }
 
+    /// Allocates immutable storage for the vertex and index buffers and keeps them mapped.
+    /// The buffer ids don't change so the shader vaos still refer to them.
+    fn initMeshRing(self: *Renderer) void {
+        const flags = gl.GL_MAP_WRITE_BIT | gl.GL_MAP_PERSISTENT_BIT | gl.GL_MAP_COHERENT_BIT;
+        const vert_size = NumMeshRegions * RegionVerts * @sizeOf(TexShaderVertex);
+        const index_size = NumMeshRegions * RegionIndexes * @sizeOf(u32);
+
+        gl.bindBuffer(gl.GL_ARRAY_BUFFER, self.vert_buf_id);
+        gl.bufferStorage(gl.GL_ARRAY_BUFFER, vert_size, null, flags);
+        const vert_ptr = gl.mapBufferRange(gl.GL_ARRAY_BUFFER, 0, vert_size, flags);
+        gl.bindBuffer(gl.GL_ARRAY_BUFFER, 0);
+
+        // Binding the element buffer requires a vao in core profile.
+        gl.bindVertexArray(self.pipelines.tex.shader.vao_id);
+        gl.bindBuffer(gl.GL_ELEMENT_ARRAY_BUFFER, self.index_buf_id);
+        gl.bufferStorage(gl.GL_ELEMENT_ARRAY_BUFFER, index_size, null, flags);
+        const index_ptr = gl.mapBufferRange(gl.GL_ELEMENT_ARRAY_BUFFER, 0, index_size, flags);
+        gl.bindVertexArray(0);
+
+        if (vert_ptr == null or index_ptr == null) {
+            // The buffers are immutable now so there's no falling back to bufferData.
+            stdx.panic("failed to map mesh buffers");
+        }
+        self.mesh_ring = .{
+            .verts = stdx.ptrCastAlign([*]TexShaderVertex, vert_ptr.?)[0 .. NumMeshRegions * RegionVerts],
+            .indexes = stdx.ptrCastAlign([*]u32, index_ptr.?)[0 .. NumMeshRegions * RegionIndexes],
+            .fences = [_]gl.GLsync{null} ** NumMeshRegions,
+            .region = 0,
+        };
+        self.mesh.setMappedBuffers(self.mesh_ring.?.verts[0..RegionVerts], self.mesh_ring.?.indexes[0..RegionIndexes]);
+    }
+
     pub fn deinit(self: Renderer, alloc: std.mem.Allocator) void {
+        if (!IsWasm) {
+            if (self.mesh_ring) |ring| {
+                for (ring.fences) |fence| {
+                    if (fence != null) {
+                        gl.deleteSync(fence);
+                    }
+                }
+            }
+        }
         const bufs = [_]gl.GLuint{
             self.vert_buf_id,
             self.index_buf_id,
@@ -132,12 +197,110 @@ pub const Renderer = struct {
         self.binded_draw_framebuffer = framebuffer;
     }
 
+    /// Starts writing the frame's mesh data into the next region.
+    pub fn beginMeshFrame(self: *Renderer) void {
+        if (self.mesh_ring != null) {
+            self.nextMeshRegion();
+        }
+        self.mesh.reset();
+    }
+
+    /// Fences the current region and moves to the next one, waiting until the gpu has finished reading from it.
+    /// All mesh data in the current region must be drawn beforehand.
+    pub fn nextMeshRegion(self: *Renderer) void {
+        if (IsWasm) {
+            unreachable;
+        } else {
+            const ring = &self.mesh_ring.?;
+            if (self.mesh.cur_index_buf_size > 0) {
+                ring.fences[ring.region] = gl.fenceSync(gl.GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            }
+            ring.region = (ring.region + 1) % NumMeshRegions;
+            const fence = ring.fences[ring.region];
+            if (fence != null) {
+                // Usually already signaled since the region was last used a few frames ago.
+                _ = gl.clientWaitSync(fence, gl.GL_SYNC_FLUSH_COMMANDS_BIT, std.math.maxInt(u64));
+                gl.deleteSync(fence);
+                ring.fences[ring.region] = null;
+            }
+            self.mesh.setMappedBuffers(ring.verts[ring.region * RegionVerts..][0..RegionVerts], ring.indexes[ring.region * RegionIndexes..][0..RegionIndexes]);
+            self.mesh_draw_start = 0;
+            self.mesh_draw_vert_start = 0;
+        }
+    }
+
+    pub fn hasPendingMesh(self: Renderer) bool {
+        return self.mesh.cur_index_buf_size > self.mesh_draw_start;
+    }
+
+    /// Draws the mesh indexes that haven't been drawn with the currently bound vao.
+    pub fn drawMesh(self: *Renderer) void {
+        const num_indexes = self.mesh.cur_index_buf_size - self.mesh_draw_start;
+        if (num_indexes == 0) {
+            return;
+        }
+        self.prepareMeshDraws();
+        self.drawMeshIndexes(self.mesh_draw_start, num_indexes);
+        self.finishMeshDraws();
+    }
+
+    /// Makes the mesh data written since the last draw available to drawMeshIndexes.
+    /// With mapped buffers, the data is already in gpu memory. Otherwise, the mesh is uploaded.
+    pub fn prepareMeshDraws(self: *Renderer) void {
+        if (!self.hasPendingMesh()) {
+            return;
+        }
+        if (self.mesh_ring != null) {
+            // Written once into gpu memory. Staged data is copied over first.
+            self.mesh.flushStaged();
+            const num_verts = self.mesh.cur_vert_buf_size - self.mesh_draw_vert_start;
+            const num_indexes = self.mesh.cur_index_buf_size - self.mesh_draw_start;
+            self.stats.cur_upload_bytes += num_verts * @sizeOf(TexShaderVertex) + num_indexes * @sizeOf(u32);
+            return;
+        }
+        const num_verts = self.mesh.cur_vert_buf_size;
+        const num_indexes = self.mesh.cur_index_buf_size;
+
+        // Update vertex buffer.
+        gl.bindBuffer(gl.GL_ARRAY_BUFFER, self.vert_buf_id);
+        gl.bufferData(gl.GL_ARRAY_BUFFER, @intCast(c_long, num_verts * @sizeOf(TexShaderVertex)), self.mesh.vert_buf.ptr, gl.GL_DYNAMIC_DRAW);
+
+        // Update index buffer.
+        gl.bindBuffer(gl.GL_ELEMENT_ARRAY_BUFFER, self.index_buf_id);
+        gl.bufferData(gl.GL_ELEMENT_ARRAY_BUFFER, @intCast(c_long, num_indexes * @sizeOf(u32)), self.mesh.index_buf.ptr, gl.GL_DYNAMIC_DRAW);
+        self.stats.cur_upload_bytes += num_verts * @sizeOf(TexShaderVertex) + num_indexes * @sizeOf(u32);
+    }
+
+    /// Draws a range of prepared mesh indexes with the currently bound vao.
+    pub fn drawMeshIndexes(self: *Renderer, start: u32, num_indexes: u32) void {
+        gl.bindBuffer(gl.GL_ELEMENT_ARRAY_BUFFER, self.index_buf_id);
+        if (!IsWasm) {
+            if (self.mesh_ring) |ring| {
+                // Mesh indexes are relative to the start of the region.
+                const index_offset = (ring.region * RegionIndexes + start) * @sizeOf(u32);
+                gl.drawElementsBaseVertex(gl.GL_TRIANGLES, num_indexes, self.mesh.index_buffer_type, index_offset, @intCast(gl.GLint, ring.region * RegionVerts));
+                return;
+            }
+        }
+        gl.drawElements(gl.GL_TRIANGLES, num_indexes, self.mesh.index_buffer_type, start * @sizeOf(u32));
+    }
+
+    /// Marks the prepared mesh data as drawn. Without mapped buffers, the mesh is reset.
+    pub fn finishMeshDraws(self: *Renderer) void {
+        if (self.mesh_ring != null) {
+            self.mesh_draw_start = self.mesh.cur_index_buf_size;
+            self.mesh_draw_vert_start = self.mesh.cur_vert_buf_size;
+        } else {
+            self.mesh.reset();
+        }
+    }
+
     pub fn pushTex3D(self: *Renderer, mvp: Mat4, tex_id: TextureId) void {
         const gl_tex_id = self.image_store.getTexture(tex_id).inner.tex_id;
         self.setDepthTest(true);
         self.pipelines.tex.bind(mvp, gl_tex_id);
         gl.bindVertexArray(self.pipelines.tex.shader.vao_id);
-        self.pushCurrentElements();
+        self.drawMesh();
     }
 
     pub fn pushTexWireframe3D(self: *Renderer, mvp: Mat4, tex_id: TextureId) void {
@@ -148,7 +311,7 @@ pub const Renderer = struct {
             self.setDepthTest(true);
             self.pipelines.tex.bind(mvp, gl_tex_id);
             gl.bindVertexArray(self.pipelines.tex.shader.vao_id);
-            self.pushCurrentElements();
+            self.drawMesh();
             gl.polygonMode(gl.GL_FRONT_AND_BACK, gl.GL_FILL);
         }
     }
@@ -158,7 +321,7 @@ pub const Renderer = struct {
         self.setDepthTest(true);
         self.pipelines.tex_pbr.bind(mvp, model, normal, gl_tex_id, mat, light);
         gl.bindVertexArray(self.pipelines.tex_pbr.shader.vao_id);
-        self.pushCurrentElements();
+        self.drawMesh();
     }
 
     pub fn ensurePushMeshData(self: *Renderer, verts: []const TexShaderVertex, indexes: []const u16) void {
@@ -170,27 +333,16 @@ pub const Renderer = struct {
     /// Ensures that the buffer has enough space.
     pub fn ensureUnusedBuffer(self: *Renderer, vert_inc: usize, index_inc: usize) void {
         if (!self.mesh.ensureUnusedBuffer(vert_inc, index_inc)) {
+            if (self.mesh_ring != null and !self.hasPendingMesh()) {
+                // Previous data in the region was already drawn so the rest of the frame continues in the next region.
+                self.nextMeshRegion();
+                return;
+            }
             // Currently, draw calls reset the mesh so data that proceeds the current buffer belongs to the same draw call.
             stdx.panic("buffer limit");
         }
     }
 
-    fn pushCurrentElements(self: *Renderer) void {
-        const num_verts = self.mesh.cur_vert_buf_size;
-        const num_indexes = self.mesh.cur_index_buf_size;
-
-        // Update vertex buffer.
-        gl.bindBuffer(gl.GL_ARRAY_BUFFER, self.vert_buf_id);
-        gl.bufferData(gl.GL_ARRAY_BUFFER, @intCast(c_long, num_verts * @sizeOf(TexShaderVertex)), self.mesh.vert_buf.ptr, gl.GL_DYNAMIC_DRAW);
-
-        // Update index buffer.
-        gl.bindBuffer(gl.GL_ELEMENT_ARRAY_BUFFER, self.index_buf_id);
-        gl.bufferData(gl.GL_ELEMENT_ARRAY_BUFFER, @intCast(c_long, num_indexes * 2), self.mesh.index_buf.ptr, gl.GL_DYNAMIC_DRAW);
-
-        gl.drawElements(gl.GL_TRIANGLES, num_indexes, self.mesh.index_buffer_type, 0);
-        self.mesh.reset();
-    }
-
     pub fn setDepthTest(self: *Renderer, depth_test: bool) void {
         if (self.depth_test == depth_test) {
             return;
@@ -218,14 +370,25 @@ pub const Renderer = struct {
 
 pub const Pipelines = struct {
     tex: shaders.TexShader,
+    sdf: shaders.TexShader,
     gradient: shaders.GradientShader,
     plane: shaders.PlaneShader,
     tex_pbr: shaders.TexPbrShader,
 
     pub fn deinit(self: Pipelines) void {
         self.tex.deinit();
+        self.sdf.deinit();
         self.tex_pbr.deinit();
         self.gradient.deinit();
         self.plane.deinit();
     }
-};
\ No newline at end of file
+};
+
+/// Persistently mapped vertex and index buffers split into regions with a fence for each.
+const MeshRing = struct {
+    verts: []TexShaderVertex,
+    indexes: []u32,
+    /// Signaled once the gpu is done with the draws that read from the region.
+    fences: [NumMeshRegions]gl.GLsync,
+    region: u32,
+};
@@ -21,6 +21,9 @@ const tex_frag = @embedFile("shaders/tex_frag.glsl");
 const tex_vert_webgl2 = @embedFile("shaders/tex_vert_webgl2.glsl");
 const tex_frag_webgl2 = @embedFile("shaders/tex_frag_webgl2.glsl");
 
+const sdf_frag = @embedFile("shaders/sdf_frag.glsl");
+const sdf_frag_webgl2 = @embedFile("shaders/sdf_frag_webgl2.glsl");
+
 const tex_pbr_vert = @embedFile("shaders/tex_pbr_vert.glsl");
 const tex_pbr_frag = @embedFile("shaders/tex_pbr_frag.glsl");
 
@@ -180,16 +183,44 @@ pub const TexShader = struct {
     u_tex: gl.GLint,
 
     pub fn init(vert_buf_id: gl.GLuint) !TexShader {
+        if (IsWasm) {
+            return initWithFrag(vert_buf_id, tex_frag_webgl2);
+        } else {
+            return initWithFrag(vert_buf_id, tex_frag);
+        }
+    }
+
+    /// Same inputs as the tex shader but the texture alpha is decoded as a signed distance field.
+    pub fn initSdf(vert_buf_id: gl.GLuint) !TexShader {
+        if (IsWasm) {
+            return initWithFrag(vert_buf_id, sdf_frag_webgl2);
+        } else {
+            return initWithFrag(vert_buf_id, sdf_frag);
+        }
+    }
+
+    fn initWithFrag(vert_buf_id: gl.GLuint, frag_src: []const u8) !TexShader {
         var shader: Shader = undefined;
         if (IsWasm) {
-            shader = Shader.init(tex_vert_webgl2, tex_frag_webgl2) catch unreachable;
+            shader = Shader.init(tex_vert_webgl2, frag_src) catch unreachable;
         } else {
-            shader = Shader.init(tex_vert, tex_frag) catch unreachable;
+            shader = Shader.init(tex_vert, frag_src) catch unreachable;
         }
 
         gl.bindVertexArray(shader.vao_id);
         defer gl.bindVertexArray(0);
+        bindVertexAttributes(vert_buf_id);
+
+        return TexShader{
+            .shader = shader,
+            .u_mvp = try shader.getUniformLocation("u_mvp"),
+            .u_tex = try shader.getUniformLocation("u_tex"),
+        };
+    }
 
+    /// Records the vertex layout for a vertex buffer into the currently bound vertex array.
+    /// Used for vertex buffers that are not owned by the renderer.
+    pub fn bindVertexAttributes(vert_buf_id: gl.GLuint) void {
         gl.bindBuffer(gl.GL_ARRAY_BUFFER, vert_buf_id);
         bindAttributes(@sizeOf(TexShaderVertex), &.{
             // a_pos
@@ -199,12 +230,6 @@ pub const TexShader = struct {
             // a_color
             ShaderAttribute.init(2, @offsetOf(TexShaderVertex, "color"), gl.GL_FLOAT, 4),
         });
-
-        return TexShader{
-            .shader = shader,
-            .u_mvp = try shader.getUniformLocation("u_mvp"),
-            .u_tex = try shader.getUniformLocation("u_tex"),
-        };
     }
 
     pub fn deinit(self: TexShader) void {
@@ -0,0 +1,19 @@
+#version 330
+
+uniform sampler2D u_tex;
+
+in vec2 v_uv;
+in vec4 v_color;
+
+out vec4 f_color;
+
+// Matches sdf.OnEdgeValue.
+const float edge = 128.0 / 255.0;
+
+void main() {
+    float dist = texture(u_tex, v_uv).a;
+    // Keeps the anti-aliased edge about one screen pixel wide at any scale.
+    float w = fwidth(dist) * 0.7;
+    float alpha = smoothstep(edge - w, edge + w, dist);
+    f_color = vec4(v_color.rgb, v_color.a * alpha);
+}
\ No newline at end of file
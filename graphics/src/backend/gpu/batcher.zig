@@ -3,6 +3,7 @@ const Backend = @import("graphics_options").GraphicsBackend;
 const builtin = @import("builtin");
 const IsWasm = builtin.target.isWasm();
 const stdx = @import("stdx");
+const t = stdx.testing;
 const fatal = stdx.fatal;
 const unsupported = stdx.unsupported;
 const ds = stdx.ds;
@@ -25,10 +26,14 @@ const Color = graphics.Color;
 const mesh = @import("mesh.zig");
 const VertexData = mesh.VertexData;
 const Mesh = mesh.Mesh;
+const RetainedDrawList = @import("retained.zig").RetainedDrawList;
 const log = stdx.log.scoped(.batcher);
 
 const NullId = std.math.maxInt(u32);
 
+/// How many groups back a deferred batch looks for one with the same state.
+const MaxMergeSearch = 64;
+
 /// Initial buffer sizes
 pub const MatBufferInitialSize = 5000;
 pub const MatBufferInitialSizeBytes = MatBufferInitialSize * @sizeOf(stdx.math.Mat4);
@@ -46,6 +51,7 @@ const ShaderType = enum(u4) {
     Normal = 7,
     TexPbr3D = 8,
     AnimPbr3D = 9,
+    Sdf = 10,
 };
 
 const PreFlushTask = struct {
@@ -62,14 +68,25 @@ const VkFrame = struct {
 /// Batcher is responsible for:
 /// 1. Pushing various vertex/index data formats into a mesh buffer. 
 /// 2. Automatically ending the current batch command when necessary. eg. Change to shader, texture, mvp, or reaching a buffer limit.
+/// 3. In deferred mode, 2D batches ended by a state change are recorded instead of drawn. At the next flush, they are grouped by state
+///    and batches with the same state are merged into one draw call. A batch only moves ahead of batches it doesn't overlap so the result is the same.
+/// 4. Copying the 2D geometry pushed between beginRecording and endRecording into a DrawRecording that can be replayed later.
 pub const Batcher = struct {
     pre_flush_tasks: std.ArrayList(PreFlushTask),
 
     mesh: *Mesh,
+    /// Recorded batches in submission order until they are drawn.
     cmds: std.ArrayList(DrawCmd),
+    cmd_groups: std.ArrayList(DrawCmdGroup),
+    deferred: bool,
     cmd_vert_start_idx: u32,
     cmd_index_start_idx: u32,
 
+    /// The active recording. Mesh data after the marks hasn't been copied into it yet.
+    recording: ?*DrawRecording,
+    rec_vert_mark: u32,
+    rec_index_mark: u32,
+
     /// Model view projection is kept until flush time to reduce redundant uniform uploads.
     mvp: Transform,
 
@@ -105,8 +122,11 @@ pub const Batcher = struct {
             mats_desc_set: vk.VkDescriptorSet,
             batcher_frames: []VkFrame,
             cur_batcher_frame: VkFrame,
+            /// Mapped vertex and index buffers with a region for each frame in flight. The mesh writes directly into the current frame's region.
             host_vert_buf: []TexShaderVertex,
-            host_index_buf: []u16,
+            host_index_buf: []u32,
+            vert_region_offset: vk.VkDeviceSize,
+            index_region_offset: vk.VkDeviceSize,
             host_mats_buf: []stdx.math.Mat4,
             host_materials_buf: []graphics.Material,
             do_shadow_pass: bool,
@@ -134,8 +154,13 @@ pub const Batcher = struct {
         var new = Batcher{
             .mesh = &renderer.mesh,
             .cmds = std.ArrayList(DrawCmd).init(alloc),
+            .cmd_groups = std.ArrayList(DrawCmdGroup).init(alloc),
+            .deferred = false,
             .cmd_vert_start_idx = 0,
             .cmd_index_start_idx = 0,
+            .recording = null,
+            .rec_vert_mark = 0,
+            .rec_index_mark = 0,
             .inner = .{
                 .renderer = renderer,
                 .cur_gl_tex_id = undefined,
@@ -170,13 +195,19 @@ pub const Batcher = struct {
         vk_ctx: gvk.VkContext,
         renderer: *gvk.Renderer,
         pipelines: gvk.Pipelines,
-        image_store: *graphics.gpu.ImageStore
+        image_store: *graphics.gpu.ImageStore,
+        stats: *graphics.FrameStats,
     ) !void {
         new.* = .{
             .mesh = undefined,
             .cmds = std.ArrayList(DrawCmd).init(alloc),
+            .cmd_groups = std.ArrayList(DrawCmdGroup).init(alloc),
+            .deferred = false,
             .cmd_vert_start_idx = 0,
             .cmd_index_start_idx = 0,
+            .recording = null,
+            .rec_vert_mark = 0,
+            .rec_index_mark = 0,
             .pre_flush_tasks = std.ArrayList(PreFlushTask).init(alloc),
             .mvp = undefined,
             .normal = undefined,
@@ -208,12 +239,15 @@ pub const Batcher = struct {
                 .cur_tex_desc_set = undefined,
                 .host_vert_buf = undefined,
                 .host_index_buf = undefined,
+                .vert_region_offset = 0,
+                .index_region_offset = 0,
                 .host_mats_buf = undefined,
                 .host_materials_buf = undefined,
                 .do_shadow_pass = false,
                 .light_cast_vp = undefined,
             },
             .image_store = image_store,
+            .stats = stats,
         };
 
         var host_vert_buf: [*]TexShaderVertex = undefined;
@@ -221,10 +255,10 @@ pub const Batcher = struct {
         vk.assertSuccess(res);
         new.inner.host_vert_buf = host_vert_buf[0..new.inner.vert_buf.size/@sizeOf(TexShaderVertex)];
 
-        var host_index_buf: [*]u16 = undefined;
+        var host_index_buf: [*]u32 = undefined;
         res = vk.mapMemory(new.inner.ctx.device, new.inner.index_buf.mem, 0, new.inner.index_buf.size, 0, @ptrCast([*c]?*anyopaque, &host_index_buf));
         vk.assertSuccess(res);
-        new.inner.host_index_buf = host_index_buf[0..new.inner.index_buf.size/@sizeOf(u16)];
+        new.inner.host_index_buf = host_index_buf[0..new.inner.index_buf.size/@sizeOf(u32)];
 
         var host_mats_buf: [*]stdx.math.Mat4 = undefined;
         res = vk.mapMemory(new.inner.ctx.device, new.inner.mats_buf.mem, 0, new.inner.mats_buf.size, 0, @ptrCast([*c]?*anyopaque, &host_mats_buf));
@@ -251,6 +285,7 @@ pub const Batcher = struct {
     pub fn deinit(self: Batcher, alloc: std.mem.Allocator) void {
         self.pre_flush_tasks.deinit();
         self.cmds.deinit();
+        self.cmd_groups.deinit();
 
         switch (Backend) {
             .Vulkan => {
@@ -278,7 +313,7 @@ pub const Batcher = struct {
     /// Begins the tex shader. Will flush previous batched command.
     pub fn beginTex(self: *Batcher, image: ImageTex) void {
         if (self.cur_shader_type != .Tex) {
-            self.endCmd();
+            self.endBatch();
             self.cur_shader_type = .Tex;
             self.setTexture(image);
             return;
@@ -286,6 +321,25 @@ pub const Batcher = struct {
         self.setTexture(image);
     }
 
+    /// Begins the sdf glyph shader. Will flush previous batched command.
+    pub fn beginSdf(self: *Batcher, image: ImageTex) void {
+        if (self.cur_shader_type != .Sdf) {
+            self.endBatch();
+            self.cur_shader_type = .Sdf;
+            self.setTexture(image);
+            return;
+        }
+        self.setTexture(image);
+    }
+
+    /// Returns to the tex shader after sdf glyphs since most draw calls only set the texture.
+    pub fn endSdf(self: *Batcher) void {
+        if (self.cur_shader_type == .Sdf) {
+            self.endBatch();
+            self.cur_shader_type = .Tex;
+        }
+    }
+
     pub fn beginNormal(self: *Batcher) void {
         if (self.cur_shader_type != .Normal) {
             self.endCmd();
@@ -356,7 +410,7 @@ pub const Batcher = struct {
     /// Begins the gradient shader. Will flush previous batched command.
     pub fn beginGradient(self: *Batcher, start_pos: Vec2, start_color: Color, end_pos: Vec2, end_color: Color) void {
         // Always flush the previous.
-        self.endCmd();
+        self.endBatch();
         self.start_pos = start_pos;
         self.start_color = start_color;
         self.end_pos = end_pos;
@@ -371,7 +425,7 @@ pub const Batcher = struct {
 
     inline fn setTexture(self: *Batcher, image: ImageTex) void {
         if (self.cur_image_tex.tex_id != image.tex_id) {
-            self.endCmd();
+            self.endBatch();
             self.cur_image_tex = image;
             switch (Backend) {
                 .OpenGL => {
@@ -391,7 +445,7 @@ pub const Batcher = struct {
         self.cmd_vert_start_idx = 0;
         self.cmd_index_start_idx = 0;
         self.inner.cur_gl_tex_id = self.image_store.getTexture(tex.tex_id).inner.tex_id;
-        self.mesh.reset();
+        self.inner.renderer.beginMeshFrame();
     }
 
     pub fn resetStateVK(self: *Batcher, image_tex: ImageTex, frame_idx: u8, framebuffer: vk.VkFramebuffer, clear_color: Color) void {
@@ -406,6 +460,13 @@ pub const Batcher = struct {
         self.cmd_index_start_idx = 0;
         self.mesh.reset();
 
+        // The swapchain already waited on this frame's fence so the gpu is done reading the region.
+        const region_verts = self.inner.host_vert_buf.len / gvk.MaxActiveFrames;
+        const region_indexes = self.inner.host_index_buf.len / gvk.MaxActiveFrames;
+        self.mesh.setMappedBuffers(self.inner.host_vert_buf[frame_idx * region_verts..][0..region_verts], self.inner.host_index_buf[frame_idx * region_indexes..][0..region_indexes]);
+        self.inner.vert_region_offset = frame_idx * region_verts * @sizeOf(TexShaderVertex);
+        self.inner.index_region_offset = frame_idx * region_indexes * @sizeOf(u32);
+
         // Push the identity matrix onto index 0 for draw calls that don't need a model matrix.
         self.mesh.pushMatrix(Transform.initIdentity().mat);
 
@@ -437,9 +498,12 @@ pub const Batcher = struct {
         //     0, 0, null, 0, null, 1, &barrier);
         gvk.command.beginRenderPass(cmd_buf, self.inner.renderer.main_pass, framebuffer, self.inner.renderer.fb_size.width, self.inner.renderer.fb_size.height, clear_color);
 
-        var offset: vk.VkDeviceSize = 0;
-        vk.cmdBindVertexBuffers(cmd_buf, 0, 1, &self.inner.vert_buf.buf, &offset);
-        vk.cmdBindIndexBuffer(cmd_buf, self.inner.index_buf.buf, 0, vk.VK_INDEX_TYPE_UINT16);
+        self.bindMeshBuffersVK(cmd_buf);
+    }
+
+    fn bindMeshBuffersVK(self: *Batcher, cmd_buf: vk.VkCommandBuffer) void {
+        vk.cmdBindVertexBuffers(cmd_buf, 0, 1, &self.inner.vert_buf.buf, &self.inner.vert_region_offset);
+        vk.cmdBindIndexBuffer(cmd_buf, self.inner.index_buf.buf, self.inner.index_region_offset, vk.VK_INDEX_TYPE_UINT32);
     }
 
     /// Must be called before draw calls are recorded for the shadow pass.
@@ -454,9 +518,7 @@ pub const Batcher = struct {
                 gvk.command.beginCommandBuffer(shadow_cmd);
                 gvk.command.beginRenderPass(shadow_cmd, self.inner.renderer.shadow_pass, self.inner.cur_frame.shadow_framebuffer, gvk.Renderer.ShadowMapSize, gvk.Renderer.ShadowMapSize, null);
 
-                var offset: vk.VkDeviceSize = 0;
-                vk.cmdBindVertexBuffers(shadow_cmd, 0, 1, &self.inner.vert_buf.buf, &offset);
-                vk.cmdBindIndexBuffer(shadow_cmd, self.inner.index_buf.buf, 0, vk.VK_INDEX_TYPE_UINT16);
+                self.bindMeshBuffersVK(shadow_cmd);
 
                 const vk_rect = vk.VkRect2D{
                     .offset = .{
@@ -491,23 +553,16 @@ pub const Batcher = struct {
             self.inner.cur_batcher_frame.host_cam_buf.enable_shadows = false;
         }
 
-        // Send all the mesh data at once.
-
-        // TODO: This should work with zero copy if mesh is aware of the buffer pointer.
-        // TODO: Buffer should be reallocated if it's not big enough.
-        // TODO: The buffers should be large enough to hold 2 frames worth of data and writing data should use an offset from the previous frame.
-        // Copy vertex buffer.
-        std.mem.copy(TexShaderVertex, self.inner.host_vert_buf[0..self.mesh.cur_vert_buf_size], self.mesh.vert_buf[0..self.mesh.cur_vert_buf_size]);
-
-        // Copy index buffer.
-        std.mem.copy(u16, self.inner.host_index_buf[0..self.mesh.cur_index_buf_size], self.mesh.index_buf[0..self.mesh.cur_index_buf_size]);
+        self.mesh.flushStaged();
+        // The mesh was written directly into the frame's region of the mapped buffers.
+        self.stats.cur_upload_bytes += self.mesh.cur_vert_buf_size * @sizeOf(TexShaderVertex) + self.mesh.cur_index_buf_size * @sizeOf(u32);
 
         return res;
     }
 
     pub fn beginMvp(self: *Batcher, mvp: Transform) void {
         // Always flush the previous.
-        self.endCmd();
+        self.endBatch();
         self.mvp = mvp;
     }
 
@@ -515,6 +570,23 @@ pub const Batcher = struct {
     pub fn ensureUnusedBuffer(self: *Batcher, vert_inc: usize, index_inc: usize) void {
         if (!self.mesh.ensureUnusedBuffer(vert_inc, index_inc)) {
             self.endCmdForce();
+            switch (Backend) {
+                .OpenGL => {
+                    if (self.inner.renderer.mesh_ring != null) {
+                        // The frame outgrew its region.
+                        self.inner.renderer.nextMeshRegion();
+                        self.cmd_vert_start_idx = 0;
+                        self.cmd_index_start_idx = 0;
+                        self.rec_vert_mark = 0;
+                        self.rec_index_mark = 0;
+                    }
+                },
+                .Vulkan => {
+                    // The other regions belong to frames in flight.
+                    stdx.panicFmt("frame exceeds mesh region: {} verts, {} indexes", .{ self.mesh.vert_buf.len, self.mesh.index_buf.len });
+                },
+                else => {},
+            }
         }
     }
 
@@ -560,6 +632,8 @@ pub const Batcher = struct {
     }
 
     pub fn endCmdForce(self: *Batcher) void {
+        self.recordPendingDraws();
+
         // Run pre flush callbacks.
         if (self.pre_flush_tasks.items.len > 0) {
             for (self.pre_flush_tasks.items) |it| {
@@ -568,28 +642,304 @@ pub const Batcher = struct {
             self.pre_flush_tasks.clearRetainingCapacity();
         }
 
-        self.pushDrawCall();
-        switch (Backend) {
-            .OpenGL => {
-                self.mesh.reset();
-            },
-            .Vulkan => {
-                self.cmd_vert_start_idx = self.mesh.cur_vert_buf_size;
-                self.cmd_index_start_idx = self.mesh.cur_index_buf_size;
-            },
-            else => {},
+        const start = self.getCmdIndexStart();
+        const end = self.mesh.cur_index_buf_size;
+        const defer_cmd = self.deferred and isDeferrable(self.cur_shader_type);
+        if (defer_cmd and end > start) {
+            self.recordCmd(start, end);
+        }
+        if (self.cmds.items.len > 0) {
+            // Merging appends indexes so it's done before the mesh is prepared.
+            mergeDrawCmds(&self.cmds, &self.cmd_groups, self.mesh);
+        }
+        self.mesh.flushStaged();
+        if (Backend == .OpenGL) {
+            self.inner.renderer.prepareMeshDraws();
         }
+        if (self.cmds.items.len > 0) {
+            self.drawCmds();
+        }
+        if (!defer_cmd and end > start) {
+            self.stats.cur_batches += 1;
+            self.pushDrawCall(start, end - start);
+        }
+        if (Backend == .OpenGL) {
+            // Without mapped buffers, OpenGL resets the mesh after the draws.
+            self.inner.renderer.finishMeshDraws();
+        }
+        self.cmd_vert_start_idx = self.mesh.cur_vert_buf_size;
+        self.cmd_index_start_idx = self.mesh.cur_index_buf_size;
+        self.rec_vert_mark = self.mesh.cur_vert_buf_size;
+        self.rec_index_mark = self.mesh.cur_index_buf_size;
+        self.mesh.resetBounds();
     }
 
+    /// Flushes before a state change the batcher doesn't track. eg. Clipping or blending.
+    /// An active recording can't replay that state so it becomes invalid.
     pub fn endCmd(self: *Batcher) void {
-        if (self.mesh.cur_index_buf_size > self.cmd_index_start_idx) {
+        if (self.recording) |rec| {
+            rec.valid = false;
+        }
+        self.flushCmd();
+    }
+
+    fn flushCmd(self: *Batcher) void {
+        if (self.mesh.cur_index_buf_size > self.getCmdIndexStart() or self.cmds.items.len > 0) {
             self.endCmdForce();
         }
     }
 
+    /// Ends the current batch because of a state change.
+    /// In deferred mode, 2D batches are recorded and drawn at the next flush. Otherwise, the batch is flushed.
+    fn endBatch(self: *Batcher) void {
+        self.recordPendingDraws();
+        if (self.deferred and isDeferrable(self.cur_shader_type)) {
+            const start = self.getCmdIndexStart();
+            if (self.mesh.cur_index_buf_size > start) {
+                self.recordCmd(start, self.mesh.cur_index_buf_size);
+                self.cmd_vert_start_idx = self.mesh.cur_vert_buf_size;
+                self.cmd_index_start_idx = self.mesh.cur_index_buf_size;
+                self.mesh.resetBounds();
+            }
+        } else {
+            self.flushCmd();
+        }
+    }
+
+    /// Batches are only deferred until the next flush. Clipping, retained lists, 3D draws and the end of a frame all flush.
+    pub fn setDeferred(self: *Batcher, deferred: bool) void {
+        if (self.deferred != deferred) {
+            self.endCmd();
+            self.deferred = deferred;
+            self.updateMeshStaging();
+        }
+    }
+
+    /// Merging deferred batches and recording read back mesh data so mapped buffers are written through host buffers.
+    fn updateMeshStaging(self: *Batcher) void {
+        self.mesh.setStaging(self.deferred or self.recording != null);
+    }
+
+    /// Starts copying the 2D geometry pushed into the mesh into the recording. The recording is cleared first.
+    pub fn beginRecording(self: *Batcher, rec: *DrawRecording) void {
+        rec.reset();
+        rec.mvp = self.mvp;
+        self.resumeRecording(rec);
+    }
+
+    /// Continues a recording that was ended. Draws in between are left out.
+    pub fn resumeRecording(self: *Batcher, rec: *DrawRecording) void {
+        if (!std.mem.eql(f32, &self.mvp.mat, &rec.mvp.mat)) {
+            rec.valid = false;
+        }
+        self.recording = rec;
+        self.rec_vert_mark = self.mesh.cur_vert_buf_size;
+        self.rec_index_mark = self.mesh.cur_index_buf_size;
+        self.updateMeshStaging();
+    }
+
+    pub fn endRecording(self: *Batcher) void {
+        self.recordPendingDraws();
+        self.recording = null;
+        self.updateMeshStaging();
+    }
+
+    /// Copies the mesh data pushed since the marks into the active recording as one batch with the current state.
+    /// Called before the state changes or the mesh is flushed.
+    /// The mesh is staging while recording so this reads from host memory even if the mesh buffers are mapped.
+    fn recordPendingDraws(self: *Batcher) void {
+        const rec = self.recording orelse return;
+        const vert_end = self.mesh.cur_vert_buf_size;
+        const index_end = self.mesh.cur_index_buf_size;
+        defer {
+            self.rec_vert_mark = vert_end;
+            self.rec_index_mark = index_end;
+        }
+        if (!rec.valid or index_end <= self.rec_index_mark) {
+            return;
+        }
+        // Vertices are replayed under the transform at that time.
+        if (!isDeferrable(self.cur_shader_type) or !std.mem.eql(f32, &self.mvp.mat, &rec.mvp.mat)) {
+            rec.valid = false;
+            return;
+        }
+        const vert_start = @intCast(u32, rec.verts.items.len);
+        const idx_start = @intCast(u32, rec.idxes.items.len);
+        rec.verts.appendSlice(rec.alloc, self.mesh.vert_buf[self.rec_vert_mark..vert_end]) catch fatal();
+        rec.idxes.ensureUnusedCapacity(rec.alloc, index_end - self.rec_index_mark) catch fatal();
+        for (self.mesh.index_buf[self.rec_index_mark..index_end]) |idx| {
+            if (idx < self.rec_vert_mark) {
+                // Refers to a vertex pushed before the recording.
+                rec.valid = false;
+                return;
+            }
+            rec.idxes.appendAssumeCapacity(idx - self.rec_vert_mark);
+        }
+        rec.batches.append(rec.alloc, .{
+            .state = self.getCmdState(0, 0),
+            .vert_start = vert_start,
+            .vert_end = @intCast(u32, rec.verts.items.len),
+            .idx_start = idx_start,
+            .idx_end = @intCast(u32, rec.idxes.items.len),
+        }) catch fatal();
+    }
+
+    /// Pushes the recorded batches in [batch_start, batch_end) under the current transform.
+    /// The state is left at the last replayed batch since draws always begin their own state.
+    pub fn replayRecording(self: *Batcher, rec: *const DrawRecording, batch_start: u32, batch_end: u32) void {
+        for (rec.batches.items[batch_start..batch_end]) |batch| {
+            var state = batch.state;
+            state.mvp = self.mvp;
+            if (!self.getCmdState(0, 0).hasSameState(state)) {
+                self.endBatch();
+                self.setCmdState(state);
+            }
+            const verts = rec.verts.items[batch.vert_start..batch.vert_end];
+            const idxes = rec.idxes.items[batch.idx_start..batch.idx_end];
+            self.ensureUnusedBuffer(verts.len, idxes.len);
+            const first_vert = self.mesh.pushVertexes(verts);
+            self.mesh.pushDeltaIndexes(first_vert, idxes);
+        }
+    }
+
+    /// First index of the current batch.
+    fn getCmdIndexStart(self: Batcher) u32 {
+        if (self.cmds.items.len > 0) {
+            return self.cmds.items[self.cmds.items.len - 1].index_end;
+        }
+        return switch (Backend) {
+            // The renderer also draws from the mesh for 3D.
+            .OpenGL => self.inner.renderer.mesh_draw_start,
+            else => self.cmd_index_start_idx,
+        };
+    }
+
+    /// Only the 2D shaders are deferred. The rest depend on depth testing or the shadow pass.
+    fn isDeferrable(shader_type: ShaderType) bool {
+        return switch (shader_type) {
+            .Tex, .Sdf, .Gradient => true,
+            else => false,
+        };
+    }
+
+    fn getCmdState(self: Batcher, index_start: u32, index_end: u32) DrawCmd {
+        return .{
+            .shader_type = self.cur_shader_type,
+            .image_tex = self.cur_image_tex,
+            .mvp = self.mvp,
+            .start_pos = self.start_pos,
+            .start_color = self.start_color,
+            .end_pos = self.end_pos,
+            .end_color = self.end_color,
+            .index_start = index_start,
+            .index_end = index_end,
+            .bounds = undefined,
+            .group = undefined,
+        };
+    }
+
+    fn setCmdState(self: *Batcher, cmd: DrawCmd) void {
+        self.cur_shader_type = cmd.shader_type;
+        self.mvp = cmd.mvp;
+        self.start_pos = cmd.start_pos;
+        self.start_color = cmd.start_color;
+        self.end_pos = cmd.end_pos;
+        self.end_color = cmd.end_color;
+        if (self.cur_image_tex.tex_id != cmd.image_tex.tex_id) {
+            self.cur_image_tex = cmd.image_tex;
+            switch (Backend) {
+                .OpenGL => {
+                    self.inner.cur_gl_tex_id = self.image_store.getTexture(cmd.image_tex.tex_id).inner.tex_id;
+                },
+                .Vulkan => {
+                    self.inner.cur_tex_desc_set = self.image_store.getTexture(cmd.image_tex.tex_id).inner.desc_set;
+                },
+                else => {},
+            }
+        }
+    }
+
+    /// Records the batch with the bounds of the vertices pushed since the batch began.
+    fn recordCmd(self: *Batcher, index_start: u32, index_end: u32) void {
+        var cmd = self.getCmdState(index_start, index_end);
+        if (self.mesh.getBounds()) |local| {
+            cmd.bounds = transformBounds(self.mvp, local);
+        } else {
+            // Indexes only refer to earlier vertices. Overlap everything so the batch keeps its order.
+            cmd.bounds = stdx.math.BBox.init(-std.math.inf(f32), -std.math.inf(f32), std.math.inf(f32), std.math.inf(f32));
+        }
+        self.stats.cur_batches += 1;
+        groupDrawCmd(&self.cmds, &self.cmd_groups, cmd);
+    }
+
+    fn drawCmds(self: *Batcher) void {
+        const cur = self.getCmdState(0, 0);
+        for (self.cmds.items) |cmd| {
+            self.setCmdState(cmd);
+            self.pushDrawCall(cmd.index_start, cmd.index_end - cmd.index_start);
+        }
+        self.cmds.clearRetainingCapacity();
+        self.setCmdState(cur);
+    }
+
+    /// Draws buffers that are already on the GPU with the current mvp.
+    /// Pending batched data is flushed first to preserve draw order.
+    pub fn drawRetainedList(self: *Batcher, list: RetainedDrawList) void {
+        self.endCmd();
+        switch (Backend) {
+            .OpenGL => {
+                self.inner.renderer.setDepthTest(false);
+                gl.bindVertexArray(list.inner.vao_id);
+                for (list.batches) |batch| {
+                    const gl_tex_id = self.image_store.getTexture(batch.image_tex.tex_id).inner.tex_id;
+                    self.inner.renderer.pipelines.tex.bind(self.mvp.mat, gl_tex_id);
+                    const num_indexes = batch.idx_end - batch.idx_start;
+                    self.stats.cur_triangles += @divExact(num_indexes, 3);
+                    self.stats.cur_draw_calls += 1;
+                    self.stats.cur_batches += 1;
+                    gl.drawElements(gl.GL_TRIANGLES, num_indexes, gl.GL_UNSIGNED_INT, batch.idx_start * @sizeOf(u32));
+                }
+                gl.bindVertexArray(0);
+            },
+            .Vulkan => {
+                const cmd_buf = self.inner.cur_frame.main_cmd_buf;
+                var offset: vk.VkDeviceSize = 0;
+                vk.cmdBindVertexBuffers(cmd_buf, 0, 1, &list.inner.vert_buf.buf, &offset);
+                vk.cmdBindIndexBuffer(cmd_buf, list.inner.index_buf.buf, 0, vk.VK_INDEX_TYPE_UINT32);
+
+                const pipeline = self.inner.pipelines.tex_pipeline_2d;
+                vk.cmdBindPipeline(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+                var push_const = gvk.ModelVertexConstant{
+                    .vp = self.mvp.mat,
+                    .model_idx = 0,
+                };
+                vk.cmdPushConstants(cmd_buf, pipeline.layout, vk.VK_SHADER_STAGE_VERTEX_BIT, 0, @sizeOf(gvk.ModelVertexConstant), &push_const);
+                for (list.batches) |batch| {
+                    const desc_sets = [_]vk.VkDescriptorSet{
+                        self.image_store.getTexture(batch.image_tex.tex_id).inner.desc_set,
+                        self.inner.mats_desc_set,
+                    };
+                    vk.cmdBindDescriptorSets(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, desc_sets.len, &desc_sets, 0, null);
+                    const num_indexes = batch.idx_end - batch.idx_start;
+                    self.stats.cur_triangles += @divExact(num_indexes, 3);
+                    self.stats.cur_draw_calls += 1;
+                    self.stats.cur_batches += 1;
+                    vk.cmdDrawIndexed(cmd_buf, num_indexes, 1, batch.idx_start, 0, 0);
+                }
+
+                // Restore the batcher's buffers.
+                self.bindMeshBuffersVK(cmd_buf);
+            },
+            else => unsupported(),
+        }
+    }
+
+    /// Draws a range of mesh indexes with the current state.
     /// OpenGL immediately flushes with drawElements.
     /// Vulkan records the draw command, flushed by endFrameVK.
-    fn pushDrawCall(self: *Batcher) void {
+    fn pushDrawCall(self: *Batcher, index_start: u32, num_indexes: u32) void {
+        self.stats.cur_draw_calls += 1;
+        self.stats.cur_triangles += @divExact(num_indexes, 3);
         switch (Backend) {
             .OpenGL => {
                 switch (self.cur_shader_type) {
@@ -607,6 +957,11 @@ pub const Batcher = struct {
                         // Recall how to pull data from the buffer for shader.
                         gl.bindVertexArray(self.inner.renderer.pipelines.tex.shader.vao_id);
                     },
+                    .Sdf => {
+                        self.inner.renderer.setDepthTest(false);
+                        self.inner.renderer.pipelines.sdf.bind(self.mvp.mat, self.inner.cur_gl_tex_id);
+                        gl.bindVertexArray(self.inner.renderer.pipelines.sdf.shader.vao_id);
+                    },
                     .Gradient => {
                         self.inner.renderer.setDepthTest(false);
                         self.inner.renderer.pipelines.gradient.bind(self.mvp.mat, self.start_pos, self.start_color, self.end_pos, self.end_color);
@@ -619,23 +974,10 @@ pub const Batcher = struct {
                     .Custom => unsupported(),
                 }
 
-                const num_verts = self.mesh.cur_vert_buf_size;
-                const num_indexes = self.mesh.cur_index_buf_size;
-
-                // Update vertex buffer.
-                gl.bindBuffer(gl.GL_ARRAY_BUFFER, self.inner.renderer.vert_buf_id);
-                gl.bufferData(gl.GL_ARRAY_BUFFER, @intCast(c_long, num_verts * @sizeOf(TexShaderVertex)), self.mesh.vert_buf.ptr, gl.GL_DYNAMIC_DRAW);
-
-                // Update index buffer.
-                gl.bindBuffer(gl.GL_ELEMENT_ARRAY_BUFFER, self.inner.renderer.index_buf_id);
-                gl.bufferData(gl.GL_ELEMENT_ARRAY_BUFFER, @intCast(c_long, num_indexes * @sizeOf(u32)), self.mesh.index_buf.ptr, gl.GL_DYNAMIC_DRAW);
-
-                self.stats.cur_triangles += @divExact(num_indexes, 3);
-                gl.drawElements(gl.GL_TRIANGLES, num_indexes, self.mesh.index_buffer_type, 0);
+                self.inner.renderer.drawMeshIndexes(index_start, num_indexes);
             },
             .Vulkan => {
                 const cmd_buf = self.inner.cur_frame.main_cmd_buf;
-                const num_indexes = self.mesh.cur_index_buf_size - self.cmd_index_start_idx;
                 switch (self.cur_shader_type) {
                     .Tex3D => {
                         const pipeline = self.inner.pipelines.tex_pipeline;
@@ -668,7 +1010,7 @@ pub const Batcher = struct {
                                 .model_idx = self.model_idx,
                             };
                             vk.cmdPushConstants(shadow_cmd, shadow_p.layout, vk.VK_SHADER_STAGE_VERTEX_BIT, 0, @sizeOf(gvk.ShadowVertexConstant), &push_const);
-                            vk.cmdDrawIndexed(shadow_cmd, num_indexes, 1, self.cmd_index_start_idx, 0, 0);
+                            vk.cmdDrawIndexed(shadow_cmd, num_indexes, 1, index_start, 0, 0);
                         }
                         const pipeline = self.inner.pipelines.tex_pbr_pipeline;
                         vk.cmdBindPipeline(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
@@ -705,7 +1047,7 @@ pub const Batcher = struct {
                                 .model_idx = self.model_idx,
                             };
                             vk.cmdPushConstants(shadow_cmd, shadow_p.layout, vk.VK_SHADER_STAGE_VERTEX_BIT, 0, @sizeOf(gvk.ShadowVertexConstant), &push_const);
-                            vk.cmdDrawIndexed(shadow_cmd, num_indexes, 1, self.cmd_index_start_idx, 0, 0);
+                            vk.cmdDrawIndexed(shadow_cmd, num_indexes, 1, index_start, 0, 0);
                         }
                         const pipeline = self.inner.pipelines.anim_pbr_pipeline;
                         vk.cmdBindPipeline(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
@@ -757,8 +1099,8 @@ pub const Batcher = struct {
                         vk.cmdBindPipeline(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
                         vk.cmdPushConstants(cmd_buf, pipeline.layout, vk.VK_SHADER_STAGE_VERTEX_BIT, 0, 16 * 4, &self.mvp.mat);
                     },
-                    .Tex => {
-                        const pipeline = self.inner.pipelines.tex_pipeline_2d;
+                    .Tex, .Sdf => {
+                        const pipeline = if (self.cur_shader_type == .Tex) self.inner.pipelines.tex_pipeline_2d else self.inner.pipelines.sdf_pipeline_2d;
                         vk.cmdBindPipeline(cmd_buf, vk.VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
                         const desc_sets = [_]vk.VkDescriptorSet{
                             self.inner.cur_tex_desc_set,
@@ -790,17 +1132,202 @@ pub const Batcher = struct {
                     },
                     else => stdx.unsupported(),
                 }
-                vk.cmdDrawIndexed(cmd_buf, num_indexes, 1, self.cmd_index_start_idx, 0, 0);
+                vk.cmdDrawIndexed(cmd_buf, num_indexes, 1, index_start, 0, 0);
             },
             else => stdx.unsupported(),
         }
     }
 };
 
-/// Currently not used. 
+/// Bounds in clip space. Assumes an affine mvp which is the case for 2D.
+fn transformBounds(mvp: Transform, local: stdx.math.BBox) stdx.math.BBox {
+    const corners = [_]Vec2{
+        mvp.interpolatePt(Vec2.init(local.min_x, local.min_y)),
+        mvp.interpolatePt(Vec2.init(local.max_x, local.min_y)),
+        mvp.interpolatePt(Vec2.init(local.max_x, local.max_y)),
+        mvp.interpolatePt(Vec2.init(local.min_x, local.max_y)),
+    };
+    var res = stdx.math.BBox.init(corners[0].x, corners[0].y, corners[0].x, corners[0].y);
+    for (corners[1..]) |pt| {
+        res.encloseBBox(stdx.math.BBox.init(pt.x, pt.y, pt.x, pt.y));
+    }
+    return res;
+}
+
+/// Appends the batch and assigns it to the latest group with the same state that can be reached without passing an overlapping group.
+fn groupDrawCmd(cmds: *std.ArrayList(DrawCmd), groups: *std.ArrayList(DrawCmdGroup), cmd_: DrawCmd) void {
+    var cmd = cmd_;
+    var group_id = @intCast(u32, groups.items.len);
+    var i = groups.items.len;
+    const search_end = i -| MaxMergeSearch;
+    while (i > search_end) {
+        i -= 1;
+        const group = &groups.items[i];
+        if (cmds.items[group.first_cmd].hasSameState(cmd)) {
+            group_id = @intCast(u32, i);
+            group.bounds.encloseBBox(cmd.bounds);
+            break;
+        }
+        if (group.bounds.intersects(cmd.bounds)) {
+            break;
+        }
+    }
+    if (group_id == groups.items.len) {
+        groups.append(.{
+            .first_cmd = @intCast(u32, cmds.items.len),
+            .bounds = cmd.bounds,
+        }) catch fatal();
+    }
+    cmd.group = group_id;
+    cmds.append(cmd) catch fatal();
+}
+
+/// Orders the batches by group and replaces each group with one batch.
+/// Indexes of a group that aren't already contiguous are copied to the end of the mesh.
+/// Only the index ranges of the batches are used to merge. The copied indexes are read from the mesh's staging buffer.
+fn mergeDrawCmds(cmds_: *std.ArrayList(DrawCmd), groups: *std.ArrayList(DrawCmdGroup), m: *Mesh) void {
+    const S = struct {
+        fn lessThan(_: void, a: DrawCmd, b: DrawCmd) bool {
+            return a.group < b.group;
+        }
+    };
+    // Stable so batches within a group stay in submission order.
+    std.sort.sort(DrawCmd, cmds_.items, {}, S.lessThan);
+
+    const cmds = cmds_.items;
+    var num_out: usize = 0;
+    var i: usize = 0;
+    while (i < cmds.len) {
+        var end = i + 1;
+        var contiguous = true;
+        var num_indexes = cmds[i].index_end - cmds[i].index_start;
+        while (end < cmds.len and cmds[end].group == cmds[i].group) : (end += 1) {
+            if (cmds[end].index_start != cmds[end - 1].index_end) {
+                contiguous = false;
+            }
+            num_indexes += cmds[end].index_end - cmds[end].index_start;
+        }
+        if (contiguous) {
+            var merged = cmds[i];
+            merged.index_end = cmds[end - 1].index_end;
+            cmds[num_out] = merged;
+            num_out += 1;
+        } else if (m.ensureUnusedBuffer(0, num_indexes)) {
+            var merged = cmds[i];
+            merged.index_start = m.cur_index_buf_size;
+            for (cmds[i..end]) |cmd| {
+                const len = cmd.index_end - cmd.index_start;
+                std.mem.copy(u32, m.index_buf[m.cur_index_buf_size..m.cur_index_buf_size + len], m.index_buf[cmd.index_start..cmd.index_end]);
+                m.cur_index_buf_size += len;
+            }
+            merged.index_end = m.cur_index_buf_size;
+            cmds[num_out] = merged;
+            num_out += 1;
+        } else {
+            // No room to merge, draw them separately.
+            for (cmds[i..end]) |cmd| {
+                cmds[num_out] = cmd;
+                num_out += 1;
+            }
+        }
+        i = end;
+    }
+    cmds_.shrinkRetainingCapacity(num_out);
+    groups.clearRetainingCapacity();
+}
+
+/// A recorded 2D batch in deferred mode.
 const DrawCmd = struct {
-    vert_offset: u32,
-    idx_offset: u32,
+    shader_type: ShaderType,
+    image_tex: ImageTex,
+    mvp: Transform,
+    /// Only used by the gradient shader.
+    start_pos: Vec2,
+    start_color: Color,
+    end_pos: Vec2,
+    end_color: Color,
+
+    index_start: u32,
+    index_end: u32,
+    /// Clip space bounds.
+    bounds: stdx.math.BBox,
+    group: u32,
+
+    fn hasSameState(self: DrawCmd, other: DrawCmd) bool {
+        if (self.shader_type != other.shader_type) {
+            return false;
+        }
+        if (!std.mem.eql(f32, &self.mvp.mat, &other.mvp.mat)) {
+            return false;
+        }
+        return switch (self.shader_type) {
+            .Tex, .Sdf => self.image_tex.tex_id == other.image_tex.tex_id,
+            .Gradient => std.meta.eql(self.start_pos, other.start_pos) and std.meta.eql(self.start_color, other.start_color) and
+                std.meta.eql(self.end_pos, other.end_pos) and std.meta.eql(self.end_color, other.end_color),
+            else => false,
+        };
+    }
+};
+
+/// Host copy of the 2D batches drawn while recording. Replaying pushes the vertices back into the mesh,
+/// which skips the work that generated them. eg. Text layout, glyph lookups and tessellation.
+/// Vertices are replayed under the current transform so a recording is only valid if the transform didn't change while recording.
+pub const DrawRecording = struct {
+    alloc: std.mem.Allocator,
+    verts: std.ArrayListUnmanaged(TexShaderVertex),
+    /// Relative to the first vertex of their batch.
+    idxes: std.ArrayListUnmanaged(u32),
+    batches: std.ArrayListUnmanaged(RecordedBatch),
+    /// Cleared when something was drawn that can't be replayed. eg. 3D, clipping or a transform change.
+    valid: bool,
+    /// Graphics.recording_version when the recording began.
+    version: u32,
+    mvp: Transform,
+
+    pub fn init(alloc: std.mem.Allocator) DrawRecording {
+        return .{
+            .alloc = alloc,
+            .verts = .{},
+            .idxes = .{},
+            .batches = .{},
+            .valid = false,
+            .version = 0,
+            .mvp = undefined,
+        };
+    }
+
+    pub fn deinit(self: *DrawRecording) void {
+        self.verts.deinit(self.alloc);
+        self.idxes.deinit(self.alloc);
+        self.batches.deinit(self.alloc);
+    }
+
+    fn reset(self: *DrawRecording) void {
+        self.verts.clearRetainingCapacity();
+        self.idxes.clearRetainingCapacity();
+        self.batches.clearRetainingCapacity();
+        self.valid = true;
+    }
+
+    pub fn numBatches(self: DrawRecording) u32 {
+        return @intCast(u32, self.batches.items.len);
+    }
+};
+
+const RecordedBatch = struct {
+    /// Only the shader, texture and gradient vars are used.
+    state: DrawCmd,
+    vert_start: u32,
+    vert_end: u32,
+    idx_start: u32,
+    idx_end: u32,
+};
+
+/// Batches with the same state that are drawn together.
+const DrawCmdGroup = struct {
+    first_cmd: u32,
+    /// Union of the batches' bounds.
+    bounds: stdx.math.BBox,
 };
 
 /// Properties are ordered to have the same alignment in glsl.
@@ -810,3 +1337,154 @@ const GradientFragmentData = struct {
     start_pos: Vec2,
     end_pos: Vec2,
 };
+
+fn initTestCmd(tex_id: u32, index_start: u32, index_end: u32, bounds: stdx.math.BBox) DrawCmd {
+    return .{
+        .shader_type = .Tex,
+        .image_tex = .{ .image_id = 0, .tex_id = tex_id },
+        .mvp = Transform.initIdentity(),
+        .start_pos = undefined,
+        .start_color = undefined,
+        .end_pos = undefined,
+        .end_color = undefined,
+        .index_start = index_start,
+        .index_end = index_end,
+        .bounds = bounds,
+        .group = undefined,
+    };
+}
+
+test "groupDrawCmd and mergeDrawCmds" {
+    const BBox = stdx.math.BBox;
+    var cmds = std.ArrayList(DrawCmd).init(t.alloc);
+    defer cmds.deinit();
+    var groups = std.ArrayList(DrawCmdGroup).init(t.alloc);
+    defer groups.deinit();
+
+    groupDrawCmd(&cmds, &groups, initTestCmd(1, 0, 6, BBox.init(0, 0, 1, 1)));
+    groupDrawCmd(&cmds, &groups, initTestCmd(2, 6, 12, BBox.init(2, 0, 3, 1)));
+    // Joins the first group since the second group doesn't overlap.
+    groupDrawCmd(&cmds, &groups, initTestCmd(1, 12, 18, BBox.init(4, 0, 5, 1)));
+    groupDrawCmd(&cmds, &groups, initTestCmd(2, 18, 24, BBox.init(0, 0, 1, 1)));
+    // Overlaps the second group so it can't be drawn before it.
+    groupDrawCmd(&cmds, &groups, initTestCmd(1, 24, 30, BBox.init(2, 0, 3, 1)));
+    try t.eq(groups.items.len, 3);
+    var group_ids: [5]u32 = undefined;
+    for (cmds.items, 0..) |cmd, idx| {
+        group_ids[idx] = cmd.group;
+    }
+    try t.eqSlice(u32, &group_ids, &.{ 0, 1, 0, 1, 2 });
+    try t.eq(groups.items[0].bounds, BBox.init(0, 0, 5, 1));
+
+    var m = Mesh.init(t.alloc, &.{}, &.{});
+    defer m.deinit();
+    var i: u32 = 0;
+    while (i < 30) : (i += 1) {
+        m.pushIndex(i);
+    }
+    mergeDrawCmds(&cmds, &groups, &m);
+    try t.eq(groups.items.len, 0);
+    try t.eq(cmds.items.len, 3);
+
+    // Groups that aren't contiguous have their indexes appended.
+    try t.eq(cmds.items[0].index_start, 30);
+    try t.eq(cmds.items[0].index_end, 42);
+    try t.eqSlice(u32, m.index_buf[30..42], &.{ 0, 1, 2, 3, 4, 5, 12, 13, 14, 15, 16, 17 });
+    try t.eq(cmds.items[1].index_start, 42);
+    try t.eq(cmds.items[1].index_end, 54);
+    try t.eqSlice(u32, m.index_buf[42..48], &.{ 6, 7, 8, 9, 10, 11 });
+    // A contiguous group is drawn in place.
+    try t.eq(cmds.items[2].index_start, 24);
+    try t.eq(cmds.items[2].index_end, 30);
+    try t.eq(m.cur_index_buf_size, 54);
+}
+
+test "groupDrawCmd merges adjacent batches" {
+    var cmds = std.ArrayList(DrawCmd).init(t.alloc);
+    defer cmds.deinit();
+    var groups = std.ArrayList(DrawCmdGroup).init(t.alloc);
+    defer groups.deinit();
+    const bounds = stdx.math.BBox.init(0, 0, 1, 1);
+    groupDrawCmd(&cmds, &groups, initTestCmd(1, 0, 6, bounds));
+    groupDrawCmd(&cmds, &groups, initTestCmd(1, 6, 12, bounds));
+
+    var m = Mesh.init(t.alloc, &.{}, &.{});
+    defer m.deinit();
+    mergeDrawCmds(&cmds, &groups, &m);
+    try t.eq(cmds.items.len, 1);
+    try t.eq(cmds.items[0].index_start, 0);
+    try t.eq(cmds.items[0].index_end, 12);
+    try t.eq(m.cur_index_buf_size, 0);
+}
+
+fn initTestBatcher(m: *Mesh) Batcher {
+    return .{
+        .pre_flush_tasks = std.ArrayList(PreFlushTask).init(t.alloc),
+        .mesh = m,
+        .cmds = std.ArrayList(DrawCmd).init(t.alloc),
+        .cmd_groups = std.ArrayList(DrawCmdGroup).init(t.alloc),
+        .deferred = false,
+        .cmd_vert_start_idx = 0,
+        .cmd_index_start_idx = 0,
+        .recording = null,
+        .rec_vert_mark = 0,
+        .rec_index_mark = 0,
+        .mvp = Transform.initIdentity(),
+        .normal = undefined,
+        .material_idx = undefined,
+        .model_idx = undefined,
+        .cur_image_tex = .{ .image_id = 0, .tex_id = 1 },
+        .cur_shader_type = .Tex,
+        .inner = undefined,
+        .image_store = undefined,
+        .stats = undefined,
+        .start_pos = undefined,
+        .start_color = undefined,
+        .end_pos = undefined,
+        .end_color = undefined,
+    };
+}
+
+test "DrawRecording records, replays and invalidates" {
+    var m = Mesh.init(t.alloc, &.{}, &.{});
+    defer m.deinit();
+    var verts: [16]TexShaderVertex = undefined;
+    var idxes: [24]u32 = undefined;
+    m.setMappedBuffers(&verts, &idxes);
+    var b = initTestBatcher(&m);
+    var rec = DrawRecording.init(t.alloc);
+    defer rec.deinit();
+
+    var vert: TexShaderVertex = undefined;
+    vert.setColor(Color.Black);
+    // Pushed before the recording and left out of it.
+    m.pushQuad(Vec4.init(0, 0, 0, 1), Vec4.init(1, 0, 0, 1), Vec4.init(1, 1, 0, 1), Vec4.init(0, 1, 0, 1), vert);
+
+    // The mapped mesh is staged so the recording reads from host memory.
+    b.beginRecording(&rec);
+    try t.eq(m.staging, true);
+    m.pushQuad(Vec4.init(10, 0, 0, 1), Vec4.init(20, 0, 0, 1), Vec4.init(20, 10, 0, 1), Vec4.init(10, 10, 0, 1), vert);
+    b.endRecording();
+    try t.eq(m.staging, false);
+    try t.eq(rec.valid, true);
+    try t.eq(rec.numBatches(), 1);
+    try t.eq(rec.verts.items.len, 4);
+    try t.eq(rec.verts.items[1].pos.x, 20);
+    try t.eqSlice(u32, rec.idxes.items, &.{ 0, 3, 1, 1, 3, 2 });
+    // Staged data was copied to the mapped buffers.
+    try t.eq(verts[5].pos.x, 20);
+
+    // Replaying pushes the recorded geometry again.
+    b.replayRecording(&rec, 0, rec.numBatches());
+    try t.eq(m.cur_vert_buf_size, 12);
+    try t.eq(verts[9].pos.x, 20);
+    try t.eqSlice(u32, idxes[12..18], &.{ 8, 11, 9, 9, 11, 10 });
+
+    // Geometry pushed under a different transform can't be replayed.
+    b.beginRecording(&rec);
+    try t.eq(rec.valid, true);
+    b.mvp.translate(5, 0);
+    m.pushQuad(Vec4.init(0, 0, 0, 1), Vec4.init(1, 0, 0, 1), Vec4.init(1, 1, 0, 1), Vec4.init(0, 1, 0, 1), vert);
+    b.endRecording();
+    try t.eq(rec.valid, false);
+}
@@ -1,14 +1,22 @@
 const std = @import("std");
 const stdx = @import("stdx");
 const stbi = @import("stbi");
+const vk = @import("vk");
+const build_options = @import("graphics_options");
+const Backend = build_options.GraphicsBackend;
 const Point2 = stdx.math.Point2;
 
 const graphics = @import("../../graphics.zig");
 const gpu = graphics.gpu;
+const gvk = graphics.vk;
+const Glyph = gpu.Glyph;
 const RectBinPacker = graphics.RectBinPacker;
+const RectBinPackerStats = @import("../../rect_bin_packer.zig").RectBinPackerStats;
 const log = stdx.log.scoped(.font_atlas);
 
 /// Holds a buffer of font glyphs in memory that is then synced to the gpu.
+/// Once the atlas reaches its max size, the least recently used glyphs are evicted to make room and their rects are reused.
+/// Freed space that is too fragmented to reuse is reclaimed by compacting at the start of a frame.
 pub const FontAtlas = struct {
     g: *gpu.Graphics,
 
@@ -31,6 +39,32 @@ pub const FontAtlas = struct {
     linear_filter: bool,
     dirty: bool,
 
+    /// Rows that changed since the last sync. Only this band is uploaded.
+    dirty_start_y: u32,
+    dirty_end_y: u32,
+
+    /// Scratch list for eviction and compaction.
+    glyph_refs: std.ArrayListUnmanaged(GlyphRef),
+
+    num_evicted: u64,
+    num_compactions: u32,
+
+    /// A glyph must go unused for this many frames before it can be evicted.
+    /// With Vulkan, the frames in flight could still be sampling it.
+    const MinUnusedFrames = if (Backend == .Vulkan) gvk.MaxActiveFrames else 1;
+
+    /// Evicting frees at least this fraction of the atlas so a burst of new glyphs doesn't evict on every miss.
+    const MinEvictFraction = 8;
+
+    /// Compact when the freed rects add up to this fraction of the atlas.
+    const CompactFreeFraction = 4;
+
+    const GlyphRef = struct {
+        render_font_id: u32,
+        cp: u21,
+        last_used_frame: u32,
+    };
+
     /// Linear filter disabled is good for bitmap fonts that scale upwards.
     /// Outline glyphs and color bitmaps would use linear filtering. Although in the future, outline glyphs might also need to have linear filter disabled.
     pub fn init(self: *FontAtlas, alloc: std.mem.Allocator, g: *gpu.Graphics, width: u32, height: u32, linear_filter: bool) void {
@@ -46,6 +80,11 @@ pub const FontAtlas = struct {
             .gl_buf = undefined,
             .linear_filter = linear_filter,
             .dirty = false,
+            .dirty_start_y = std.math.maxInt(u32),
+            .dirty_end_y = 0,
+            .glyph_refs = .{},
+            .num_evicted = 0,
+            .num_compactions = 0,
         };
         self.image = g.image_store.createImageFromBitmap(width, height, null, .{
             .linear_filter = linear_filter
@@ -66,9 +105,196 @@ pub const FontAtlas = struct {
     pub fn deinit(self: *FontAtlas) void {
         self.packer.deinit();
         self.alloc.free(self.gl_buf);
+        self.glyph_refs.deinit(self.alloc);
         self.g.image_store.markForRemoval(self.image.image_id);
     }
 
+    /// Caps the atlas dimensions. An atlas that is already larger keeps its size.
+    pub fn setMaxSize(self: *FontAtlas, max_width: u32, max_height: u32) void {
+        self.packer.setMaxSize(max_width, max_height);
+    }
+
+    /// Allocates space for a glyph. At the max size, glyphs that haven't been used recently are evicted first.
+    /// The max size is only exceeded when the glyphs used within the last few frames don't fit.
+    pub fn allocRect(self: *FontAtlas, width: u32, height: u32) stdx.math.Point2(u32) {
+        if (self.packer.tryAllocRect(width, height)) |pos| {
+            return pos;
+        }
+        if (self.evictGlyphs(width * height)) {
+            if (self.packer.tryAllocRect(width, height)) |pos| {
+                return pos;
+            }
+            // The freed rects are too fragmented.
+            // Vulkan records the whole frame before submitting so glyphs already drawn this frame can't be moved.
+            if (Backend != .Vulkan) {
+                self.compact();
+                if (self.packer.tryAllocRect(width, height)) |pos| {
+                    return pos;
+                }
+            }
+        }
+        log.warn("Font atlas exceeds max size: {}x{}", .{self.packer.max_width, self.packer.max_height});
+        return self.packer.allocRect(width, height);
+    }
+
+    /// Removes the least recently used glyphs until min_area is freed. Returns false if nothing could be evicted.
+    fn evictGlyphs(self: *FontAtlas, min_area: u32) bool {
+        const fc = &self.g.font_cache;
+        self.glyph_refs.clearRetainingCapacity();
+        for (fc.render_fonts.items, 0..) |*font, font_id| {
+            var iter = font.glyphIterator();
+            while (iter.next()) |entry| {
+                const glyph = entry.glyph;
+                // Placeholders of glyphs still being rasterized don't take up space.
+                if (glyph.image.image_id != self.image.image_id or glyph.width == 0) {
+                    continue;
+                }
+                if (fc.frame -% glyph.last_used_frame < MinUnusedFrames) {
+                    continue;
+                }
+                self.glyph_refs.append(self.alloc, .{
+                    .render_font_id = @intCast(u32, font_id),
+                    .cp = entry.cp,
+                    .last_used_frame = glyph.last_used_frame,
+                }) catch @panic("error");
+            }
+        }
+        if (self.glyph_refs.items.len == 0) {
+            return false;
+        }
+        const S = struct {
+            fn lessThan(_: void, a: GlyphRef, b: GlyphRef) bool {
+                return a.last_used_frame < b.last_used_frame;
+            }
+        };
+        std.sort.sort(GlyphRef, self.glyph_refs.items, {}, S.lessThan);
+
+        const target = @max(min_area, self.width * self.height / MinEvictFraction);
+        var freed: u32 = 0;
+        for (self.glyph_refs.items) |ref| {
+            if (freed >= target) {
+                break;
+            }
+            const glyph = fc.render_fonts.items[ref.render_font_id].removeGlyph(ref.cp).?;
+            self.packer.freeRect(glyph.x, glyph.y, glyph.width, glyph.height);
+            // A glyph copied into part of this rect only writes inside its padding, so clear the rest.
+            self.clearRect(glyph.x, glyph.y, glyph.width, glyph.height);
+            freed += glyph.width * glyph.height;
+            self.num_evicted += 1;
+        }
+        // The freed rects are reused by other glyphs.
+        self.g.recording_version +%= 1;
+        self.markDirtyBuffer();
+        return true;
+    }
+
+    /// Compacting is worthwhile once a large part of the atlas is only reachable through small freed rects.
+    pub fn shouldCompact(self: FontAtlas) bool {
+        const stats = self.packer.getStats();
+        return stats.free_list_area > @as(u64, self.width) * self.height / CompactFreeFraction;
+    }
+
+    /// Repacks the cached glyphs from scratch which merges the freed rects back into open space.
+    /// Glyph positions and uvs are rewritten. With Vulkan, this must be called before any glyphs are drawn in the frame.
+    pub fn compact(self: *FontAtlas) void {
+        const fc = &self.g.font_cache;
+        if (Backend == .Vulkan) {
+            // Moved glyphs can't be sampled by frames in flight.
+            vk.assertSuccess(vk.queueWaitIdle(self.g.inner.renderer.graphics_queue));
+        }
+        // Batched quads still refer to the old positions.
+        self.g.batcher.endCmd();
+
+        // Pack the tallest glyphs first.
+        var glyphs = std.ArrayList(*Glyph).init(self.alloc);
+        defer glyphs.deinit();
+        for (fc.render_fonts.items) |*font| {
+            var iter = font.glyphIterator();
+            while (iter.next()) |entry| {
+                const glyph = entry.glyph;
+                if (glyph.image.image_id == self.image.image_id and glyph.width > 0) {
+                    glyphs.append(glyph) catch @panic("error");
+                }
+            }
+            if (font.missing_glyph) |*glyph| {
+                if (glyph.image.image_id == self.image.image_id and glyph.width > 0) {
+                    glyphs.append(glyph) catch @panic("error");
+                }
+            }
+        }
+        const S = struct {
+            fn lessThan(_: void, a: *Glyph, b: *Glyph) bool {
+                return a.height > b.height;
+            }
+        };
+        std.sort.sort(*Glyph, glyphs.items, {}, S.lessThan);
+
+        const old_buf = self.alloc.dupe(u8, self.gl_buf) catch @panic("error");
+        defer self.alloc.free(old_buf);
+        const old_width = self.width;
+        std.mem.set(u8, self.gl_buf, 0);
+        self.packer.reset();
+        for (glyphs.items) |glyph| {
+            // The same glyphs fit before, but a different packing order could still need a resize.
+            // A resize only rewrites uvs from the current glyph positions so moving the glyph afterwards is still correct.
+            const pos = self.packer.allocRect(glyph.width, glyph.height);
+            self.copyRectFromBuf(old_buf, old_width, glyph.x, glyph.y, pos.x, pos.y, glyph.width, glyph.height);
+            glyph.x = pos.x;
+            glyph.y = pos.y;
+            self.updateGlyphUvs(glyph);
+        }
+        self.extendDirtyRows(0, self.height);
+        self.markDirtyBuffer();
+        self.num_compactions += 1;
+        fc.atlas_version +%= 1;
+        self.g.recording_version +%= 1;
+    }
+
+    pub fn getStats(self: FontAtlas) FontAtlasStats {
+        return .{
+            .packer = self.packer.getStats(),
+            .num_evicted = self.num_evicted,
+            .num_compactions = self.num_compactions,
+        };
+    }
+
+    fn updateGlyphUvs(self: FontAtlas, glyph: *Glyph) void {
+        const tex_width = @intToFloat(f32, self.width);
+        const tex_height = @intToFloat(f32, self.height);
+        const x = @intToFloat(f32, glyph.x);
+        const y = @intToFloat(f32, glyph.y);
+        glyph.u0 = x / tex_width;
+        glyph.v0 = y / tex_height;
+        glyph.u1 = (x + @intToFloat(f32, glyph.width)) / tex_width;
+        glyph.v1 = (y + @intToFloat(f32, glyph.height)) / tex_height;
+    }
+
+    fn clearRect(self: *FontAtlas, x: usize, y: usize, width: usize, height: usize) void {
+        self.extendDirtyRows(y, height);
+        const row_size = self.width * self.channels;
+        var offset = (x + y * self.width) * self.channels;
+        var row: usize = 0;
+        while (row < height) : (row += 1) {
+            std.mem.set(u8, self.gl_buf[offset .. offset + width * self.channels], 0);
+            offset += row_size;
+        }
+    }
+
+    /// Copies a rect out of a 4 channel buffer that has the given row width.
+    fn copyRectFromBuf(self: *FontAtlas, src: []const u8, src_width: usize, src_x: usize, src_y: usize, dst_x: usize, dst_y: usize, width: usize, height: usize) void {
+        const dst_row_size = self.width * self.channels;
+        const src_row_size = src_width * self.channels;
+        const len = width * self.channels;
+        var dst_offset = (dst_x + dst_y * self.width) * self.channels;
+        var src_offset = (src_x + src_y * src_width) * self.channels;
+        var row: usize = 0;
+        while (row < height) : (row += 1) {
+            std.mem.copy(u8, self.gl_buf[dst_offset .. dst_offset + len], src[src_offset .. src_offset + len]);
+            dst_offset += dst_row_size;
+            src_offset += src_row_size;
+        }
+    }
+
     fn resizeLocalBuffer(self: *FontAtlas, width: u32, height: u32) void {
         const old_buf = self.gl_buf;
         defer self.alloc.free(old_buf);
@@ -83,6 +309,8 @@ pub const FontAtlas = struct {
 
         // Copy over existing data.
         self.copySubImageFrom(0, 0, old_width, old_height, old_buf);
+        // The new texture is empty so all rows need to be synced.
+        self.extendDirtyRows(0, self.height);
 
         // End the current command so the current uv data still maps to correct texture data and create a new image.
         const old_image_id = self.image.image_id;
@@ -92,26 +320,31 @@ pub const FontAtlas = struct {
         });
 
         // Update tex_id and uvs in existing glyphs.
-        const tex_width = @intToFloat(f32, self.width);
-        const tex_height = @intToFloat(f32, self.height);
-        for (self.g.font_cache.render_fonts.items) |font| {
-            var iter = font.glyphs.valueIterator();
-            while (iter.next()) |glyph| {
+        self.g.font_cache.atlas_version +%= 1;
+        self.g.recording_version +%= 1;
+        for (self.g.font_cache.render_fonts.items) |*font| {
+            var iter = font.glyphIterator();
+            while (iter.next()) |entry| {
+                const glyph = entry.glyph;
                 if (glyph.image.image_id == old_image_id) {
                     glyph.image = self.image;
-                    const x = @intToFloat(f32, glyph.x);
-                    const y = @intToFloat(f32, glyph.y);
-                    const widthf = @intToFloat(f32, glyph.width);
-                    const heightf = @intToFloat(f32, glyph.height);
-                    glyph.u0 = x / tex_width;
-                    glyph.v0 = y / tex_height;
-                    glyph.u1 = (x + widthf) / tex_width;
-                    glyph.v1 = (y + heightf) / tex_height;
+                    self.updateGlyphUvs(glyph);
+                }
+            }
+            if (font.missing_glyph) |*glyph| {
+                if (glyph.image.image_id == old_image_id) {
+                    glyph.image = self.image;
+                    self.updateGlyphUvs(glyph);
                 }
             }
         }
     }
 
+    fn extendDirtyRows(self: *FontAtlas, y: usize, height: usize) void {
+        self.dirty_start_y = @min(self.dirty_start_y, @intCast(u32, y));
+        self.dirty_end_y = @max(self.dirty_end_y, @intCast(u32, y + height));
+    }
+
     /// Copy from 1 channel row major sub image data. markDirtyBuffer needs to be called afterwards to queue a sync op to the gpu.
     pub fn copySubImageFrom1Channel(self: *FontAtlas, x: usize, y: usize, width: usize, height: usize, src: []const u8) void {
         // Ensure src has the correct data length.
@@ -119,6 +352,7 @@ pub const FontAtlas = struct {
         // Ensure bounds in atlas bitmap.
         std.debug.assert(x + width <= self.width);
         std.debug.assert(y + height <= self.height);
+        self.extendDirtyRows(y, height);
 
         const dst_row_size = self.width * self.channels;
         const src_row_size = width;
@@ -146,6 +380,7 @@ pub const FontAtlas = struct {
         // Ensure bounds in atlas bitmap.
         std.debug.assert(bm_x + width <= self.width);
         std.debug.assert(bm_y + height <= self.height);
+        self.extendDirtyRows(bm_y, height);
 
         const dst_row_size = self.width * self.channels;
         const src_row_size = width * self.channels;
@@ -173,13 +408,26 @@ pub const FontAtlas = struct {
     }
 };
 
+pub const FontAtlasStats = struct {
+    packer: RectBinPackerStats,
+    /// Totals since the atlas was created.
+    num_evicted: u64,
+    num_compactions: u32,
+};
+
 /// Updates gpu texture before current draw call batch is sent to gpu.
 fn syncFontAtlasToGpu(ptr: ?*anyopaque) void {
     const self = stdx.ptrCastAlign(*FontAtlas, ptr);
     self.dirty = false;
+    if (self.dirty_start_y >= self.dirty_end_y) {
+        return;
+    }
 
-    // Send bitmap data.
-    // TODO: send only subimage that changed.
+    // Send only the band of rows that changed. The packer fills the atlas from the top so new glyphs tend to share rows.
     const image = self.g.image_store.images.getNoCheck(self.image.image_id);
-    self.g.updateTextureData(image, self.gl_buf);
+    const row_size = self.width * self.channels;
+    const rows = self.gl_buf[self.dirty_start_y * row_size .. self.dirty_end_y * row_size];
+    self.g.updateTextureRows(image, self.dirty_start_y, self.dirty_end_y - self.dirty_start_y, rows);
+    self.dirty_start_y = std.math.maxInt(u32);
+    self.dirty_end_y = 0;
 }
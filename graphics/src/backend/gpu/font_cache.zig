@@ -25,21 +25,39 @@ pub const RenderFontId = u32;
 const RenderFontDesc = struct {
     font_id: RenderFontId,
     font_size: u16,
+    sdf: bool,
 };
 
 const RenderFontKey = struct {
     font_id: FontId,
     font_size: u16,
+    sdf: bool,
 };
 
-// Once we support SDFs we can increase this to 2^16
+/// Render font size and whether the glyphs are signed distance fields.
+/// SDF render fonts can have the same size as a bitmap render font so both are needed to find a RenderFont.
+pub const RenderFontParams = struct {
+    size: u16,
+    sdf: bool,
+};
+
+// Only bitmap render fonts are limited by this. SDF glyphs are rendered once at SdfRenderFontSize.
 pub const MaxRenderFontSize = 256; // 2^8
 
+/// Outline glyphs above OutlineMaxNoScale are rasterized at this size into a signed distance field when sdf_glyphs is enabled.
+/// The same glyph is then scaled to any font size up to MaxSdfFontSize.
+pub const SdfRenderFontSize = 48;
+
+pub const MaxSdfFontSize = 1 << 16;
+
 pub const MinRenderFontSize = 1;
 
 // Used to insert initial RenderFontDesc mru that will always be a cache miss.
 const NullFontSize: u16 = 0;
 
+/// Atlases stop growing at this size and evict glyphs instead. 64MB for an RGBA atlas.
+pub const DefaultMaxAtlasSize = 4096;
+
 pub const FontCache = struct {
     const Self = @This();
 
@@ -64,11 +82,24 @@ pub const FontCache = struct {
     /// For bitmap font glyphs. Linear filtering disabled.
     bitmap_atlas: FontAtlas,
 
+    /// Larger outline font sizes share one set of SDF glyphs in main_atlas instead of a bitmap render font per size.
+    /// Smaller sizes still get exact bitmaps since they depend more on hinting.
+    sdf_glyphs: bool,
+
+    /// Incremented at the start of each frame. Glyphs record the frame they were last used in.
+    frame: u32,
+
+    /// Incremented whenever an atlas moves existing glyphs. Glyph data copied before then is stale.
+    atlas_version: u32,
+
     pub fn init(self: *Self, alloc: std.mem.Allocator, gctx: *gpu.Graphics) void {
         self.* = .{
             .alloc = alloc,
             .main_atlas = undefined,
             .bitmap_atlas = undefined,
+            .sdf_glyphs = false,
+            .frame = 0,
+            .atlas_version = 0,
             .fonts = std.ArrayList(Font).init(alloc),
             .render_fonts = std.ArrayList(RenderFont).init(alloc),
             .render_font_mru = std.ArrayList(RenderFontDesc).init(alloc),
@@ -85,6 +116,8 @@ pub const FontCache = struct {
         const main_atlas_height = 1024;
         self.main_atlas.init(alloc, gctx, main_atlas_width, main_atlas_height, true);
         self.bitmap_atlas.init(alloc, gctx, 256, 256, false);
+        self.main_atlas.setMaxSize(DefaultMaxAtlasSize, DefaultMaxAtlasSize);
+        self.bitmap_atlas.setMaxSize(DefaultMaxAtlasSize, DefaultMaxAtlasSize);
     }
 
     pub fn deinit(self: *Self) void {
@@ -115,11 +148,50 @@ pub const FontCache = struct {
         self.font_groups.deinit();
     }
 
+    pub fn setSdfGlyphs(self: *Self, sdf_glyphs: bool) void {
+        self.sdf_glyphs = sdf_glyphs;
+    }
+
+    /// Advances the frame used for glyph eviction and compacts fragmented atlases before anything is drawn.
+    pub fn beginFrame(self: *Self) void {
+        self.frame +%= 1;
+        if (self.main_atlas.shouldCompact()) {
+            self.main_atlas.compact();
+        }
+        if (self.bitmap_atlas.shouldCompact()) {
+            self.bitmap_atlas.compact();
+        }
+    }
+
+    /// Limits the memory used by each atlas. An RGBA atlas uses width * height * 4 bytes.
+    pub fn setAtlasMaxSize(self: *Self, max_width: u32, max_height: u32) void {
+        self.main_atlas.setMaxSize(max_width, max_height);
+        self.bitmap_atlas.setMaxSize(max_width, max_height);
+    }
+
+    /// Computes the render font params for a font size and also updates the requested font size if necessary.
+    /// Bitmap render font sizes are scaled by dpr while SDF glyphs already scale to any size.
+    pub fn computeRenderFontParams(self: *const Self, desc: FontDesc, font_size: *f32, dpr: u32) RenderFontParams {
+        if (self.sdf_glyphs and desc.font_type == .Outline and font_size.* > OutlineMaxNoScale) {
+            if (font_size.* > MaxSdfFontSize) {
+                font_size.* = MaxSdfFontSize;
+            }
+            return .{
+                .size = SdfRenderFontSize,
+                .sdf = true,
+            };
+        }
+        return .{
+            .size = computeRenderFontSize(desc, font_size) * @intCast(u16, dpr),
+            .sdf = false,
+        };
+    }
+
     pub fn getPrimaryFontVMetrics(self: *Self, font_gid: FontGroupId, font_size: f32) VMetrics {
         const fgroup = self.getFontGroup(font_gid);
         var req_font_size = font_size;
-        const render_font_size = computeRenderFontSize(fgroup.primary_font_desc, &req_font_size);
-        const render_font = self.getOrCreateRenderFont(fgroup.primary_font, render_font_size);
+        const params = self.computeRenderFontParams(fgroup.primary_font_desc, &req_font_size, 1);
+        const render_font = self.getOrCreateRenderFont(fgroup.primary_font, params);
         return render_font.getVerticalMetrics(req_font_size);
     }
 
@@ -130,16 +202,16 @@ pub const FontCache = struct {
             .font_type = font.font_type,
             .bmfont_scaler = font.bmfont_scaler,
         };
-        const render_font_size = computeRenderFontSize(desc, &req_font_size);
-        const render_font = self.getOrCreateRenderFont(font, render_font_size);
+        const params = self.computeRenderFontParams(desc, &req_font_size, 1);
+        const render_font = self.getOrCreateRenderFont(font_id, params);
         return render_font.getVerticalMetrics(req_font_size);
     }
 
     // If a glyph is loaded, this will queue a gpu buffer upload.
-    pub fn getOrLoadFontGroupGlyph(self: *Self, g: *gpu.Graphics, font_grp: *FontGroup, render_font_size: u16, cp: u21) GlyphResult {
+    pub fn getOrLoadFontGroupGlyph(self: *Self, g: *gpu.Graphics, font_grp: *FontGroup, params: RenderFontParams, cp: u21) GlyphResult {
         // Find glyph by iterating fonts until the glyph is found.
         for (font_grp.fonts) |font_id| {
-            const render_font = self.getOrCreateRenderFont(font_id, render_font_size);
+            const render_font = self.getOrCreateRenderFont(font_id, params);
             const fnt = self.getFont(font_id);
             if (font_renderer.getOrLoadGlyph(g, fnt, render_font, cp)) |glyph| {
                 return .{
@@ -152,7 +224,7 @@ pub const FontCache = struct {
 
         // Find glyph in system fonts.
         for (g.ps.fallback_fonts.items) |font_id| {
-            const render_font = self.getOrCreateRenderFont(font_id, render_font_size);
+            const render_font = self.getOrCreateRenderFont(font_id, params);
             const fnt = self.getFont(font_id);
             if (font_renderer.getOrLoadGlyph(g, fnt, render_font, cp)) |glyph| {
                 return .{
@@ -165,7 +237,7 @@ pub const FontCache = struct {
 
         // If we still can't find it. Return the special missing glyph for the first user font.
         const font_id = font_grp.fonts[0];
-        const render_font = self.getOrCreateRenderFont(font_id, render_font_size);
+        const render_font = self.getOrCreateRenderFont(font_id, params);
         const fnt = self.getFont(font_id);
         const glyph = font_renderer.getOrLoadMissingGlyph(g, fnt, render_font);
         return .{
@@ -175,16 +247,19 @@ pub const FontCache = struct {
         };
     }
 
-    // Assumes render_font_size is a valid size.
-    pub fn getOrCreateRenderFont(self: *Self, font_id: FontId, render_font_size: u16) *RenderFont {
+    // Assumes params.size is a valid size.
+    pub fn getOrCreateRenderFont(self: *Self, font_id: FontId, params: RenderFontParams) *RenderFont {
+        const render_font_size = params.size;
         const mru = self.render_font_mru.items[font_id];
-        if (mru.font_size == render_font_size) {
+        if (mru.font_size == render_font_size and mru.sdf == params.sdf) {
             return &self.render_fonts.items[mru.font_id];
         } else {
-            if (self.render_font_map.get(.{ .font_id = font_id, .font_size = render_font_size })) |render_font_id| {
+            const key = RenderFontKey{ .font_id = font_id, .font_size = render_font_size, .sdf = params.sdf };
+            if (self.render_font_map.get(key)) |render_font_id| {
                 self.render_font_mru.items[font_id] = .{
                     .font_id = render_font_id,
                     .font_size = render_font_size,
+                    .sdf = params.sdf,
                 };
                 return &self.render_fonts.items[render_font_id];
             } else {
@@ -195,14 +270,16 @@ pub const FontCache = struct {
 
                 const ot_font = font.getOtFontBySize(render_font_size);
                 switch (font.font_type) {
-                    .Outline => render_font.initOutline(self.alloc, font.id, ot_font, render_font_size),
+                    .Outline => render_font.initOutline(self.alloc, font.id, ot_font, render_font_size, params.sdf),
+                    // A bitmap fallback font in a group with SDF glyphs still renders bitmaps at the SDF size.
                     .Bitmap => render_font.initBitmap(self.alloc, font.id, ot_font, render_font_size),
                 }
 
-                self.render_font_map.put(.{ .font_id = font_id, .font_size = render_font_size }, render_font_id) catch unreachable;
+                self.render_font_map.put(key, render_font_id) catch unreachable;
                 self.render_font_mru.items[font_id] = .{
                     .font_id = render_font_id,
                     .font_size = render_font_size,
+                    .sdf = params.sdf,
                 };
                 return render_font;
             }
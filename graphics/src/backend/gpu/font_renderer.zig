@@ -12,6 +12,7 @@ const Font = graphics.Font;
 const RenderFont = gpu.RenderFont;
 const OpenTypeFont = graphics.OpenTypeFont;
 const Glyph = gpu.Glyph;
+const sdf = @import("sdf.zig");
 const log = std.log.scoped(.font_renderer);
 
 pub fn getOrLoadMissingGlyph(g: *gpu.Graphics, font: *Font, render_font: *RenderFont) *Glyph {
@@ -27,10 +28,11 @@ pub fn getOrLoadMissingGlyph(g: *gpu.Graphics, font: *Font, render_font: *Render
 
 pub fn getOrLoadGlyph(g: *gpu.Graphics, font: *Font, render_font: *RenderFont, cp: u21) ?*Glyph {
     // var buf: [4]u8 = undefined;
-    if (render_font.glyphs.getEntry(cp)) |entry| {
+    if (render_font.getGlyph(cp)) |glyph| {
         // _ = std.unicode.utf8Encode(cp, &buf) catch unreachable;
         // log.debug("{} cache hit: {s}", .{render_font.render_font_size, buf});
-        return entry.value_ptr;
+        glyph.last_used_frame = g.font_cache.frame;
+        return glyph;
     } else {
         // _ = std.unicode.utf8Encode(cp, &buf) catch unreachable;
         // log.debug("{} cache miss: {s}", .{render_font.render_font_size, buf});
@@ -39,9 +41,13 @@ pub fn getOrLoadGlyph(g: *gpu.Graphics, font: *Font, render_font: *RenderFont, c
 
         // Attempt to generate glyph.
         if (ot_font.getGlyphId(cp) catch unreachable) |glyph_id| {
-            const glyph = generateGlyph(g, font, ot_font, render_font, glyph_id);
-            const entry = render_font.glyphs.getOrPutValue(cp, glyph) catch unreachable;
-            return entry.value_ptr;
+            const glyph = if (g.glyph_rasterizer.canRasterize(font))
+                g.glyph_rasterizer.request(g, font, render_font, cp, glyph_id)
+            else
+                generateGlyph(g, font, ot_font, render_font, glyph_id);
+            const new_glyph = render_font.putGlyph(cp, glyph);
+            new_glyph.last_used_frame = g.font_cache.frame;
+            return new_glyph;
         } else return null;
     }
 }
@@ -77,104 +83,169 @@ const h_padding = Glyph.Padding * 2;
 const v_padding = Glyph.Padding * 2;
 
 fn generateOutlineGlyph(g: *gpu.Graphics, font: *Font, render_font: *const RenderFont, glyph_id: u16, set_size: bool) Glyph {
-    const scale = render_font.scale_from_ttf;
-    const fc = &g.font_cache;
-
-    // negative y indicates upwards dist from baseline.
-    // positive y indicates downwards dist from baseline.
-    // x0, y0 represents top left.
-    // x1, y1 represents bot right.
-    var x0: c_int = 0;
-    var y0: c_int = 0;
-    var x1: c_int = 0;
-    var y1: c_int = 0;
+    const face = switch (graphics.FontRendererBackend) {
+        .Freetype => font.impl,
+        .Stbtt => &font.impl,
+    };
+    const raster = rasterizeOutlineGlyph(g.alloc, face, render_font.render_font_size, render_font.scale_from_ttf, render_font.sdf, set_size, glyph_id, &g.raster_glyph_buffer);
+    const glyph = packOutlineGlyph(g, font, render_font, glyph_id, raster, g.raster_glyph_buffer.items);
+    if (raster.width > 0) {
+        g.font_cache.main_atlas.markDirtyBuffer();
+    }
+    return glyph;
+}
 
-    var glyph_x: u32 = 0;
-    var glyph_y: u32 = 0;
-    var glyph_width: u32 = 0;
-    var glyph_height: u32 = 0;
+/// Font handle used to rasterize outlines.
+/// A freetype face can only be used by one thread at a time so each glyph rasterizer worker loads its own.
+pub const OutlineFace = switch (graphics.FontRendererBackend) {
+    .Freetype => *ft.Face,
+    .Stbtt => *const stbtt.fontinfo,
+};
 
+/// An outline glyph rasterized into a 1 channel bitmap that hasn't been packed into an atlas yet.
+pub const RasterGlyph = struct {
+    // Top left of the bitmap from the glyph origin.
+    // negative y indicates upwards dist from baseline.
+    x0: c_int,
+    y0: c_int,
+    width: u32,
+    height: u32,
+};
+
+/// Rasterizes an outline glyph into buf. Blank glyphs like the space char have a width of 0.
+/// Only touches the face and buf so it can run on a worker thread.
+pub fn rasterizeOutlineGlyph(alloc: std.mem.Allocator, face: OutlineFace, render_font_size: u16, scale: f32, sdf_glyph: bool, set_size: bool, glyph_id: u16, buf: *std.ArrayList(u8)) RasterGlyph {
+    var res = RasterGlyph{
+        .x0 = 0,
+        .y0 = 0,
+        .width = 0,
+        .height = 0,
+    };
     switch (graphics.FontRendererBackend) {
         .Freetype => {
             if (set_size) {
                 // Freetype does not allow setting to arbitrary pixel size for color bitmaps: https://github.com/python-pillow/Pillow/issues/6166
-                const err = ft.FT_Set_Pixel_Sizes(font.impl, 0, render_font.render_font_size);
+                const err = ft.FT_Set_Pixel_Sizes(face, 0, render_font_size);
                 if (err != 0) {
                     stdx.panicFmt("freetype error {}: {s}", .{err, ft.FT_Error_String(err)});
                 }
             }
-            var err = ft.FT_Load_Glyph(font.impl, glyph_id, ft.FT_LOAD_DEFAULT);
+            var err = ft.FT_Load_Glyph(face, glyph_id, ft.FT_LOAD_DEFAULT);
             if (err != 0) {
                 stdx.panicFmt("freetype error {}", .{err});
             }
-            err = ft.FT_Render_Glyph(font.impl.glyph, ft.FT_RENDER_MODE_NORMAL);
+            err = ft.FT_Render_Glyph(face.glyph, ft.FT_RENDER_MODE_NORMAL);
             if (err != 0) {
                 stdx.panicFmt("freetype error {}", .{err});
             }
-            const src_width = font.impl.glyph[0].bitmap.width;
-            const src_height = font.impl.glyph[0].bitmap.rows;
-
-            x0 = font.impl.glyph[0].bitmap_left;
-            y0 = -font.impl.glyph[0].bitmap_top;
+            const src_width = face.glyph[0].bitmap.width;
+            const src_height = face.glyph[0].bitmap.rows;
 
-            // log.debug("glyph {any} {} {}", .{font.impl.glyph[0].bitmap, x0, y0});
+            res.x0 = face.glyph[0].bitmap_left;
+            res.y0 = -face.glyph[0].bitmap_top;
 
-            if (src_width > 0) {
-                glyph_width = src_width + h_padding;
-                glyph_height = src_height + v_padding;
+            // log.debug("glyph {any} {} {}", .{face.glyph[0].bitmap, res.x0, res.y0});
 
-                const pos = fc.main_atlas.packer.allocRect(glyph_width, glyph_height);
-                glyph_x = pos.x;
-                glyph_y = pos.y;
-
-                // Debug: Dump specific glyph.
-                // if (glyph_id == 76) {
-                //     _ = stbi.stbi_write_bmp("test.bmp", @intCast(c_int, src_width), @intCast(c_int, src_height), 1, font.impl.glyph[0].bitmap.buffer);
-                //     log.debug("{} {} {}", .{src_width, src_height, x0});
-                // }
+            if (src_width == 0) {
+                // Some characters will be blank like the space char.
+                return res;
+            }
+            const src = face.glyph[0].bitmap.buffer[0..src_width*src_height];
+
+            // Debug: Dump specific glyph.
+            // if (glyph_id == 76) {
+            //     _ = stbi.stbi_write_bmp("test.bmp", @intCast(c_int, src_width), @intCast(c_int, src_height), 1, face.glyph[0].bitmap.buffer);
+            //     log.debug("{} {} {}", .{src_width, src_height, res.x0});
+            // }
+
+            if (sdf_glyph) {
+                // The vendored freetype doesn't build the sdf renderer module so the field is computed from the coverage bitmap.
+                const field_width = src_width + sdf.Spread * 2;
+                const field_height = src_height + sdf.Spread * 2;
+                const field_len = field_width * field_height;
+                buf.resize(field_len * 2) catch @panic("error");
+                const coverage = buf.items[field_len..];
+                std.mem.set(u8, coverage, 0);
+                var row: u32 = 0;
+                while (row < src_height) : (row += 1) {
+                    const dst_start = (row + sdf.Spread) * field_width + sdf.Spread;
+                    std.mem.copy(u8, coverage[dst_start..dst_start + src_width], src[row * src_width..(row + 1) * src_width]);
+                }
+                sdf.coverageToSdf(alloc, buf.items[0..field_len], coverage, field_width, field_height, sdf.Spread) catch @panic("error");
+                buf.shrinkRetainingCapacity(field_len);
 
-                fc.main_atlas.copySubImageFrom1Channel(glyph_x + Glyph.Padding, glyph_y + Glyph.Padding, src_width, src_height, font.impl.glyph[0].bitmap.buffer[0..src_width*src_height]);
-                fc.main_atlas.markDirtyBuffer();
+                res.x0 -= sdf.Spread;
+                res.y0 -= sdf.Spread;
+                res.width = field_width;
+                res.height = field_height;
             } else {
-                // Some characters will be blank like the space char.
-                glyph_width = 0;
-                glyph_height = 0;
-                glyph_x = 0;
-                glyph_y = 0;
+                buf.resize(src.len) catch @panic("error");
+                std.mem.copy(u8, buf.items, src);
+                res.width = src_width;
+                res.height = src_height;
             }
         },
-        .Stbtt => {
-            stbtt.stbtt_GetGlyphBitmapBox(&font.impl, glyph_id, scale, scale, &x0, &y0, &x1, &y1);
-            // Draw glyph into bitmap buffer.
-            const src_width = @intCast(u32, x1 - x0);
-            const src_height = @intCast(u32, y1 - y0);
-            glyph_width = src_width + h_padding;
-            glyph_height = src_height + v_padding;
-
-            const pos = fc.main_atlas.packer.allocRect(glyph_width, glyph_height);
-            glyph_x = pos.x;
-            glyph_y = pos.y;
-
-            g.raster_glyph_buffer.resize(src_width * src_height) catch @panic("error");
+        .Stbtt => if (sdf_glyph) {
+            var src_width: c_int = 0;
+            var src_height: c_int = 0;
+            const pixel_dist_scale = @intToFloat(f32, sdf.OnEdgeValue) / sdf.Spread;
+            const field = stbtt.stbtt_GetGlyphSDF(face, scale, glyph_id, sdf.Spread, sdf.OnEdgeValue, pixel_dist_scale, &src_width, &src_height, &res.x0, &res.y0);
+            if (field == null) {
+                return res;
+            }
+            defer stbtt.stbtt_FreeSDF(field, null);
+            res.width = @intCast(u32, src_width);
+            res.height = @intCast(u32, src_height);
+            buf.resize(res.width * res.height) catch @panic("error");
+            std.mem.copy(u8, buf.items, field[0..buf.items.len]);
+        } else {
+            var x1: c_int = 0;
+            var y1: c_int = 0;
+            stbtt.stbtt_GetGlyphBitmapBox(face, glyph_id, scale, scale, &res.x0, &res.y0, &x1, &y1);
+            res.width = @intCast(u32, x1 - res.x0);
+            res.height = @intCast(u32, y1 - res.y0);
+            buf.resize(res.width * res.height) catch @panic("error");
             // Don't include extra padding when blitting to bitmap with stbtt.
-            stbtt.stbtt_MakeGlyphBitmap(&font.impl, g.raster_glyph_buffer.items.ptr, @intCast(c_int, src_width), @intCast(c_int, src_height), @intCast(c_int, src_width), scale, scale, glyph_id);
-            fc.main_atlas.copySubImageFrom1Channel(glyph_x + Glyph.Padding, glyph_y + Glyph.Padding, src_width, src_height, g.raster_glyph_buffer.items);
-            fc.main_atlas.markDirtyBuffer();
+            stbtt.stbtt_MakeGlyphBitmap(face, buf.items.ptr, @intCast(c_int, res.width), @intCast(c_int, res.height), @intCast(c_int, res.width), scale, scale, glyph_id);
         },
     }
+    return res;
+}
+
+/// Copies a rasterized outline glyph into the main atlas and returns the glyph metadata.
+/// The caller marks the atlas dirty so multiple glyphs can be synced together.
+/// A blank raster glyph still has the advance width so it can stand in for a glyph that is still being rasterized.
+pub fn packOutlineGlyph(g: *gpu.Graphics, font: *Font, render_font: *const RenderFont, glyph_id: u16, raster: RasterGlyph, data: []const u8) Glyph {
+    const scale = render_font.scale_from_ttf;
+    const fc = &g.font_cache;
+
+    var glyph_x: u32 = 0;
+    var glyph_y: u32 = 0;
+    var glyph_width: u32 = 0;
+    var glyph_height: u32 = 0;
+    if (raster.width > 0) {
+        glyph_width = raster.width + h_padding;
+        glyph_height = raster.height + v_padding;
+
+        const pos = fc.main_atlas.allocRect(glyph_width, glyph_height);
+        glyph_x = pos.x;
+        glyph_y = pos.y;
+        fc.main_atlas.copySubImageFrom1Channel(glyph_x + Glyph.Padding, glyph_y + Glyph.Padding, raster.width, raster.height, data[0..raster.width * raster.height]);
+    }
 
-    // log.debug("box {} {} {} {}", .{x0, y0, x1, y1});
+    // log.debug("box {} {} {} {}", .{raster.x0, raster.y0, raster.width, raster.height});
 
     const h_metrics = font.ot_font.getGlyphHMetrics(glyph_id);
     // log.info("adv: {}, lsb: {}", .{h_metrics.advance_width, h_metrics.left_side_bearing});
 
     var glyph = Glyph.init(glyph_id, fc.main_atlas.image);
     glyph.is_color_bitmap = false;
+    glyph.is_sdf = render_font.sdf;
     // Include padding in offsets.
     // glyph.x_offset = scale * @intToFloat(f32, h_metrics.left_side_bearing) - Glyph.Padding;
-    glyph.x_offset = @intToFloat(f32, x0) - Glyph.Padding;
-    // log.warn("lsb: {} x: {}", .{scale * @intToFloat(f32, h_metrics.left_side_bearing), x0});
-    glyph.y_offset = @round(render_font.ascent) - @intToFloat(f32, -y0) - Glyph.Padding;
+    glyph.x_offset = @intToFloat(f32, raster.x0) - Glyph.Padding;
+    // log.warn("lsb: {} x: {}", .{scale * @intToFloat(f32, h_metrics.left_side_bearing), raster.x0});
+    glyph.y_offset = @round(render_font.ascent) - @intToFloat(f32, -raster.y0) - Glyph.Padding;
     glyph.x = glyph_x;
     glyph.y = glyph_y;
     glyph.width = glyph_width;
@@ -201,8 +272,8 @@ fn generateColorBitmapGlyph(g: *gpu.Graphics, ot_font: OpenTypeFont, render_font
         var src_height: c_int = undefined;
         var channels: c_int = undefined;
 
-        // Never flip y for loading font bitmaps.
-        stbi.stbi_set_flip_vertically_on_load(0);
+        // Never flip y for loading font bitmaps. Set per thread like the image loaders since stbi ignores the global flag once a thread sets its own.
+        stbi.stbi_set_flip_vertically_on_load_thread(0);
         const bitmap = stbi.stbi_load_from_memory(&data.png_data[0], @intCast(c_int, data.png_data.len), &src_width, &src_height, &channels, 0);
         defer stbi.stbi_image_free(bitmap);
         // log.debug("color glyph {}x{} {}x{}", .{data.width, data.height, src_width, src_height});
@@ -210,7 +281,7 @@ fn generateColorBitmapGlyph(g: *gpu.Graphics, ot_font: OpenTypeFont, render_font
         const glyph_width = @intCast(u32, src_width) + h_padding;
         const glyph_height = @intCast(u32, src_height) + v_padding;
 
-        const pos = fc.main_atlas.packer.allocRect(glyph_width, glyph_height);
+        const pos = fc.main_atlas.allocRect(glyph_width, glyph_height);
         const glyph_x = pos.x;
         const glyph_y = pos.y;
 
@@ -272,7 +343,7 @@ fn generateEmbeddedBitmapGlyph(g: *gpu.Graphics, ot_font: OpenTypeFont, render_f
         const dst_width: u32 = ot_glyph.width + h_padding;
         const dst_height: u32 = ot_glyph.height + v_padding;
 
-        const dst_pos = fc.bitmap_atlas.packer.allocRect(dst_width, dst_height);
+        const dst_pos = fc.bitmap_atlas.allocRect(dst_width, dst_height);
 
         fc.bitmap_atlas.copySubImageFrom1Channel(dst_pos.x + Glyph.Padding, dst_pos.y + Glyph.Padding, ot_glyph.width, ot_glyph.height, ot_glyph.data);
         fc.bitmap_atlas.markDirtyBuffer();
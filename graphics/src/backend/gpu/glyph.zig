@@ -45,11 +45,18 @@ pub const Glyph = struct {
 
     is_color_bitmap: bool,
 
+    // Alpha holds a signed distance field with the outline at sdf.OnEdgeValue.
+    is_sdf: bool,
+
+    // FontCache frame this glyph was last looked up in. The font atlas evicts the least recently used glyphs.
+    last_used_frame: u32,
+
     pub fn init(glyph_id: u16, image: graphics.ImageTex) @This() {
         return .{
             .glyph_id = glyph_id,
             .image = image,
             .is_color_bitmap = false,
+            .is_sdf = false,
             .u0 = 0,
             .v0 = 0,
             .u1 = 0,
@@ -64,6 +71,7 @@ pub const Glyph = struct {
             .dst_width = 0,
             .dst_height = 0,
             .advance_width = 0,
+            .last_used_frame = 0,
         };
     }
 };
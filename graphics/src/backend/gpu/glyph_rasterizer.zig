@@ -0,0 +1,372 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const builtin = @import("builtin");
+const IsWasm = builtin.target.isWasm();
+const stbtt = @import("stbtt");
+const ft = @import("freetype");
+
+const graphics = @import("../../graphics.zig");
+const gpu = graphics.gpu;
+const FontId = graphics.FontId;
+const Font = graphics.Font;
+const RenderFont = gpu.RenderFont;
+const Glyph = gpu.Glyph;
+const font_cache = @import("font_cache.zig");
+const RenderFontParams = font_cache.RenderFontParams;
+const font_renderer = @import("font_renderer.zig");
+const RasterGlyph = font_renderer.RasterGlyph;
+const t = stdx.testing;
+const log = stdx.log.scoped(.glyph_rasterizer);
+
+/// Rasterizes outline glyphs on worker threads so a burst of cache misses (eg. a page of CJK text) doesn't stall the render thread.
+/// A missed glyph is given a blank placeholder with the correct advance so layout doesn't shift when the real glyph arrives.
+/// Finished glyphs are packed into the atlas together at the start of the next frame which results in one atlas upload.
+/// Workers are only spawned on the first request.
+pub const GlyphRasterizer = struct {
+    alloc: std.mem.Allocator,
+    enabled: bool,
+    workers: []Worker,
+    started_workers: bool,
+
+    /// Guards jobs, results, result_data and closing.
+    mutex: std.Thread.Mutex,
+    has_jobs: std.Thread.Condition,
+    jobs: std.fifo.LinearFifo(Job, .Dynamic),
+    results: std.ArrayListUnmanaged(Result),
+    result_data: std.ArrayListUnmanaged(u8),
+    closing: bool,
+
+    /// Swapped with results and result_data so packing doesn't hold the lock.
+    packing: std.ArrayListUnmanaged(Result),
+    packing_data: std.ArrayListUnmanaged(u8),
+
+    /// Number of requested glyphs that haven't been packed. Only accessed by the render thread.
+    num_pending: u32,
+
+    const MaxWorkers = 4;
+
+    const Job = struct {
+        font_id: FontId,
+        params: RenderFontParams,
+        cp: u21,
+        glyph_id: u16,
+        scale: f32,
+        /// Stbtt font info is read only after init so workers can share a copy.
+        /// Freetype workers load their own face from the font data.
+        face: switch (graphics.FontRendererBackend) {
+            .Freetype => []const u8,
+            .Stbtt => stbtt.fontinfo,
+        },
+    };
+
+    const Result = struct {
+        font_id: FontId,
+        params: RenderFontParams,
+        cp: u21,
+        glyph_id: u16,
+        raster: RasterGlyph,
+        data_start: u32,
+    };
+
+    const Worker = struct {
+        owner: *GlyphRasterizer,
+        thread: std.Thread,
+        /// Scratch memory for the sdf computation. Reset after each glyph.
+        arena: std.heap.ArenaAllocator,
+        buf: std.ArrayList(u8),
+        ft_library: if (graphics.FontRendererBackend == .Freetype) ft.FT_Library else void,
+        ft_faces: if (graphics.FontRendererBackend == .Freetype) std.AutoHashMapUnmanaged(FontId, *ft.Face) else void,
+
+        fn loop(self: *Worker) void {
+            const owner = self.owner;
+            while (true) {
+                owner.mutex.lock();
+                while (owner.jobs.readableLength() == 0 and !owner.closing) {
+                    owner.has_jobs.wait(&owner.mutex);
+                }
+                if (owner.closing) {
+                    owner.mutex.unlock();
+                    return;
+                }
+                const job = owner.jobs.readItem().?;
+                owner.mutex.unlock();
+
+                const raster = self.rasterize(job);
+                _ = self.arena.reset(.retain_capacity);
+
+                owner.mutex.lock();
+                defer owner.mutex.unlock();
+                const data_start = @intCast(u32, owner.result_data.items.len);
+                owner.result_data.appendSlice(std.heap.page_allocator, self.buf.items[0..raster.width * raster.height]) catch stdx.fatal();
+                owner.results.append(std.heap.page_allocator, .{
+                    .font_id = job.font_id,
+                    .params = job.params,
+                    .cp = job.cp,
+                    .glyph_id = job.glyph_id,
+                    .raster = raster,
+                    .data_start = data_start,
+                }) catch stdx.fatal();
+            }
+        }
+
+        fn rasterize(self: *Worker, job: Job) RasterGlyph {
+            const alloc = self.arena.allocator();
+            switch (graphics.FontRendererBackend) {
+                .Freetype => {
+                    const res = self.ft_faces.getOrPut(std.heap.page_allocator, job.font_id) catch stdx.fatal();
+                    if (!res.found_existing) {
+                        const err = ft.FT_New_Memory_Face(self.ft_library, job.face.ptr, @intCast(c_long, job.face.len), 0, @ptrCast([*c][*c]ft.Face, res.value_ptr));
+                        if (err != 0) {
+                            stdx.panicFmt("freetype error {}: {s}", .{err, ft.FT_Error_String(err)});
+                        }
+                    }
+                    return font_renderer.rasterizeOutlineGlyph(alloc, res.value_ptr.*, job.params.size, job.scale, job.params.sdf, true, job.glyph_id, &self.buf);
+                },
+                .Stbtt => {
+                    return font_renderer.rasterizeOutlineGlyph(alloc, &job.face, job.params.size, job.scale, job.params.sdf, true, job.glyph_id, &self.buf);
+                },
+            }
+        }
+
+        fn deinit(self: *Worker) void {
+            self.arena.deinit();
+            self.buf.deinit();
+            if (graphics.FontRendererBackend == .Freetype) {
+                // Also frees the faces.
+                _ = ft.FT_Done_FreeType(self.ft_library);
+                self.ft_faces.deinit(std.heap.page_allocator);
+            }
+        }
+    };
+
+    /// Worker memory uses the page allocator since the provided allocator isn't required to be thread safe.
+    pub fn init(alloc: std.mem.Allocator) GlyphRasterizer {
+        return .{
+            .alloc = alloc,
+            .enabled = false,
+            .workers = &.{},
+            .started_workers = false,
+            .mutex = .{},
+            .has_jobs = .{},
+            .jobs = std.fifo.LinearFifo(Job, .Dynamic).init(std.heap.page_allocator),
+            .results = .{},
+            .result_data = .{},
+            .closing = false,
+            .packing = .{},
+            .packing_data = .{},
+            .num_pending = 0,
+        };
+    }
+
+    pub fn deinit(self: *GlyphRasterizer) void {
+        if (self.started_workers) {
+            self.mutex.lock();
+            self.closing = true;
+            self.mutex.unlock();
+            self.has_jobs.broadcast();
+            for (self.workers) |*worker| {
+                worker.thread.join();
+                worker.deinit();
+            }
+            self.alloc.free(self.workers);
+        }
+        self.jobs.deinit();
+        self.results.deinit(std.heap.page_allocator);
+        self.result_data.deinit(std.heap.page_allocator);
+        self.packing.deinit(std.heap.page_allocator);
+        self.packing_data.deinit(std.heap.page_allocator);
+    }
+
+    /// Rasterizing on workers is not available on wasm.
+    pub fn setEnabled(self: *GlyphRasterizer, enabled: bool) void {
+        self.enabled = enabled and !IsWasm and !builtin.single_threaded;
+    }
+
+    fn startWorkers(self: *GlyphRasterizer) !void {
+        const num_workers = @min(std.Thread.getCpuCount() catch 1, MaxWorkers);
+        self.workers = try self.alloc.alloc(Worker, num_workers);
+        for (self.workers) |*worker| {
+            worker.* = .{
+                .owner = self,
+                .thread = undefined,
+                .arena = std.heap.ArenaAllocator.init(std.heap.page_allocator),
+                .buf = std.ArrayList(u8).init(std.heap.page_allocator),
+                .ft_library = undefined,
+                .ft_faces = if (graphics.FontRendererBackend == .Freetype) .{} else {},
+            };
+            if (graphics.FontRendererBackend == .Freetype) {
+                const err = ft.FT_Init_FreeType(&worker.ft_library);
+                if (err != 0) {
+                    stdx.panicFmt("freetype error: {}", .{err});
+                }
+            }
+            worker.thread = try std.Thread.spawn(.{}, Worker.loop, .{worker});
+        }
+        self.started_workers = true;
+    }
+
+    /// Only fonts that rasterize purely from outlines are done on workers. Bitmap and color glyphs are cheap to generate in comparison.
+    pub fn canRasterize(self: GlyphRasterizer, font: *const Font) bool {
+        return self.enabled and font.font_type == .Outline and !font.ot_font.hasEmbeddedBitmap() and !font.ot_font.hasColorBitmap() and font.ot_font.hasGlyphOutlines();
+    }
+
+    /// Queues the glyph and returns a blank placeholder glyph to draw in the meantime.
+    pub fn request(self: *GlyphRasterizer, g: *gpu.Graphics, font: *Font, render_font: *const RenderFont, cp: u21, glyph_id: u16) Glyph {
+        if (!self.started_workers) {
+            self.startWorkers() catch stdx.fatal();
+        }
+        const job = Job{
+            .font_id = font.id,
+            .params = .{
+                .size = render_font.render_font_size,
+                .sdf = render_font.sdf,
+            },
+            .cp = cp,
+            .glyph_id = glyph_id,
+            .scale = render_font.scale_from_ttf,
+            .face = switch (graphics.FontRendererBackend) {
+                .Freetype => font.data,
+                .Stbtt => font.impl,
+            },
+        };
+        self.pushJob(job);
+
+        const blank = RasterGlyph{ .x0 = 0, .y0 = 0, .width = 0, .height = 0 };
+        return font_renderer.packOutlineGlyph(g, font, render_font, glyph_id, blank, &.{});
+    }
+
+    fn pushJob(self: *GlyphRasterizer, job: Job) void {
+        self.mutex.lock();
+        self.jobs.writeItem(job) catch stdx.fatal();
+        self.mutex.unlock();
+        self.has_jobs.signal();
+        self.num_pending += 1;
+    }
+
+    pub fn hasPendingGlyphs(self: GlyphRasterizer) bool {
+        return self.num_pending > 0;
+    }
+
+    /// Replaces placeholders with the glyphs finished since the last call. The atlas is marked dirty once for all of them.
+    pub fn packFinishedGlyphs(self: *GlyphRasterizer, g: *gpu.Graphics) void {
+        if (self.num_pending == 0) {
+            return;
+        }
+        self.mutex.lock();
+        std.mem.swap(std.ArrayListUnmanaged(Result), &self.results, &self.packing);
+        std.mem.swap(std.ArrayListUnmanaged(u8), &self.result_data, &self.packing_data);
+        self.mutex.unlock();
+        defer {
+            self.packing.clearRetainingCapacity();
+            self.packing_data.clearRetainingCapacity();
+        }
+
+        const fc = &g.font_cache;
+        if (self.packing.items.len > 0) {
+            // Recorded draws still have the placeholders.
+            g.recording_version +%= 1;
+        }
+        var packed_any = false;
+        for (self.packing.items) |res| {
+            self.num_pending -= 1;
+            const font = fc.getFont(res.font_id);
+            const render_font = fc.getOrCreateRenderFont(res.font_id, res.params);
+            const data = self.packing_data.items[res.data_start..res.data_start + res.raster.width * res.raster.height];
+            var glyph = font_renderer.packOutlineGlyph(g, font, render_font, res.glyph_id, res.raster, data);
+            glyph.last_used_frame = fc.frame;
+            _ = render_font.putGlyph(res.cp, glyph);
+            if (res.raster.width > 0) {
+                packed_any = true;
+            }
+        }
+        if (packed_any) {
+            fc.main_atlas.markDirtyBuffer();
+        }
+    }
+};
+
+const TestFace = switch (graphics.FontRendererBackend) {
+    .Freetype => struct {
+        lib: ft.FT_Library,
+        face: *ft.Face,
+    },
+    .Stbtt => struct {
+        face: stbtt.fontinfo,
+    },
+};
+
+test "GlyphRasterizer workers match serial rasterization" {
+    var r = GlyphRasterizer.init(t.alloc);
+    defer r.deinit();
+    r.setEnabled(true);
+    if (!r.enabled) {
+        return error.SkipZigTest;
+    }
+    try r.startWorkers();
+
+    const vera_ttf = @embedFile("../../assets/vera.ttf");
+    const ot_font = try graphics.OpenTypeFont.init(t.alloc, vera_ttf, 0);
+    defer ot_font.deinit();
+    const size: u16 = 32;
+    const scale = ot_font.getScaleToUserFontSize(@intToFloat(f32, size));
+
+    var serial_face: TestFace = undefined;
+    switch (graphics.FontRendererBackend) {
+        .Freetype => {
+            var err = ft.FT_Init_FreeType(&serial_face.lib);
+            try t.eq(err, 0);
+            err = ft.FT_New_Memory_Face(serial_face.lib, vera_ttf.ptr, @intCast(c_long, vera_ttf.len), 0, @ptrCast([*c][*c]ft.Face, &serial_face.face));
+            try t.eq(err, 0);
+        },
+        .Stbtt => try stbtt.InitFont(&serial_face.face, vera_ttf, 0),
+    }
+    defer {
+        if (graphics.FontRendererBackend == .Freetype) {
+            _ = ft.FT_Done_FreeType(serial_face.lib);
+        }
+    }
+
+    const cps = "abgQ@ ";
+    for (cps) |cp| {
+        r.pushJob(.{
+            .font_id = 0,
+            .params = .{ .size = size, .sdf = false },
+            .cp = cp,
+            .glyph_id = (try ot_font.getGlyphId(cp)).?,
+            .scale = scale,
+            .face = switch (graphics.FontRendererBackend) {
+                .Freetype => vera_ttf,
+                .Stbtt => serial_face.face,
+            },
+        });
+    }
+
+    // Wait for the workers. Results can arrive in any order.
+    var waited_ms: u32 = 0;
+    while (true) {
+        r.mutex.lock();
+        const num_results = r.results.items.len;
+        r.mutex.unlock();
+        if (num_results == cps.len) {
+            break;
+        }
+        try t.expect(waited_ms < 10000);
+        std.time.sleep(std.time.ns_per_ms);
+        waited_ms += 1;
+    }
+
+    var arena = std.heap.ArenaAllocator.init(t.alloc);
+    defer arena.deinit();
+    var buf = std.ArrayList(u8).init(t.alloc);
+    defer buf.deinit();
+    for (r.results.items) |res| {
+        const face = switch (graphics.FontRendererBackend) {
+            .Freetype => serial_face.face,
+            .Stbtt => &serial_face.face,
+        };
+        const exp = font_renderer.rasterizeOutlineGlyph(arena.allocator(), face, size, scale, false, true, res.glyph_id, &buf);
+        try t.eq(res.raster, exp);
+        const data = r.result_data.items[res.data_start..res.data_start + res.raster.width * res.raster.height];
+        try t.eqSlice(u8, data, buf.items[0..exp.width * exp.height]);
+    }
+}
@@ -0,0 +1,136 @@
+const std = @import("std");
+
+const graphics = @import("graphics");
+const Color = graphics.Color;
+const gpu = graphics.gpu;
+const Mesh = gpu.Mesh;
+const VertexData = gpu.VertexData;
+const TexShaderVertex = gpu.TexShaderVertex;
+const GlyphRun = gpu.GlyphRun;
+
+// Compares pushing one glyph quad at a time through VertexData against GlyphRun's batched quads for a 10k glyph paragraph.
+// Glyphs are synthetic since resolving real glyphs requires a gpu context. Only quad generation and the vertex writes are measured.
+// Run with: zig build run -Dpath="graphics/src/backend/gpu/glyph_run.bench.zig" -Dgraphics -Doptimize=ReleaseFast
+
+const NumGlyphs = 10000;
+const NumRuns = 200;
+
+/// Stays below the mesh's vertex buffer size.
+const GlyphsPerFlush = 1024;
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const alloc = gpa.allocator();
+
+    var run = GlyphRun.init();
+    defer run.deinit(alloc);
+    try initParagraph(alloc, &run);
+
+    var mesh = Mesh.init(alloc, &.{}, &.{});
+    defer mesh.deinit();
+
+    std.debug.print("glyphs: {}, runs: {}\n", .{ NumGlyphs, NumRuns });
+    std.debug.print("{s:>12} {s:>12} {s:>10}\n", .{ "method", "ns/glyph", "speedup" });
+    const base_ns = try runScalar(&mesh, &run);
+    std.debug.print("{s:>12} {d:>12.3} {d:>10.2}\n", .{ "scalar", base_ns, 1.0 });
+    const ns = try runBatched(&mesh, &run);
+    std.debug.print("{s:>12} {d:>12.3} {d:>10.2}\n", .{ "batched", ns, base_ns / ns });
+}
+
+/// Lines of 80 glyphs with varying advances and sizes.
+fn initParagraph(alloc: std.mem.Allocator, run: *GlyphRun) !void {
+    var rand = std.rand.DefaultPrng.init(0);
+    const r = rand.random();
+    var x: f32 = 0;
+    var y: f32 = 0;
+    var i: u32 = 0;
+    while (i < NumGlyphs) : (i += 1) {
+        if (i % 80 == 0) {
+            x = 0;
+            y += 20;
+        }
+        const width = 4 + r.float(f32) * 8;
+        try run.glyphs.append(alloc, .{
+            .pen_x = x,
+            .offset_x = r.float(f32),
+            .y0 = y + r.float(f32) * 4,
+            .width = width,
+            .height = 10 + r.float(f32) * 4,
+            .u0 = r.float(f32),
+            .v0 = r.float(f32),
+            .u1 = r.float(f32),
+            .v1 = r.float(f32),
+            .image = .{ .image_id = 0, .tex_id = 0 },
+            .is_color_bitmap = false,
+            .is_sdf = false,
+            .color = Color.Black,
+            .x0 = undefined,
+            .x1 = undefined,
+            .y1 = undefined,
+        });
+        x += width + 1.3;
+    }
+}
+
+/// Same approach as the previous per codepoint quad path.
+fn runScalar(mesh: *Mesh, run: *const GlyphRun) !f64 {
+    const s = run.glyphs.slice();
+    var vert: TexShaderVertex = undefined;
+    var vdata: VertexData(4, 6) = undefined;
+
+    var timer = try std.time.Timer.start();
+    var n: u32 = 0;
+    while (n < NumRuns) : (n += 1) {
+        mesh.reset();
+        var i: usize = 0;
+        while (i < s.len) : (i += 1) {
+            if (i % GlyphsPerFlush == 0) {
+                mesh.reset();
+            }
+            const x0 = @round(s.items(.pen_x)[i] + s.items(.offset_x)[i]);
+            const x1 = x0 + s.items(.width)[i];
+            const y0 = s.items(.y0)[i];
+            const y1 = y0 + s.items(.height)[i];
+            const u0 = s.items(.u0)[i];
+            const v0 = s.items(.v0)[i];
+            const u1 = s.items(.u1)[i];
+            const v1 = s.items(.v1)[i];
+            vert.setColor(s.items(.color)[i]);
+
+            vert.setXY(x0, y0);
+            vert.setUV(u0, v0);
+            vdata.verts[0] = vert;
+            vert.setXY(x1, y0);
+            vert.setUV(u1, v0);
+            vdata.verts[1] = vert;
+            vert.setXY(x1, y1);
+            vert.setUV(u1, v1);
+            vdata.verts[2] = vert;
+            vert.setXY(x0, y1);
+            vert.setUV(u0, v1);
+            vdata.verts[3] = vert;
+            vdata.setRect(0, 0, 1, 2, 3);
+            mesh.pushVertexData(4, 6, &vdata);
+        }
+        std.mem.doNotOptimizeAway(mesh.vert_buf[0]);
+    }
+    return @intToFloat(f64, timer.read()) / NumRuns / NumGlyphs;
+}
+
+fn runBatched(mesh: *Mesh, run: *GlyphRun) !f64 {
+    var timer = try std.time.Timer.start();
+    var n: u32 = 0;
+    while (n < NumRuns) : (n += 1) {
+        run.computeQuads(true);
+        var i: usize = 0;
+        while (i < run.len()) {
+            const end = @min(i + GlyphsPerFlush, run.len());
+            mesh.reset();
+            run.writeQuads(i, end, mesh);
+            i = end;
+        }
+        std.mem.doNotOptimizeAway(mesh.vert_buf[0]);
+    }
+    return @intToFloat(f64, timer.read()) / NumRuns / NumGlyphs;
+}
@@ -0,0 +1,192 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const t = stdx.testing;
+
+const graphics = @import("../../graphics.zig");
+const Color = graphics.Color;
+const ImageTex = @import("image.zig").ImageTex;
+const TexShaderVertex = @import("vertex.zig").TexShaderVertex;
+const Mesh = @import("mesh.zig").Mesh;
+
+/// Number of glyphs computed together.
+const Lanes = 8;
+const Vf = @Vector(Lanes, f32);
+
+/// Glyphs of a text run resolved ahead of time and stored as struct of arrays.
+/// Resolving the glyphs (font lookup and kerning) is sequential but the quad corners
+/// are then computed several glyphs at a time and written straight into the vertex buffer.
+pub const GlyphRun = struct {
+    glyphs: std.MultiArrayList(RunGlyph),
+
+    /// Pen position after the last glyph appended.
+    end_x: f32,
+    /// Last codepoint appended so the next segment can kern with it.
+    last_cp: ?u21,
+
+    pub const RunGlyph = struct {
+        /// Pen position after kerning. Already snapped if snapping was requested.
+        pen_x: f32,
+        /// Glyph offsets and dimensions scaled to the user font size.
+        offset_x: f32,
+        y0: f32,
+        width: f32,
+        height: f32,
+        u0: f32,
+        v0: f32,
+        u1: f32,
+        v1: f32,
+        image: ImageTex,
+        is_color_bitmap: bool,
+        is_sdf: bool,
+        color: Color,
+
+        /// Set by computeQuads.
+        x0: f32,
+        x1: f32,
+        y1: f32,
+    };
+
+    pub fn init() GlyphRun {
+        return .{
+            .glyphs = .{},
+            .end_x = 0,
+            .last_cp = null,
+        };
+    }
+
+    pub fn deinit(self: *GlyphRun, alloc: std.mem.Allocator) void {
+        self.glyphs.deinit(alloc);
+    }
+
+    pub fn clear(self: *GlyphRun) void {
+        self.glyphs.shrinkRetainingCapacity(0);
+        self.end_x = 0;
+        self.last_cp = null;
+    }
+
+    pub fn len(self: GlyphRun) usize {
+        return self.glyphs.len;
+    }
+
+    /// Computes x0, x1 and y1 for every glyph.
+    pub fn computeQuads(self: *GlyphRun, comptime snap_to_grid: bool) void {
+        const s = self.glyphs.slice();
+        const pen_x = s.items(.pen_x);
+        const offset_x = s.items(.offset_x);
+        const y0 = s.items(.y0);
+        const width = s.items(.width);
+        const height = s.items(.height);
+        const x0 = s.items(.x0);
+        const x1 = s.items(.x1);
+        const y1 = s.items(.y1);
+
+        var i: usize = 0;
+        while (i + Lanes <= s.len) : (i += Lanes) {
+            var vx0: Vf = pen_x[i..][0..Lanes].*;
+            vx0 += @as(Vf, offset_x[i..][0..Lanes].*);
+            if (snap_to_grid) {
+                // Snap to pixel for consistent glyph rendering.
+                vx0 = @round(vx0);
+            }
+            x0[i..][0..Lanes].* = vx0;
+            x1[i..][0..Lanes].* = vx0 + @as(Vf, width[i..][0..Lanes].*);
+            y1[i..][0..Lanes].* = @as(Vf, y0[i..][0..Lanes].*) + @as(Vf, height[i..][0..Lanes].*);
+        }
+        while (i < s.len) : (i += 1) {
+            x0[i] = pen_x[i] + offset_x[i];
+            if (snap_to_grid) {
+                x0[i] = @round(x0[i]);
+            }
+            x1[i] = x0[i] + width[i];
+            y1[i] = y0[i] + height[i];
+        }
+    }
+
+    /// Returns the end of the glyphs from start that can be drawn with the same texture and shader.
+    pub fn getBatchEnd(self: GlyphRun, start: usize) usize {
+        const s = self.glyphs.slice();
+        const images = s.items(.image);
+        const is_sdf = s.items(.is_sdf);
+        var end = start + 1;
+        while (end < s.len) : (end += 1) {
+            if (images[end].tex_id != images[start].tex_id or is_sdf[end] != is_sdf[start]) {
+                break;
+            }
+        }
+        return end;
+    }
+
+    /// Writes quads for glyphs in [start, end) into the mesh. The caller ensures there is enough space.
+    /// Same vertex order and winding as VertexData.setRect.
+    pub fn writeQuads(self: GlyphRun, start: usize, end: usize, mesh: *Mesh) void {
+        const s = self.glyphs.slice();
+        const x0 = s.items(.x0);
+        const y0 = s.items(.y0);
+        const x1 = s.items(.x1);
+        const y1 = s.items(.y1);
+        const u0 = s.items(.u0);
+        const v0 = s.items(.v0);
+        const u1 = s.items(.u1);
+        const v1 = s.items(.v1);
+        const colors = s.items(.color);
+
+        var vi = mesh.cur_vert_buf_size;
+        var ii = mesh.cur_index_buf_size;
+        const verts = mesh.vert_buf;
+        const idxes = mesh.index_buf;
+        var vert: TexShaderVertex = undefined;
+        var i = start;
+        while (i < end) : (i += 1) {
+            vert.setColor(colors[i]);
+            mesh.enclosePos(x0[i], y0[i]);
+            mesh.enclosePos(x1[i], y1[i]);
+
+            // top left
+            vert.setXY(x0[i], y0[i]);
+            vert.setUV(u0[i], v0[i]);
+            verts[vi] = vert;
+            // top right
+            vert.setXY(x1[i], y0[i]);
+            vert.setUV(u1[i], v0[i]);
+            verts[vi + 1] = vert;
+            // bottom right
+            vert.setXY(x1[i], y1[i]);
+            vert.setUV(u1[i], v1[i]);
+            verts[vi + 2] = vert;
+            // bottom left
+            vert.setXY(x0[i], y1[i]);
+            vert.setUV(u0[i], v1[i]);
+            verts[vi + 3] = vert;
+
+            idxes[ii..][0..6].* = .{ vi, vi + 3, vi + 2, vi + 2, vi + 1, vi };
+            vi += 4;
+            ii += 6;
+        }
+        mesh.cur_vert_buf_size = vi;
+        mesh.cur_index_buf_size = ii;
+    }
+};
+
+test "GlyphRun.computeQuads" {
+    var run = GlyphRun.init();
+    defer run.deinit(t.alloc);
+    // More than one vector of glyphs plus a remainder.
+    var i: u32 = 0;
+    while (i < Lanes + 3) : (i += 1) {
+        var glyph: GlyphRun.RunGlyph = undefined;
+        glyph.pen_x = @intToFloat(f32, i) * 10;
+        glyph.offset_x = 0.4;
+        glyph.y0 = 5;
+        glyph.width = 8;
+        glyph.height = 12;
+        try run.glyphs.append(t.alloc, glyph);
+    }
+    run.computeQuads(true);
+    const s = run.glyphs.slice();
+    i = 0;
+    while (i < Lanes + 3) : (i += 1) {
+        try t.eq(s.items(.x0)[i], @intToFloat(f32, i) * 10);
+        try t.eq(s.items(.x1)[i], @intToFloat(f32, i) * 10 + 8);
+        try t.eq(s.items(.y1)[i], 17);
+    }
+}
@@ -39,26 +39,40 @@ const FontId = graphics.FontId;
 const FontGroupId = graphics.FontGroupId;
 const mesh_ = @import("mesh.zig");
 pub const Mesh = mesh_.Mesh;
-const VertexData = mesh_.VertexData;
+pub const VertexData = mesh_.VertexData;
 const vertex = @import("vertex.zig");
 pub const TexShaderVertex = vertex.TexShaderVertex;
 const batcher = @import("batcher.zig");
 const Batcher = batcher.Batcher;
+pub const DrawRecording = batcher.DrawRecording;
 const text_renderer = @import("text_renderer.zig");
 pub const TextGlyphIterator = text_renderer.TextGlyphIterator;
-const RenderTextIterator = text_renderer.RenderTextIterator;
+pub const GlyphRun = @import("glyph_run.zig").GlyphRun;
 const svg = graphics.svg;
 const stroke = @import("stroke.zig");
 const tessellator = @import("../../tessellator.zig");
 const Tessellator = tessellator.Tessellator;
+const ParallelTessellator = tessellator.ParallelTessellator;
+const tess_cache = @import("tess_cache.zig");
+pub const TessCache = tess_cache.TessCache;
+const TessResult = tess_cache.TessResult;
+const TessKey = tess_cache.TessKey;
+const TessBatch = tess_cache.TessBatch;
+const retained = @import("retained.zig");
+const GlyphRasterizer = @import("glyph_rasterizer.zig").GlyphRasterizer;
+const RetainedDrawListId = graphics.RetainedDrawListId;
 pub const RenderFont = @import("render_font.zig").RenderFont;
 pub const Glyph = @import("glyph.zig").Glyph;
+pub const FontAtlasStats = @import("font_atlas.zig").FontAtlasStats;
 const gvk = graphics.vk;
 const ggl = graphics.gl;
 const VkContext = gvk.VkContext;
 const image = @import("image.zig");
 pub const ImageStore = image.ImageStore;
 pub const Image = image.Image;
+pub const DecodedImage = image.DecodedImage;
+pub const decodeImage = image.decodeImage;
+pub const MaxAtlasImageSize = image.MaxAtlasImageSize;
 pub const ImageTex = image.ImageTex;
 pub const TextureId = image.TextureId;
 pub const shader = @import("shader.zig");
@@ -69,6 +83,9 @@ const vera_ttf = @embedFile("../../assets/vera.ttf");
 const IsWasm = builtin.target.isWasm();
 const NullId = std.math.maxInt(u32);
 
+/// Keeps each vertex buffer reservation well below the batcher's max buffer size.
+const MaxGlyphQuadsPerWrite = 1024;
+
 /// Should be agnostic to viewport dimensions so it can be reused to draw on different viewports.
 pub const Graphics = struct {
     alloc: std.mem.Allocator,
@@ -124,10 +141,25 @@ pub const Graphics = struct {
     dpr_ceil: u8,
 
     tessellator: Tessellator,
+    /// Used by fillPolygons for large polygon sets.
+    par_tessellator: ParallelTessellator,
+    /// Batch for output from the single threaded tessellator.
+    tess_batch: [1]TessBatch,
+    tess_cache: TessCache,
+
+    retained_lists: retained.RetainedDrawLists,
+    retained_builder: retained.RetainedDrawListBuilder,
+    /// Incremented whenever glyphs or images that a DrawRecording can refer to are evicted, moved, replaced or removed.
+    /// Recordings from an older version aren't replayed.
+    recording_version: u32,
     debugTessellator: if (builtin.mode == .Debug) Tessellator else void,
 
     /// Temporary buffer used to rasterize a glyph by a backend (eg. stbtt).
     raster_glyph_buffer: std.ArrayList(u8),
+    glyph_rasterizer: GlyphRasterizer,
+
+    /// Glyphs of the text being drawn.
+    glyph_run: GlyphRun,
 
     /// Currently one directional light. HDR light intensity.
     light_color: Vec3 = Vec3.init(5, 5, 5),
@@ -140,7 +172,7 @@ pub const Graphics = struct {
         self.batcher = Batcher.initGL(alloc, renderer, &self.image_store, stats);
     }
 
-    pub fn initVK(self: *Graphics, alloc: std.mem.Allocator, dpr: f32, renderer: *gvk.Renderer, vk_ctx: VkContext) !void {
+    pub fn initVK(self: *Graphics, alloc: std.mem.Allocator, dpr: f32, renderer: *gvk.Renderer, vk_ctx: VkContext, stats: *graphics.FrameStats) !void {
         const physical = vk_ctx.physical;
         const device = vk_ctx.device;
         const fb_size = renderer.fb_size;
@@ -153,8 +185,9 @@ pub const Graphics = struct {
         const desc_pool = renderer.desc_pool;
         try self.initCommon(alloc);
 
-        const vert_buf = gvk.buffer.createVertexBuffer(physical, device, 40 * 80000);
-        const index_buf = gvk.buffer.createIndexBuffer(physical, device, 2 * 120000 * 3);
+        // A region for each frame in flight.
+        const vert_buf = gvk.buffer.createVertexBuffer(physical, device, gvk.MaxActiveFrames * mesh_.MaxVertexBufferSize * @sizeOf(TexShaderVertex));
+        const index_buf = gvk.buffer.createIndexBuffer(physical, device, gvk.MaxActiveFrames * mesh_.MaxIndexBufferSize * @sizeOf(u32));
         // TODO: Move buffer management into Batcher.
         const mats_buf = gvk.buffer.createStorageBuffer(physical, device, batcher.MatBufferInitialSizeBytes);
         const materials_buf = gvk.buffer.createStorageBuffer(physical, device, batcher.MaterialBufferInitialSizeBytes);
@@ -175,6 +208,10 @@ pub const Graphics = struct {
             self.inner.pipelines.tex_pipeline = gvk.createTexPipeline(device, pass, fb_size, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout, vert_spv, frag_spv, true, false);
             self.inner.pipelines.tex_pipeline_2d = gvk.createTexPipeline(device, pass, fb_size, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout, vert_spv, frag_spv, false, false);
             self.inner.pipelines.wireframe_pipeline = gvk.createTexPipeline(device, pass, fb_size, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout, vert_spv, frag_spv, true, true);
+
+            const sdf_frag_spv = try shader.compileGLSL(alloc, .Fragment, gvk.shaders.sdf_frag_glsl, .{});
+            defer alloc.free(sdf_frag_spv);
+            self.inner.pipelines.sdf_pipeline_2d = gvk.createTexPipeline(device, pass, fb_size, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout, vert_spv, sdf_frag_spv, false, false);
         }
         self.inner.pipelines.norm_pipeline = try gvk.createNormPipeline(alloc, device, pass, fb_size);
         self.inner.pipelines.anim_pipeline = try gvk.createAnimPipeline(alloc, device, pass, fb_size, self.inner.mats_desc_set_layout, self.inner.tex_desc_set_layout);
@@ -187,7 +224,7 @@ pub const Graphics = struct {
         self.inner.pipelines.shadow_pipeline = try gvk.createShadowPipeline(alloc, device, shadow_pass, shadow_dim, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout);
         self.inner.pipelines.anim_shadow_pipeline = try gvk.createAnimShadowPipeline(alloc, device, shadow_pass, shadow_dim, self.inner.tex_desc_set_layout, self.inner.mats_desc_set_layout);
 
-        try self.batcher.initVK(alloc, vert_buf, index_buf, mats_buf, mats_desc_set, materials_buf, materials_desc_set, vk_ctx, renderer, self.inner.pipelines, &self.image_store);
+        try self.batcher.initVK(alloc, vert_buf, index_buf, mats_buf, mats_desc_set, materials_buf, materials_desc_set, vk_ctx, renderer, self.inner.pipelines, &self.image_store, stats);
         for (self.batcher.inner.batcher_frames) |frame| {
             frame.host_cam_buf.light_color = self.light_color;
             frame.host_cam_buf.light_vec = self.light_vec;
@@ -215,13 +252,22 @@ pub const Graphics = struct {
             .dpr = dpr,
             .dpr_ceil = @floatToInt(u8, std.math.ceil(dpr)),
             .tessellator = undefined,
+            .par_tessellator = undefined,
+            .tess_batch = undefined,
+            .tess_cache = TessCache.init(alloc, TessCache.DefaultMaxBytes),
+            .retained_lists = retained.RetainedDrawLists.init(alloc),
+            .retained_builder = retained.RetainedDrawListBuilder.init(),
+            .recording_version = 0,
             .debugTessellator = undefined,
             .raster_glyph_buffer = std.ArrayList(u8).init(alloc),
+            .glyph_rasterizer = GlyphRasterizer.init(alloc),
+            .glyph_run = GlyphRun.init(),
         };
     }
 
     fn initCommon(self: *Graphics, alloc: std.mem.Allocator) !void {
         self.tessellator.init(alloc);
+        try self.par_tessellator.init(alloc, 0);
         if (builtin.mode == .Debug) {
             self.debugTessellator.init(alloc);
         }
@@ -267,6 +313,8 @@ pub const Graphics = struct {
             },
             else => {},
         }
+        // Stop the workers before the fonts they reference are freed.
+        self.glyph_rasterizer.deinit();
         self.batcher.deinit(self.alloc);
         self.font_cache.deinit();
 
@@ -280,10 +328,15 @@ pub const Graphics = struct {
         self.image_store.deinit();
 
         self.tessellator.deinit();
+        self.par_tessellator.deinit();
+        self.tess_cache.deinit();
+        self.retained_lists.deinit(self);
+        self.retained_builder.deinit(self.alloc);
         if (builtin.mode == .Debug) {
             self.debugTessellator.deinit();
         }
         self.raster_glyph_buffer.deinit();
+        self.glyph_run.deinit(self.alloc);
     }
 
     pub fn addFontOTB(self: *Graphics, data: []const graphics.BitmapFontData) FontId {
@@ -303,6 +356,41 @@ pub const Graphics = struct {
         try self.ps.fallback_fonts.appendSlice(self.alloc, fonts);
     }
 
+    pub fn setSdfGlyphs(self: *Graphics, sdf_glyphs: bool) void {
+        self.font_cache.setSdfGlyphs(sdf_glyphs);
+    }
+
+    pub fn setAsyncGlyphs(self: *Graphics, async_glyphs: bool) void {
+        self.glyph_rasterizer.setEnabled(async_glyphs);
+    }
+
+    /// Whether glyphs are still being rasterized and another frame is needed to draw them.
+    pub fn hasPendingGlyphs(self: *Graphics) bool {
+        return self.glyph_rasterizer.hasPendingGlyphs();
+    }
+
+    /// Whether async images are still being uploaded and another frame is needed to draw them.
+    pub fn hasPendingImageUploads(self: *Graphics) bool {
+        return self.image_store.uploader.hasPendingUploads();
+    }
+
+    /// Sets the max number of bytes of async images uploaded per frame.
+    pub fn setImageUploadBudget(self: *Graphics, bytes: u32) void {
+        self.image_store.uploader.frame_budget = bytes;
+    }
+
+    pub fn setDeferredBatching(self: *Graphics, deferred: bool) void {
+        self.batcher.setDeferred(deferred);
+    }
+
+    pub fn setFontAtlasMaxSize(self: *Graphics, max_width: u32, max_height: u32) void {
+        self.font_cache.setAtlasMaxSize(max_width, max_height);
+    }
+
+    pub fn getFontAtlasStats(self: *Graphics) FontAtlasStats {
+        return self.font_cache.main_atlas.getStats();
+    }
+
     pub fn getClipRect(self: *Graphics) geom.Rect {
         return self.ps.clip_rect;
     }
@@ -539,6 +627,10 @@ pub const Graphics = struct {
         text_renderer.measureText(self, group_id, size, self.dpr_ceil, str, res, true);
     }
 
+    pub fn measureTextBatch(self: *Graphics, arr: []*graphics.TextMeasure) void {
+        text_renderer.measureTextBatch(self, arr, self.dpr_ceil, true);
+    }
+
     pub inline fn textGlyphIter(self: *Graphics, font_gid: FontGroupId, size: f32, str: []const u8) graphics.TextGlyphIterator {
         return text_renderer.textGlyphIter(self, font_gid, size, self.dpr_ceil, str);
     }
@@ -551,28 +643,19 @@ pub const Graphics = struct {
     }
 
     pub fn fillTextRunExt(self: *Graphics, x: f32, y: f32, run: graphics.TextRun, opts: graphics.TextOptions) void {
-        var vert: TexShaderVertex = undefined;
-        var vdata: VertexData(4, 6) = undefined;
-
         const start = self.getFillTextStartPos(x, y, run.str, opts);
-        const firstSegment = run.segments[0];
-        var iter = text_renderer.RenderTextIterator.init(self, firstSegment.fontGroupId, firstSegment.fontSize, self.dpr_ceil, start.x, start.y, run.str[firstSegment.start..firstSegment.end]);
-        while (iter.nextCodepointQuad(true)) {
-            self.pushCodepointQuad(&vdata, &vert, iter.quad, firstSegment.color);
-        }
-        for (run.segments[1..]) |segment| {
-            const lastCp = iter.quad.cp;
-            iter = text_renderer.RenderTextIterator.init(self, segment.fontGroupId, segment.fontSize, self.dpr_ceil, iter.x, iter.y, run.str[segment.start..segment.end]);
-
-            const fgroup = self.font_cache.getFontGroup(segment.fontGroupId);
-            const glyph_info = self.font_cache.getOrLoadFontGroupGlyph(self, fgroup, iter.iter.inner.render_font_size, lastCp);
-            iter.iter.inner.prev_glyph_id_opt = glyph_info.glyph.glyph_id;
-            iter.iter.inner.prev_glyph_font = glyph_info.font;
-
-            while (iter.nextCodepointQuad(true)) {
-                self.pushCodepointQuad(&vdata, &vert, iter.quad, segment.color);
+        while (true) {
+            const atlas_version = self.font_cache.atlas_version;
+            self.glyph_run.clear();
+            for (run.segments) |segment| {
+                text_renderer.appendGlyphRun(self, &self.glyph_run, segment.fontGroupId, segment.fontSize, self.dpr_ceil, start.x, start.y, run.str[segment.start..segment.end], segment.color, true);
+            }
+            // Resolve again if glyphs were moved in the atlas while resolving.
+            if (self.font_cache.atlas_version == atlas_version) {
+                break;
             }
         }
+        self.pushGlyphRun();
     }
 
     pub inline fn fillText(self: *Graphics, x: f32, y: f32, str: []const u8) void {
@@ -584,14 +667,17 @@ pub const Graphics = struct {
 
     pub fn fillTextExt(self: *Graphics, x: f32, y: f32, str: []const u8, opts: graphics.TextOptions) void {
         // log.info("draw text '{s}'", .{str});
-        var vert: TexShaderVertex = undefined;
-        var vdata: VertexData(4, 6) = undefined;
-
         const start = self.getFillTextStartPos(x, y, str, opts);
-        var iter = text_renderer.RenderTextIterator.init(self, self.ps.font_gid, self.ps.font_size, self.dpr_ceil, start.x, start.y, str);
-        while (iter.nextCodepointQuad(true)) {
-            self.pushCodepointQuad(&vdata, &vert, iter.quad, self.ps.fill_color);
+        while (true) {
+            const atlas_version = self.font_cache.atlas_version;
+            self.glyph_run.clear();
+            text_renderer.appendGlyphRun(self, &self.glyph_run, self.ps.font_gid, self.ps.font_size, self.dpr_ceil, start.x, start.y, str, self.ps.fill_color, true);
+            // Resolve again if glyphs were moved in the atlas while resolving.
+            if (self.font_cache.atlas_version == atlas_version) {
+                break;
+            }
         }
+        self.pushGlyphRun();
     }
 
     fn getFillTextStartPos(self: *Graphics, x: f32, y: f32, str: []const u8, opts: graphics.TextOptions) Vec2 {
@@ -617,39 +703,32 @@ pub const Graphics = struct {
         return res;
     }
 
-    fn pushCodepointQuad(self: *Graphics, vdata: *VertexData(4, 6), vert: *TexShaderVertex, quad: text_renderer.TextureQuad, color: Color) void {
-        self.setCurrentTexture(quad.image);
-
-        if (quad.is_color_bitmap) {
-            vert.setColor(Color.White);
-        } else {
-            vert.setColor(color);
+    /// Writes the quads of the resolved glyph run into the vertex buffer, one texture batch at a time.
+    fn pushGlyphRun(self: *Graphics) void {
+        const run = &self.glyph_run;
+        run.computeQuads(true);
+        const s = run.glyphs.slice();
+        const images = s.items(.image);
+        const is_sdf = s.items(.is_sdf);
+        var start: usize = 0;
+        while (start < s.len) {
+            const end = run.getBatchEnd(start);
+            if (is_sdf[start]) {
+                self.batcher.beginSdf(images[start]);
+            } else {
+                self.batcher.endSdf();
+                self.setCurrentTexture(images[start]);
+            }
+            var i = start;
+            while (i < end) {
+                const n = @min(end - i, MaxGlyphQuadsPerWrite);
+                self.batcher.ensureUnusedBuffer(n * 4, n * 6);
+                run.writeQuads(i, i + n, &self.batcher.mesh);
+                i += n;
+            }
+            start = end;
         }
-
-        // top left
-        vert.setXY(quad.x0, quad.y0);
-        vert.setUV(quad.u0, quad.v0);
-        vdata.verts[0] = vert.*;
-
-        // top right
-        vert.setXY(quad.x1, quad.y0);
-        vert.setUV(quad.u1, quad.v0);
-        vdata.verts[1] = vert.*;
-
-        // bottom right
-        vert.setXY(quad.x1, quad.y1);
-        vert.setUV(quad.u1, quad.v1);
-        vdata.verts[2] = vert.*;
-
-        // bottom left
-        vert.setXY(quad.x0, quad.y1);
-        vert.setUV(quad.u0, quad.v1);
-        vdata.verts[3] = vert.*;
-
-        // indexes
-        vdata.setRect(0, 0, 1, 2, 3);
-
-        self.pushVertexData(4, 6, vdata);
+        self.batcher.endSdf();
     }
 
     pub inline fn setCurrentTexture(self: *Graphics, image_tex: image.ImageTex) void {
@@ -1182,6 +1261,11 @@ pub const Graphics = struct {
         _ = x;
         _ = y;
 
+        const key = TessCache.hashSvgPath(.FillPathTess2, path.*, 0);
+        if (self.pushCachedTess(key, self.ps.fill_color)) {
+            return;
+        }
+
         // Accumulate polygons.
         self.vec2_helper_buf.clearRetainingCapacity();
         self.vec2_slice_helper_buf.clearRetainingCapacity();
@@ -1347,6 +1431,7 @@ pub const Graphics = struct {
             return;
         }
 
+        self.tess_cache.beginBuild();
         for (self.vec2_slice_helper_buf.items) |polygon_slice| {
             var tess = getTess2Handle();
             const polygon = self.vec2_helper_buf.items[polygon_slice.start..polygon_slice.end];
@@ -1356,40 +1441,30 @@ pub const Graphics = struct {
                 unreachable;
             }
 
-            var gpu_vert: TexShaderVertex = undefined;
-            gpu_vert.setColor(self.ps.fill_color);
-            const vert_offset_id = self.batcher.mesh.getNextIndexId();
-            var nverts = tess2.tessGetVertexCount(tess);
-            var verts = tess2.tessGetVertices(tess);
-            const nelems = tess2.tessGetElementCount(tess);
-
+            const nverts = @intCast(usize, tess2.tessGetVertexCount(tess));
+            const verts = @ptrCast([*]const Vec2, tess2.tessGetVertices(tess))[0..nverts];
+            const nelems = @intCast(usize, tess2.tessGetElementCount(tess));
+            const elems = tess2.tessGetElements(tess)[0..nelems*3];
             // log.debug("poly: {}, {}, {}", .{polygon.len, nverts, nelems});
 
-            self.setCurrentTexture(self.white_tex);
-            self.batcher.ensureUnusedBuffer(@intCast(u32, nverts), @intCast(usize, nelems * 3));
-
-            var i: u32 = 0;
-            while (i < nverts) : (i += 1) {
-                gpu_vert.setXY(verts[i*2], verts[i*2+1]);
-                // log.debug("{},{}", .{gpu_vert.pos_x, gpu_vert.pos_y});
-                gpu_vert.setUV(0, 0);
-                _ = self.batcher.mesh.pushVertex(gpu_vert);
-            }
-            const elems = tess2.tessGetElements(tess);
-            i = 0;
-            while (i < nelems) : (i += 1) {
-                self.batcher.mesh.pushIndex(vert_offset_id + elems[i*3+2]);
-                self.batcher.mesh.pushIndex(vert_offset_id + elems[i*3+1]);
-                self.batcher.mesh.pushIndex(vert_offset_id + elems[i*3]);
-                // log.debug("idx {}", .{elems[i]});
-            }
+            // tess2 outputs the opposite winding.
+            self.tess_cache.appendBuild(verts, elems, true) catch fatal();
         }
+        const res = self.tess_cache.getBuild();
+        self.tess_cache.put(key, res) catch fatal();
+        self.pushTessResult(res, self.ps.fill_color);
     }
 
     fn drawSvgPathLyon(self: *Graphics, x: f32, y: f32, path: *const svg.SvgPath, fill: bool) void {
         // log.debug("drawSvgPath {}", .{path.cmds.len});
         _ = x;
         _ = y;
+        const kind: tess_cache.TessKind = if (fill) .FillPathLyon else .StrokePathLyon;
+        const color = if (fill) self.ps.fill_color else self.ps.stroke_color;
+        const key = TessCache.hashSvgPath(kind, path.*, if (fill) 0 else self.ps.line_width);
+        if (self.pushCachedTess(key, color)) {
+            return;
+        }
         const b = lyon.initBuilder();
         var cur_pos = pt(0, 0);
         var cur_data_idx: u32 = 0;
@@ -1530,15 +1605,20 @@ pub const Graphics = struct {
             }
             last_cmd_was_curveto = cmd_is_curveto;
         }
-        if (fill) {
-            var data = lyon.buildFill(b);
-            self.setCurrentTexture(self.white_tex);
-            self.pushLyonVertexData(&data, self.ps.fill_color);
-        } else {
-            var data = lyon.buildStroke(b, self.ps.line_width);
-            self.setCurrentTexture(self.white_tex);
-            self.pushLyonVertexData(&data, self.ps.stroke_color);
-        }
+        const data = if (fill) lyon.buildFill(b) else lyon.buildStroke(b, self.ps.line_width);
+        self.tess_batch[0] = .{
+            .vert_start = 0,
+            .vert_end = @intCast(u32, data.vertex_len),
+            .idx_start = 0,
+            .idx_end = @intCast(u32, data.index_len),
+        };
+        const res = TessResult{
+            .verts = @ptrCast([*]const Vec2, data.vertex_buf)[0..data.vertex_len],
+            .idxes = data.index_buf[0..data.index_len],
+            .batches = &self.tess_batch,
+        };
+        self.tess_cache.put(key, res) catch fatal();
+        self.pushTessResult(res, color);
     }
 
     /// Points of front face is in ccw order.
@@ -1608,22 +1688,137 @@ pub const Graphics = struct {
     pub fn fillPolygon(self: *Graphics, pts: []const Vec2) !void {
         self.tessellator.clearBuffers();
         try self.tessellator.triangulatePolygon(pts);
-        self.setCurrentTexture(self.white_tex);
-        const out_verts = self.tessellator.out_verts.items;
-        const out_idxes = self.tessellator.out_idxes.items;
-        self.batcher.ensureUnusedBuffer(out_verts.len, out_idxes.len);
-        self.batcher.pushVertIdxBatch(out_verts, out_idxes, self.ps.fill_color);
+        self.pushTessResult(self.getTessellatorResult(), self.ps.fill_color);
+    }
+
+    /// Same as fillPolygon but the output is kept in the tess cache. Only use for polygons that are drawn again unchanged.
+    pub fn fillPolygonCached(self: *Graphics, pts: []const Vec2) !void {
+        const key = TessCache.hashPoints(.Polygon, pts);
+        if (self.pushCachedTess(key, self.ps.fill_color)) {
+            return;
+        }
+        self.tessellator.clearBuffers();
+        try self.tessellator.triangulatePolygon(pts);
+        const res = self.getTessellatorResult();
+        try self.tess_cache.put(key, res);
+        self.pushTessResult(res, self.ps.fill_color);
     }
 
     pub fn fillPolygons(self: *Graphics, pts: []const Vec2, polygons: []const stdx.IndexSlice(u32)) !void {
         // dumpPolygons(self.alloc, self.vec2_slice_helper_buf.items);
+        const res = try self.triangulatePolygons(pts, polygons);
+        self.pushTessResult(res, self.ps.fill_color);
+    }
+
+    /// Same as fillPolygons but the output is cached with a key from TessCache.hashSvgPath or TessCache.hashPoints.
+    /// The caller should check pushCachedTess first.
+    pub fn fillPolygonsCached(self: *Graphics, key: TessKey, pts: []const Vec2, polygons: []const stdx.IndexSlice(u32)) !void {
+        const res = try self.triangulatePolygons(pts, polygons);
+        try self.tess_cache.put(key, res);
+        self.pushTessResult(res, self.ps.fill_color);
+    }
+
+    fn triangulatePolygons(self: *Graphics, pts: []const Vec2, polygons: []const stdx.IndexSlice(u32)) !TessResult {
+        if (polygons.len >= ParallelTessellator.MinParallelPolygons) {
+            try self.par_tessellator.triangulatePolygons2(pts, polygons);
+            return TessResult{
+                .verts = self.par_tessellator.out_verts.items,
+                .idxes = self.par_tessellator.out_idxes.items,
+                .batches = self.par_tessellator.out_batches.items,
+            };
+        }
         self.tessellator.clearBuffers();
         try self.tessellator.triangulatePolygons2(pts, polygons);
-        self.setCurrentTexture(self.white_tex);
+        return self.getTessellatorResult();
+    }
+
+    fn getTessellatorResult(self: *Graphics) TessResult {
         const out_verts = self.tessellator.out_verts.items;
         const out_idxes = self.tessellator.out_idxes.items;
-        self.batcher.ensureUnusedBuffer(out_verts.len, out_idxes.len);
-        self.batcher.pushVertIdxBatch(out_verts, out_idxes, self.ps.fill_color);
+        self.tess_batch[0] = .{
+            .vert_start = 0,
+            .vert_end = @intCast(u32, out_verts.len),
+            .idx_start = 0,
+            .idx_end = @intCast(u32, out_idxes.len),
+        };
+        return .{
+            .verts = out_verts,
+            .idxes = out_idxes,
+            .batches = &self.tess_batch,
+        };
+    }
+
+    /// Returns true if the tessellation for the key was cached and pushed to the batcher.
+    pub fn pushCachedTess(self: *Graphics, key: TessKey, color: Color) bool {
+        if (self.tess_cache.get(key)) |res| {
+            self.batcher.stats.cur_tess_cache_hits += 1;
+            self.pushTessResult(res, color);
+            return true;
+        } else {
+            self.batcher.stats.cur_tess_cache_misses += 1;
+            return false;
+        }
+    }
+
+    fn pushTessResult(self: *Graphics, res: TessResult, color: Color) void {
+        self.setCurrentTexture(self.white_tex);
+        for (res.batches) |batch| {
+            self.batcher.ensureUnusedBuffer(batch.vert_end - batch.vert_start, batch.idx_end - batch.idx_start);
+            self.batcher.pushVertIdxBatch(res.verts[batch.vert_start..batch.vert_end], res.idxes[batch.idx_start..batch.idx_end], color);
+        }
+    }
+
+    pub fn beginRetainedDrawList(self: *Graphics) void {
+        self.retained_builder.reset();
+    }
+
+    pub fn retainPolygon(self: *Graphics, pts: []const Vec2, color: Color) !void {
+        self.tessellator.clearBuffers();
+        try self.tessellator.triangulatePolygon(pts);
+        try self.retained_builder.pushTessResult(self.alloc, self.white_tex, self.getTessellatorResult(), color);
+    }
+
+    pub fn retainPolygons(self: *Graphics, pts: []const Vec2, polygons: []const stdx.IndexSlice(u32), color: Color) !void {
+        const res = try self.triangulatePolygons(pts, polygons);
+        try self.retained_builder.pushTessResult(self.alloc, self.white_tex, res, color);
+    }
+
+    pub fn retainRect(self: *Graphics, x: f32, y: f32, width: f32, height: f32, color: Color) !void {
+        try self.retained_builder.pushRect(self.alloc, self.white_tex, x, y, width, height, color);
+    }
+
+    /// Uploads everything retained since beginRetainedDrawList into GPU buffers.
+    pub fn endRetainedDrawList(self: *Graphics) !RetainedDrawListId {
+        return self.retained_lists.create(self, self.retained_builder);
+    }
+
+    pub fn drawRetainedDrawList(self: *Graphics, id: RetainedDrawListId) void {
+        self.batcher.drawRetainedList(self.retained_lists.get(id));
+    }
+
+    pub fn removeRetainedDrawList(self: *Graphics, id: RetainedDrawListId) void {
+        self.retained_lists.markForRemoval(self, id);
+    }
+
+    pub fn beginRecording(self: *Graphics, rec: *DrawRecording) void {
+        self.batcher.beginRecording(rec);
+        rec.version = self.recording_version;
+    }
+
+    pub fn resumeRecording(self: *Graphics, rec: *DrawRecording) void {
+        self.batcher.resumeRecording(rec);
+    }
+
+    pub fn endRecording(self: *Graphics) void {
+        self.batcher.endRecording();
+    }
+
+    pub fn canReplayRecording(self: *Graphics, rec: *const DrawRecording) bool {
+        return rec.valid and rec.version == self.recording_version;
+    }
+
+    pub fn replayRecording(self: *Graphics, rec: *const DrawRecording, batch_start: u32, batch_end: u32) void {
+        self.batcher.replayRecording(rec, batch_start, batch_end);
     }
 
     pub fn fillPolygonLyon(self: *Graphics, pts: []const Vec2) void {
@@ -2078,157 +2273,66 @@ pub const Graphics = struct {
         self.pushLyonVertexData(&data, self.ps.stroke_color);
     }
 
+    /// src coords are in image pixels from the top left.
     pub fn drawSubImage(self: *Graphics, src_x: f32, src_y: f32, src_width: f32, src_height: f32, x: f32, y: f32, width: f32, height: f32, image_id: graphics.ImageId) void {
-        const img = self.image_store.images.get(image_id);
-        self.batcher.beginTex(image.ImageDesc{ .image_id = image_id, .tex_id = img.tex_id });
+        const img = self.image_store.images.getNoCheck(image_id);
+        const img_width = @intToFloat(f32, img.width);
+        const img_height = @intToFloat(f32, img.height);
+        self.pushImageQuad(img, image_id, x, y, width, height, src_x / img_width, src_y / img_height, (src_x + src_width) / img_width, (src_y + src_height) / img_height, Color.White);
+    }
+
+    pub fn drawImageScaled(self: *Graphics, x: f32, y: f32, width: f32, height: f32, image_id: graphics.ImageId, tint: Color) void {
+        const img = self.image_store.images.getNoCheck(image_id);
+        self.pushImageQuad(img, image_id, x, y, width, height, 0, 0, 1, 1, tint);
+    }
+
+    pub fn drawImage(self: *Graphics, x: f32, y: f32, image_id: graphics.ImageId, tint: Color) void {
+        const img = self.image_store.images.getNoCheck(image_id);
+        self.pushImageQuad(img, image_id, x, y, @intToFloat(f32, img.width), @intToFloat(f32, img.height), 0, 0, 1, 1, tint);
+    }
+
+    /// Pushes a quad that samples the image between normalized image coords (s0, t0) and (s1, t1) with a top left origin.
+    /// Atlas images on the same page share a texture so consecutive draws stay in one batch.
+    fn pushImageQuad(self: *Graphics, img: image.Image, image_id: graphics.ImageId, x: f32, y: f32, width: f32, height: f32, s0: f32, t0: f32, s1: f32, t1: f32, tint: Color) void {
+        if (!img.ready) {
+            return;
+        }
+        self.batcher.beginTex(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id });
         self.batcher.ensureUnusedBuffer(4, 6);
 
         var vert: TexShaderVertex = undefined;
-        vert.setColor(Color.White);
+        vert.setColor(tint);
 
         const start_idx = self.batcher.mesh.getNextIndexId();
 
-        const u_start = src_x / width;
-        const u_end = (src_x + src_width) / width;
-        const v_start = src_y / height;
-        const v_end = (src_y + src_height) / height;
-
         // top left
+        var uv = img.getTexUV(s0, t0);
         vert.setXY(x, y);
-        vert.setUV(u_start, v_start);
+        vert.setUV(uv.x, uv.y);
         self.batcher.mesh.pushVertex(vert);
 
         // top right
+        uv = img.getTexUV(s1, t0);
         vert.setXY(x + width, y);
-        vert.setUV(u_end, v_start);
+        vert.setUV(uv.x, uv.y);
         self.batcher.mesh.pushVertex(vert);
 
         // bottom right
+        uv = img.getTexUV(s1, t1);
         vert.setXY(x + width, y + height);
-        vert.setUV(u_end, v_end);
+        vert.setUV(uv.x, uv.y);
         self.batcher.mesh.pushVertex(vert);
 
         // bottom left
+        uv = img.getTexUV(s0, t1);
         vert.setXY(x, y + height);
-        vert.setUV(u_start, v_end);
+        vert.setUV(uv.x, uv.y);
         self.batcher.mesh.pushVertex(vert);
 
         // add rect
         self.batcher.mesh.pushQuadIndexes(start_idx, start_idx + 1, start_idx + 2, start_idx + 3);
     }
 
-    pub fn drawImageScaled(self: *Graphics, x: f32, y: f32, width: f32, height: f32, image_id: graphics.ImageId, tint: Color) void {
-        const img = self.image_store.images.getNoCheck(image_id);
-        self.batcher.beginTex(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id });
-        self.batcher.ensureUnusedBuffer(4, 6);
-
-        var vert: TexShaderVertex = undefined;
-        vert.setColor(tint);
-
-        const start_idx = self.batcher.mesh.getNextIndexId();
-
-        if (Backend == .OpenGL) {
-            // top left
-            vert.setXY(x, y);
-            vert.setUV(0, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // top right
-            vert.setXY(x + width, y);
-            vert.setUV(1, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom right
-            vert.setXY(x + width, y + height);
-            vert.setUV(1, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom left
-            vert.setXY(x, y + height);
-            vert.setUV(0, 0);
-            self.batcher.mesh.pushVertex(vert);
-        } else {
-            // top left
-            vert.setXY(x, y);
-            vert.setUV(0, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // top right
-            vert.setXY(x + width, y);
-            vert.setUV(1, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom right
-            vert.setXY(x + width, y + height);
-            vert.setUV(1, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom left
-            vert.setXY(x, y + height);
-            vert.setUV(0, 1);
-            self.batcher.mesh.pushVertex(vert);
-        }
-
-        // add rect
-        self.batcher.mesh.pushQuadIndexes(start_idx, start_idx + 1, start_idx + 2, start_idx + 3);
-    }
-
-    pub fn drawImage(self: *Graphics, x: f32, y: f32, image_id: graphics.ImageId, tint: Color) void {
-        const img = self.image_store.images.getNoCheck(image_id);
-        self.batcher.beginTex(image.ImageTex{ .image_id = image_id, .tex_id = img.tex_id });
-        self.batcher.ensureUnusedBuffer(4, 6);
-
-        var vert: TexShaderVertex = undefined;
-        vert.setColor(tint);
-
-        const start_idx = self.batcher.mesh.getNextIndexId();
-
-        if (Backend == .OpenGL) {
-            // top left
-            vert.setXY(x, y);
-            vert.setUV(0, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // top right
-            vert.setXY(x + @intToFloat(f32, img.width), y);
-            vert.setUV(1, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom right
-            vert.setXY(x + @intToFloat(f32, img.width), y + @intToFloat(f32, img.height));
-            vert.setUV(1, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom left
-            vert.setXY(x, y + @intToFloat(f32, img.height));
-            vert.setUV(0, 0);
-            self.batcher.mesh.pushVertex(vert);
-        } else {
-            // top left
-            vert.setXY(x, y);
-            vert.setUV(0, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // top right
-            vert.setXY(x + @intToFloat(f32, img.width), y);
-            vert.setUV(1, 0);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom right
-            vert.setXY(x + @intToFloat(f32, img.width), y + @intToFloat(f32, img.height));
-            vert.setUV(1, 1);
-            self.batcher.mesh.pushVertex(vert);
-
-            // bottom left
-            vert.setXY(x, y + @intToFloat(f32, img.height));
-            vert.setUV(0, 1);
-            self.batcher.mesh.pushVertex(vert);
-        }
-
-        // add rect
-        self.batcher.mesh.pushQuadIndexes(start_idx, start_idx + 1, start_idx + 2, start_idx + 3);
-    }
-
     /// Like beginFrame but only adjusts the viewport and binds the fbo.
     pub fn bindFramebuffer(self: *Graphics, width: u32, height: u32, buf_width: u32, buf_height: u32, fbo: gl.GLuint) void {
         self.endCmd();
@@ -2296,6 +2400,10 @@ pub const Graphics = struct {
         self.ps.using_scissors = false;
 
         self.clipRectCmd(self.ps.clip_rect);
+
+        self.font_cache.beginFrame();
+        self.glyph_rasterizer.packFinishedGlyphs(self);
+        self.image_store.uploader.process(&self.image_store);
     }
 
     /// Begin frame sets up the context before any other draw call.
@@ -2337,17 +2445,23 @@ pub const Graphics = struct {
 
         // Straight alpha by default.
         self.setBlendMode(.StraightAlpha);
+
+        self.font_cache.beginFrame();
+        self.glyph_rasterizer.packFinishedGlyphs(self);
+        self.image_store.uploader.process(&self.image_store);
     }
 
     pub fn endFrameVK(self: *Graphics) graphics.FrameResultVK {
         self.endCmd();
         self.image_store.processRemovals();
+        self.retained_lists.processRemovals(self);
         return self.batcher.endFrameVK();
     }
 
     pub fn endFrame(self: *Graphics, buf_width: u32, buf_height: u32, custom_fbo: gl.GLuint) void {
         // log.debug("endFrame", .{});
         self.endCmd();
+        self.image_store.processRemovals();
         if (custom_fbo != 0) {
             // If we were drawing to custom framebuffer such as msaa buffer, then blit the custom buffer into the default ogl buffer.
             gl.bindFramebuffer(gl.GL_READ_FRAMEBUFFER, custom_fbo);
@@ -2489,12 +2603,24 @@ pub const Graphics = struct {
     }
 
     pub fn updateTextureData(self: *const Graphics, img: image.Image, buf: []const u8) void {
+        self.updateTextureRows(img, 0, img.height, buf);
+    }
+
+    /// Updates a band of full width rows starting at y. Rows are contiguous in a row major rgba buffer so no row stride is needed.
+    pub fn updateTextureRows(self: *const Graphics, img: image.Image, y: usize, height: usize, buf: []const u8) void {
+        self.updateTextureRect(img, 0, y, img.width, height, buf);
+    }
+
+    /// Updates a rect of the image's texture from a tightly packed rgba buffer.
+    pub fn updateTextureRect(self: *const Graphics, img: image.Image, x: usize, y: usize, width: usize, height: usize, buf: []const u8) void {
+        std.debug.assert(buf.len == width * height * 4);
+        self.batcher.stats.cur_upload_bytes += @intCast(u32, buf.len);
         switch (Backend) {
             .OpenGL => {
                 gl.activeTexture(gl.GL_TEXTURE0 + 0);
                 const gl_tex_id = self.image_store.getTexture(img.tex_id).inner.tex_id;
                 gl.bindTexture(gl.GL_TEXTURE_2D, gl_tex_id);
-                gl.texSubImage2D(gl.GL_TEXTURE_2D, 0, 0, 0, @intCast(c_int, img.width), @intCast(c_int, img.height), gl.GL_RGBA, gl.GL_UNSIGNED_BYTE, buf.ptr);
+                gl.texSubImage2D(gl.GL_TEXTURE_2D, 0, @intCast(c_int, x), @intCast(c_int, y), @intCast(c_int, width), @intCast(c_int, height), gl.GL_RGBA, gl.GL_UNSIGNED_BYTE, buf.ptr);
                 gl.bindTexture(gl.GL_TEXTURE_2D, 0);
             },
             .Vulkan => {
@@ -2512,7 +2638,7 @@ pub const Graphics = struct {
 
                 // Transition to transfer dst layout.
                 gvk.transitionImageLayout(renderer, img.inner.image, vk.VK_FORMAT_R8G8B8A8_SRGB, vk.VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, vk.VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-                gvk.copyBufferToImage(renderer, staging_buf.buf, img.inner.image, img.width, img.height);
+                gvk.copyBufferToImageRegion(renderer, staging_buf.buf, 0, img.inner.image, x, y, width, height);
                 // Transition to shader access layout.
                 gvk.transitionImageLayout(renderer, img.inner.image, vk.VK_FORMAT_R8G8B8A8_SRGB, vk.VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, vk.VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
@@ -1,5 +1,6 @@
 const std = @import("std");
 const stdx = @import("stdx");
+const t = stdx.testing;
 const build_options = @import("graphics_options");
 const Backend = build_options.GraphicsBackend;
 const gl = @import("gl");
@@ -15,8 +16,19 @@ const gvk = graphics.vk;
 const log = stdx.log.scoped(.image);
 
 const ImageId = graphics.ImageId;
+const RectBinPacker = graphics.RectBinPacker;
+const TextureUploader = @import("texture_uploader.zig").TextureUploader;
 pub const TextureId = u32;
 
+/// Width and height of an atlas page texture.
+pub const AtlasPageSize = 1024;
+
+/// Images with CreateImageOptions.atlas that are larger than this still get their own texture.
+pub const MaxAtlasImageSize = 256;
+
+/// Edge pixels of atlas images are extruded by this much so linear filtering doesn't sample neighboring images.
+const AtlasImagePadding = 1;
+
 pub const ImageStore = struct {
     alloc: std.mem.Allocator,
     images: stdx.ds.PooledHandleList(ImageId, Image),
@@ -25,9 +37,15 @@ pub const ImageStore = struct {
 
     textures: stdx.ds.PooledHandleList(TextureId, Texture),
 
+    /// Shared textures that small images are packed into so they can be drawn in one batch.
+    atlas_pages: std.ArrayList(AtlasPage),
+
     /// Images are queued for removal due to multiple frames in flight.
     removals: std.ArrayList(RemoveEntry),
 
+    /// Uploads pixels of images created with createImageFromBitmapAsync over multiple frames.
+    uploader: TextureUploader,
+
     pub fn init(alloc: std.mem.Allocator, gctx: *graphics.gpu.Graphics) ImageStore {
         var ret = ImageStore{
             .alloc = alloc,
@@ -36,11 +54,15 @@ pub const ImageStore = struct {
             .gpu = gctx,
             .gctx = @fieldParentPtr(graphics.Graphics, "impl", gctx),
             .removals = std.ArrayList(RemoveEntry).init(alloc),
+            .atlas_pages = std.ArrayList(AtlasPage).init(alloc),
+            .uploader = TextureUploader.init(alloc),
         };
         return ret;
     }
 
     pub fn deinit(self: *ImageStore) void {
+        self.uploader.deinit(self);
+
         // Delete images after since some deinit could have removed images.
         self.images.deinit();
 
@@ -54,40 +76,59 @@ pub const ImageStore = struct {
         }
         self.textures.deinit();
 
+        for (self.atlas_pages.items) |*page| {
+            page.packer.deinit();
+        }
+        self.atlas_pages.deinit();
         self.removals.deinit();
     }
 
     /// Cleans up images and their textures that are no longer used.
+    /// The rect of an atlas image is freed for reuse while the atlas page texture is kept.
     pub fn processRemovals(self: *ImageStore) void {
-        for (self.removals.items, 0..) |*entry, entry_idx| {
+        var i: usize = 0;
+        while (i < self.removals.items.len) {
+            const entry = &self.removals.items[i];
             if (entry.frame_age < gvk.MaxActiveFrames) {
                 entry.frame_age += 1;
+                i += 1;
                 continue;
             }
             const image = self.images.getNoCheck(entry.image_id);
-            const tex_id = image.tex_id;
-            const tex = self.textures.getPtrNoCheck(tex_id);
-
             self.images.remove(entry.image_id);
 
-            // Remove from texture's image list.
-            for (tex.inner.cs_images.items, 0..) |id, i| {
-                if (id == entry.image_id) {
-                    _ = tex.inner.cs_images.swapRemove(i);
-                }
+            if (image.atlas_page != null) {
+                self.freeAtlasRect(image);
+            } else {
+                self.removeTextureImage(image.tex_id, entry.image_id);
             }
+            _ = self.removals.swapRemove(i);
+        }
+    }
 
-            // No more images in the texture. Cleanup.
-            if (tex.inner.cs_images.items.len == 0) {
-                if (Backend == .Vulkan) {
+    fn removeTextureImage(self: *ImageStore, tex_id: TextureId, image_id: ImageId) void {
+        const tex = self.textures.getPtrNoCheck(tex_id);
+        switch (Backend) {
+            .Vulkan => {
+                // Remove from texture's image list.
+                for (tex.inner.cs_images.items, 0..) |id, i| {
+                    if (id == image_id) {
+                        _ = tex.inner.cs_images.swapRemove(i);
+                        break;
+                    }
+                }
+                // No more images in the texture. Cleanup.
+                if (tex.inner.cs_images.items.len == 0) {
                     tex.deinitVK(self.gpu.inner.ctx.device);
-                } else if (Backend == .OpenGL) {
-                    tex.deinitGL();
+                    self.textures.remove(tex_id);
                 }
+            },
+            .OpenGL => {
+                // Each non atlas texture has one image.
+                tex.deinitGL();
                 self.textures.remove(tex_id);
-            }
-            // Remove the entry.
-            _ = self.removals.swapRemove(entry_idx);
+            },
+            else => {},
         }
     }
 
@@ -142,21 +183,19 @@ pub const ImageStore = struct {
         };
     }
 
-    pub fn createImageFromData(self: *ImageStore, data: []const u8) !graphics.Image {
+    pub fn createImageFromData(self: *ImageStore, data: []const u8, opts: graphics.CreateImageOptions) !graphics.Image {
         var src_width: c_int = undefined;
         var src_height: c_int = undefined;
         // This records the original number of channels in the source input.
         var channels: c_int = undefined;
 
         // stbimage should load images with y flipped for OpenGL.
-        if (Backend == .OpenGL) {
-            stbi.stbi_set_flip_vertically_on_load(1);
-        } else {
-            stbi.stbi_set_flip_vertically_on_load(0);
-        }
+        // The flag is set per thread since decodeImage can run on any thread. Once a thread sets it, stbi ignores the global flag on that thread.
+        stbi.stbi_set_flip_vertically_on_load_thread(if (Backend == .OpenGL) 1 else 0);
 
         // Request 4 channels to pass rgba to gpu. If image only has rgb channels, alpha is generated.
         const bitmap = stbi.stbi_load_from_memory(data.ptr, @intCast(c_int, data.len), &src_width, &src_height, &channels, 4);
+        stbi.stbi_set_flip_vertically_on_load_thread(0);
         defer stbi.stbi_image_free(bitmap);
         if (bitmap == null) {
             log.debug("{s}", .{stbi.stbi_failure_reason()});
@@ -165,9 +204,7 @@ pub const ImageStore = struct {
         // log.debug("loaded image: {} {} {} {*}", .{src_width, src_height, channels, bitmap});
 
         const bitmap_len = @intCast(usize, src_width * src_height * 4);
-        const desc = self.createImageFromBitmap(@intCast(usize, src_width), @intCast(usize, src_height), bitmap[0..bitmap_len], .{
-            .linear_filter = true,
-        });
+        const desc = self.createImageFromBitmap(@intCast(usize, src_width), @intCast(usize, src_height), bitmap[0..bitmap_len], opts);
         return graphics.Image{
             .id = desc.image_id,
             .width = @intCast(usize, src_width),
@@ -175,9 +212,30 @@ pub const ImageStore = struct {
         };
     }
 
-    // TODO: Each texture resource should be an atlas of images since the number of textures is limited on the gpu.
+    /// Creates the image's texture without waiting for its pixels. Rgba data is uploaded over the next frames
+    /// within the uploader's frame budget. The image isn't drawn until it's ready. Atlas images are small so they are uploaded immediately.
+    /// Takes ownership of data which must be allocated with the ImageStore's allocator.
+    pub fn createImageFromBitmapAsync(self: *ImageStore, width: usize, height: usize, data: []const u8, opts: graphics.CreateImageOptions) ImageTex {
+        if (useAtlas(width, height, opts)) {
+            defer self.alloc.free(data);
+            return self.createImageFromBitmap(width, height, data, opts);
+        }
+        const res = self.createImageFromBitmap(width, height, null, opts);
+        self.images.getPtrNoCheck(res.image_id).ready = false;
+        self.uploader.queue(res.image_id, width, height, data);
+        return res;
+    }
+
+    pub fn isImageReady(self: *ImageStore, id: ImageId) bool {
+        return self.images.getPtrNoCheck(id).ready;
+    }
+
     /// Assumes rgba data.
     pub fn createImageFromBitmapInto(self: *ImageStore, image: *Image, width: usize, height: usize, data: ?[]const u8, opts: graphics.CreateImageOptions) ImageId {
+        if (useAtlas(width, height, opts)) {
+            self.initAtlasImage(image, width, height, data, opts.linear_filter);
+            return self.images.add(image.*) catch stdx.fatal();
+        }
         self.initImage(image, width, height, data, opts.linear_filter);
 
         if (Backend == .Vulkan) {
@@ -223,6 +281,95 @@ pub const ImageStore = struct {
         return self.images.add(image.*) catch stdx.fatal();
     }
 
+    fn useAtlas(width: usize, height: usize, opts: graphics.CreateImageOptions) bool {
+        return opts.atlas and !opts.offscreen_rendering and width > 0 and height > 0 and width <= MaxAtlasImageSize and height <= MaxAtlasImageSize;
+    }
+
+    /// Packs the image into the first atlas page with the same filtering that has room. A new page is created if none do.
+    fn initAtlasImage(self: *ImageStore, image: *Image, width: usize, height: usize, data: ?[]const u8, linear_filter: bool) void {
+        const padded_width = @intCast(u32, width) + AtlasImagePadding * 2;
+        const padded_height = @intCast(u32, height) + AtlasImagePadding * 2;
+        const rect = self.allocAtlasRect(padded_width, padded_height, linear_filter) orelse b: {
+            const page_idx = self.createAtlasPage(linear_filter);
+            const page = &self.atlas_pages.items[page_idx];
+            const pos = page.packer.allocRect(padded_width, padded_height);
+            page.num_images += 1;
+            break :b AtlasRect{ .page = page_idx, .x = pos.x, .y = pos.y };
+        };
+        const page_idx = rect.page;
+        const page = &self.atlas_pages.items[page_idx];
+
+        const page_image = self.images.getNoCheck(page.image_id);
+        const page_size = @intToFloat(f32, AtlasPageSize);
+        image.* = .{
+            .tex_id = page.tex_id,
+            .width = width,
+            .height = height,
+            .inner = page_image.inner,
+            .remove = false,
+            .u0 = @intToFloat(f32, rect.x + AtlasImagePadding) / page_size,
+            .v0 = @intToFloat(f32, rect.y + AtlasImagePadding) / page_size,
+            .u1 = @intToFloat(f32, rect.x + padded_width - AtlasImagePadding) / page_size,
+            .v1 = @intToFloat(f32, rect.y + padded_height - AtlasImagePadding) / page_size,
+            .atlas_page = page_idx,
+            .atlas_x = rect.x,
+            .atlas_y = rect.y,
+        };
+        self.uploadAtlasImage(page_image, rect.x, rect.y, width, height, data);
+    }
+
+    /// Allocates a padded rect in an existing page with the same filtering. Returns null if none of them have room.
+    fn allocAtlasRect(self: *ImageStore, padded_width: u32, padded_height: u32, linear_filter: bool) ?AtlasRect {
+        for (self.atlas_pages.items, 0..) |*page, i| {
+            if (page.linear_filter != linear_filter) {
+                continue;
+            }
+            if (page.packer.tryAllocRect(padded_width, padded_height)) |pos| {
+                page.num_images += 1;
+                return AtlasRect{ .page = @intCast(u32, i), .x = pos.x, .y = pos.y };
+            }
+        }
+        return null;
+    }
+
+    /// Returns the padded rect of an atlas image to its page for reuse.
+    fn freeAtlasRect(self: *ImageStore, image: Image) void {
+        const page = &self.atlas_pages.items[image.atlas_page.?];
+        page.packer.freeRect(image.atlas_x, image.atlas_y, @intCast(u32, image.width) + AtlasImagePadding * 2, @intCast(u32, image.height) + AtlasImagePadding * 2);
+        page.num_images -= 1;
+    }
+
+    fn createAtlasPage(self: *ImageStore, linear_filter: bool) u32 {
+        const image = self.createImageFromBitmap(AtlasPageSize, AtlasPageSize, null, .{
+            .linear_filter = linear_filter,
+        });
+        var packer = RectBinPacker.init(self.alloc, AtlasPageSize, AtlasPageSize);
+        // Pages don't grow since the uvs of packed images would change.
+        packer.setMaxSize(AtlasPageSize, AtlasPageSize);
+        self.atlas_pages.append(.{
+            .image_id = image.image_id,
+            .tex_id = image.tex_id,
+            .packer = packer,
+            .linear_filter = linear_filter,
+            .num_images = 0,
+        }) catch stdx.fatal();
+        return @intCast(u32, self.atlas_pages.items.len - 1);
+    }
+
+    /// Uploads the image with its edge pixels extruded into the padding. A freed rect could be reused so a blank image is uploaded as zeros.
+    fn uploadAtlasImage(self: *ImageStore, page_image: Image, x: u32, y: u32, width: usize, height: usize, data: ?[]const u8) void {
+        const padded_width = width + AtlasImagePadding * 2;
+        const padded_height = height + AtlasImagePadding * 2;
+        const buf = self.alloc.alloc(u8, padded_width * padded_height * 4) catch stdx.fatal();
+        defer self.alloc.free(buf);
+        if (data) |src| {
+            copyExtruded(buf, src, width, height, AtlasImagePadding);
+        } else {
+            std.mem.set(u8, buf, 0);
+        }
+        self.gpu.updateTextureRect(page_image, x, y, padded_width, padded_height, buf);
+    }
+
     // TODO: Rename to initTexture.
     /// Assumes rgba data.
     pub fn initImage(self: *ImageStore, image: *Image, width: usize, height: usize, data: ?[]const u8, linear_filter: bool) void {
@@ -254,6 +401,9 @@ pub const ImageStore = struct {
                 .frame_age = 0,
             }) catch stdx.fatal();
             image.remove = true;
+            // The id is freed after MaxActiveFrames while the upload could still be queued.
+            self.uploader.cancel(id);
+            self.gpu.recording_version +%= 1;
         }
     }
 
@@ -276,7 +426,8 @@ pub const ImageStore = struct {
     pub fn endCmdAndMarkForRemoval(self: *ImageStore, image_id: ImageId) void {
         const image = self.images.getNoCheck(image_id);
         // If we deleted the current tex, flush and reset to default texture.
-        if (self.gpu.batcher.cur_image_tex.tex_id == image.tex_id) {
+        // An atlas page outlives its images so there is nothing to flush.
+        if (image.atlas_page == null and self.gpu.batcher.cur_image_tex.tex_id == image.tex_id) {
             self.gpu.endCmd();
             self.gpu.batcher.cur_image_tex = self.gpu.white_tex;
         }
@@ -284,6 +435,42 @@ pub const ImageStore = struct {
     }
 };
 
+/// Rgba pixels decoded from encoded image data.
+pub const DecodedImage = struct {
+    width: usize,
+    height: usize,
+    data: []const u8,
+
+    pub fn deinit(self: DecodedImage, alloc: std.mem.Allocator) void {
+        alloc.free(self.data);
+    }
+};
+
+/// Decodes image data without touching any gpu state so it can be done on another thread.
+/// The result can be passed to ImageStore.createImageFromBitmapAsync.
+pub fn decodeImage(alloc: std.mem.Allocator, data: []const u8) !DecodedImage {
+    var src_width: c_int = undefined;
+    var src_height: c_int = undefined;
+    var channels: c_int = undefined;
+
+    // Same y flip as createImageFromData. Reset afterwards so other loads on this thread aren't flipped.
+    stbi.stbi_set_flip_vertically_on_load_thread(if (Backend == .OpenGL) 1 else 0);
+
+    const bitmap = stbi.stbi_load_from_memory(data.ptr, @intCast(c_int, data.len), &src_width, &src_height, &channels, 4);
+    stbi.stbi_set_flip_vertically_on_load_thread(0);
+    defer stbi.stbi_image_free(bitmap);
+    if (bitmap == null) {
+        log.debug("{s}", .{stbi.stbi_failure_reason()});
+        return error.BadImage;
+    }
+    const bitmap_len = @intCast(usize, src_width * src_height * 4);
+    return DecodedImage{
+        .width = @intCast(usize, src_width),
+        .height = @intCast(usize, src_height),
+        .data = try alloc.dupe(u8, bitmap[0..bitmap_len]),
+    };
+}
+
 /// It's often useful to pass around the image id and texture id.
 pub const ImageTex = struct {
     image_id: ImageId,
@@ -309,6 +496,36 @@ pub const Image = struct {
     /// Framebuffer used to draw to the texture.
     fbo_id: ?gl.GLuint = null,
     remove: bool, 
+
+    /// Region of the texture occupied by the image. Only atlas images don't cover the whole texture.
+    u0: f32 = 0,
+    v0: f32 = 0,
+    u1: f32 = 1,
+    v1: f32 = 1,
+
+    /// Index into ImageStore.atlas_pages and the position of the padded rect in the page.
+    atlas_page: ?u32 = null,
+    atlas_x: u32 = 0,
+    atlas_y: u32 = 0,
+
+    /// False until the pixels of an async image are uploaded. Image draws skip images that aren't ready.
+    ready: bool = true,
+
+    /// Maps normalized image coords with a top left origin to texture uvs.
+    /// OpenGL images are stored bottom up.
+    pub inline fn getTexUV(self: Image, x: f32, y: f32) stdx.math.Vec2 {
+        const v = if (Backend == .OpenGL) 1 - y else y;
+        return stdx.math.Vec2.init(self.u0 + x * (self.u1 - self.u0), self.v0 + v * (self.v1 - self.v0));
+    }
+};
+
+const AtlasPage = struct {
+    /// Image that owns the page texture.
+    image_id: ImageId,
+    tex_id: TextureId,
+    packer: RectBinPacker,
+    linear_filter: bool,
+    num_images: u32,
 };
 
 pub const Texture = struct {
@@ -343,7 +560,110 @@ pub const Texture = struct {
     }
 };
 
+const AtlasRect = struct {
+    page: u32,
+    x: u32,
+    y: u32,
+};
+
 const RemoveEntry = struct {
     image_id: ImageId,
     frame_age: u32,
-};
\ No newline at end of file
+};
+
+/// Copies an rgba image into the center of dst and repeats its edge pixels into the surrounding padding.
+fn copyExtruded(dst: []u8, src: []const u8, width: usize, height: usize, padding: usize) void {
+    const padded_width = width + padding * 2;
+    const padded_height = height + padding * 2;
+    std.debug.assert(dst.len == padded_width * padded_height * 4);
+    var row: usize = 0;
+    while (row < padded_height) : (row += 1) {
+        const src_row = std.math.clamp(row, padding, padding + height - 1) - padding;
+        const src_line = src[src_row * width * 4..][0..width * 4];
+        const dst_line = dst[row * padded_width * 4..][0..padded_width * 4];
+        std.mem.copy(u8, dst_line[padding * 4..], src_line);
+        var i: usize = 0;
+        while (i < padding) : (i += 1) {
+            std.mem.copy(u8, dst_line[i * 4..][0..4], src_line[0..4]);
+            std.mem.copy(u8, dst_line[(padding + width + i) * 4..][0..4], src_line[(width - 1) * 4..][0..4]);
+        }
+    }
+}
+
+test "copyExtruded" {
+    // 2x1 image with a red and a blue pixel.
+    const src = [_]u8{ 255, 0, 0, 255, 0, 0, 255, 255 };
+    var dst: [4 * 3 * 4]u8 = undefined;
+    copyExtruded(&dst, &src, 2, 1, 1);
+    const red = [_]u8{ 255, 0, 0, 255 };
+    const blue = [_]u8{ 0, 0, 255, 255 };
+    const row = red ++ red ++ blue ++ blue;
+    try t.eqSlice(u8, &dst, &(row ++ row ++ row));
+}
+
+test "ImageStore frees atlas rects in processRemovals" {
+    // Only the packing state is used so no gpu is needed.
+    var store = ImageStore{
+        .alloc = t.alloc,
+        .images = stdx.ds.PooledHandleList(ImageId, Image).init(t.alloc),
+        .textures = stdx.ds.PooledHandleList(TextureId, Texture).init(t.alloc),
+        .gpu = undefined,
+        .gctx = undefined,
+        .removals = std.ArrayList(RemoveEntry).init(t.alloc),
+        .atlas_pages = std.ArrayList(AtlasPage).init(t.alloc),
+        .uploader = TextureUploader.init(t.alloc),
+    };
+    defer store.deinit();
+
+    var packer = RectBinPacker.init(t.alloc, AtlasPageSize, AtlasPageSize);
+    packer.setMaxSize(AtlasPageSize, AtlasPageSize);
+    try store.atlas_pages.append(.{
+        .image_id = 0,
+        .tex_id = 0,
+        .packer = packer,
+        .linear_filter = false,
+        .num_images = 0,
+    });
+
+    // Only pages with the same filtering are used.
+    const padded = MaxAtlasImageSize + AtlasImagePadding * 2;
+    try t.eq(store.allocAtlasRect(padded, padded, true), null);
+
+    // Fill the page with the largest atlas images.
+    var ids = std.ArrayList(ImageId).init(t.alloc);
+    defer ids.deinit();
+    while (store.allocAtlasRect(padded, padded, false)) |rect| {
+        try t.eq(rect.page, 0);
+        try ids.append(try store.images.add(.{
+            .tex_id = 0,
+            .width = MaxAtlasImageSize,
+            .height = MaxAtlasImageSize,
+            .inner = undefined,
+            .remove = false,
+            .atlas_page = rect.page,
+            .atlas_x = rect.x,
+            .atlas_y = rect.y,
+        }));
+    }
+    const per_page = @intCast(u32, ids.items.len);
+    try t.expect(per_page > 1);
+    try t.eq(store.atlas_pages.items[0].num_images, per_page);
+
+    // The rect is kept until the image is no longer used by any frame in flight.
+    const removed = store.images.getNoCheck(ids.items[1]);
+    try store.removals.append(.{ .image_id = ids.items[1], .frame_age = 0 });
+    var i: u32 = 0;
+    while (i < gvk.MaxActiveFrames) : (i += 1) {
+        store.processRemovals();
+        try t.eq(store.allocAtlasRect(padded, padded, false), null);
+    }
+    store.processRemovals();
+    try t.eq(store.removals.items.len, 0);
+    try t.eq(store.atlas_pages.items[0].num_images, per_page - 1);
+
+    // The freed rect is reused.
+    const rect = store.allocAtlasRect(padded, padded, false).?;
+    try t.eq(rect.x, removed.atlas_x);
+    try t.eq(rect.y, removed.atlas_y);
+    try t.eq(store.atlas_pages.items[0].num_images, per_page);
+}
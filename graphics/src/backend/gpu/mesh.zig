@@ -1,5 +1,6 @@
 const std = @import("std");
 const stdx = @import("stdx");
+const t = stdx.testing;
 const Vec3 = stdx.math.Vec3;
 const Vec4 = stdx.math.Vec4;
 const Mat4 = stdx.math.Mat4;
@@ -13,8 +14,8 @@ const log = stdx.log.scoped(.mesh);
 const StartVertexBufferSize = 20000;
 const StartIndexBufferSize = StartVertexBufferSize * 8;
 
-const MaxVertexBufferSize = 20000 * 4;
-const MaxIndexBufferSize = MaxVertexBufferSize * 8;
+pub const MaxVertexBufferSize = 20000 * 4;
+pub const MaxIndexBufferSize = MaxVertexBufferSize * 8;
 
 // TODO: Move vertex and index buffer management to Batcher.
 /// Vertex, index, mats, materials buffer.
@@ -33,6 +34,24 @@ pub const Mesh = struct {
     materials_buf: []graphics.Material,
     cur_materials_buf_size: u32,
 
+    /// Whether vert_buf and index_buf point into mapped gpu memory. Mapped buffers are not owned and don't grow.
+    mapped: bool,
+    mapped_vert_buf: []TexShaderVertex,
+    mapped_index_buf: []u32,
+
+    /// While staging, vert_buf and index_buf point to these host buffers instead of the mapped buffers
+    /// so the data can be read back without touching write combined memory. flushStaged copies it over.
+    staging: bool,
+    staging_vert_buf: []TexShaderVertex,
+    staging_index_buf: []u32,
+    /// Start of the data that hasn't been copied to the mapped buffers.
+    staged_vert_start: u32,
+    staged_index_start: u32,
+
+    /// Local bounds of the vertices pushed since resetBounds.
+    /// Lets the batcher sort batches without reading vertices back from the buffer.
+    bounds: stdx.math.BBox,
+
     pub fn init(alloc: std.mem.Allocator, mats_buf: []Mat4, materials_buf: []graphics.Material) Mesh {
         const vertex_buf = alloc.alloc(TexShaderVertex, StartVertexBufferSize) catch unreachable;
         const index_buf = alloc.alloc(u32, StartIndexBufferSize) catch unreachable;
@@ -47,12 +66,113 @@ pub const Mesh = struct {
             .cur_index_buf_size = 0,
             .cur_mats_buf_size = 0,
             .cur_materials_buf_size = 0,
+            .mapped = false,
+            .mapped_vert_buf = &.{},
+            .mapped_index_buf = &.{},
+            .staging = false,
+            .staging_vert_buf = &.{},
+            .staging_index_buf = &.{},
+            .staged_vert_start = 0,
+            .staged_index_start = 0,
+            .bounds = EmptyBounds,
         };
     }
 
     pub fn deinit(self: Mesh) void {
-        self.alloc.free(self.vert_buf);
-        self.alloc.free(self.index_buf);
+        if (!self.mapped) {
+            self.alloc.free(self.vert_buf);
+            self.alloc.free(self.index_buf);
+        }
+        self.alloc.free(self.staging_vert_buf);
+        self.alloc.free(self.staging_index_buf);
+    }
+
+    /// Writes directly into mapped gpu memory from now on. The owned buffers are freed on the first call.
+    /// The caller is responsible for making sure the gpu is no longer reading from the region.
+    pub fn setMappedBuffers(self: *Mesh, vert_buf: []TexShaderVertex, index_buf: []u32) void {
+        if (!self.mapped) {
+            self.alloc.free(self.vert_buf);
+            self.alloc.free(self.index_buf);
+            self.mapped = true;
+        }
+        self.mapped_vert_buf = vert_buf;
+        self.mapped_index_buf = index_buf;
+        self.cur_vert_buf_size = 0;
+        self.cur_index_buf_size = 0;
+        self.staged_vert_start = 0;
+        self.staged_index_start = 0;
+        if (self.staging) {
+            self.useStagingBuffers();
+        } else {
+            self.vert_buf = vert_buf;
+            self.index_buf = index_buf;
+        }
+    }
+
+    /// When enabled, mapped meshes are written to host buffers first. Used when the pushed data needs to be read back.
+    /// Disabling copies the staged data to the mapped buffers. Does nothing for meshes that aren't mapped.
+    pub fn setStaging(self: *Mesh, staging: bool) void {
+        if (self.staging == staging) {
+            return;
+        }
+        if (!self.mapped) {
+            self.staging = staging;
+            return;
+        }
+        if (staging) {
+            self.staging = true;
+            self.staged_vert_start = self.cur_vert_buf_size;
+            self.staged_index_start = self.cur_index_buf_size;
+            self.useStagingBuffers();
+        } else {
+            self.flushStaged();
+            self.staging = false;
+            self.vert_buf = self.mapped_vert_buf;
+            self.index_buf = self.mapped_index_buf;
+        }
+    }
+
+    fn useStagingBuffers(self: *Mesh) void {
+        if (self.staging_vert_buf.len != self.mapped_vert_buf.len) {
+            self.staging_vert_buf = self.alloc.realloc(self.staging_vert_buf, self.mapped_vert_buf.len) catch stdx.fatal();
+        }
+        if (self.staging_index_buf.len != self.mapped_index_buf.len) {
+            self.staging_index_buf = self.alloc.realloc(self.staging_index_buf, self.mapped_index_buf.len) catch stdx.fatal();
+        }
+        self.vert_buf = self.staging_vert_buf;
+        self.index_buf = self.staging_index_buf;
+    }
+
+    /// Copies data staged since the last flush to the mapped buffers. Must be called before the gpu draws from the mesh.
+    pub fn flushStaged(self: *Mesh) void {
+        if (!self.mapped or !self.staging) {
+            return;
+        }
+        const vert_start = self.staged_vert_start;
+        const index_start = self.staged_index_start;
+        std.mem.copy(TexShaderVertex, self.mapped_vert_buf[vert_start..self.cur_vert_buf_size], self.staging_vert_buf[vert_start..self.cur_vert_buf_size]);
+        std.mem.copy(u32, self.mapped_index_buf[index_start..self.cur_index_buf_size], self.staging_index_buf[index_start..self.cur_index_buf_size]);
+        self.staged_vert_start = self.cur_vert_buf_size;
+        self.staged_index_start = self.cur_index_buf_size;
+    }
+
+    pub fn resetBounds(self: *Mesh) void {
+        self.bounds = EmptyBounds;
+    }
+
+    /// Returns null if no vertices were pushed since resetBounds.
+    pub fn getBounds(self: Mesh) ?stdx.math.BBox {
+        if (self.bounds.min_x > self.bounds.max_x) {
+            return null;
+        }
+        return self.bounds;
+    }
+
+    pub inline fn enclosePos(self: *Mesh, x: f32, y: f32) void {
+        self.bounds.min_x = @min(self.bounds.min_x, x);
+        self.bounds.min_y = @min(self.bounds.min_y, y);
+        self.bounds.max_x = @max(self.bounds.max_x, x);
+        self.bounds.max_y = @max(self.bounds.max_y, y);
     }
 
     pub fn reset(self: *Mesh) void {
@@ -60,6 +180,9 @@ pub const Mesh = struct {
         self.cur_index_buf_size = 0;
         self.cur_mats_buf_size = 0;
         self.cur_materials_buf_size = 0;
+        self.staged_vert_start = 0;
+        self.staged_index_start = 0;
+        self.bounds = EmptyBounds;
     }
 
     pub fn pushMatrix(self: *Mesh, mat: Mat4) void {
@@ -73,6 +196,7 @@ pub const Mesh = struct {
     }
 
     pub fn pushVertex(self: *Mesh, vert: TexShaderVertex) void {
+        self.enclosePos(vert.pos.x, vert.pos.y);
         self.vert_buf[self.cur_vert_buf_size] = vert;
         self.cur_vert_buf_size += 1;
     }
@@ -80,6 +204,7 @@ pub const Mesh = struct {
     // Assumes enough capacity.
     pub fn pushVertexGetIndex(self: *Mesh, vert: *TexShaderVertex) u32 {
         const idx = self.cur_vert_buf_size;
+        self.enclosePos(vert.pos.x, vert.pos.y);
         self.vert_buf[self.cur_vert_buf_size] = vert.*;
         self.cur_vert_buf_size += 1;
         return idx;
@@ -89,6 +214,7 @@ pub const Mesh = struct {
     pub fn pushVertexes(self: *Mesh, verts: []const TexShaderVertex) u32 {
         const first_idx = self.cur_vert_buf_size;
         for (verts) |it| {
+            self.enclosePos(it.pos.x, it.pos.y);
             self.vert_buf[self.cur_vert_buf_size] = it;
             self.cur_vert_buf_size += 1;
         }
@@ -154,6 +280,12 @@ pub const Mesh = struct {
     }
 
     pub fn ensureUnusedBuffer(self: *Mesh, vert_inc: usize, index_inc: usize) bool {
+        if (self.mapped) {
+            if (vert_inc > self.vert_buf.len or index_inc > self.index_buf.len) {
+                stdx.panicFmt("requesting buffer size {}/{} that exceeds mapped region {}/{}", .{ vert_inc, index_inc, self.vert_buf.len, self.index_buf.len });
+            }
+            return self.cur_vert_buf_size + vert_inc <= self.vert_buf.len and self.cur_index_buf_size + index_inc <= self.index_buf.len;
+        }
         if (self.cur_vert_buf_size + vert_inc > self.vert_buf.len) {
             // Grow buffer.
             var new_size = @floatToInt(u32, @intToFloat(f32, self.cur_vert_buf_size + vert_inc) * 1.5);
@@ -191,6 +323,8 @@ pub const Mesh = struct {
     }
 };
 
+const EmptyBounds = stdx.math.BBox.init(std.math.inf(f32), std.math.inf(f32), -std.math.inf(f32), -std.math.inf(f32));
+
 // Used to set a bunch of data in one go, reducing the number of batcher capacity checks.
 pub fn VertexData(comptime num_verts: usize, comptime num_indices: usize) type {
     if (num_indices == 0 or num_indices % 3 != 0) {
@@ -211,4 +345,49 @@ pub fn VertexData(comptime num_verts: usize, comptime num_indices: usize) type {
             };
         }
     };
-}
\ No newline at end of file
+}
+
+test "Mesh mapped buffers don't grow" {
+    var mesh = Mesh.init(t.alloc, &.{}, &.{});
+    defer mesh.deinit();
+    var verts: [8]TexShaderVertex = undefined;
+    var indexes: [12]u32 = undefined;
+    mesh.setMappedBuffers(&verts, &indexes);
+    try t.eq(mesh.ensureUnusedBuffer(4, 6), true);
+    var vert: TexShaderVertex = undefined;
+    vert.setColor(Color.Black);
+    mesh.pushQuad(Vec4.init(0, 0, 0, 1), Vec4.init(1, 0, 0, 1), Vec4.init(1, 1, 0, 1), Vec4.init(0, 1, 0, 1), vert);
+    try t.eq(mesh.ensureUnusedBuffer(4, 6), true);
+    mesh.pushQuad(Vec4.init(0, 0, 0, 1), Vec4.init(1, 0, 0, 1), Vec4.init(1, 1, 0, 1), Vec4.init(0, 1, 0, 1), vert);
+    try t.eq(mesh.ensureUnusedBuffer(1, 3), false);
+    try t.eq(mesh.vert_buf.len, 8);
+    try t.eq(indexes[6], 4);
+}
+
+test "Mesh staging writes to host buffers until flushed" {
+    var mesh = Mesh.init(t.alloc, &.{}, &.{});
+    defer mesh.deinit();
+    var verts = [_]TexShaderVertex{undefined} ** 8;
+    var indexes = [_]u32{0} ** 12;
+    mesh.setMappedBuffers(&verts, &indexes);
+    mesh.setStaging(true);
+
+    var vert: TexShaderVertex = undefined;
+    vert.setColor(Color.Black);
+    mesh.pushQuad(Vec4.init(0, 0, 0, 1), Vec4.init(2, 0, 0, 1), Vec4.init(2, 3, 0, 1), Vec4.init(0, 3, 0, 1), vert);
+    try t.eq(indexes[1], 0);
+    try t.eq(mesh.index_buf[1], 3);
+    try t.eq(mesh.getBounds().?, stdx.math.BBox.init(0, 0, 2, 3));
+
+    mesh.flushStaged();
+    try t.eq(indexes[1], 3);
+    try t.eq(verts[2].pos.x, 2);
+
+    // Disabling flushes the rest and writes to the mapped buffers again.
+    mesh.resetBounds();
+    try t.eq(mesh.getBounds(), null);
+    mesh.pushQuad(Vec4.init(0, 0, 0, 1), Vec4.init(1, 0, 0, 1), Vec4.init(1, 1, 0, 1), Vec4.init(0, 1, 0, 1), vert);
+    mesh.setStaging(false);
+    try t.eq(indexes[7], 7);
+    try t.eq(mesh.index_buf.ptr, &indexes);
+}
@@ -1,5 +1,6 @@
 const std = @import("std");
 const stdx = @import("stdx");
+const t = stdx.testing;
 
 const graphics = @import("../../graphics.zig");
 const gpu = graphics.gpu;
@@ -9,6 +10,9 @@ const FontId = graphics.FontId;
 const VMetrics = graphics.VMetrics;
 const log = std.log.scoped(.font);
 
+/// Codepoints below this are stored in RenderFont's flat glyph table. Covers ASCII and Latin-1.
+pub const NumFlatGlyphs = 256;
+
 // Represents a font rendered at a specific bitmap font size.
 pub const RenderFont = struct {
     const Self = @This();
@@ -18,6 +22,14 @@ pub const RenderFont = struct {
     // The font size of the underlying bitmap data.
     render_font_size: u16,
 
+    // Outline glyphs are rasterized as signed distance fields.
+    sdf: bool,
+
+    // Direct indexed glyphs for codepoints below NumFlatGlyphs. Only entries set in flat_loaded are valid.
+    flat_glyphs: []Glyph,
+    flat_loaded: std.StaticBitSet(NumFlatGlyphs),
+
+    // Glyphs for the remaining codepoints.
     glyphs: std.AutoHashMap(u21, Glyph),
 
     // Special missing glyph, every font should have this. glyph_id = 0.
@@ -38,7 +50,7 @@ pub const RenderFont = struct {
     // should just be ascent + descent amounts.
     font_height: f32,
 
-    pub fn initOutline(self: *Self, alloc: std.mem.Allocator, font_id: FontId, ot_font: OpenTypeFont, render_font_size: u16) void {
+    pub fn initOutline(self: *Self, alloc: std.mem.Allocator, font_id: FontId, ot_font: OpenTypeFont, render_font_size: u16, sdf: bool) void {
         const scale = ot_font.getScaleToUserFontSize(@intToFloat(f32, render_font_size));
 
         const v_metrics = ot_font.getVerticalMetrics();
@@ -49,16 +61,17 @@ pub const RenderFont = struct {
         self.* = .{
             .font_id = font_id,
             .render_font_size = render_font_size,
+            .sdf = sdf,
             .scale_from_ttf = scale,
             .ascent = s_ascent,
             .descent = s_descent,
             .line_gap = s_line_gap,
             .font_height = s_ascent - s_descent,
+            .flat_glyphs = alloc.alloc(Glyph, NumFlatGlyphs) catch unreachable,
+            .flat_loaded = std.StaticBitSet(NumFlatGlyphs).initEmpty(),
             .glyphs = std.AutoHashMap(u21, Glyph).init(alloc),
             .missing_glyph = null,
         };
-        // Start with enough memory for ascii codepoints.
-        self.glyphs.ensureTotalCapacity(256) catch unreachable;
     }
 
     pub fn initBitmap(self: *Self, alloc: std.mem.Allocator, font_id: FontId, ot_font: OpenTypeFont, render_font_size: u16) void {
@@ -66,22 +79,93 @@ pub const RenderFont = struct {
         self.* = .{
             .font_id = font_id,
             .render_font_size = render_font_size,
+            .sdf = false,
             .scale_from_ttf = 1,
             .ascent = @intToFloat(f32, v_metrics.ascender),
             .descent = @intToFloat(f32, v_metrics.descender),
             .line_gap = @intToFloat(f32, v_metrics.line_gap),
             .font_height = @intToFloat(f32, v_metrics.ascender - v_metrics.descender),
+            .flat_glyphs = alloc.alloc(Glyph, NumFlatGlyphs) catch unreachable,
+            .flat_loaded = std.StaticBitSet(NumFlatGlyphs).initEmpty(),
             .glyphs = std.AutoHashMap(u21, Glyph).init(alloc),
             .missing_glyph = null,
         };
-        // Start with enough memory for ascii codepoints.
-        self.glyphs.ensureTotalCapacity(256) catch unreachable;
     }
 
     pub fn deinit(self: *Self) void {
+        self.glyphs.allocator.free(self.flat_glyphs);
         self.glyphs.deinit();
     }
 
+    pub inline fn getGlyph(self: *Self, cp: u21) ?*Glyph {
+        if (cp < NumFlatGlyphs) {
+            if (self.flat_loaded.isSet(cp)) {
+                return &self.flat_glyphs[cp];
+            } else return null;
+        } else {
+            return self.glyphs.getPtr(cp);
+        }
+    }
+
+    /// Inserts or replaces the glyph for cp.
+    pub fn putGlyph(self: *Self, cp: u21, glyph: Glyph) *Glyph {
+        if (cp < NumFlatGlyphs) {
+            self.flat_glyphs[cp] = glyph;
+            self.flat_loaded.set(cp);
+            return &self.flat_glyphs[cp];
+        } else {
+            const entry = self.glyphs.getOrPut(cp) catch unreachable;
+            entry.value_ptr.* = glyph;
+            return entry.value_ptr;
+        }
+    }
+
+    pub fn removeGlyph(self: *Self, cp: u21) ?Glyph {
+        if (cp < NumFlatGlyphs) {
+            if (self.flat_loaded.isSet(cp)) {
+                self.flat_loaded.unset(cp);
+                return self.flat_glyphs[cp];
+            } else return null;
+        } else {
+            const kv = self.glyphs.fetchRemove(cp) orelse return null;
+            return kv.value;
+        }
+    }
+
+    /// Iterates the flat glyph table and then the hashmap. Doesn't include the missing glyph.
+    pub fn glyphIterator(self: *Self) GlyphIterator {
+        return .{
+            .font = self,
+            .flat_iter = self.flat_loaded.iterator(.{}),
+            .map_iter = self.glyphs.iterator(),
+        };
+    }
+
+    pub const GlyphIterator = struct {
+        font: *RenderFont,
+        flat_iter: std.StaticBitSet(NumFlatGlyphs).Iterator(.{}),
+        map_iter: std.AutoHashMap(u21, Glyph).Iterator,
+
+        pub const Entry = struct {
+            cp: u21,
+            glyph: *Glyph,
+        };
+
+        pub fn next(self: *GlyphIterator) ?Entry {
+            if (self.flat_iter.next()) |cp| {
+                return Entry{
+                    .cp = @intCast(u21, cp),
+                    .glyph = &self.font.flat_glyphs[cp],
+                };
+            }
+            const entry = self.map_iter.next() orelse return null;
+            return Entry{
+                .cp = entry.key_ptr.*,
+                .glyph = entry.value_ptr,
+            };
+        }
+    };
+
     pub fn getScaleToUserFontSize(self: *const Self, size: f32) f32 {
         return size / @intToFloat(f32, self.render_font_size);
     }
@@ -99,3 +183,28 @@ pub const RenderFont = struct {
         };
     }
 };
+
+test "RenderFont flat and hashed glyphs" {
+    var font: RenderFont = undefined;
+    font.flat_glyphs = try t.alloc.alloc(Glyph, NumFlatGlyphs);
+    font.flat_loaded = std.StaticBitSet(NumFlatGlyphs).initEmpty();
+    font.glyphs = std.AutoHashMap(u21, Glyph).init(t.alloc);
+    defer font.deinit();
+
+    const image = gpu.ImageTex{ .image_id = 0, .tex_id = 0 };
+    _ = font.putGlyph('a', Glyph.init(1, image));
+    _ = font.putGlyph(0x4E00, Glyph.init(2, image));
+    try t.eq(font.getGlyph('a').?.glyph_id, 1);
+    try t.eq(font.getGlyph(0x4E00).?.glyph_id, 2);
+    try t.eq(font.getGlyph('b'), null);
+
+    var iter = font.glyphIterator();
+    try t.eq(iter.next().?.cp, 'a');
+    try t.eq(iter.next().?.cp, 0x4E00);
+    try t.eq(iter.next(), null);
+
+    try t.eq(font.removeGlyph('a').?.glyph_id, 1);
+    try t.eq(font.getGlyph('a'), null);
+    try t.eq(font.removeGlyph(0x4E00).?.glyph_id, 2);
+    try t.eq(font.getGlyph(0x4E00), null);
+}
@@ -0,0 +1,324 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const gl = @import("gl");
+const vk = @import("vk");
+const build_options = @import("graphics_options");
+const Backend = build_options.GraphicsBackend;
+
+const graphics = @import("../../graphics.zig");
+const Color = graphics.Color;
+const gpu = graphics.gpu;
+const TexShaderVertex = gpu.TexShaderVertex;
+const ImageTex = gpu.ImageTex;
+const gvk = graphics.vk;
+const ggl = graphics.gl;
+const TessResult = @import("tess_cache.zig").TessResult;
+const RetainedDrawListId = graphics.RetainedDrawListId;
+const t = stdx.testing;
+const log = stdx.log.scoped(.retained);
+
+/// Vertex and index buffers that stay on the GPU along with the draw ranges for each texture.
+/// Created from a DrawCommandList so replaying it only records one draw per batch under the current transform.
+pub const RetainedDrawList = struct {
+    batches: []const Batch,
+    num_verts: u32,
+    num_idxes: u32,
+    inner: switch (Backend) {
+        .OpenGL => struct {
+            vao_id: gl.GLuint,
+            vert_buf_id: gl.GLuint,
+            index_buf_id: gl.GLuint,
+        },
+        .Vulkan => struct {
+            vert_buf: gvk.Buffer,
+            index_buf: gvk.Buffer,
+        },
+        else => void,
+    },
+    remove: bool,
+
+    pub const Batch = struct {
+        image_tex: ImageTex,
+        idx_start: u32,
+        idx_end: u32,
+    };
+
+    fn deinit(self: RetainedDrawList, alloc: std.mem.Allocator, g: *gpu.Graphics) void {
+        switch (Backend) {
+            .OpenGL => {
+                const bufs = [_]gl.GLuint{ self.inner.vert_buf_id, self.inner.index_buf_id };
+                gl.deleteBuffers(2, &bufs);
+                gl.deleteVertexArrays(1, &self.inner.vao_id);
+            },
+            .Vulkan => {
+                const device = g.inner.ctx.device;
+                self.inner.vert_buf.deinit(device);
+                self.inner.index_buf.deinit(device);
+            },
+            else => {},
+        }
+        alloc.free(self.batches);
+    }
+};
+
+/// Accumulates vertices and indexes on the host before they are uploaded into a RetainedDrawList.
+/// Indexes are u32 so a list is not split by the u16 limit of the batcher.
+pub const RetainedDrawListBuilder = struct {
+    verts: std.ArrayListUnmanaged(TexShaderVertex),
+    idxes: std.ArrayListUnmanaged(u32),
+    batches: std.ArrayListUnmanaged(RetainedDrawList.Batch),
+
+    pub fn init() RetainedDrawListBuilder {
+        return .{
+            .verts = .{},
+            .idxes = .{},
+            .batches = .{},
+        };
+    }
+
+    pub fn deinit(self: *RetainedDrawListBuilder, alloc: std.mem.Allocator) void {
+        self.verts.deinit(alloc);
+        self.idxes.deinit(alloc);
+        self.batches.deinit(alloc);
+    }
+
+    pub fn reset(self: *RetainedDrawListBuilder) void {
+        self.verts.clearRetainingCapacity();
+        self.idxes.clearRetainingCapacity();
+        self.batches.clearRetainingCapacity();
+    }
+
+    /// Continues the last batch if it uses the same texture.
+    fn beginTex(self: *RetainedDrawListBuilder, alloc: std.mem.Allocator, image_tex: ImageTex) !void {
+        const num_idxes = @intCast(u32, self.idxes.items.len);
+        if (self.batches.items.len > 0) {
+            const last = &self.batches.items[self.batches.items.len-1];
+            if (last.image_tex.tex_id == image_tex.tex_id) {
+                return;
+            }
+            if (last.idx_start == last.idx_end) {
+                last.image_tex = image_tex;
+                return;
+            }
+        }
+        try self.batches.append(alloc, .{
+            .image_tex = image_tex,
+            .idx_start = num_idxes,
+            .idx_end = num_idxes,
+        });
+    }
+
+    fn endTex(self: *RetainedDrawListBuilder) void {
+        self.batches.items[self.batches.items.len-1].idx_end = @intCast(u32, self.idxes.items.len);
+    }
+
+    pub fn pushTessResult(self: *RetainedDrawListBuilder, alloc: std.mem.Allocator, tex: ImageTex, res: TessResult, color: Color) !void {
+        try self.beginTex(alloc, tex);
+        defer self.endTex();
+        var vert: TexShaderVertex = undefined;
+        vert.setColor(color);
+        vert.setUV(0, 0);
+        try self.verts.ensureUnusedCapacity(alloc, res.verts.len);
+        try self.idxes.ensureUnusedCapacity(alloc, res.idxes.len);
+        for (res.batches) |batch| {
+            const vert_offset = @intCast(u32, self.verts.items.len);
+            for (res.verts[batch.vert_start..batch.vert_end]) |v| {
+                vert.setXY(v.x, v.y);
+                self.verts.appendAssumeCapacity(vert);
+            }
+            for (res.idxes[batch.idx_start..batch.idx_end]) |idx| {
+                self.idxes.appendAssumeCapacity(vert_offset + idx);
+            }
+        }
+    }
+
+    pub fn pushRect(self: *RetainedDrawListBuilder, alloc: std.mem.Allocator, tex: ImageTex, x: f32, y: f32, width: f32, height: f32, color: Color) !void {
+        try self.beginTex(alloc, tex);
+        defer self.endTex();
+        const start = @intCast(u32, self.verts.items.len);
+        var vert: TexShaderVertex = undefined;
+        vert.setColor(color);
+        vert.setUV(0, 0);
+        try self.verts.ensureUnusedCapacity(alloc, 4);
+        // Same vertex order and winding as Mesh.pushQuadIndexes.
+        vert.setXY(x, y);
+        self.verts.appendAssumeCapacity(vert);
+        vert.setXY(x + width, y);
+        self.verts.appendAssumeCapacity(vert);
+        vert.setXY(x + width, y + height);
+        self.verts.appendAssumeCapacity(vert);
+        vert.setXY(x, y + height);
+        self.verts.appendAssumeCapacity(vert);
+        try self.idxes.appendSlice(alloc, &.{ start, start + 3, start + 1, start + 1, start + 3, start + 2 });
+    }
+};
+
+/// Owns the GPU buffers of retained draw lists.
+/// With multiple frames in flight, Vulkan buffers are only destroyed once no frame can be using them.
+pub const RetainedDrawLists = struct {
+    alloc: std.mem.Allocator,
+    lists: stdx.ds.PooledHandleList(RetainedDrawListId, RetainedDrawList),
+    removals: std.ArrayList(RemoveEntry),
+
+    const RemoveEntry = struct {
+        id: RetainedDrawListId,
+        frame_age: u32,
+    };
+
+    pub fn init(alloc: std.mem.Allocator) RetainedDrawLists {
+        return .{
+            .alloc = alloc,
+            .lists = stdx.ds.PooledHandleList(RetainedDrawListId, RetainedDrawList).init(alloc),
+            .removals = std.ArrayList(RemoveEntry).init(alloc),
+        };
+    }
+
+    pub fn deinit(self: *RetainedDrawLists, g: *gpu.Graphics) void {
+        var iter = self.lists.iterator();
+        while (iter.next()) |list| {
+            list.deinit(self.alloc, g);
+        }
+        self.lists.deinit();
+        self.removals.deinit();
+    }
+
+    /// Uploads the builder's data into new GPU buffers.
+    pub fn create(self: *RetainedDrawLists, g: *gpu.Graphics, b: RetainedDrawListBuilder) !RetainedDrawListId {
+        const batches = try self.alloc.dupe(RetainedDrawList.Batch, b.batches.items);
+        errdefer self.alloc.free(batches);
+        var list = RetainedDrawList{
+            .batches = batches,
+            .num_verts = @intCast(u32, b.verts.items.len),
+            .num_idxes = @intCast(u32, b.idxes.items.len),
+            .inner = undefined,
+            .remove = false,
+        };
+        const verts_size = @max(b.verts.items.len, 1) * @sizeOf(TexShaderVertex);
+        const idxes_size = @max(b.idxes.items.len, 1) * @sizeOf(u32);
+        switch (Backend) {
+            .OpenGL => {
+                var buf_ids: [2]gl.GLuint = undefined;
+                gl.genBuffers(2, &buf_ids);
+                list.inner.vert_buf_id = buf_ids[0];
+                list.inner.index_buf_id = buf_ids[1];
+                gl.genVertexArrays(1, &list.inner.vao_id);
+
+                // The vertex array records the vertex layout and the index buffer binding.
+                gl.bindVertexArray(list.inner.vao_id);
+                defer gl.bindVertexArray(0);
+                ggl.TexShader.bindVertexAttributes(list.inner.vert_buf_id);
+                gl.bufferData(gl.GL_ARRAY_BUFFER, @intCast(c_long, verts_size), b.verts.items.ptr, gl.GL_STATIC_DRAW);
+                gl.bindBuffer(gl.GL_ELEMENT_ARRAY_BUFFER, list.inner.index_buf_id);
+                gl.bufferData(gl.GL_ELEMENT_ARRAY_BUFFER, @intCast(c_long, idxes_size), b.idxes.items.ptr, gl.GL_STATIC_DRAW);
+            },
+            .Vulkan => {
+                const ctx = g.inner.ctx;
+                list.inner.vert_buf = gvk.buffer.createVertexBuffer(ctx.physical, ctx.device, verts_size);
+                list.inner.index_buf = gvk.buffer.createIndexBuffer(ctx.physical, ctx.device, idxes_size);
+                // Written once so the host visible memory doesn't stay mapped.
+                copyToBufferVK(ctx.device, list.inner.vert_buf, std.mem.sliceAsBytes(b.verts.items));
+                copyToBufferVK(ctx.device, list.inner.index_buf, std.mem.sliceAsBytes(b.idxes.items));
+            },
+            else => stdx.unsupported(),
+        }
+        return try self.lists.add(list);
+    }
+
+    pub fn get(self: RetainedDrawLists, id: RetainedDrawListId) RetainedDrawList {
+        return self.lists.getNoCheck(id);
+    }
+
+    /// OpenGL buffers are deleted right away since draw calls are already flushed.
+    pub fn markForRemoval(self: *RetainedDrawLists, g: *gpu.Graphics, id: RetainedDrawListId) void {
+        const list = self.lists.getPtrNoCheck(id);
+        if (list.remove) {
+            return;
+        }
+        if (Backend == .Vulkan) {
+            self.removals.append(.{
+                .id = id,
+                .frame_age = 0,
+            }) catch stdx.fatal();
+            list.remove = true;
+        } else {
+            list.deinit(self.alloc, g);
+            self.lists.remove(id);
+        }
+    }
+
+    pub fn processRemovals(self: *RetainedDrawLists, g: *gpu.Graphics) void {
+        var i: usize = 0;
+        while (i < self.removals.items.len) {
+            const entry = &self.removals.items[i];
+            if (entry.frame_age < gvk.MaxActiveFrames) {
+                entry.frame_age += 1;
+                i += 1;
+                continue;
+            }
+            self.lists.getNoCheck(entry.id).deinit(self.alloc, g);
+            self.lists.remove(entry.id);
+            _ = self.removals.swapRemove(i);
+        }
+    }
+};
+
+fn copyToBufferVK(device: vk.VkDevice, buf: gvk.Buffer, data: []const u8) void {
+    if (data.len == 0) {
+        return;
+    }
+    var dst: [*]u8 = undefined;
+    const res = vk.mapMemory(device, buf.mem, 0, buf.size, 0, @ptrCast([*c]?*anyopaque, &dst));
+    vk.assertSuccess(res);
+    std.mem.copy(u8, dst[0..data.len], data);
+    vk.unmapMemory(device, buf.mem);
+}
+
+test "RetainedDrawListBuilder records batches that replay, and resets for a new list" {
+    const Vec2 = stdx.math.Vec2;
+    const TessBatch = @import("tess_cache.zig").TessBatch;
+
+    var b = RetainedDrawListBuilder.init();
+    defer b.deinit(t.alloc);
+    const tex_a = ImageTex{ .image_id = 0, .tex_id = 1 };
+    const tex_b = ImageTex{ .image_id = 1, .tex_id = 2 };
+
+    // Two tessellator batches with indexes relative to their own first vertex.
+    const verts = [_]Vec2{ Vec2.init(0, 0), Vec2.init(1, 0), Vec2.init(0, 1), Vec2.init(10, 10), Vec2.init(11, 10), Vec2.init(10, 11) };
+    const idxes = [_]u16{ 0, 1, 2, 0, 1, 2 };
+    const batches = [_]TessBatch{
+        .{ .vert_start = 0, .vert_end = 3, .idx_start = 0, .idx_end = 3 },
+        .{ .vert_start = 3, .vert_end = 6, .idx_start = 3, .idx_end = 6 },
+    };
+    try b.pushRect(t.alloc, tex_a, 0, 0, 5, 5, Color.Red);
+    try b.pushTessResult(t.alloc, tex_a, .{ .verts = &verts, .idxes = &idxes, .batches = &batches }, Color.Blue);
+    try b.pushRect(t.alloc, tex_b, 20, 20, 5, 5, Color.Green);
+
+    // Same texture continues a batch.
+    try t.eq(b.batches.items.len, 2);
+    try t.eq(b.batches.items[0].image_tex.tex_id, tex_a.tex_id);
+    try t.eq(b.batches.items[0].idx_start, 0);
+    try t.eq(b.batches.items[0].idx_end, 12);
+    try t.eq(b.batches.items[1].image_tex.tex_id, tex_b.tex_id);
+    try t.eq(b.batches.items[1].idx_start, 12);
+    try t.eq(b.batches.items[1].idx_end, 18);
+
+    // Replaying a batch draws its index range against the whole vertex buffer.
+    // The second tessellator batch is offset past the rect and the first batch.
+    const second_tri = b.idxes.items[9..12];
+    try t.eqSlice(u32, second_tri, &.{ 7, 8, 9 });
+    try t.eq(b.verts.items[second_tri[0]].pos.x, 10);
+    try t.eq(b.verts.items[second_tri[0]].pos.y, 10);
+    const rect_b = b.idxes.items[b.batches.items[1].idx_start..b.batches.items[1].idx_end];
+    for (rect_b) |idx| {
+        try t.expect(idx >= 10 and idx < 14);
+        try t.expect(b.verts.items[idx].pos.x >= 20 and b.verts.items[idx].pos.x <= 25);
+    }
+
+    // Reset invalidates the recorded data and the next list starts from zero.
+    b.reset();
+    try b.pushRect(t.alloc, tex_b, 0, 0, 1, 1, Color.Red);
+    try t.eq(b.verts.items.len, 4);
+    try t.eq(b.batches.items.len, 1);
+    try t.eq(b.batches.items[0].image_tex.tex_id, tex_b.tex_id);
+    try t.eqSlice(u32, b.idxes.items, &.{ 0, 3, 1, 1, 3, 2 });
+}
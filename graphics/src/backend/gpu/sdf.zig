@@ -0,0 +1,168 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const t = stdx.testing;
+
+/// Distance in px from the outline that the field covers on each side.
+/// Glyphs are rasterized with this much extra border so the field can fall off outside the outline.
+pub const Spread = 6;
+
+/// Value of the outline in the field. Inside is above and outside is below.
+pub const OnEdgeValue = 128;
+
+const Inf: f32 = 1e20;
+
+/// Converts a coverage bitmap (e.g. an anti-aliased glyph) into a signed distance field of the same dimensions.
+/// Partially covered pixels are treated as subpixel edge offsets so the field is more accurate than one from a thresholded bitmap.
+/// Uses the exact euclidean distance transform from Felzenszwalb and Huttenlocher, once for the outside and once for the inside.
+pub fn coverageToSdf(alloc: std.mem.Allocator, dst: []u8, src: []const u8, width: usize, height: usize, spread: f32) !void {
+    std.debug.assert(src.len == width * height);
+    std.debug.assert(dst.len == width * height);
+
+    const outer = try alloc.alloc(f32, src.len);
+    defer alloc.free(outer);
+    const inner = try alloc.alloc(f32, src.len);
+    defer alloc.free(inner);
+
+    for (src, 0..) |cov, i| {
+        const a = @intToFloat(f32, cov) / 255;
+        if (cov == 255) {
+            outer[i] = 0;
+            inner[i] = Inf;
+        } else if (cov == 0) {
+            outer[i] = Inf;
+            inner[i] = 0;
+        } else {
+            outer[i] = std.math.pow(f32, @max(0, 0.5 - a), 2);
+            inner[i] = std.math.pow(f32, @max(0, a - 0.5), 2);
+        }
+    }
+
+    const max_dim = @max(width, height);
+    var scratch = try Scratch.init(alloc, max_dim);
+    defer scratch.deinit(alloc);
+    edt2d(outer, width, height, &scratch);
+    edt2d(inner, width, height, &scratch);
+
+    for (dst, 0..) |*out, i| {
+        // Positive outside the outline.
+        const dist = @sqrt(outer[i]) - @sqrt(inner[i]);
+        const val = @intToFloat(f32, OnEdgeValue) - dist * @intToFloat(f32, OnEdgeValue) / spread;
+        out.* = @floatToInt(u8, std.math.clamp(@round(val), 0.0, 255.0));
+    }
+}
+
+const Scratch = struct {
+    f: []f32,
+    v: []usize,
+    z: []f32,
+
+    fn init(alloc: std.mem.Allocator, len: usize) !Scratch {
+        const f = try alloc.alloc(f32, len);
+        errdefer alloc.free(f);
+        const v = try alloc.alloc(usize, len);
+        errdefer alloc.free(v);
+        return Scratch{
+            .f = f,
+            .v = v,
+            .z = try alloc.alloc(f32, len + 1),
+        };
+    }
+
+    fn deinit(self: Scratch, alloc: std.mem.Allocator) void {
+        alloc.free(self.f);
+        alloc.free(self.v);
+        alloc.free(self.z);
+    }
+};
+
+/// Squared distances are transformed in place by columns and then by rows.
+fn edt2d(grid: []f32, width: usize, height: usize, s: *Scratch) void {
+    var x: usize = 0;
+    while (x < width) : (x += 1) {
+        edt1d(grid, x, width, height, s);
+    }
+    var y: usize = 0;
+    while (y < height) : (y += 1) {
+        edt1d(grid, y * width, 1, width, s);
+    }
+}
+
+/// Lower envelope of the parabolas rooted at each sample.
+fn edt1d(grid: []f32, offset: usize, stride: usize, len: usize, s: *Scratch) void {
+    const f = s.f[0..len];
+    for (f, 0..) |*it, i| {
+        it.* = grid[offset + i * stride];
+    }
+    s.v[0] = 0;
+    s.z[0] = -Inf;
+    s.z[1] = Inf;
+
+    var k: usize = 0;
+    var q: usize = 1;
+    while (q < len) : (q += 1) {
+        var sec = intersect(f, q, s.v[k]);
+        // z[0] is -Inf so this stops at the first parabola.
+        while (sec <= s.z[k]) {
+            k -= 1;
+            sec = intersect(f, q, s.v[k]);
+        }
+        k += 1;
+        s.v[k] = q;
+        s.z[k] = sec;
+        s.z[k + 1] = Inf;
+    }
+
+    k = 0;
+    q = 0;
+    while (q < len) : (q += 1) {
+        const qf = @intToFloat(f32, q);
+        while (s.z[k + 1] < qf) {
+            k += 1;
+        }
+        const r = s.v[k];
+        const rf = @intToFloat(f32, r);
+        grid[offset + q * stride] = (qf - rf) * (qf - rf) + f[r];
+    }
+}
+
+/// Horizontal position where the parabolas rooted at q and r intersect.
+inline fn intersect(f: []const f32, q: usize, r: usize) f32 {
+    const qf = @intToFloat(f32, q);
+    const rf = @intToFloat(f32, r);
+    return (f[q] - f[r] + qf * qf - rf * rf) / (2 * qf - 2 * rf);
+}
+
+test "coverageToSdf" {
+    const w = 9;
+    const h = 5;
+    // A fully covered 3px wide column in the middle.
+    var src = [_]u8{0} ** (w * h);
+    var y: usize = 0;
+    while (y < h) : (y += 1) {
+        src[y * w + 3] = 255;
+        src[y * w + 4] = 255;
+        src[y * w + 5] = 255;
+    }
+    var dst: [w * h]u8 = undefined;
+    try coverageToSdf(t.alloc, &dst, &src, w, h, 3);
+
+    // Symmetric around the column.
+    try t.eq(dst[2 * w + 2], dst[2 * w + 6]);
+    try t.eq(dst[2 * w + 0], dst[2 * w + 8]);
+    // Inside is above the edge value and increases towards the center.
+    try t.eq(dst[2 * w + 3] > OnEdgeValue, true);
+    try t.eq(dst[2 * w + 4] > dst[2 * w + 3], true);
+    // Outside is below the edge value and decreases away from the column.
+    try t.eq(dst[2 * w + 2] < OnEdgeValue, true);
+    try t.eq(dst[2 * w + 1] < dst[2 * w + 2], true);
+    // Clamped to the spread.
+    try t.eq(dst[2 * w + 0], 0);
+}
+
+test "coverageToSdf uses partial coverage as the edge" {
+    var src = [_]u8{ 0, 0, 128, 255, 255 };
+    var dst: [5]u8 = undefined;
+    try coverageToSdf(t.alloc, &dst, &src, 5, 1, 4);
+    // Half covered pixel lies on the outline.
+    try t.eq(dst[2], OnEdgeValue);
+}
@@ -0,0 +1,374 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const ds = stdx.ds;
+const t = stdx.testing;
+const Vec2 = stdx.math.Vec2;
+const vec2 = Vec2.init;
+
+const graphics = @import("../../graphics.zig");
+const svg = graphics.svg;
+const tessellator = @import("../../tessellator.zig");
+pub const TessBatch = tessellator.ParallelTessellator.Batch;
+
+const log = stdx.log.scoped(.tess_cache);
+
+const NullId = std.math.maxInt(u32);
+
+/// Seed of the second hash in TessKey.
+const CheckSeed = 0x9e3779b97f4a7c15;
+
+/// Which tessellator and mode produced the output. Part of the key since the same geometry can be drawn differently.
+pub const TessKind = enum(u8) {
+    Polygon,
+    FillPath,
+    StrokePath,
+    FillPathLyon,
+    StrokePathLyon,
+    FillPathTess2,
+};
+
+/// Identifies the source geometry. hash indexes the cache while check and len are compared on a hit
+/// so inputs with colliding hashes don't return each other's output.
+pub const TessKey = struct {
+    hash: u64,
+    check: u64,
+    len: u32,
+
+    fn eql(a: TessKey, b: TessKey) bool {
+        return a.hash == b.hash and a.check == b.check and a.len == b.len;
+    }
+};
+
+/// Tessellation output. Indexes in each batch are relative to the batch's first vertex.
+pub const TessResult = struct {
+    verts: []const Vec2,
+    idxes: []const u16,
+    batches: []const TessBatch,
+};
+
+/// Caches tessellation output keyed by a hash of the source geometry so static shapes are only triangulated once.
+/// Only static geometry should be cached (eg. svg paths) since every new shape takes a miss and an entry.
+/// Vertices are in local space since the batcher applies the current transform, so entries are reused across transforms.
+/// Entries are evicted in least recently used order once the total size exceeds max_bytes.
+pub const TessCache = struct {
+    alloc: std.mem.Allocator,
+    map: std.AutoHashMapUnmanaged(u64, u32),
+    entries: ds.PooledHandleList(u32, Entry),
+
+    /// Most recently used entry.
+    lru_head: u32,
+    /// Least recently used entry. Evicted first.
+    lru_tail: u32,
+
+    num_bytes: usize,
+    max_bytes: usize,
+
+    /// Used to accumulate output from tessellators that produce one batch per polygon.
+    build_verts: std.ArrayListUnmanaged(Vec2),
+    build_idxes: std.ArrayListUnmanaged(u16),
+    build_batches: std.ArrayListUnmanaged(TessBatch),
+
+    pub const DefaultMaxBytes = 16 * 1024 * 1024;
+
+    const Entry = struct {
+        key: TessKey,
+        verts: []const Vec2,
+        idxes: []const u16,
+        batches: []const TessBatch,
+        prev: u32,
+        next: u32,
+
+        fn numBytes(self: Entry) usize {
+            return self.verts.len * @sizeOf(Vec2) + self.idxes.len * @sizeOf(u16) + self.batches.len * @sizeOf(TessBatch);
+        }
+    };
+
+    pub fn init(alloc: std.mem.Allocator, max_bytes: usize) TessCache {
+        return .{
+            .alloc = alloc,
+            .map = .{},
+            .entries = ds.PooledHandleList(u32, Entry).init(alloc),
+            .lru_head = NullId,
+            .lru_tail = NullId,
+            .num_bytes = 0,
+            .max_bytes = max_bytes,
+            .build_verts = .{},
+            .build_idxes = .{},
+            .build_batches = .{},
+        };
+    }
+
+    pub fn deinit(self: *TessCache) void {
+        self.clear();
+        self.map.deinit(self.alloc);
+        self.entries.deinit();
+        self.build_verts.deinit(self.alloc);
+        self.build_idxes.deinit(self.alloc);
+        self.build_batches.deinit(self.alloc);
+    }
+
+    pub fn clear(self: *TessCache) void {
+        var iter = self.entries.iterator();
+        while (iter.next()) |entry| {
+            self.freeEntryData(entry);
+        }
+        self.entries.clearRetainingCapacity();
+        self.map.clearRetainingCapacity();
+        self.lru_head = NullId;
+        self.lru_tail = NullId;
+        self.num_bytes = 0;
+    }
+
+    pub fn hashPoints(kind: TessKind, pts: []const Vec2) TessKey {
+        const bytes = std.mem.sliceAsBytes(pts);
+        return .{
+            .hash = std.hash.Wyhash.hash(@enumToInt(kind), bytes),
+            .check = std.hash.Wyhash.hash(CheckSeed +% @enumToInt(kind), bytes),
+            .len = @intCast(u32, pts.len),
+        };
+    }
+
+    /// `param` is for anything else that changes the output. eg. The line width of a stroke.
+    pub fn hashSvgPath(kind: TessKind, path: svg.SvgPath, param: f32) TessKey {
+        const cmds = std.mem.sliceAsBytes(path.cmds);
+        const data = std.mem.sliceAsBytes(path.data[0..svg.getPathDataLen(path.cmds)]);
+        var hasher = std.hash.Wyhash.init(@enumToInt(kind));
+        var check_hasher = std.hash.Wyhash.init(CheckSeed +% @enumToInt(kind));
+        hasher.update(cmds);
+        check_hasher.update(cmds);
+        hasher.update(data);
+        check_hasher.update(data);
+        hasher.update(std.mem.asBytes(&param));
+        check_hasher.update(std.mem.asBytes(&param));
+        return .{
+            .hash = hasher.final(),
+            .check = check_hasher.final(),
+            .len = @intCast(u32, path.cmds.len),
+        };
+    }
+
+    /// Returns the cached output and marks it as most recently used.
+    pub fn get(self: *TessCache, key: TessKey) ?TessResult {
+        const id = self.map.get(key.hash) orelse return null;
+        const entry = self.entries.getNoCheck(id);
+        if (!entry.key.eql(key)) {
+            // Hash collision with different geometry.
+            return null;
+        }
+        self.unlinkLru(id);
+        self.linkLruHead(id);
+        return TessResult{
+            .verts = entry.verts,
+            .idxes = entry.idxes,
+            .batches = entry.batches,
+        };
+    }
+
+    /// Copies the output into the cache. Output larger than a quarter of max_bytes is not cached.
+    /// An entry with the same hash is replaced.
+    pub fn put(self: *TessCache, key: TessKey, res: TessResult) !void {
+        const num_bytes = res.verts.len * @sizeOf(Vec2) + res.idxes.len * @sizeOf(u16) + res.batches.len * @sizeOf(TessBatch);
+        if (num_bytes > self.max_bytes / 4) {
+            return;
+        }
+        if (self.map.get(key.hash)) |id| {
+            self.removeEntry(id);
+        }
+        while (self.num_bytes + num_bytes > self.max_bytes and self.lru_tail != NullId) {
+            self.removeEntry(self.lru_tail);
+        }
+
+        const verts = try self.alloc.dupe(Vec2, res.verts);
+        errdefer self.alloc.free(verts);
+        const idxes = try self.alloc.dupe(u16, res.idxes);
+        errdefer self.alloc.free(idxes);
+        const batches = try self.alloc.dupe(TessBatch, res.batches);
+        errdefer self.alloc.free(batches);
+        const id = try self.entries.add(.{
+            .key = key,
+            .verts = verts,
+            .idxes = idxes,
+            .batches = batches,
+            .prev = NullId,
+            .next = NullId,
+        });
+        errdefer self.entries.remove(id);
+        try self.map.put(self.alloc, key.hash, id);
+        self.linkLruHead(id);
+        self.num_bytes += num_bytes;
+    }
+
+    pub fn beginBuild(self: *TessCache) void {
+        self.build_verts.clearRetainingCapacity();
+        self.build_idxes.clearRetainingCapacity();
+        self.build_batches.clearRetainingCapacity();
+    }
+
+    /// Appends tessellator output where indexes are relative to verts[0]. `idxes` can be a slice of any integer type.
+    /// Consecutive outputs are merged into the same batch until it would overflow u16 indexes.
+    pub fn appendBuild(self: *TessCache, verts: []const Vec2, idxes: anytype, comptime FlipWinding: bool) !void {
+        if (verts.len == 0) {
+            return;
+        }
+        const num_verts = @intCast(u32, self.build_verts.items.len);
+        const num_idxes = @intCast(u32, self.build_idxes.items.len);
+        var batch: *TessBatch = undefined;
+        if (self.build_batches.items.len == 0 or num_verts - self.build_batches.items[self.build_batches.items.len-1].vert_start + verts.len > std.math.maxInt(u16) + 1) {
+            batch = try self.build_batches.addOne(self.alloc);
+            batch.* = .{
+                .vert_start = num_verts,
+                .vert_end = num_verts,
+                .idx_start = num_idxes,
+                .idx_end = num_idxes,
+            };
+        } else {
+            batch = &self.build_batches.items[self.build_batches.items.len-1];
+        }
+        const offset = @intCast(u16, batch.vert_end - batch.vert_start);
+        try self.build_verts.appendSlice(self.alloc, verts);
+        try self.build_idxes.ensureUnusedCapacity(self.alloc, idxes.len);
+        if (FlipWinding) {
+            var i: usize = 0;
+            while (i < idxes.len) : (i += 3) {
+                self.build_idxes.appendAssumeCapacity(offset + @intCast(u16, idxes[i+2]));
+                self.build_idxes.appendAssumeCapacity(offset + @intCast(u16, idxes[i+1]));
+                self.build_idxes.appendAssumeCapacity(offset + @intCast(u16, idxes[i]));
+            }
+        } else {
+            for (idxes) |idx| {
+                self.build_idxes.appendAssumeCapacity(offset + @intCast(u16, idx));
+            }
+        }
+        batch.vert_end += @intCast(u32, verts.len);
+        batch.idx_end += @intCast(u32, idxes.len);
+    }
+
+    pub fn getBuild(self: TessCache) TessResult {
+        return .{
+            .verts = self.build_verts.items,
+            .idxes = self.build_idxes.items,
+            .batches = self.build_batches.items,
+        };
+    }
+
+    fn removeEntry(self: *TessCache, id: u32) void {
+        const entry = self.entries.getNoCheck(id);
+        self.unlinkLru(id);
+        _ = self.map.remove(entry.key.hash);
+        self.num_bytes -= entry.numBytes();
+        self.freeEntryData(entry);
+        self.entries.remove(id);
+    }
+
+    fn freeEntryData(self: *TessCache, entry: Entry) void {
+        self.alloc.free(entry.verts);
+        self.alloc.free(entry.idxes);
+        self.alloc.free(entry.batches);
+    }
+
+    fn linkLruHead(self: *TessCache, id: u32) void {
+        const entry = self.entries.getPtrNoCheck(id);
+        entry.prev = NullId;
+        entry.next = self.lru_head;
+        if (self.lru_head != NullId) {
+            self.entries.getPtrNoCheck(self.lru_head).prev = id;
+        } else {
+            self.lru_tail = id;
+        }
+        self.lru_head = id;
+    }
+
+    fn unlinkLru(self: *TessCache, id: u32) void {
+        const entry = self.entries.getNoCheck(id);
+        if (entry.prev != NullId) {
+            self.entries.getPtrNoCheck(entry.prev).next = entry.next;
+        } else {
+            self.lru_head = entry.next;
+        }
+        if (entry.next != NullId) {
+            self.entries.getPtrNoCheck(entry.next).prev = entry.prev;
+        } else {
+            self.lru_tail = entry.prev;
+        }
+    }
+};
+
+test "TessCache evicts least recently used by bytes" {
+    const verts = [_]Vec2{ vec2(0, 0), vec2(1, 0), vec2(0, 1) };
+    const idxes = [_]u16{ 0, 1, 2 };
+    const batches = [_]TessBatch{.{ .vert_start = 0, .vert_end = 3, .idx_start = 0, .idx_end = 3 }};
+    const res = TessResult{ .verts = &verts, .idxes = &idxes, .batches = &batches };
+    const entry_size = @sizeOf(@TypeOf(verts)) + @sizeOf(@TypeOf(idxes)) + @sizeOf(@TypeOf(batches));
+
+    var cache = TessCache.init(t.alloc, entry_size * 4);
+    defer cache.deinit();
+
+    try cache.put(testKey(1), res);
+    try cache.put(testKey(2), res);
+    try cache.put(testKey(3), res);
+    try cache.put(testKey(4), res);
+    try t.eq(cache.num_bytes, entry_size * 4);
+
+    // Touch 1 so 2 is evicted next.
+    try t.eqSlice(u16, cache.get(testKey(1)).?.idxes, &idxes);
+    try cache.put(testKey(5), res);
+    try t.eq(cache.get(testKey(2)), null);
+    try t.eq(cache.get(testKey(1)) != null, true);
+    try t.eq(cache.num_bytes, entry_size * 4);
+
+    // Replacing a key doesn't grow the cache.
+    try cache.put(testKey(5), res);
+    try t.eq(cache.num_bytes, entry_size * 4);
+    try t.eq(cache.entries.size(), 4);
+}
+
+fn testKey(hash: u64) TessKey {
+    return .{ .hash = hash, .check = hash, .len = 1 };
+}
+
+test "TessCache misses on a hash collision" {
+    const verts = [_]Vec2{ vec2(0, 0), vec2(1, 0), vec2(0, 1) };
+    const idxes = [_]u16{ 0, 1, 2 };
+    const batches = [_]TessBatch{.{ .vert_start = 0, .vert_end = 3, .idx_start = 0, .idx_end = 3 }};
+    const res = TessResult{ .verts = &verts, .idxes = &idxes, .batches = &batches };
+
+    var cache = TessCache.init(t.alloc, TessCache.DefaultMaxBytes);
+    defer cache.deinit();
+
+    try cache.put(.{ .hash = 1, .check = 1, .len = 3 }, res);
+    try t.eq(cache.get(.{ .hash = 1, .check = 2, .len = 3 }), null);
+    try t.eq(cache.get(.{ .hash = 1, .check = 1, .len = 4 }), null);
+    try t.eq(cache.get(.{ .hash = 1, .check = 1, .len = 3 }) != null, true);
+
+    const pts = [_]Vec2{ vec2(0, 0), vec2(1, 0), vec2(0, 1) };
+    const other_pts = [_]Vec2{ vec2(0, 0), vec2(2, 0), vec2(0, 1) };
+    const a = TessCache.hashPoints(.Polygon, &pts);
+    const b = TessCache.hashPoints(.Polygon, &other_pts);
+    try t.neq(a.check, b.check);
+    try t.eq(a.len, 3);
+}
+
+test "TessCache build merges outputs into u16 batches" {
+    var cache = TessCache.init(t.alloc, TessCache.DefaultMaxBytes);
+    defer cache.deinit();
+
+    const verts = [_]Vec2{ vec2(0, 0), vec2(1, 0), vec2(0, 1) };
+    const idxes = [_]u16{ 0, 1, 2 };
+    cache.beginBuild();
+    try cache.appendBuild(&verts, @as([]const u16, &idxes), false);
+    try cache.appendBuild(&verts, @as([]const u16, &idxes), true);
+    const res = cache.getBuild();
+    try t.eq(res.batches.len, 1);
+    try t.eqSlice(u16, res.idxes, &.{ 0, 1, 2, 5, 4, 3 });
+}
+
+test "TessCache.hashSvgPath only hashes data used by the path" {
+    const cmds = [_]svg.PathCommand{ .MoveTo, .LineTo, .ClosePath };
+    const data = [_]f32{ 1, 2, 3, 4, 100 };
+    const other_data = [_]f32{ 1, 2, 3, 4, 200 };
+    const a = TessCache.hashSvgPath(.FillPath, .{ .alloc = null, .data = &data, .cmds = &cmds }, 0);
+    const b = TessCache.hashSvgPath(.FillPath, .{ .alloc = null, .data = &other_data, .cmds = &cmds }, 0);
+    const c = TessCache.hashSvgPath(.FillPathLyon, .{ .alloc = null, .data = &data, .cmds = &cmds }, 0);
+    try t.eq(a, b);
+    try t.neq(a.hash, c.hash);
+}
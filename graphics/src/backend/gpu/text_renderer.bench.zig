@@ -0,0 +1,54 @@
+const std = @import("std");
+const platform = @import("platform");
+const graphics = @import("graphics");
+
+// Measures long ASCII strings with the default font. Glyphs and kerning for these come from
+// RenderFont's flat glyph table and the font's kerning pair table instead of hashmap lookups.
+// The first measure loads the glyphs and builds the kerning table so it's excluded.
+// Needs a window since the glyphs are rasterized into the gpu font atlas.
+// Run with: zig build run -Dpath="graphics/src/backend/gpu/text_renderer.bench.zig" -Dgraphics -Doptimize=ReleaseFast
+
+const NumRuns = 100;
+const Lengths = [_]usize{ 100, 1000, 10000 };
+const FontSize = 16;
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const alloc = gpa.allocator();
+
+    var win = try platform.Window.init(alloc, .{
+        .title = "measureText bench",
+        .width = 200,
+        .height = 200,
+    });
+    defer win.deinit();
+    var renderer: graphics.WindowRenderer = undefined;
+    try renderer.init(alloc, &win);
+    defer renderer.deinit(alloc);
+    const g = renderer.getGraphics();
+    const font_gid = g.getDefaultFontGroupId();
+
+    // Printable ASCII with spaces so it resembles a paragraph.
+    const str = try alloc.alloc(u8, Lengths[Lengths.len - 1]);
+    defer alloc.free(str);
+    for (str, 0..) |*ch, i| {
+        ch.* = if (i % 7 == 6) ' ' else @intCast(u8, 33 + (i * 31) % 94);
+    }
+
+    var metrics: graphics.TextMetrics = undefined;
+    g.measureFontText(font_gid, FontSize, str, &metrics);
+
+    std.debug.print("runs: {}\n", .{NumRuns});
+    std.debug.print("{s:>10} {s:>12} {s:>12}\n", .{ "chars", "us/measure", "ns/char" });
+    for (Lengths) |len| {
+        var timer = try std.time.Timer.start();
+        var i: u32 = 0;
+        while (i < NumRuns) : (i += 1) {
+            g.measureFontText(font_gid, FontSize, str[0..len], &metrics);
+            std.mem.doNotOptimizeAway(metrics.width);
+        }
+        const ns = @intToFloat(f64, timer.read()) / NumRuns;
+        std.debug.print("{:>10} {d:>12.3} {d:>12.3}\n", .{ len, ns / 1e3, ns / @intToFloat(f64, len) });
+    }
+}
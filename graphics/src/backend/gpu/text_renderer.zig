@@ -14,8 +14,11 @@ const OpenTypeFont = graphics.OpenTypeFont;
 const ImageTex = gpu.ImageTex;
 const font_cache = @import("font_cache.zig");
 const BitmapFontStrike = graphics.BitmapFontStrike;
+const NumKernTableCodepoints = graphics.NumKernTableCodepoints;
 const log = stdx.log.scoped(.text_renderer);
 const Glyph = @import("glyph.zig").Glyph;
+const GlyphRun = @import("glyph_run.zig").GlyphRun;
+const Color = graphics.Color;
 
 /// Returns an glyph iterator over UTF8 text.
 pub fn textGlyphIter(g: *gpu.Graphics, font_gid: FontGroupId, font_size: f32, dpr: u32, str: []const u8) graphics.TextGlyphIterator {
@@ -28,24 +31,28 @@ pub fn textGlyphIter(g: *gpu.Graphics, font_gid: FontGroupId, font_size: f32, dp
 pub fn measureCharAdvance(g: *gpu.Graphics, font_gid: FontGroupId, font_size: f32, dpr: u32, prev_cp: u21, cp: u21) f32 {
     const font_grp = g.font_cache.getFontGroup(font_gid);
     var req_font_size = font_size;
-    const render_font_size = font_cache.computeRenderFontSize(&req_font_size) * @intCast(u16, dpr);
+    const params = g.font_cache.computeRenderFontParams(font_grp.primary_font_desc, &req_font_size, dpr);
 
-    const primary = g.font_cache.getOrCreateRenderFont(font_grp.fonts[0], render_font_size);
+    const primary = g.font_cache.getOrCreateRenderFont(font_grp.fonts[0], params);
     const to_user_scale = primary.getScaleToUserFontSize(req_font_size);
 
-    const glyph_info = g.getOrLoadFontGroupGlyph(font_grp, cp);
+    const glyph_info = g.font_cache.getOrLoadFontGroupGlyph(g, font_grp, params, cp);
     const glyph = glyph_info.glyph;
     var advance = glyph.advance_width * to_user_scale;
 
-    const prev_glyph_info = g.getOrLoadFontGroupGlyph(font_grp, prev_cp);
+    const prev_glyph_info = g.font_cache.getOrLoadFontGroupGlyph(g, font_grp, params, prev_cp);
     const prev_glyph = prev_glyph_info.glyph;
-    advance += computeKern(prev_glyph.glyph_id, prev_glyph_info.font, glyph.glyph_id, glyph_info.font, to_user_scale, cp);
+    advance += computeKern(g.font_cache.alloc, prev_cp, prev_glyph.glyph_id, prev_glyph_info.font, cp, glyph.glyph_id, glyph_info.font, glyph_info.render_font, to_user_scale);
     return @round(advance);
 }
 
 /// For lower font sizes, snap_to_grid is desired since baked fonts don't have subpixel rendering. TODO: Could this be achieved if multiple subpixel variation renders were baked as well?
 pub fn measureText(g: *gpu.Graphics, font_gid: FontGroupId, font_size: f32, dpr: u32, str: []const u8, res: *TextMetrics, comptime snap_to_grid: bool) void {
     var iter = textGlyphIter(g, font_gid, font_size, dpr, str);
+    measureGlyphs(&iter, res, snap_to_grid);
+}
+
+inline fn measureGlyphs(iter: *graphics.TextGlyphIterator, res: *TextMetrics, comptime snap_to_grid: bool) void {
     res.height = iter.primary_height;
     res.width = 0;
     while (iter.nextCodepoint()) {
@@ -58,6 +65,42 @@ pub fn measureText(g: *gpu.Graphics, font_gid: FontGroupId, font_size: f32, dpr:
     }
 }
 
+/// Measures many texts at once. Measures are grouped by font group and size so the render font and
+/// glyph table lookups are resolved once for each group, and identical strings in a group are only measured once.
+/// Reorders arr.
+pub fn measureTextBatch(g: *gpu.Graphics, arr: []*graphics.TextMeasure, dpr: u32, comptime snap_to_grid: bool) void {
+    std.sort.sort(*graphics.TextMeasure, arr, {}, measureLessThan);
+    var i: usize = 0;
+    while (i < arr.len) {
+        const first = arr[i];
+        var iter = textGlyphIter(g, first.font_gid, first.font_size, dpr, first.text);
+        var prev: ?*graphics.TextMeasure = null;
+        while (i < arr.len) : (i += 1) {
+            const measure = arr[i];
+            if (measure.font_gid != first.font_gid or measure.font_size != first.font_size) {
+                break;
+            }
+            if (prev != null and std.mem.eql(u8, prev.?.text, measure.text)) {
+                measure.res = prev.?.res;
+                continue;
+            }
+            iter.inner.reset(measure.text);
+            measureGlyphs(&iter, &measure.res, snap_to_grid);
+            prev = measure;
+        }
+    }
+}
+
+fn measureLessThan(_: void, a: *graphics.TextMeasure, b: *graphics.TextMeasure) bool {
+    if (a.font_gid != b.font_gid) {
+        return a.font_gid < b.font_gid;
+    }
+    if (a.font_size != b.font_size) {
+        return a.font_size < b.font_size;
+    }
+    return std.mem.lessThan(u8, a.text, b.text);
+}
+
 pub const TextGlyphIterator = struct {
     g: *gpu.Graphics,
     fgroup: *FontGroup,
@@ -65,11 +108,12 @@ pub const TextGlyphIterator = struct {
     cp_iter: std.unicode.Utf8Iterator,
     user_scale: f32,
 
+    prev_cp: u21,
     prev_glyph_id_opt: ?u16,
     prev_glyph_font: ?*Font,
 
     req_font_size: f32,
-    render_font_size: u16,
+    render_font_params: font_cache.RenderFontParams,
 
     primary_font: graphics.FontId,
     primary_ascent: f32,
@@ -78,9 +122,9 @@ pub const TextGlyphIterator = struct {
 
     fn init(self: *Self, g: *gpu.Graphics, fgroup: *FontGroup, font_size: f32, dpr: u32, str: []const u8, iter: *graphics.TextGlyphIterator) void {
         var req_font_size = font_size;
-        const render_font_size = font_cache.computeRenderFontSize(fgroup.primary_font_desc, &req_font_size) * @intCast(u16, dpr);
+        const render_font_params = g.font_cache.computeRenderFontParams(fgroup.primary_font_desc, &req_font_size, dpr);
 
-        const primary = g.font_cache.getOrCreateRenderFont(fgroup.primary_font, render_font_size);
+        const primary = g.font_cache.getOrCreateRenderFont(fgroup.primary_font, render_font_params);
         const user_scale = primary.getScaleToUserFontSize(req_font_size);
 
         iter.primary_ascent = primary.ascent * user_scale;
@@ -104,15 +148,24 @@ pub const TextGlyphIterator = struct {
             .fgroup = fgroup,
             .user_scale = user_scale,
             .cp_iter = std.unicode.Utf8View.initUnchecked(str).iterator(),
+            .prev_cp = 0,
             .prev_glyph_id_opt = null,
             .prev_glyph_font = null,
             .req_font_size = req_font_size,
-            .render_font_size = render_font_size,
+            .render_font_params = render_font_params,
             .primary_font = fgroup.primary_font,
             .primary_ascent = iter.primary_ascent,
         };
     }
 
+    /// Restarts the iterator on another string with the same font group and size.
+    pub fn reset(self: *Self, str: []const u8) void {
+        self.cp_iter = std.unicode.Utf8View.initUnchecked(str).iterator();
+        self.prev_cp = 0;
+        self.prev_glyph_id_opt = null;
+        self.prev_glyph_font = null;
+    }
+
     pub fn setIndex(self: *Self, i: usize) void {
         self.cp_iter.i = i;
     }
@@ -123,7 +176,7 @@ pub const TextGlyphIterator = struct {
         state.cp = self.cp_iter.nextCodepoint() orelse return false;
         state.end_idx = self.cp_iter.i;
 
-        const glyph_info = self.g.font_cache.getOrLoadFontGroupGlyph(self.g, self.fgroup, self.render_font_size, state.cp);
+        const glyph_info = self.g.font_cache.getOrLoadFontGroupGlyph(self.g, self.fgroup, self.render_font_params, state.cp);
         const glyph = glyph_info.glyph;
 
         if (self.prev_glyph_font != glyph_info.font) {
@@ -140,7 +193,7 @@ pub const TextGlyphIterator = struct {
             // Advance kerning from previous codepoint.
             switch (glyph_info.font.font_type) {
                 .Outline => {
-                    state.kern = computeKern(prev_glyph_id, self.prev_glyph_font.?, glyph.glyph_id, glyph_info.font, glyph_info.render_font, self.user_scale, state.cp);
+                    state.kern = computeKern(self.g.font_cache.alloc, self.prev_cp, prev_glyph_id, self.prev_glyph_font.?, state.cp, glyph.glyph_id, glyph_info.font, glyph_info.render_font, self.user_scale);
                 },
                 .Bitmap => {
                     const bm_font = glyph_info.font.getBitmapFontBySize(@floatToInt(u16, self.req_font_size));
@@ -158,6 +211,7 @@ pub const TextGlyphIterator = struct {
             cb(ctx, glyph.*);
         }
 
+        self.prev_cp = state.cp;
         self.prev_glyph_id_opt = glyph.glyph_id;
         self.prev_glyph_font = glyph_info.font;
         return true;
@@ -186,12 +240,14 @@ pub const TextGlyphIterator = struct {
     }
 };
 
-// TODO: Cache results since each time it scans the in memory ot font data.
 /// Return kerning from previous glyph id.
-inline fn computeKern(prev_glyph_id: u16, prev_font: *Font, glyph_id: u16, fnt: *Font, render_font: *RenderFont, user_scale: f32, cp: u21) f32 {
-    _ = cp;
+/// ASCII pairs come from the font's precomputed table, other pairs scan the in memory ot font data.
+inline fn computeKern(alloc: std.mem.Allocator, prev_cp: u21, prev_glyph_id: u16, prev_font: *Font, cp: u21, glyph_id: u16, fnt: *Font, render_font: *RenderFont, user_scale: f32) f32 {
     if (prev_font == fnt) {
-        const kern = fnt.getKernAdvance(prev_glyph_id, glyph_id);
+        const kern = if (prev_cp < NumKernTableCodepoints and cp < NumKernTableCodepoints)
+            fnt.getKernTable(alloc)[prev_cp * NumKernTableCodepoints + cp]
+        else
+            fnt.getKernAdvance(prev_glyph_id, glyph_id);
         return @intToFloat(f32, kern) * render_font.scale_from_ttf * user_scale;
     } else {
         // TODO: What to do for kerning between two different fonts?
@@ -211,89 +267,64 @@ inline fn computeBitmapKern(prev_glyph_id: u16, prev_font: *Font, glyph_id: u16,
     return 0;
 }
 
-pub const RenderTextIterator = struct {
-    iter: graphics.TextGlyphIterator,
-    quad: TextureQuad,
-
-    // cur top left position for next codepoint to be drawn.
-    x: f32,
-    y: f32,
-
-    const Self = @This();
-
-    pub fn init(g: *gpu.Graphics, group_id: FontGroupId, font_size: f32, dpr: u32, x: f32, y: f32, str: []const u8) Self {
-        return .{
-            .iter = textGlyphIter(g, group_id, font_size, dpr, str),
-            .quad = undefined,
-            // Start at snapped pos.
-            .x = @round(x),
-            .y = @round(y),
-        };
+/// Resolves the glyphs of str and appends them to run. Kerning continues from the last glyph in the run.
+/// Starts at x, y unless the run already has glyphs, in which case it continues from the run's end.
+pub fn appendGlyphRun(g: *gpu.Graphics, run: *GlyphRun, group_id: FontGroupId, font_size: f32, dpr: u32, x: f32, y: f32, str: []const u8, color: Color, comptime snap_to_grid: bool) void {
+    var iter = textGlyphIter(g, group_id, font_size, dpr, str);
+    if (run.last_cp) |cp| {
+        const glyph_info = g.font_cache.getOrLoadFontGroupGlyph(g, iter.inner.fgroup, iter.inner.render_font_params, cp);
+        iter.inner.prev_cp = cp;
+        iter.inner.prev_glyph_id_opt = glyph_info.glyph.glyph_id;
+        iter.inner.prev_glyph_font = glyph_info.font;
     }
-
-    /// Writes the vertex data of the next codepoint to ctx.quad
-    pub fn nextCodepointQuad(self: *Self, comptime snap_to_grid: bool) bool {
-        const S = struct {
-            fn onGlyphSnap(self_: *Self, glyph: Glyph) void {
-                const scale = self_.iter.inner.user_scale;
-                self_.x += self_.iter.state.kern;
+    const Context = struct {
+        iter: *graphics.TextGlyphIterator,
+        run: *GlyphRun,
+        alloc: std.mem.Allocator,
+        color: Color,
+        x: f32,
+        y: f32,
+
+        fn onGlyph(ctx: *@This(), glyph: Glyph) void {
+            const scale = ctx.iter.inner.user_scale;
+            ctx.x += ctx.iter.state.kern;
+            if (snap_to_grid) {
                 // Snap to pixel after applying advance and kern.
-                self_.x = @round(self_.x);
-
-                // Update quad result.
-                self_.quad.image = glyph.image;
-                self_.quad.cp = self_.iter.state.cp;
-                self_.quad.is_color_bitmap = glyph.is_color_bitmap;
-                // quad.x0 = ctx.x + glyph.x_offset * user_scale;
-                // Snap to pixel for consistent glyph rendering.
-                self_.quad.x0 = @round(self_.x + glyph.x_offset * scale);
-                self_.quad.y0 = self_.y + glyph.y_offset * scale + self_.iter.state.primary_offset_y;
-                self_.quad.x1 = self_.quad.x0 + glyph.dst_width * scale;
-                self_.quad.y1 = self_.quad.y0 + glyph.dst_height * scale;
-                self_.quad.u0 = glyph.u0;
-                self_.quad.v0 = glyph.v0;
-                self_.quad.u1 = glyph.u1;
-                self_.quad.v1 = glyph.v1;
-                // Advance draw x.
-                self_.x += self_.iter.state.advance_width;
-            }
-
-            fn onGlyph(self_: *Self, glyph: Glyph) void {
-                const scale = self_.iter.inner.user_scale;
-                self_.x += self_.iter.state.kern;
-
-                // Update quad result.
-                self_.quad.image = glyph.image;
-                self_.quad.cp = self_.iter.state.cp;
-                self_.quad.is_color_bitmap = glyph.is_color_bitmap;
-                self_.quad.x0 = self_.x + glyph.x_offset * scale;
-                self_.quad.y0 = self_.y + glyph.y_offset * scale + self_.iter.state.primary_offset_y;
-                self_.quad.x1 = self_.quad.x0 + glyph.dst_width * scale;
-                self_.quad.y1 = self_.quad.y0 + glyph.dst_height * scale;
-                self_.quad.u0 = glyph.u0;
-                self_.quad.v0 = glyph.v0;
-                self_.quad.u1 = glyph.u1;
-                self_.quad.v1 = glyph.v1;
-                // Advance draw x.
-                self_.x += self_.iter.state.advance_width;
+                ctx.x = @round(ctx.x);
             }
-        };
-        const onGlyph = if (snap_to_grid) S.onGlyphSnap else S.onGlyph;
-        return self.iter.inner.nextCodepoint(&self.iter.state, self, onGlyph);
+            ctx.run.glyphs.append(ctx.alloc, .{
+                .pen_x = ctx.x,
+                .offset_x = glyph.x_offset * scale,
+                .y0 = ctx.y + glyph.y_offset * scale + ctx.iter.state.primary_offset_y,
+                .width = glyph.dst_width * scale,
+                .height = glyph.dst_height * scale,
+                .u0 = glyph.u0,
+                .v0 = glyph.v0,
+                .u1 = glyph.u1,
+                .v1 = glyph.v1,
+                .image = glyph.image,
+                .is_color_bitmap = glyph.is_color_bitmap,
+                .is_sdf = glyph.is_sdf,
+                .color = if (glyph.is_color_bitmap) Color.White else ctx.color,
+                .x0 = undefined,
+                .x1 = undefined,
+                .y1 = undefined,
+            }) catch stdx.fatal();
+            // Advance draw x.
+            ctx.x += ctx.iter.state.advance_width;
+        }
+    };
+    var ctx = Context{
+        .iter = &iter,
+        .run = run,
+        .alloc = g.alloc,
+        .color = color,
+        // Start at snapped pos.
+        .x = if (run.last_cp != null) run.end_x else @round(x),
+        .y = @round(y),
+    };
+    while (iter.inner.nextCodepoint(&iter.state, &ctx, Context.onGlyph)) {
+        run.last_cp = iter.state.cp;
     }
-};
-
-// Holds compact data relevant to adding texture vertex data.
-pub const TextureQuad = struct {
-    image: ImageTex,
-    cp: u21,
-    is_color_bitmap: bool,
-    x0: f32,
-    y0: f32,
-    x1: f32,
-    y1: f32,
-    u0: f32,
-    v0: f32,
-    u1: f32,
-    v1: f32,
-};
+    run.end_x = ctx.x;
+}
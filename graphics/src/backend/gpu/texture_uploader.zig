@@ -0,0 +1,270 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const t = stdx.testing;
+const builtin = @import("builtin");
+const IsWasm = builtin.target.isWasm();
+const build_options = @import("graphics_options");
+const Backend = build_options.GraphicsBackend;
+const gl = @import("gl");
+const vk = @import("vk");
+
+const graphics = @import("../../graphics.zig");
+const gvk = graphics.vk;
+const ImageId = graphics.ImageId;
+const image = @import("image.zig");
+const ImageStore = image.ImageStore;
+
+/// Default number of bytes uploaded each frame.
+pub const DefaultFrameBudget = 4 * 1024 * 1024;
+
+/// Size of the staging ring. Rows are written at the ring head and the ring wraps when a chunk doesn't fit.
+const StagingBufferSize = 8 * 1024 * 1024;
+
+/// Uploads image pixels to their textures a chunk of rows at a time so a large image doesn't stall a frame.
+/// Rows are copied into a staging ring buffer (a pixel unpack buffer for OpenGL and a host visible buffer for Vulkan)
+/// and then copied into the texture by the gpu. An image is marked ready once all its rows are uploaded.
+pub const TextureUploader = struct {
+    alloc: std.mem.Allocator,
+    /// Uploaded in order. The first upload is the one in progress.
+    uploads: std.ArrayListUnmanaged(Upload),
+    frame_budget: u32,
+    /// Offset of the next write into the staging ring.
+    ring_pos: u32,
+    inner: switch (Backend) {
+        .OpenGL => struct {
+            /// Created on the first upload.
+            pbo: gl.GLuint = 0,
+        },
+        .Vulkan => struct {
+            /// Created on the first upload and stays mapped.
+            staging_buf: ?gvk.buffer.Buffer = null,
+            mapped: [*]u8 = undefined,
+        },
+        else => struct {},
+    },
+
+    const Upload = struct {
+        image_id: ImageId,
+        /// Owned rgba pixels.
+        data: []const u8,
+        width: u32,
+        height: u32,
+        next_row: u32,
+    };
+
+    pub fn init(alloc: std.mem.Allocator) TextureUploader {
+        return .{
+            .alloc = alloc,
+            .uploads = .{},
+            .frame_budget = DefaultFrameBudget,
+            .ring_pos = 0,
+            .inner = .{},
+        };
+    }
+
+    pub fn deinit(self: *TextureUploader, store: *ImageStore) void {
+        for (self.uploads.items) |upload| {
+            self.alloc.free(upload.data);
+        }
+        self.uploads.deinit(self.alloc);
+        switch (Backend) {
+            .OpenGL => {
+                if (self.inner.pbo != 0) {
+                    gl.deleteBuffers(1, &self.inner.pbo);
+                }
+            },
+            .Vulkan => {
+                if (self.inner.staging_buf) |buf| {
+                    const device = store.gpu.inner.ctx.device;
+                    vk.unmapMemory(device, buf.mem);
+                    buf.deinit(device);
+                }
+            },
+            else => {},
+        }
+    }
+
+    /// Queues rgba pixels to upload to the image's texture. Takes ownership of data.
+    pub fn queue(self: *TextureUploader, image_id: ImageId, width: usize, height: usize, data: []const u8) void {
+        self.uploads.append(self.alloc, .{
+            .image_id = image_id,
+            .data = data,
+            .width = @intCast(u32, width),
+            .height = @intCast(u32, height),
+            .next_row = 0,
+        }) catch stdx.fatal();
+    }
+
+    /// Drops pending uploads for an image. Called when the image is marked for removal since its id
+    /// can be freed and reused before the upload would have finished.
+    pub fn cancel(self: *TextureUploader, image_id: ImageId) void {
+        var i: usize = 0;
+        while (i < self.uploads.items.len) {
+            if (self.uploads.items[i].image_id == image_id) {
+                self.alloc.free(self.uploads.items[i].data);
+                _ = self.uploads.orderedRemove(i);
+            } else {
+                i += 1;
+            }
+        }
+    }
+
+    pub fn hasPendingUploads(self: TextureUploader) bool {
+        return self.uploads.items.len > 0;
+    }
+
+    /// Uploads queued rows until the frame budget is used. Called at the start of a frame before any draws.
+    pub fn process(self: *TextureUploader, store: *ImageStore) void {
+        var budget: usize = self.frame_budget;
+        while (self.uploads.items.len > 0) {
+            const upload = &self.uploads.items[0];
+            // Uploads for removed images are dropped in cancel.
+            const img = store.images.getPtrNoCheck(upload.image_id);
+            const row_size = upload.width * 4;
+            const num_rows = getChunkRows(budget, self.frame_budget, row_size, upload.height - upload.next_row);
+            if (num_rows == 0) {
+                break;
+            }
+            const chunk = upload.data[upload.next_row * row_size..][0..num_rows * row_size];
+            self.uploadRows(store, img.*, upload.next_row, upload.width, num_rows, chunk);
+            budget -|= chunk.len;
+            upload.next_row += num_rows;
+            if (upload.next_row == upload.height) {
+                img.ready = true;
+                // Recorded draws left out the image.
+                store.gpu.recording_version +%= 1;
+                self.alloc.free(upload.data);
+                _ = self.uploads.orderedRemove(0);
+            }
+        }
+    }
+
+    fn uploadRows(self: *TextureUploader, store: *ImageStore, img: image.Image, y: u32, width: u32, num_rows: u32, data: []const u8) void {
+        if (data.len > StagingBufferSize) {
+            store.gpu.updateTextureRect(img, 0, y, width, num_rows, data);
+            return;
+        }
+        switch (Backend) {
+            .OpenGL => {
+                if (IsWasm) {
+                    // WebGL doesn't support mapping buffers.
+                    store.gpu.updateTextureRect(img, 0, y, width, num_rows, data);
+                } else {
+                    self.uploadRowsGL(store, img, y, width, num_rows, data);
+                }
+            },
+            .Vulkan => self.uploadRowsVK(store, img, y, width, num_rows, data),
+            else => {},
+        }
+    }
+
+    fn uploadRowsGL(self: *TextureUploader, store: *ImageStore, img: image.Image, y: u32, width: u32, num_rows: u32, data: []const u8) void {
+        if (self.inner.pbo == 0) {
+            gl.genBuffers(1, &self.inner.pbo);
+            gl.bindBuffer(gl.GL_PIXEL_UNPACK_BUFFER, self.inner.pbo);
+            gl.bufferData(gl.GL_PIXEL_UNPACK_BUFFER, StagingBufferSize, null, gl.GL_STREAM_DRAW);
+        } else {
+            gl.bindBuffer(gl.GL_PIXEL_UNPACK_BUFFER, self.inner.pbo);
+        }
+        defer gl.bindBuffer(gl.GL_PIXEL_UNPACK_BUFFER, 0);
+        if (self.ring_pos + data.len > StagingBufferSize) {
+            // Orphan the buffer so the driver can give us new storage while pending copies still read from the old one.
+            gl.bufferData(gl.GL_PIXEL_UNPACK_BUFFER, StagingBufferSize, null, gl.GL_STREAM_DRAW);
+            self.ring_pos = 0;
+        }
+        const offset = self.ring_pos;
+        // Unsynchronized since the range hasn't been written to since the buffer was last orphaned.
+        const access = gl.GL_MAP_WRITE_BIT | gl.GL_MAP_INVALIDATE_RANGE_BIT | gl.GL_MAP_UNSYNCHRONIZED_BIT;
+        const ptr = gl.mapBufferRange(gl.GL_PIXEL_UNPACK_BUFFER, offset, @intCast(gl.GLsizeiptr, data.len), access) orelse {
+            gl.bindBuffer(gl.GL_PIXEL_UNPACK_BUFFER, 0);
+            store.gpu.updateTextureRect(img, 0, y, width, num_rows, data);
+            return;
+        };
+        std.mem.copy(u8, @ptrCast([*]u8, ptr)[0..data.len], data);
+        _ = gl.unmapBuffer(gl.GL_PIXEL_UNPACK_BUFFER);
+        self.ring_pos += @intCast(u32, data.len);
+        store.gpu.batcher.stats.cur_upload_bytes += @intCast(u32, data.len);
+
+        gl.activeTexture(gl.GL_TEXTURE0 + 0);
+        const gl_tex_id = store.getTexture(img.tex_id).inner.tex_id;
+        gl.bindTexture(gl.GL_TEXTURE_2D, gl_tex_id);
+        // With an unpack buffer bound, the pixels arg is an offset into the buffer.
+        gl.texSubImage2D(gl.GL_TEXTURE_2D, 0, 0, @intCast(c_int, y), @intCast(c_int, width), @intCast(c_int, num_rows), gl.GL_RGBA, gl.GL_UNSIGNED_BYTE, @intToPtr(?*const anyopaque, offset));
+        gl.bindTexture(gl.GL_TEXTURE_2D, 0);
+    }
+
+    fn uploadRowsVK(self: *TextureUploader, store: *ImageStore, img: image.Image, y: u32, width: u32, num_rows: u32, data: []const u8) void {
+        const renderer = store.gpu.inner.renderer;
+        const ctx = store.gpu.inner.ctx;
+        if (self.inner.staging_buf == null) {
+            const buf = gvk.buffer.createBuffer(ctx.physical, ctx.device, StagingBufferSize, vk.VK_BUFFER_USAGE_TRANSFER_SRC_BIT, vk.VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | vk.VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            var mapped: ?*anyopaque = null;
+            const res = vk.mapMemory(ctx.device, buf.mem, 0, StagingBufferSize, 0, &mapped);
+            vk.assertSuccess(res);
+            self.inner.staging_buf = buf;
+            self.inner.mapped = @ptrCast([*]u8, mapped);
+        }
+        if (self.ring_pos + data.len > StagingBufferSize) {
+            // Single time commands wait for the queue so earlier ranges are no longer read.
+            self.ring_pos = 0;
+        }
+        const offset = self.ring_pos;
+        std.mem.copy(u8, self.inner.mapped[offset..offset + data.len], data);
+        self.ring_pos += @intCast(u32, data.len);
+        store.gpu.batcher.stats.cur_upload_bytes += @intCast(u32, data.len);
+
+        // Transition to transfer dst layout.
+        gvk.transitionImageLayout(renderer, img.inner.image, vk.VK_FORMAT_R8G8B8A8_SRGB, vk.VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, vk.VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        gvk.copyBufferToImageRegion(renderer, self.inner.staging_buf.?.buf, offset, img.inner.image, 0, y, width, num_rows);
+        // Transition to shader access layout.
+        gvk.transitionImageLayout(renderer, img.inner.image, vk.VK_FORMAT_R8G8B8A8_SRGB, vk.VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, vk.VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+};
+
+/// Returns how many rows fit in the remaining budget. A row wider than the whole budget is still uploaded
+/// one at a time when nothing else was uploaded in the frame so an upload always makes progress.
+fn getChunkRows(budget_left: usize, frame_budget: usize, row_size: usize, rows_left: u32) u32 {
+    var num_rows = budget_left / row_size;
+    if (num_rows == 0 and budget_left == frame_budget) {
+        num_rows = 1;
+    }
+    return @intCast(u32, @min(num_rows, rows_left));
+}
+
+test "getChunkRows" {
+    // Fits the budget.
+    try t.eq(getChunkRows(1000, 1000, 100, 50), 10);
+    // Fewer rows left.
+    try t.eq(getChunkRows(1000, 1000, 100, 4), 4);
+    // Partially used budget.
+    try t.eq(getChunkRows(250, 1000, 100, 50), 2);
+    try t.eq(getChunkRows(50, 1000, 100, 50), 0);
+    // Row is larger than the budget.
+    try t.eq(getChunkRows(1000, 1000, 4000, 50), 1);
+    try t.eq(getChunkRows(500, 1000, 4000, 50), 0);
+}
+
+test "TextureUploader.cancel drops pending uploads for a removed image" {
+    var uploader = TextureUploader.init(t.alloc);
+    defer {
+        for (uploader.uploads.items) |upload| {
+            t.alloc.free(upload.data);
+        }
+        uploader.uploads.deinit(t.alloc);
+    }
+
+    uploader.queue(1, 2, 2, try t.alloc.alloc(u8, 16));
+    uploader.queue(2, 2, 2, try t.alloc.alloc(u8, 16));
+    // A second upload for the same image queued behind another image.
+    uploader.queue(1, 2, 2, try t.alloc.alloc(u8, 16));
+    uploader.uploads.items[0].next_row = 1;
+
+    // Removed while its upload is in progress.
+    uploader.cancel(1);
+    try t.eq(uploader.uploads.items.len, 1);
+    try t.eq(uploader.uploads.items[0].image_id, 2);
+    try t.eq(uploader.hasPendingUploads(), true);
+
+    uploader.cancel(2);
+    try t.eq(uploader.hasPendingUploads(), false);
+}
@@ -95,10 +95,16 @@ pub fn copyImageToBuffer(renderer: *Renderer, img: vk.VkImage, buf: vk.VkBuffer,
 }
 
 pub fn copyBufferToImage(renderer: *Renderer, buf: vk.VkBuffer, img: vk.VkImage, width: usize, height: usize) void {
+    copyBufferToImageRegion(renderer, buf, 0, img, 0, 0, width, height);
+}
+
+/// Copies tightly packed buffer data into a region of the image.
+/// Copies tightly packed rgba pixels starting at buf_offset into a region of the image.
+pub fn copyBufferToImageRegion(renderer: *Renderer, buf: vk.VkBuffer, buf_offset: usize, img: vk.VkImage, x: usize, y: usize, width: usize, height: usize) void {
     const cmd_buf = renderer.beginSingleTimeCommands();
 
     const copy = vk.VkBufferImageCopy{
-        .bufferOffset = 0,
+        .bufferOffset = buf_offset,
         .bufferRowLength = 0,
         .bufferImageHeight = 0,
 
@@ -110,8 +116,8 @@ pub fn copyBufferToImage(renderer: *Renderer, buf: vk.VkBuffer, img: vk.VkImage,
         },
 
         .imageOffset = .{
-            .x = 0,
-            .y = 0,
+            .x = @intCast(i32, x),
+            .y = @intCast(i32, y),
             .z = 0,
         },
         .imageExtent = .{
@@ -868,6 +874,7 @@ pub const Pipelines = struct {
     wireframe_pipeline: Pipeline,
     tex_pipeline: Pipeline,
     tex_pipeline_2d: Pipeline,
+    sdf_pipeline_2d: Pipeline,
     tex_pbr_pipeline: Pipeline,
     anim_pipeline: Pipeline,
     anim_pbr_pipeline: Pipeline,
@@ -881,6 +888,7 @@ pub const Pipelines = struct {
         self.wireframe_pipeline.deinit(device);
         self.tex_pipeline.deinit(device);
         self.tex_pipeline_2d.deinit(device);
+        self.sdf_pipeline_2d.deinit(device);
         self.tex_pbr_pipeline.deinit(device);
         self.anim_pipeline.deinit(device);
         self.anim_pbr_pipeline.deinit(device);
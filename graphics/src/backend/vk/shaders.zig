@@ -3,6 +3,7 @@ pub const norm_frag_glsl = @embedFile("shaders/norm_frag.glsl");
 
 pub const tex_vert_glsl = @embedFile("shaders/tex_vert.glsl");
 pub const tex_frag_glsl = @embedFile("shaders/tex_frag.glsl");
+pub const sdf_frag_glsl = @embedFile("shaders/sdf_frag.glsl");
 
 pub const anim_vert_glsl = @embedFile("shaders/anim_vert.glsl");
 pub const anim_frag_glsl = @embedFile("shaders/anim_frag.glsl");
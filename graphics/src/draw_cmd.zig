@@ -5,7 +5,7 @@ const log = stdx.log.scoped(.draw_cmd);
 
 // Draw calls serialized into data.
 // This is useful for parsing svg files into draw calls.
-// In the future, it might be useful for a library consumer to cache draw calls.
+// Graphics.compileDrawCommandList can also turn a list into GPU buffers that are replayed with drawRetainedDrawList.
 
 pub const DrawCommandList = struct {
     alloc: ?std.mem.Allocator,
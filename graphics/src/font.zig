@@ -32,6 +32,9 @@ pub const BitmapFontScaler = struct {
     },
 };
 
+/// Codepoints below this have their kerning pairs precomputed in Font.kern_table.
+pub const NumKernTableCodepoints = 128;
+
 // Contains rendering metadata about one font face. 
 // Contains the backing bitmap font size to scale to user requested font size.
 pub const Font = struct {
@@ -52,6 +55,10 @@ pub const Font = struct {
     bmfont_scaler: BitmapFontScaler,
     bmfont_strikes: []const BitmapFontStrike,
 
+    /// Unscaled kerning between codepoints below NumKernTableCodepoints, indexed by prev_cp * NumKernTableCodepoints + cp.
+    /// Only for Outline fonts and built on the first lookup.
+    kern_table: ?[]i16,
+
     pub fn initTTF(self: *Font, alloc: std.mem.Allocator, id: FontId, data: []const u8) !void {
         switch (graphics.FontRendererBackend) {
             .Freetype => {
@@ -68,6 +75,7 @@ pub const Font = struct {
                     .data = own_data,
                     .bmfont_scaler = undefined,
                     .bmfont_strikes = undefined,
+                    .kern_table = null,
                 };
                 FreetypeBackend.initFont(graphics.ft_library, &self.impl, own_data, 0);
             },
@@ -93,6 +101,7 @@ pub const Font = struct {
                     .data = own_data,
                     .bmfont_scaler = undefined,
                     .bmfont_strikes = undefined,
+                    .kern_table = null,
                 };
             },
         }
@@ -132,6 +141,7 @@ pub const Font = struct {
             .data = undefined,
             .bmfont_scaler = undefined,
             .bmfont_strikes = strikes,
+            .kern_table = null,
         };
 
         // Build BitmapFontScaler.
@@ -171,9 +181,45 @@ pub const Font = struct {
                 alloc.free(self.bmfont_strikes);
             },
         }
+        if (self.kern_table) |table| {
+            alloc.free(table);
+        }
         alloc.free(self.name);
     }
 
+    /// Returns the kerning table for codepoints below NumKernTableCodepoints.
+    pub fn getKernTable(self: *Font, alloc: std.mem.Allocator) []const i16 {
+        if (self.kern_table == null) {
+            self.kern_table = self.buildKernTable(alloc);
+        }
+        return self.kern_table.?;
+    }
+
+    fn buildKernTable(self: Font, alloc: std.mem.Allocator) []i16 {
+        const N = NumKernTableCodepoints;
+        var glyph_ids: [N]?u16 = undefined;
+        for (&glyph_ids, 0..) |*id, cp| {
+            id.* = self.ot_font.getGlyphId(@intCast(u21, cp)) catch null;
+        }
+        const table = alloc.alloc(i16, N * N) catch @panic("error");
+        for (glyph_ids, 0..) |m_prev_id, prev_cp| {
+            const row = table[prev_cp * N..][0..N];
+            const prev_id = m_prev_id orelse {
+                std.mem.set(i16, row, 0);
+                continue;
+            };
+            for (glyph_ids, 0..) |m_id, cp| {
+                if (m_id) |id| {
+                    const kern = self.getKernAdvance(prev_id, id);
+                    row[cp] = @intCast(i16, std.math.clamp(kern, std.math.minInt(i16), std.math.maxInt(i16)));
+                } else {
+                    row[cp] = 0;
+                }
+            }
+        }
+        return table;
+    }
+
     pub fn getOtFontBySize(self: Font, font_size: u16) OpenTypeFont {
         switch (self.font_type) {
             .Outline => {
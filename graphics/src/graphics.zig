@@ -56,9 +56,15 @@ pub const TextMeasure = text_.TextMeasure;
 pub const TextMetrics = text_.TextMetrics;
 pub const TextGlyphIterator = text_.TextGlyphIterator;
 pub const TextLayout = text_.TextLayout;
+pub const TextLayoutCache = text_.TextLayoutCache;
 pub const TextRun = text_.TextRun;
 pub const TextRunSegment = text_.TextRunSegment;
 
+/// Decodes image data into rgba pixels without a graphics context so it can be done on a worker thread.
+pub const decodeImage = gpu.decodeImage;
+pub const DecodedImage = gpu.DecodedImage;
+pub const DrawRecording = gpu.DrawRecording;
+
 const FontRendererBackendType = enum(u1) {
     /// Default renderer for desktop.
     Freetype = 0,
@@ -78,6 +84,7 @@ pub const OpenTypeFont = _ttf.OpenTypeFont;
 const font_ = @import("font.zig");
 pub const Font = font_.Font;
 pub const FontType = font_.FontType;
+pub const NumKernTableCodepoints = font_.NumKernTableCodepoints;
 const font_group_ = @import("font_group.zig");
 pub const FontGroup = font_group_.FontGroup;
 pub const FontDesc = font_.FontDesc;
@@ -112,6 +119,10 @@ pub const Graphics = struct {
     vec2_buf: std.ArrayListUnmanaged(Vec2),
     vec2_slice_buf: std.ArrayListUnmanaged(stdx.IndexSlice(u32)),
     qbez_buf: std.ArrayListUnmanaged(curve.SubQuadBez),
+    text_layout_cache: text_.TextLayoutCache,
+    /// Incremented when glyphs can resolve to different fonts, eg. the fallback fonts changed.
+    /// Text layouts and measures from an older generation are stale.
+    font_gen: u32,
 
     pub fn init(self: *Graphics, alloc: std.mem.Allocator, dpr: f32, renderer: *gl.Renderer, stats: *FrameStats) !void {
         self.initCommon(alloc);
@@ -121,6 +132,7 @@ pub const Graphics = struct {
                 try gpu.Graphics.initGL(&self.impl, alloc, renderer, dpr, stats);
                 self.new_impl.gpu_ctx = &self.impl;
                 self.new_impl.renderer.image_store = &self.impl.image_store;
+                self.new_impl.renderer.stats = stats;
             },
             .WasmCanvas => canvas.Graphics.init(&self.impl, alloc),
             .Test => testg.Graphics.init(&self.impl, alloc),
@@ -128,9 +140,9 @@ pub const Graphics = struct {
         }
     }
 
-    pub fn initVK(self: *Graphics, alloc: std.mem.Allocator, dpr: f32, renderer: *vk.Renderer, vk_ctx: vk.VkContext) void {
+    pub fn initVK(self: *Graphics, alloc: std.mem.Allocator, dpr: f32, renderer: *vk.Renderer, vk_ctx: vk.VkContext, stats: *FrameStats) void {
         self.initCommon(alloc);
-        gpu.Graphics.initVK(&self.impl, alloc, dpr, renderer, vk_ctx) catch fatal();
+        gpu.Graphics.initVK(&self.impl, alloc, dpr, renderer, vk_ctx, stats) catch fatal();
     }
 
     fn initCommon(self: *Graphics, alloc: std.mem.Allocator) void {
@@ -142,6 +154,8 @@ pub const Graphics = struct {
             .vec2_buf = .{},
             .vec2_slice_buf = .{},
             .qbez_buf = .{},
+            .text_layout_cache = text_.TextLayoutCache.init(alloc, text_.TextLayoutCache.DefaultMaxBytes),
+            .font_gen = 0,
             .impl = undefined,
             .new_impl = undefined,
         };
@@ -161,6 +175,7 @@ pub const Graphics = struct {
         self.vec2_buf.deinit(self.alloc);
         self.vec2_slice_buf.deinit(self.alloc);
         self.qbez_buf.deinit(self.alloc);
+        self.text_layout_cache.deinit();
         switch (Backend) {
             .OpenGL => {
                 self.impl.deinit();
@@ -589,6 +604,16 @@ pub const Graphics = struct {
         }
     }
 
+    /// Same as fillPolygon but the triangulation is cached and reused the next time the same points are drawn.
+    /// Use for static shapes only since every distinct polygon takes up cache space.
+    pub fn fillPolygonCached(self: *Graphics, pts: []const Vec2) !void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => try gpu.Graphics.fillPolygonCached(&self.impl, pts),
+            .WasmCanvas => canvas.Graphics.fillPolygon(&self.impl, pts),
+            else => stdx.unsupported(),
+        }
+    }
+
     pub fn strokePolygonF(self: *Graphics, pts: []const f32) void {
         self.vec2_buf.resize(self.alloc, pts.len / 2) catch fatal();
         var i: u32 = 0;
@@ -652,6 +677,12 @@ pub const Graphics = struct {
                 const t_ = trace(@src());
                 defer t_.end();
 
+                // Static paths are only flattened and triangulated once.
+                const key = gpu.TessCache.hashSvgPath(.FillPath, path, 0);
+                if (self.impl.pushCachedTess(key, self.impl.ps.fill_color)) {
+                    return;
+                }
+
                 self.vec2_buf.clearRetainingCapacity();
                 self.vec2_slice_buf.clearRetainingCapacity();
                 self.qbez_buf.clearRetainingCapacity();
@@ -663,7 +694,7 @@ pub const Graphics = struct {
                 if (self.vec2_slice_buf.items.len == 0) {
                     return;
                 }
-                try gpu.Graphics.fillPolygons(&self.impl, self.vec2_buf.items, self.vec2_slice_buf.items);
+                try gpu.Graphics.fillPolygonsCached(&self.impl, key, self.vec2_buf.items, self.vec2_slice_buf.items);
             },
             .WasmCanvas => canvas.Graphics.fillSvgPath(&self.impl, x, y, path),
             else => stdx.unsupported(),
@@ -676,6 +707,12 @@ pub const Graphics = struct {
                 const t_ = trace(@src());
                 defer t_.end();
 
+                // Static paths are only flattened and triangulated once.
+                const key = gpu.TessCache.hashSvgPath(.StrokePath, path, self.impl.ps.line_width);
+                if (self.impl.pushCachedTess(key, self.impl.ps.fill_color)) {
+                    return;
+                }
+
                 self.vec2_buf.clearRetainingCapacity();
                 self.vec2_slice_buf.clearRetainingCapacity();
                 self.qbez_buf.clearRetainingCapacity();
@@ -687,7 +724,7 @@ pub const Graphics = struct {
                 if (self.vec2_slice_buf.items.len == 0) {
                     return;
                 }
-                try gpu.Graphics.fillPolygons(&self.impl, self.vec2_buf.items, self.vec2_slice_buf.items);
+                try gpu.Graphics.fillPolygonsCached(&self.impl, key, self.vec2_buf.items, self.vec2_slice_buf.items);
             },
             .WasmCanvas => canvas.Graphics.strokeSvgPath(&self.impl, x, y, path),
             else => stdx.unsupported(),
@@ -724,6 +761,113 @@ pub const Graphics = struct {
         }
     }
 
+    /// Compiles a DrawCommandList into vertex and index buffers that stay on the GPU.
+    /// Paths are flattened and tessellated once and fill colors are baked into the vertices,
+    /// so drawing the result with drawRetainedDrawList costs one draw call per texture under the current transform.
+    pub fn compileDrawCommandList(self: *Graphics, _list: DrawCommandList) !RetainedDrawListId {
+        switch (Backend) {
+            .OpenGL, .Vulkan => {
+                var list = _list;
+                var color = self.getFillColor();
+                self.impl.beginRetainedDrawList();
+                for (list.cmds) |ptr| {
+                    switch (ptr.tag) {
+                        .FillColor => {
+                            const cmd = list.getCommand(.FillColor, ptr);
+                            color = Color.fromU32(cmd.rgba);
+                        },
+                        .FillPolygon => {
+                            const cmd = list.getCommand(.FillPolygon, ptr);
+                            const slice = list.getExtraData(cmd.start_vertex_id, cmd.num_vertices * 2);
+                            try self.impl.retainPolygon(@ptrCast([*]const Vec2, slice.ptr)[0..cmd.num_vertices], color);
+                        },
+                        .FillPath => {
+                            const cmd = list.getCommand(.FillPath, ptr);
+                            var end = cmd.start_path_cmd_id + cmd.num_cmds;
+                            self.vec2_buf.clearRetainingCapacity();
+                            self.vec2_slice_buf.clearRetainingCapacity();
+                            self.qbez_buf.clearRetainingCapacity();
+                            try svg.flattenSvgPathFill(self.alloc, .{
+                                .vec2 = &self.vec2_buf,
+                                .vec2_slice = &self.vec2_slice_buf,
+                                .qbez = &self.qbez_buf,
+                            }, .{
+                                .alloc = null,
+                                .data = list.extra_data[cmd.start_data_id..],
+                                .cmds = std.mem.bytesAsSlice(svg.PathCommand, list.sub_cmds)[cmd.start_path_cmd_id..end],
+                            });
+                            if (self.vec2_slice_buf.items.len > 0) {
+                                try self.impl.retainPolygons(self.vec2_buf.items, self.vec2_slice_buf.items, color);
+                            }
+                        },
+                        .FillRect => {
+                            const cmd = list.getCommand(.FillRect, ptr);
+                            try self.impl.retainRect(cmd.x, cmd.y, cmd.width, cmd.height, color);
+                        },
+                    }
+                }
+                return self.impl.endRetainedDrawList();
+            },
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// Draws a compiled DrawCommandList with the current transform.
+    pub fn drawRetainedDrawList(self: *Graphics, id: RetainedDrawListId) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.drawRetainedDrawList(&self.impl, id),
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// GPU buffers are released once no frame in flight can still be using them.
+    pub fn removeRetainedDrawList(self: *Graphics, id: RetainedDrawListId) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.removeRetainedDrawList(&self.impl, id),
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// Starts copying the 2D geometry that is drawn into a recording so it can be replayed without redoing the work that generated it.
+    /// Only one recording is active at a time. Clipping, blending, 3D or a transform change while recording makes it invalid.
+    pub fn beginRecording(self: *Graphics, rec: *DrawRecording) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.beginRecording(&self.impl, rec),
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// Continues a recording after endRecording. Draws in between are left out.
+    pub fn resumeRecording(self: *Graphics, rec: *DrawRecording) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.resumeRecording(&self.impl, rec),
+            else => stdx.unsupported(),
+        }
+    }
+
+    pub fn endRecording(self: *Graphics) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.endRecording(&self.impl),
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// False if the recording is invalid or glyphs and images it refers to have changed since.
+    pub fn canReplayRecording(self: *Graphics, rec: *const DrawRecording) bool {
+        switch (Backend) {
+            .OpenGL, .Vulkan => return gpu.Graphics.canReplayRecording(&self.impl, rec),
+            else => return false,
+        }
+    }
+
+    /// Draws the recorded batches in [batch_start, batch_end) with the current transform.
+    pub fn replayRecording(self: *Graphics, rec: *const DrawRecording, batch_start: u32, batch_end: u32) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.replayRecording(&self.impl, rec, batch_start, batch_end),
+            else => stdx.unsupported(),
+        }
+    }
+
     pub fn drawCommandListLyon(self: *Graphics, _list: DrawCommandList) void {
         var list = _list;
         for (list.cmds) |ptr| {
@@ -823,13 +967,43 @@ pub const Graphics = struct {
 
     // Loads an image from various data formats.
     pub fn createImage(self: *Graphics, data: []const u8) !Image {
+        return self.createImageExt(data, .{});
+    }
+
+    /// Creates an image from encoded image data with options. eg. Set atlas to pack a small sprite with other images.
+    pub fn createImageExt(self: *Graphics, data: []const u8, opts: CreateImageOptions) !Image {
         switch (Backend) {
-            .OpenGL, .Vulkan => return gpu.ImageStore.createImageFromData(&self.impl.image_store, data),
+            .OpenGL, .Vulkan => return gpu.ImageStore.createImageFromData(&self.impl.image_store, data, opts),
             .WasmCanvas => stdx.panic("unsupported, use createImageFromPathPromise"),
             else => stdx.unsupported(),
         }
     }
 
+    /// Creates an image from pixels decoded with decodeImage, usually on another thread. The pixels are uploaded
+    /// over the next frames so a large image doesn't stall a frame. The image is skipped when drawn until it's ready.
+    /// Takes ownership of the decoded pixels, so they must be decoded with the same allocator this Graphics was created with.
+    pub fn createImageAsync(self: *Graphics, decoded: DecodedImage, opts: CreateImageOptions) Image {
+        switch (Backend) {
+            .OpenGL, .Vulkan => {
+                const res = gpu.ImageStore.createImageFromBitmapAsync(&self.impl.image_store, decoded.width, decoded.height, decoded.data, opts);
+                return .{
+                    .id = res.image_id,
+                    .width = decoded.width,
+                    .height = decoded.height,
+                };
+            },
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// Whether the image's pixels have been uploaded and it can be drawn.
+    pub fn isImageReady(self: *Graphics, id: ImageId) bool {
+        switch (Backend) {
+            .OpenGL, .Vulkan => return gpu.ImageStore.isImageReady(&self.impl.image_store, id),
+            else => return true,
+        }
+    }
+
     /// Creates an image from svg content. The svg will be rendered to fit the provided image size.
     pub fn createSvgImage(self: *Graphics, data: []const u8, width: u32, height: u32, opts: svg.SvgOptions) !Image {
         switch (Backend) {
@@ -922,7 +1096,18 @@ pub const Graphics = struct {
         }
     }
 
+    /// Device pixel ratio rounded up. Text is measured at this scale so measures change with it.
+    pub fn getDprCeil(self: Graphics) u8 {
+        switch (Backend) {
+            .OpenGL, .Vulkan => return self.impl.dpr_ceil,
+            else => return 1,
+        }
+    }
+
     pub fn addFallbackFont(self: *Graphics, font_id: FontId) !void {
+        // Glyphs can resolve to different fonts.
+        self.text_layout_cache.clear();
+        self.font_gen +%= 1;
         switch (Backend) {
             .OpenGL, .Vulkan => try gpu.Graphics.addFallbackFont(&self.impl, font_id),
             else => stdx.unsupported(),
@@ -930,12 +1115,80 @@ pub const Graphics = struct {
     }
 
     pub fn setFallbackFonts(self: *Graphics, fonts: []const FontId) !void {
+        // Glyphs can resolve to different fonts.
+        self.text_layout_cache.clear();
+        self.font_gen +%= 1;
         switch (Backend) {
             .OpenGL, .Vulkan => try gpu.Graphics.setFallbackFonts(&self.impl, fonts),
             else => stdx.unsupported(),
         }
     }
 
+    /// Renders larger outline font sizes from one set of signed distance field glyphs instead of a bitmap per size.
+    pub fn setSdfGlyphs(self: *Graphics, sdf_glyphs: bool) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.setSdfGlyphs(&self.impl, sdf_glyphs),
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// Rasterizes outline glyphs on worker threads. Missed glyphs are drawn blank until they are ready in a later frame.
+    pub fn setAsyncGlyphs(self: *Graphics, async_glyphs: bool) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.setAsyncGlyphs(&self.impl, async_glyphs),
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// Whether another frame is needed to draw glyphs that are still being rasterized.
+    pub fn hasPendingGlyphs(self: *Graphics) bool {
+        switch (Backend) {
+            .OpenGL, .Vulkan => return gpu.Graphics.hasPendingGlyphs(&self.impl),
+            else => return false,
+        }
+    }
+
+    /// Whether another frame is needed to finish uploading images created with createImageAsync.
+    pub fn hasPendingImageUploads(self: *Graphics) bool {
+        switch (Backend) {
+            .OpenGL, .Vulkan => return gpu.Graphics.hasPendingImageUploads(&self.impl),
+            else => return false,
+        }
+    }
+
+    /// Max number of bytes of async images uploaded each frame. Defaults to 4MB.
+    pub fn setImageUploadBudget(self: *Graphics, bytes: u32) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.setImageUploadBudget(&self.impl, bytes),
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// When enabled, 2D batches are grouped by pipeline, texture and transform, and batches with the same state are merged into one draw call.
+    /// Batches are only reordered when they don't overlap so the result is the same. FrameStats reports the draw calls before and after.
+    pub fn setDeferredBatching(self: *Graphics, deferred: bool) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.setDeferredBatching(&self.impl, deferred),
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// Caps the font atlas dimensions. Once reached, the least recently used glyphs are evicted instead of growing the atlas.
+    pub fn setFontAtlasMaxSize(self: *Graphics, max_width: u32, max_height: u32) void {
+        switch (Backend) {
+            .OpenGL, .Vulkan => gpu.Graphics.setFontAtlasMaxSize(&self.impl, max_width, max_height),
+            else => stdx.unsupported(),
+        }
+    }
+
+    /// Occupancy and eviction stats of the main font atlas.
+    pub fn getFontAtlasStats(self: *Graphics) gpu.FontAtlasStats {
+        switch (Backend) {
+            .OpenGL, .Vulkan => return gpu.Graphics.getFontAtlasStats(&self.impl),
+            else => stdx.unsupported(),
+        }
+    }
+
     /// Adds .otb bitmap font with data at different font sizes.
     pub fn addFontOTB(self: *Graphics, data: []const BitmapFontData) FontId {
         switch (Backend) {
@@ -1058,14 +1311,10 @@ pub const Graphics = struct {
         }
     }
 
-    /// Measure many text at once.
+    /// Measure many text at once. Identical texts with the same font group and size are only measured once. Reorders arr.
     pub fn measureTextBatch(self: *Graphics, arr: []*TextMeasure) void {
         switch (Backend) {
-            .OpenGL, .Vulkan => {
-                for (arr) |measure| {
-                    gpu.Graphics.measureFontText(&self.impl, measure.font_gid, measure.font_size, measure.text, &measure.res);
-                }
-            },
+            .OpenGL, .Vulkan => gpu.Graphics.measureTextBatch(&self.impl, arr),
             .WasmCanvas => canvas.Graphics.measureTexts(&self.impl, arr),
             .Test => {},
             else => stdx.unsupported(),
@@ -1075,7 +1324,7 @@ pub const Graphics = struct {
     /// Measure the char advance between two codepoints.
     pub fn measureCharAdvance(self: *Graphics, font_gid: FontGroupId, font_size: f32, prev_cp: u21, cp: u21) f32 {
         switch (Backend) {
-            .OpenGL, .Vulkan => return text_renderer.measureCharAdvance(&self.impl.font_cache, &self.impl, font_gid, font_size, prev_cp, cp),
+            .OpenGL, .Vulkan => return text_renderer.measureCharAdvance(&self.impl, font_gid, font_size, self.impl.dpr_ceil, prev_cp, cp),
             .Test => {
                 const factor = font_size / self.impl.default_font_size;
                 return factor * self.impl.default_font_glyph_advance_width;
@@ -1093,6 +1342,7 @@ pub const Graphics = struct {
     }
 
     /// Perform text layout and save the results.
+    /// If buf was laid out before with the same font and width, only the lines from the first edit onwards are redone.
     pub fn textLayout(self: *Graphics, font_gid: FontGroupId, size: f32, str: []const u8, preferred_width: f32, spanStartX: f32, buf: *TextLayout) void {
         text_.textLayout(self, font_gid, size, str, preferred_width, spanStartX, buf);
     }
@@ -2268,6 +2518,8 @@ pub const VMetrics = struct {
 
 pub const ImageId = u32;
 
+pub const RetainedDrawListId = u32;
+
 pub const Image = struct {
     id: ImageId,
     width: usize,
@@ -2414,6 +2666,11 @@ pub const CreateImageOptions = struct {
 
     /// Whether image samplers will use linear filtering.
     linear_filter: bool = true,
+
+    /// Pack the image into a shared atlas texture so many small images can be drawn in one batch.
+    /// Ignored for offscreen rendering and images larger than gpu.MaxAtlasImageSize.
+    /// An atlas image only covers part of its texture so it should only be drawn with drawImage, drawImageScaled and drawSubImage.
+    atlas: bool = false,
 };
 
 const FlattenResultView = struct {
@@ -17,6 +17,7 @@ const ResizeCallbackItem = struct {
 /// Perform best fit placement. The placement with the lowest y is chosen, ties are broken with lowest waste.
 /// Does not own the underlying buffer and only cares about providing the next available rectangle and triggering resize events.
 /// When the buffer needs to resize, the width and height are doubled and resize callbacks are invoked.
+/// Freed rects are kept in a free list and reused with guillotine splits before the skyline is consulted.
 pub const RectBinPacker = struct {
     spans: stdx.ds.PooledHandleSLLBuffer(SpanId, Span),
 
@@ -26,17 +27,31 @@ pub const RectBinPacker = struct {
     /// In-order callbacks.
     resize_cbs: std.ArrayList(ResizeCallbackItem),
 
+    /// Rects below the skyline that were freed and can be handed out again.
+    free_rects: std.ArrayList(Rect),
+
     width: u32,
     height: u32,
 
+    /// tryAllocRect won't grow past these dimensions.
+    max_width: u32,
+    max_height: u32,
+
+    /// Area of the rects currently allocated.
+    used_area: u64,
+
     const Self = @This();
 
     pub fn init(alloc: std.mem.Allocator, width: u32, height: u32) Self {
         var new = Self{
             .spans = stdx.ds.PooledHandleSLLBuffer(SpanId, Span).init(alloc),
             .resize_cbs = std.ArrayList(ResizeCallbackItem).init(alloc),
+            .free_rects = std.ArrayList(Rect).init(alloc),
             .width = width,
             .height = height,
+            .max_width = std.math.maxInt(u32),
+            .max_height = std.math.maxInt(u32),
+            .used_area = 0,
             .head = undefined,
         };
         new.head = new.spans.add(.{ .x = 0, .y = 0, .width = width }) catch @panic("error");
@@ -46,6 +61,41 @@ pub const RectBinPacker = struct {
     pub fn deinit(self: *Self) void {
         self.spans.deinit();
         self.resize_cbs.deinit();
+        self.free_rects.deinit();
+    }
+
+    pub fn setMaxSize(self: *Self, max_width: u32, max_height: u32) void {
+        self.max_width = max_width;
+        self.max_height = max_height;
+    }
+
+    /// Releases every rect but keeps the current dimensions. Used to repack from scratch.
+    pub fn reset(self: *Self) void {
+        self.spans.clearRetainingCapacity();
+        self.head = self.spans.add(.{ .x = 0, .y = 0, .width = self.width }) catch @panic("error");
+        self.free_rects.clearRetainingCapacity();
+        self.used_area = 0;
+    }
+
+    /// Returns the rect so it can be reused by a later allocation.
+    /// The skyline isn't lowered so space is only reclaimed through the free list or a reset.
+    pub fn freeRect(self: *Self, x: u32, y: u32, width: u32, height: u32) void {
+        self.free_rects.append(.{ .x = x, .y = y, .width = width, .height = height }) catch @panic("error");
+        self.used_area -= @as(u64, width) * height;
+    }
+
+    pub fn getStats(self: Self) RectBinPackerStats {
+        var free_area: u64 = 0;
+        for (self.free_rects.items) |rect| {
+            free_area += @as(u64, rect.width) * rect.height;
+        }
+        return .{
+            .width = self.width,
+            .height = self.height,
+            .used_area = self.used_area,
+            .free_list_area = free_area,
+            .num_free_rects = @intCast(u32, self.free_rects.items.len),
+        };
     }
 
     pub fn addResizeCallback(self: *Self, ctx: ?*anyopaque, cb: ResizeCallback) void {
@@ -64,41 +114,99 @@ pub const RectBinPacker = struct {
         }
     }
 
+    /// Always returns a rect. Grows past the max size if there is no other space.
     pub fn allocRect(self: *Self, width: u32, height: u32) Point2 {
+        if (self.tryAllocRect(width, height)) |pos| {
+            return pos;
+        }
+        return self.growAndAllocRect(width, height, false).?;
+    }
+
+    /// Returns null if the rect can't fit without growing past the max size.
+    pub fn tryAllocRect(self: *Self, width: u32, height: u32) ?Point2 {
+        if (self.allocFreeRect(width, height)) |pos| {
+            self.used_area += @as(u64, width) * height;
+            return pos;
+        }
         if (self.findRectSpace(width, height)) |res| {
             self.allocRectResult(res);
+            self.used_area += @as(u64, width) * height;
             return Point2.init(res.x, res.y);
-        } else {
-            // Perform resize.
-            while (true) {
-                self.width *= 2;
-                self.height *= 2;
-
-                // Add or extend a span.
-                const last_id = self.spans.getLast(self.head).?;
-                const last = self.spans.getPtrNoCheck(last_id);
-                if (last.y == 0) {
-                    // Extend.
-                    last.width = self.width - last.x;
-                } else {
-                    const start_x = last.x + last.width;
-                    _ = self.spans.insertAfter(last_id, .{
-                        .x = start_x,
-                        .y = 0,
-                        .width = self.width - start_x,
-                    }) catch @panic("error");
-                }
+        }
+        return self.growAndAllocRect(width, height, true);
+    }
 
-                if (self.findRectSpace(width, height)) |res| {
-                    self.allocRectResult(res);
-                    // Invoke resize callbacks only after we allocated the rect.
-                    for (self.resize_cbs.items) |it| {
-                        it.cb(it.ctx, self.width, self.height);
+    /// Picks the free rect that leaves the least area and splits the remainder along the shorter leftover axis.
+    fn allocFreeRect(self: *Self, width: u32, height: u32) ?Point2 {
+        var best_idx: ?usize = null;
+        var best_waste: u64 = std.math.maxInt(u64);
+        for (self.free_rects.items, 0..) |rect, i| {
+            if (rect.width >= width and rect.height >= height) {
+                const waste = @as(u64, rect.width) * rect.height - @as(u64, width) * height;
+                if (waste < best_waste) {
+                    best_idx = i;
+                    best_waste = waste;
+                    if (waste == 0) {
+                        break;
                     }
-                    return Point2.init(res.x, res.y);
                 }
             }
         }
+        const rect = self.free_rects.swapRemove(best_idx orelse return null);
+        const rem_width = rect.width - width;
+        const rem_height = rect.height - height;
+        var right = Rect{ .x = rect.x + width, .y = rect.y, .width = rem_width, .height = rect.height };
+        var bottom = Rect{ .x = rect.x, .y = rect.y + height, .width = width, .height = rem_height };
+        if (rem_width < rem_height) {
+            right.height = height;
+            bottom.width = rect.width;
+        }
+        if (right.width > 0 and right.height > 0) {
+            self.free_rects.append(right) catch @panic("error");
+        }
+        if (bottom.width > 0 and bottom.height > 0) {
+            self.free_rects.append(bottom) catch @panic("error");
+        }
+        return Point2.init(rect.x, rect.y);
+    }
+
+    fn growAndAllocRect(self: *Self, width: u32, height: u32, respect_max: bool) ?Point2 {
+        var resized = false;
+        defer if (resized) {
+            // Invoke resize callbacks only after we allocated the rect.
+            for (self.resize_cbs.items) |it| {
+                it.cb(it.ctx, self.width, self.height);
+            }
+        };
+        while (true) {
+            if (respect_max and (self.width * 2 > self.max_width or self.height * 2 > self.max_height)) {
+                return null;
+            }
+            self.width *= 2;
+            self.height *= 2;
+            resized = true;
+
+            // Add or extend a span.
+            const last_id = self.spans.getLast(self.head).?;
+            const last = self.spans.getPtrNoCheck(last_id);
+            if (last.y == 0) {
+                // Extend.
+                last.width = self.width - last.x;
+            } else {
+                const start_x = last.x + last.width;
+                _ = self.spans.insertAfter(last_id, .{
+                    .x = start_x,
+                    .y = 0,
+                    .width = self.width - start_x,
+                }) catch @panic("error");
+            }
+
+            if (self.findRectSpace(width, height)) |res| {
+                self.allocRectResult(res);
+                self.used_area += @as(u64, width) * height;
+                return Point2.init(res.x, res.y);
+            }
+        }
     }
 
     fn allocRectResult(self: *Self, res: FindSpaceResult) void {
@@ -269,6 +377,27 @@ const Span = struct {
     width: u32,
 };
 
+const Rect = struct {
+    x: u32,
+    y: u32,
+    width: u32,
+    height: u32,
+};
+
+pub const RectBinPackerStats = struct {
+    width: u32,
+    height: u32,
+    used_area: u64,
+    /// Freed area waiting to be reused. Space is lost to fragmentation when this is large but allocations still fail.
+    free_list_area: u64,
+    num_free_rects: u32,
+
+    /// Fraction of the buffer that is allocated.
+    pub fn occupancy(self: RectBinPackerStats) f32 {
+        return @intToFloat(f32, self.used_area) / (@intToFloat(f32, self.width) * @intToFloat(f32, self.height));
+    }
+};
+
 const FindSpaceResult = struct {
     prev_span_id: SpanId,
     x: u32,
@@ -443,6 +572,55 @@ test "Resize." {
     try t.eq(node.data, .{ .x = 11, .y = 0, .width = 9 });
 }
 
+test "Reuse freed rect." {
+    var packer = RectBinPacker.init(t.alloc, 10, 10);
+    defer packer.deinit();
+
+    _ = packer.allocRect(10, 4);
+    const pos = packer.allocRect(4, 4);
+    try t.eq(packer.used_area, 56);
+    packer.freeRect(pos.x, pos.y, 4, 4);
+    try t.eq(packer.used_area, 40);
+
+    // Placed in the freed rect instead of the skyline. The remainder is split along the shorter axis.
+    try t.eq(packer.allocRect(3, 2), Point2.init(0, 4));
+    try t.eq(packer.free_rects.items.len, 2);
+    try t.eq(packer.free_rects.items[0], .{ .x = 3, .y = 4, .width = 1, .height = 2 });
+    try t.eq(packer.free_rects.items[1], .{ .x = 0, .y = 6, .width = 4, .height = 2 });
+    try t.eq(packer.allocRect(4, 2), Point2.init(0, 6));
+    try t.eq(packer.getStats().free_list_area, 2);
+}
+
+test "Max size." {
+    var packer = RectBinPacker.init(t.alloc, 10, 10);
+    defer packer.deinit();
+    packer.setMaxSize(20, 20);
+
+    try t.eq(packer.tryAllocRect(11, 11), Point2.init(0, 0));
+    try t.eq(packer.width, 20);
+    try t.eq(packer.tryAllocRect(11, 11), null);
+    try t.eq(packer.width, 20);
+
+    // allocRect still grows past the max.
+    _ = packer.allocRect(11, 11);
+    try t.eq(packer.width, 40);
+}
+
+test "Reset." {
+    var packer = RectBinPacker.init(t.alloc, 10, 10);
+    defer packer.deinit();
+
+    _ = packer.allocRect(4, 4);
+    _ = packer.allocRect(2, 6);
+    packer.freeRect(0, 0, 4, 4);
+    packer.reset();
+    try t.eq(packer.spans.size(), 1);
+    try t.eq(packer.free_rects.items.len, 0);
+    try t.eq(packer.used_area, 0);
+    try t.eq(packer.allocRect(10, 10), Point2.init(0, 0));
+    try t.eq(packer.getStats().occupancy(), 1);
+}
+
 /// Allocation is constant time but inefficient with space allocation.
 /// Tracks the next available pos and the max height of the current row.
 /// Upon resize, only the height is doubled since context info is lost from the other rows.
@@ -28,11 +28,11 @@ pub const Renderer = struct {
     },
 
     // TODO: Remove swapchain and window dependency.
-    pub fn initVK(self: *Renderer, alloc: std.mem.Allocator, swapc: graphics.SwapChain, win: *platform.Window) !void {
+    pub fn initVK(self: *Renderer, alloc: std.mem.Allocator, swapc: graphics.SwapChain, win: *platform.Window, stats: *FrameStats) !void {
         self.inner.vk = try gvk.Renderer.init(alloc, win, swapc);
         const vk_ctx = gvk.VkContext.init(alloc, win);
         self.inner.ctx = vk_ctx;
-        self.gctx.initVK(alloc, win.impl.dpr, &self.inner.vk, vk_ctx);
+        self.gctx.initVK(alloc, win.impl.dpr, &self.inner.vk, vk_ctx, stats);
     }
 
     pub fn init(self: *Renderer, alloc: std.mem.Allocator, dpr: f32, stats: *FrameStats) !void {
@@ -64,6 +64,24 @@ pub const Renderer = struct {
 pub const FrameStats = struct {
     last_triangles: u32,
     cur_triangles: u32,
+
+    /// Draws that reused a cached tessellation.
+    last_tess_cache_hits: u32,
+    cur_tess_cache_hits: u32,
+    /// Draws that had to tessellate.
+    last_tess_cache_misses: u32,
+    cur_tess_cache_misses: u32,
+
+    /// Vertex, index and texture bytes written to gpu memory.
+    last_upload_bytes: u32,
+    cur_upload_bytes: u32,
+
+    /// Draw calls issued.
+    last_draw_calls: u32,
+    cur_draw_calls: u32,
+    /// Batches ended by state changes or flushes. Without deferred batching, each one is a draw call.
+    last_batches: u32,
+    cur_batches: u32,
 };
 
 /// A WindowRenderer abstracts how and where a frame is drawn to and provides:
@@ -83,11 +101,21 @@ pub const WindowRenderer = struct {
         self.stats = .{
             .last_triangles = 0,
             .cur_triangles = 0,
+            .last_tess_cache_hits = 0,
+            .cur_tess_cache_hits = 0,
+            .last_tess_cache_misses = 0,
+            .cur_tess_cache_misses = 0,
+            .last_upload_bytes = 0,
+            .cur_upload_bytes = 0,
+            .last_draw_calls = 0,
+            .cur_draw_calls = 0,
+            .last_batches = 0,
+            .cur_batches = 0,
         };
         switch (Backend) {
             .Vulkan => {
                 self.swapchain.initVK(alloc, win);
-                try self.renderer.initVK(alloc, self.swapchain, win);
+                try self.renderer.initVK(alloc, self.swapchain, win, &self.stats);
             },
             .OpenGL => {
                 self.swapchain.init(alloc, win);
@@ -112,6 +140,16 @@ pub const WindowRenderer = struct {
         self.swapchain.beginFrame();
         self.stats.last_triangles = self.stats.cur_triangles;
         self.stats.cur_triangles = 0;
+        self.stats.last_tess_cache_hits = self.stats.cur_tess_cache_hits;
+        self.stats.cur_tess_cache_hits = 0;
+        self.stats.last_tess_cache_misses = self.stats.cur_tess_cache_misses;
+        self.stats.cur_tess_cache_misses = 0;
+        self.stats.last_upload_bytes = self.stats.cur_upload_bytes;
+        self.stats.cur_upload_bytes = 0;
+        self.stats.last_draw_calls = self.stats.cur_draw_calls;
+        self.stats.cur_draw_calls = 0;
+        self.stats.last_batches = self.stats.cur_batches;
+        self.stats.cur_batches = 0;
         switch (Backend) {
             .Vulkan => {
                 const cur_image_idx = self.swapchain.impl.cur_image_idx;
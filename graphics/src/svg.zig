@@ -78,6 +78,18 @@ pub fn PathCommandData(comptime Tag: PathCommand) type {
     };
 }
 
+/// Returns the number of f32s in SvgPath.data that are used by cmds.
+pub fn getPathDataLen(cmds: []const PathCommand) usize {
+    var len: usize = 0;
+    for (cmds) |cmd| {
+        len += switch (cmd) {
+            .LastDummy => unreachable,
+            inline else => |tag| @sizeOf(PathCommandData(tag)) / 4,
+        };
+    }
+    return len;
+}
+
 pub const PathCommandPtr = struct {
     tag: PathCommand,
     id: u32,
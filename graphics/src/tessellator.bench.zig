@@ -0,0 +1,69 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const Vec2 = stdx.math.Vec2;
+
+const tessellator = @import("tessellator.zig");
+const Tessellator = tessellator.Tessellator;
+const ParallelTessellator = tessellator.ParallelTessellator;
+
+// Compares the single threaded Tessellator against ParallelTessellator with the tiger test polygons copied onto a grid.
+// The copy count is kept below the u16 vertex limit of a single Tessellator.
+// Run with: zig build run -Dpath="graphics/src/tessellator.bench.zig" -Doptimize=ReleaseFast
+
+const NumCopies = 300;
+const NumRuns = 50;
+const PartitionCounts = [_]u32{ 2, 4, 8 };
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const alloc = gpa.allocator();
+
+    var pts = std.ArrayList(Vec2).init(alloc);
+    defer pts.deinit();
+    var polygons = std.ArrayList(stdx.IndexSlice(u32)).init(alloc);
+    defer polygons.deinit();
+    const tri_count = try tessellator.appendTigerGrid(&pts, &polygons, NumCopies);
+
+    std.debug.print("polygons: {}, points: {}, triangles: {}, runs: {}\n", .{ polygons.items.len, pts.items.len, tri_count, NumRuns });
+    std.debug.print("{s:>12} {s:>12} {s:>10}\n", .{ "partitions", "ms/run", "speedup" });
+
+    const base_ms = try runSingle(alloc, pts.items, polygons.items);
+    std.debug.print("{s:>12} {d:>12.3} {d:>10.2}\n", .{ "single", base_ms, 1.0 });
+    for (PartitionCounts) |num_parts| {
+        const ms = try runParallel(alloc, num_parts, pts.items, polygons.items);
+        std.debug.print("{:>12} {d:>12.3} {d:>10.2}\n", .{ num_parts, ms, base_ms / ms });
+    }
+}
+
+fn runSingle(alloc: std.mem.Allocator, pts: []const Vec2, polygons: []const stdx.IndexSlice(u32)) !f64 {
+    var tess: Tessellator = undefined;
+    tess.init(alloc);
+    defer tess.deinit();
+
+    var timer = try std.time.Timer.start();
+    var i: u32 = 0;
+    while (i < NumRuns) : (i += 1) {
+        tess.clearBuffers();
+        try tess.triangulatePolygons2(pts, polygons);
+        std.mem.doNotOptimizeAway(tess.out_idxes.items.len);
+    }
+    return @intToFloat(f64, timer.read()) / 1e6 / NumRuns;
+}
+
+fn runParallel(alloc: std.mem.Allocator, num_parts: u32, pts: []const Vec2, polygons: []const stdx.IndexSlice(u32)) !f64 {
+    var tess: ParallelTessellator = undefined;
+    try tess.init(alloc, num_parts);
+    defer tess.deinit();
+
+    // Warm up to start the workers.
+    try tess.triangulatePolygons2(pts, polygons);
+
+    var timer = try std.time.Timer.start();
+    var i: u32 = 0;
+    while (i < NumRuns) : (i += 1) {
+        try tess.triangulatePolygons2(pts, polygons);
+        std.mem.doNotOptimizeAway(tess.out_idxes.items.len);
+    }
+    return @intToFloat(f64, timer.read()) / 1e6 / NumRuns;
+}
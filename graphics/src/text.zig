@@ -1,5 +1,6 @@
 const std = @import("std");
 const stdx = @import("stdx");
+const t = stdx.testing;
 const Backend = @import("graphics_options").GraphicsBackend;
 
 const graphics = @import("graphics.zig");
@@ -39,6 +40,18 @@ pub const TextLayout = struct {
     firstLineStartX: f32,
     lastLineEndX: f32,
 
+    /// Inputs of the last layout. When only the text changed, layout resumes from the first edited line.
+    src: std.ArrayList(u8),
+    src_font_gid: FontGroupId,
+    src_font_size: f32,
+    src_preferred_width: f32,
+    /// Graphics.font_gen of the last layout.
+    src_font_gen: u32,
+    has_src: bool,
+
+    /// Lines of the previous layout. Used to reuse the lines after an edit once the layout lines up again.
+    prev_lines: std.ArrayList(TextLine),
+
     pub fn init(alloc: std.mem.Allocator) TextLayout {
         return .{
             .lines = std.ArrayList(TextLine).init(alloc),
@@ -46,23 +59,126 @@ pub const TextLayout = struct {
             .height = 0,
             .firstLineStartX = 0,
             .lastLineEndX = 0,
+            .src = std.ArrayList(u8).init(alloc),
+            .src_font_gid = 0,
+            .src_font_size = 0,
+            .src_preferred_width = 0,
+            .src_font_gen = 0,
+            .has_src = false,
+            .prev_lines = std.ArrayList(TextLine).init(alloc),
         };
     }
 
     pub fn deinit(self: TextLayout) void {
         self.lines.deinit();
+        self.src.deinit();
+        self.prev_lines.deinit();
+    }
+
+    fn setSource(self: *TextLayout, font_gid: FontGroupId, size: f32, str: []const u8, preferred_width: f32, font_gen: u32) void {
+        self.src.clearRetainingCapacity();
+        self.src.appendSlice(str) catch @panic("error");
+        self.src_font_gid = font_gid;
+        self.src_font_size = size;
+        self.src_preferred_width = preferred_width;
+        self.src_font_gen = font_gen;
+        self.has_src = true;
     }
 };
 
+/// Computes line breaks for word wrapping.
+/// Unchanged inputs return right away. If only the text changed, the lines before the edit are kept and
+/// the lines after it are reused once a new line starts at the same place in the unchanged tail.
+/// Otherwise, the shared TextLayoutCache is checked before laying out from the start.
+/// Changing the fallback fonts bumps Graphics.font_gen which starts the next layout from scratch.
 pub fn textLayout(gctx: *graphics.Graphics, font_gid: FontGroupId, size: f32, str: []const u8, preferred_width: f32, spanStartX: f32, buf: *TextLayout) void {
-    buf.lines.clearRetainingCapacity();
-    var iter = gctx.textGlyphIter(font_gid, size, str);
+    const font_gen = gctx.font_gen;
+    const same_params = buf.has_src and buf.src_font_gid == font_gid and buf.src_font_size == size and
+        buf.src_preferred_width == preferred_width and buf.firstLineStartX == spanStartX and buf.src_font_gen == font_gen;
+    if (same_params) {
+        if (std.mem.eql(u8, buf.src.items, str)) {
+            return;
+        }
+        var iter = gctx.textGlyphIter(font_gid, size, str);
+        relayoutAfterEdit(&iter, str, buf);
+    } else {
+        const key = TextLayoutCache.hashKey(font_gen, font_gid, size, preferred_width, spanStartX, str);
+        if (gctx.text_layout_cache.get(key)) |entry| {
+            buf.lines.clearRetainingCapacity();
+            buf.lines.appendSlice(entry.lines) catch @panic("error");
+            buf.width = entry.width;
+            buf.height = entry.height;
+            buf.firstLineStartX = spanStartX;
+            buf.lastLineEndX = entry.last_line_end_x;
+        } else {
+            var iter = gctx.textGlyphIter(font_gid, size, str);
+            buf.lines.clearRetainingCapacity();
+            buf.firstLineStartX = spanStartX;
+            layoutLines(&iter, preferred_width, spanStartX, 0, buf, null);
+            gctx.text_layout_cache.put(key, buf.*);
+        }
+    }
+    buf.setSource(font_gid, size, str, preferred_width, font_gen);
+}
+
+/// Resumes the layout from the line before the first edited byte since the edit could let text fit on that line.
+fn relayoutAfterEdit(iter: anytype, str: []const u8, buf: *TextLayout) void {
+    const old = buf.src.items;
+    var prefix_len: usize = 0;
+    const min_len = @min(old.len, str.len);
+    while (prefix_len < min_len and old[prefix_len] == str[prefix_len]) {
+        prefix_len += 1;
+    }
+    var suffix_len: usize = 0;
+    while (suffix_len < min_len - prefix_len and old[old.len - 1 - suffix_len] == str[str.len - 1 - suffix_len]) {
+        suffix_len += 1;
+    }
+
+    buf.prev_lines.clearRetainingCapacity();
+    buf.prev_lines.appendSlice(buf.lines.items) catch @panic("error");
+
+    var line_idx: usize = 0;
+    while (line_idx + 1 < buf.prev_lines.items.len and buf.prev_lines.items[line_idx].end_idx < prefix_len) {
+        line_idx += 1;
+    }
+    if (line_idx > 0) {
+        line_idx -= 1;
+    }
+    buf.lines.shrinkRetainingCapacity(line_idx);
+
+    var start_idx: u32 = 0;
+    var start_x = buf.firstLineStartX;
+    if (line_idx > 0) {
+        start_idx = buf.prev_lines.items[line_idx].start_idx;
+        start_x = 0;
+    }
+    layoutLines(iter, buf.src_preferred_width, start_x, start_idx, buf, .{
+        .suffix_start = @intCast(u32, str.len - suffix_len),
+        .delta = @intCast(i64, str.len) - @intCast(i64, old.len),
+    });
+}
+
+/// Where the text after an edit lines up with the previous layout.
+const Resync = struct {
+    /// Start of the unchanged tail in the new text.
+    suffix_start: u32,
+    /// New text length minus the old text length.
+    delta: i64,
+};
+
+/// Appends lines starting at start_idx to the lines already in buf.
+fn layoutLines(iter: anytype, preferred_width: f32, start_x: f32, start_idx: u32, buf: *TextLayout, resync: ?Resync) void {
     var y: f32 = 0;
-    var last_fit_start_idx: u32 = 0;
-    var last_fit_end_idx: u32 = 0;
-    var last_fit_x: f32 = 0;
-    var x: f32 = spanStartX;
     var max_width: f32 = 0;
+    for (buf.lines.items) |line| {
+        y += line.height;
+        max_width = @max(max_width, line.width);
+    }
+    iter.setIndex(start_idx);
+    iter.state.end_idx = start_idx;
+    var last_fit_start_idx: u32 = start_idx;
+    var last_fit_end_idx: u32 = start_idx;
+    var x: f32 = start_x;
     while (iter.nextCodepoint()) {
         x += iter.state.kern;
         // Assume snapping.
@@ -75,6 +191,7 @@ pub fn textLayout(gctx: *graphics.Graphics, font_gid: FontGroupId, size: f32, st
                 .start_idx = last_fit_start_idx,
                 .end_idx = @intCast(u32, iter.state.end_idx - 1), // Exclude new line.
                 .height = iter.primary_height,
+                .width = x,
             }) catch @panic("error");
             last_fit_start_idx = @intCast(u32, iter.state.end_idx);
             last_fit_end_idx = @intCast(u32, iter.state.end_idx);
@@ -83,6 +200,9 @@ pub fn textLayout(gctx: *graphics.Graphics, font_gid: FontGroupId, size: f32, st
             }
             x = 0;
             y += iter.primary_height;
+            if (resync != null and reusePrevLines(buf, resync.?, last_fit_start_idx, y, max_width)) {
+                return;
+            }
             continue;
         }
 
@@ -100,14 +220,17 @@ pub fn textLayout(gctx: *graphics.Graphics, font_gid: FontGroupId, size: f32, st
                     .start_idx = last_fit_start_idx,
                     .end_idx = last_fit_end_idx,
                     .height = iter.primary_height,
+                    .width = x,
                 }) catch @panic("error");
                 y += iter.primary_height;
                 last_fit_start_idx = last_fit_end_idx;
-                last_fit_x = 0;
                 if (x > max_width) {
                     max_width = x;
                 }
                 x = 0;
+                if (resync != null and reusePrevLines(buf, resync.?, last_fit_start_idx, y, max_width)) {
+                    return;
+                }
                 iter.setIndex(last_fit_start_idx);
             }
         }
@@ -118,6 +241,7 @@ pub fn textLayout(gctx: *graphics.Graphics, font_gid: FontGroupId, size: f32, st
             .start_idx = last_fit_start_idx,
             .end_idx = @intCast(u32, iter.state.end_idx),
             .height = iter.primary_height,
+            .width = x,
         }) catch @panic("error");
         if (x > max_width) {
             max_width = x;
@@ -126,14 +250,179 @@ pub fn textLayout(gctx: *graphics.Graphics, font_gid: FontGroupId, size: f32, st
     }
     buf.width = max_width;
     buf.height = y;
-    buf.firstLineStartX = spanStartX;
     buf.lastLineEndX = x;
 }
 
+/// A line that starts in the unchanged tail at the same place as a previous line will break the same way from then on,
+/// so the rest of the previous lines are appended with shifted indexes.
+fn reusePrevLines(buf: *TextLayout, resync: Resync, new_start: u32, y_: f32, max_width_: f32) bool {
+    if (new_start < resync.suffix_start) {
+        return false;
+    }
+    const old_start = @intCast(u32, @as(i64, new_start) - resync.delta);
+    const prev = buf.prev_lines.items;
+    // Lines are ordered by start_idx.
+    var lo: usize = 1;
+    var hi: usize = prev.len;
+    while (lo < hi) {
+        const mid = lo + (hi - lo) / 2;
+        if (prev[mid].start_idx < old_start) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == prev.len or prev[lo].start_idx != old_start) {
+        return false;
+    }
+    var y = y_;
+    var max_width = max_width_;
+    buf.lines.ensureUnusedCapacity(prev.len - lo) catch @panic("error");
+    for (prev[lo..]) |line| {
+        buf.lines.appendAssumeCapacity(.{
+            .start_idx = @intCast(u32, @as(i64, line.start_idx) + resync.delta),
+            .end_idx = @intCast(u32, @as(i64, line.end_idx) + resync.delta),
+            .height = line.height,
+            .width = line.width,
+        });
+        y += line.height;
+        max_width = @max(max_width, line.width);
+    }
+    buf.width = max_width;
+    buf.height = y;
+    buf.lastLineEndX = prev[prev.len - 1].width;
+    return true;
+}
+
 pub const TextLine = struct {
     start_idx: u32,
     end_idx: u32,
     height: f32,
+    /// x position at the end of the line. The first line starts at firstLineStartX.
+    width: f32,
+};
+
+/// Seed of the second hash in TextLayoutKey.
+const CheckSeed = 0x9e3779b97f4a7c15;
+
+/// Hashes of the layout inputs. Entries are found by hash and the check hash and string length rule out collisions.
+pub const TextLayoutKey = struct {
+    hash: u64,
+    check: u64,
+    len: u32,
+
+    fn eql(a: TextLayoutKey, b: TextLayoutKey) bool {
+        return a.hash == b.hash and a.check == b.check and a.len == b.len;
+    }
+};
+
+/// Line breaks keyed by the layout inputs so a widget that is rebuilt or text that is repeated isn't laid out again.
+/// Bounded with two generations. Once the current generation exceeds half of max_bytes, the previous one is dropped
+/// and entries that are used again get moved into the new generation.
+pub const TextLayoutCache = struct {
+    alloc: std.mem.Allocator,
+    cur: std.AutoHashMapUnmanaged(u64, Entry),
+    prev: std.AutoHashMapUnmanaged(u64, Entry),
+    cur_bytes: usize,
+    max_bytes: usize,
+
+    pub const DefaultMaxBytes = 1024 * 1024;
+
+    pub const Entry = struct {
+        key: TextLayoutKey,
+        lines: []const TextLine,
+        width: f32,
+        height: f32,
+        last_line_end_x: f32,
+    };
+
+    pub fn init(alloc: std.mem.Allocator, max_bytes: usize) TextLayoutCache {
+        return .{
+            .alloc = alloc,
+            .cur = .{},
+            .prev = .{},
+            .cur_bytes = 0,
+            .max_bytes = max_bytes,
+        };
+    }
+
+    pub fn deinit(self: *TextLayoutCache) void {
+        self.clear();
+        self.cur.deinit(self.alloc);
+        self.prev.deinit(self.alloc);
+    }
+
+    pub fn clear(self: *TextLayoutCache) void {
+        freeEntries(self.alloc, &self.cur);
+        freeEntries(self.alloc, &self.prev);
+        self.cur_bytes = 0;
+    }
+
+    fn freeEntries(alloc: std.mem.Allocator, map: *std.AutoHashMapUnmanaged(u64, Entry)) void {
+        var iter = map.valueIterator();
+        while (iter.next()) |entry| {
+            alloc.free(entry.lines);
+        }
+        map.clearRetainingCapacity();
+    }
+
+    pub fn hashKey(font_gen: u32, font_gid: FontGroupId, font_size: f32, preferred_width: f32, start_x: f32, str: []const u8) TextLayoutKey {
+        var hasher = std.hash.Wyhash.init(0);
+        var check_hasher = std.hash.Wyhash.init(CheckSeed);
+        inline for (.{ font_gen, font_gid, font_size, preferred_width, start_x }) |param| {
+            hasher.update(std.mem.asBytes(&param));
+            check_hasher.update(std.mem.asBytes(&param));
+        }
+        hasher.update(str);
+        check_hasher.update(str);
+        return .{
+            .hash = hasher.final(),
+            .check = check_hasher.final(),
+            .len = @intCast(u32, str.len),
+        };
+    }
+
+    pub fn get(self: *TextLayoutCache, key: TextLayoutKey) ?Entry {
+        if (self.cur.get(key.hash)) |entry| {
+            if (!entry.key.eql(key)) {
+                return null;
+            }
+            return entry;
+        }
+        const entry = self.prev.get(key.hash) orelse return null;
+        if (!entry.key.eql(key)) {
+            return null;
+        }
+        const kv = self.prev.fetchRemove(key.hash).?;
+        self.cur.put(self.alloc, key.hash, kv.value) catch @panic("error");
+        self.cur_bytes += kv.value.lines.len * @sizeOf(TextLine);
+        return kv.value;
+    }
+
+    pub fn put(self: *TextLayoutCache, key: TextLayoutKey, layout: TextLayout) void {
+        const num_bytes = layout.lines.items.len * @sizeOf(TextLine);
+        if (num_bytes > self.max_bytes / 4) {
+            return;
+        }
+        if (self.cur_bytes + num_bytes > self.max_bytes / 2) {
+            freeEntries(self.alloc, &self.prev);
+            std.mem.swap(std.AutoHashMapUnmanaged(u64, Entry), &self.cur, &self.prev);
+            self.cur_bytes = 0;
+        }
+        const res = self.cur.getOrPut(self.alloc, key.hash) catch @panic("error");
+        if (res.found_existing) {
+            self.cur_bytes -= res.value_ptr.lines.len * @sizeOf(TextLine);
+            self.alloc.free(res.value_ptr.lines);
+        }
+        res.value_ptr.* = .{
+            .key = key,
+            .lines = self.alloc.dupe(TextLine, layout.lines.items) catch @panic("error"),
+            .width = layout.width,
+            .height = layout.height,
+            .last_line_end_x = layout.lastLineEndX,
+        };
+        self.cur_bytes += num_bytes;
+    }
 };
 
 /// Used to traverse text one UTF-8 codepoint at a time.
@@ -213,4 +502,123 @@ pub const TextRunSegment = struct {
     /// start/end pos of the TextRun string.
     start: u32,
     end: u32,
-};
\ No newline at end of file
+};
+
+/// Fixed advance per byte so layouts can be checked without fonts.
+const TestGlyphIterator = struct {
+    str: []const u8,
+    i: usize,
+    primary_height: f32,
+    state: TextGlyphIterator.State,
+
+    fn init(str: []const u8) TestGlyphIterator {
+        return .{
+            .str = str,
+            .i = 0,
+            .primary_height = 10,
+            .state = undefined,
+        };
+    }
+
+    fn nextCodepoint(self: *TestGlyphIterator) bool {
+        if (self.i >= self.str.len) {
+            return false;
+        }
+        self.state.start_idx = self.i;
+        self.state.cp = self.str[self.i];
+        self.i += 1;
+        self.state.end_idx = self.i;
+        self.state.kern = 0;
+        self.state.advance_width = 10;
+        return true;
+    }
+
+    fn setIndex(self: *TestGlyphIterator, i: usize) void {
+        self.i = i;
+    }
+};
+
+fn testLayout(buf: *TextLayout, str: []const u8, preferred_width: f32) void {
+    var iter = TestGlyphIterator.init(str);
+    if (buf.has_src) {
+        relayoutAfterEdit(&iter, str, buf);
+    } else {
+        buf.lines.clearRetainingCapacity();
+        buf.firstLineStartX = 0;
+        layoutLines(&iter, preferred_width, 0, 0, buf, null);
+    }
+    buf.setSource(1, 10, str, preferred_width, 0);
+}
+
+test "Relayout after an edit matches a full layout." {
+    const before = "one two three four\nfive six seven eight nine ten eleven twelve";
+    const edits = [_][]const u8{
+        // Edit in the middle reuses the lines after it.
+        "one two three four\nfive sixty seven eight nine ten eleven twelve",
+        // Deleting lets text move back onto the previous line.
+        "one two three four\nfive x seven eight nine ten eleven twelve",
+        // Appending at the end.
+        "one two three four\nfive six seven eight nine ten eleven twelve thirteen",
+        // Edit before a forced line break.
+        "one two\nfive six seven eight nine ten eleven twelve",
+        "",
+    };
+    for (edits) |after| {
+        var inc = TextLayout.init(t.alloc);
+        defer inc.deinit();
+        testLayout(&inc, before, 100);
+        testLayout(&inc, after, 100);
+
+        var full = TextLayout.init(t.alloc);
+        defer full.deinit();
+        testLayout(&full, after, 100);
+
+        try t.eqSlice(TextLine, inc.lines.items, full.lines.items);
+        try t.eq(inc.width, full.width);
+        try t.eq(inc.height, full.height);
+        try t.eq(inc.lastLineEndX, full.lastLineEndX);
+    }
+}
+
+test "TextLayoutCache drops the older generation." {
+    var cache = TextLayoutCache.init(t.alloc, @sizeOf(TextLine) * 8);
+    defer cache.deinit();
+    var layout = TextLayout.init(t.alloc);
+    defer layout.deinit();
+    try layout.lines.appendNTimes(.{ .start_idx = 0, .end_idx = 1, .height = 10, .width = 10 }, 2);
+
+    cache.put(testKey(1), layout);
+    cache.put(testKey(2), layout);
+    try t.eq(cache.get(testKey(1)).?.lines.len, 2);
+    // Exceeds half of max bytes so 1 and 2 move to the previous generation.
+    cache.put(testKey(3), layout);
+    try t.eq(cache.prev.count(), 2);
+    // Used entries are moved back into the current generation.
+    try t.eq(cache.get(testKey(2)) != null, true);
+    cache.put(testKey(4), layout);
+    try t.eq(cache.get(testKey(1)), null);
+    try t.eq(cache.get(testKey(2)) != null, true);
+}
+
+test "TextLayoutCache misses when the check hash differs." {
+    var cache = TextLayoutCache.init(t.alloc, TextLayoutCache.DefaultMaxBytes);
+    defer cache.deinit();
+    var layout = TextLayout.init(t.alloc);
+    defer layout.deinit();
+    try layout.lines.append(.{ .start_idx = 0, .end_idx = 1, .height = 10, .width = 10 });
+
+    cache.put(testKey(1), layout);
+    var key = testKey(1);
+    key.check = 2;
+    try t.eq(cache.get(key), null);
+    try t.eq(cache.get(testKey(1)) != null, true);
+
+    // Different font generations don't share entries.
+    const a = TextLayoutCache.hashKey(0, 1, 10, 100, 0, "abc");
+    const b = TextLayoutCache.hashKey(1, 1, 10, 100, 0, "abc");
+    try t.eq(a.eql(b), false);
+}
+
+fn testKey(hash: u64) TextLayoutKey {
+    return .{ .hash = hash, .check = hash, .len = 1 };
+}
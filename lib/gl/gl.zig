@@ -243,6 +243,15 @@ pub fn getMaxFragmentTextures() usize {
     return @intCast(usize, res);
 }
 
+/// Always false for WebGL.
+pub fn isExtensionSupported(name: [:0]const u8) bool {
+    if (IsWasm) {
+        return false;
+    } else {
+        return sdl.SDL_GL_ExtensionSupported(name) == sdl.SDL_TRUE;
+    }
+}
+
 pub fn getMaxSamples() usize {
     var res: c_int = 0;
     getIntegerv(c.GL_MAX_SAMPLES, &res);
@@ -289,6 +298,17 @@ pub inline fn drawElements(mode: c.GLenum, num_indices: usize, index_type: c.GLe
     }
 }
 
+/// Added to every index before fetching the vertex. Not available in WebGL2.
+pub inline fn drawElementsBaseVertex(mode: c.GLenum, num_indices: usize, index_type: c.GLenum, index_offset: usize, base_vertex: c.GLint) void {
+    if (IsWasm) {
+        @compileError("unsupported");
+    } else if (IsWindows) {
+        winDrawElementsBaseVertex(mode, @intCast(c_int, num_indices), index_type, @intToPtr(?*const c.GLvoid, index_offset), base_vertex);
+    } else {
+        sdl.glDrawElementsBaseVertex(mode, @intCast(c_int, num_indices), index_type, @intToPtr(?*const c.GLvoid, index_offset), base_vertex);
+    }
+}
+
 pub inline fn flush() void {
     if (IsWasm) {
         jsGlFlush();
@@ -521,6 +541,68 @@ pub inline fn bufferData(target: c.GLenum, size: c.GLsizeiptr, data: ?*const any
     }
 }
 
+/// Immutable storage from GL 4.4 or ARB_buffer_storage. Required for persistently mapped buffers.
+pub inline fn bufferStorage(target: c.GLenum, size: c.GLsizeiptr, data: ?*const anyopaque, flags: c.GLbitfield) void {
+    if (IsWasm) {
+        @compileError("unsupported");
+    } else if (IsWindows) {
+        winBufferStorage(target, size, data, flags);
+    } else {
+        sdl.glBufferStorage(target, size, data, flags);
+    }
+}
+
+pub inline fn fenceSync(condition: c.GLenum, flags: c.GLbitfield) c.GLsync {
+    if (IsWasm) {
+        @compileError("unsupported");
+    } else if (IsWindows) {
+        return winFenceSync(condition, flags);
+    } else {
+        return sdl.glFenceSync(condition, flags);
+    }
+}
+
+pub inline fn clientWaitSync(sync: c.GLsync, flags: c.GLbitfield, timeout: c.GLuint64) c.GLenum {
+    if (IsWasm) {
+        @compileError("unsupported");
+    } else if (IsWindows) {
+        return winClientWaitSync(sync, flags, timeout);
+    } else {
+        return sdl.glClientWaitSync(sync, flags, timeout);
+    }
+}
+
+pub inline fn deleteSync(sync: c.GLsync) void {
+    if (IsWasm) {
+        @compileError("unsupported");
+    } else if (IsWindows) {
+        winDeleteSync(sync);
+    } else {
+        sdl.glDeleteSync(sync);
+    }
+}
+
+pub inline fn mapBufferRange(target: c.GLenum, offset: c.GLintptr, length: c.GLsizeiptr, access: c.GLbitfield) ?*anyopaque {
+    if (IsWasm) {
+        // WebGL2 doesn't support mapping buffers.
+        @compileError("unsupported");
+    } else if (IsWindows) {
+        return winMapBufferRange(target, offset, length, access);
+    } else {
+        return sdl.glMapBufferRange(target, offset, length, access);
+    }
+}
+
+pub inline fn unmapBuffer(target: c.GLenum) bool {
+    if (IsWasm) {
+        @compileError("unsupported");
+    } else if (IsWindows) {
+        return winUnmapBuffer(target) == c.GL_TRUE;
+    } else {
+        return sdl.glUnmapBuffer(target) == c.GL_TRUE;
+    }
+}
+
 pub inline fn polygonMode(face: c.GLenum, mode: c.GLenum) void {
     if (IsWasm) {
         @compileError("unsupported");
@@ -835,6 +917,13 @@ var winCompileShader: *const fn (shader: c.GLuint) void = undefined;
 var winGetShaderiv: *const fn (shader: c.GLuint, pname: c.GLenum, params: [*c]c.GLint) void = undefined;
 var winBindBuffer: *const fn (target: c.GLenum, buffer: c.GLuint) void = undefined;
 var winBufferData: *const fn (target: c.GLenum, size: c.GLsizeiptr, data: ?*const anyopaque, usage: c.GLenum) void = undefined;
+var winBufferStorage: *const fn (target: c.GLenum, size: c.GLsizeiptr, data: ?*const anyopaque, flags: c.GLbitfield) void = undefined;
+var winFenceSync: *const fn (condition: c.GLenum, flags: c.GLbitfield) c.GLsync = undefined;
+var winClientWaitSync: *const fn (sync: c.GLsync, flags: c.GLbitfield, timeout: c.GLuint64) c.GLenum = undefined;
+var winDeleteSync: *const fn (sync: c.GLsync) void = undefined;
+var winDrawElementsBaseVertex: *const fn (mode: c.GLenum, count: c.GLsizei, @"type": c.GLenum, indices: ?*const c.GLvoid, basevertex: c.GLint) void = undefined;
+var winMapBufferRange: *const fn (target: c.GLenum, offset: c.GLintptr, length: c.GLsizeiptr, access: c.GLbitfield) ?*anyopaque = undefined;
+var winUnmapBuffer: *const fn (target: c.GLenum) c.GLboolean = undefined;
 var winUniformMatrix3fv: *const fn (location: c.GLint, count: c.GLsizei, transpose: c.GLboolean, value: [*c]const c.GLfloat) void = undefined;
 var winUniformMatrix4fv: *const fn (location: c.GLint, count: c.GLsizei, transpose: c.GLboolean, value: [*c]const c.GLfloat) void = undefined;
 var winUniform1fv: *const fn (location: c.GLint, count: c.GLsizei, value: [*c]const c.GLfloat) void = undefined;
@@ -906,7 +995,21 @@ pub fn initWinGL_Functions() void {
     loadGlFunc(&winGetUniformLocation, "glGetUniformLocation");
     loadGlFunc(&winUniform1i, "glUniform1i");
     loadGlFunc(&winBufferData, "glBufferData");
+    loadGlFunc(&winMapBufferRange, "glMapBufferRange");
+    loadGlFunc(&winFenceSync, "glFenceSync");
+    loadGlFunc(&winClientWaitSync, "glClientWaitSync");
+    loadGlFunc(&winDeleteSync, "glDeleteSync");
+    loadGlFunc(&winDrawElementsBaseVertex, "glDrawElementsBaseVertex");
+    loadGlFunc(&winUnmapBuffer, "glUnmapBuffer");
     loadGlFunc(&winCheckFramebufferStatus, "glCheckFramebufferStatus");
+    loadOptionalGlFunc(&winBufferStorage, "glBufferStorage");
+}
+
+/// Loads functions from later GL versions that are only used when supported.
+fn loadOptionalGlFunc(ptr_to_local: anytype, name: [:0]const u8) void {
+    if (sdl.SDL_GL_GetProcAddress(name)) |ptr| {
+        ptrCastTo(ptr_to_local, ptr);
+    }
 }
 
 fn loadGlFunc(ptr_to_local: anytype, name: [:0]const u8) void {
@@ -28,11 +28,13 @@ pub extern fn h2o_set_header_by_str(pool: *c.h2o_mem_pool_t, headers: *h2o_heade
 pub extern fn h2o_start_response(req: ?*h2o_req, generator: [*c]c.h2o_generator_t) void;
 pub extern fn h2o_strdup(pool: *c.h2o_mem_pool_t, s: [*c]const u8, len: usize) c.h2o_iovec_t;
 pub extern fn h2o_send(req: ?*h2o_req, bufs: [*c]c.h2o_iovec_t, bufcnt: usize, state: c.h2o_send_state_t) void;
+pub extern fn h2o_mem_alloc_shared(pool: *c.h2o_mem_pool_t, sz: usize, dispose: ?fn (?*anyopaque) callconv(.C) void) ?*anyopaque;
 pub extern fn h2o_uv_socket_create(handle: *uv.uv_handle_t, close_cb: uv.uv_close_cb) ?*h2o_socket;
 pub extern fn h2o_ssl_register_alpn_protocols(ctx: *ssl.SSL_CTX, protocols: [*c]const h2o_iovec_t) void;
 pub extern fn h2o_access_log_open_handle(path: [*c]const u8, fmt: [*c]const u8, escape: c_int) ?*c.h2o_access_log_filehandle_t;
 pub extern fn h2o_access_log_register(pathconf: [*c]h2o_pathconf, handle: ?*anyopaque) [*c]*anyopaque;
 pub extern fn h2o_timer_unlink(timer: *c.h2o_timer_t) void;
+pub extern fn h2o_find_header(headers: *const h2o_headers, token: *const h2o_token, cursor: isize) isize;
 
 pub const H2O_LOGCONF_ESCAPE_APACHE = c.H2O_LOGCONF_ESCAPE_APACHE;
 pub const H2O_LOGCONF_ESCAPE_JSON = c.H2O_LOGCONF_ESCAPE_JSON;
@@ -47,13 +49,30 @@ pub extern fn h2o_context_size() usize;
 pub extern fn h2o_accept_ctx_size() usize;
 pub extern fn h2o_httpclient_ctx_size() usize;
 pub extern fn h2o_socket_size() usize;
+pub extern fn h2o_get_mimetype_by_extension(mimemap: ?*c.h2o_mimemap_t, ext: [*c]const u8, ext_len: usize) h2o_iovec_t;
+pub extern fn h2o_unix_time2str_rfc1123(buf: [*c]u8, secs: i64) void;
+pub const H2O_TIMESTR_RFC1123_LEN = "Sun, 06 Nov 1994 08:49:37 GMT".len;
 
 pub extern const h2o__tokens: [100]h2o_token;
+pub var H2O_TOKEN_ACCEPT_RANGES: *const h2o_token = undefined;
+pub var H2O_TOKEN_CONTENT_RANGE: *const h2o_token = undefined;
 pub var H2O_TOKEN_CONTENT_TYPE: *const h2o_token = undefined;
+pub var H2O_TOKEN_ETAG: *const h2o_token = undefined;
+pub var H2O_TOKEN_IF_MODIFIED_SINCE: *const h2o_token = undefined;
+pub var H2O_TOKEN_IF_NONE_MATCH: *const h2o_token = undefined;
+pub var H2O_TOKEN_LAST_MODIFIED: *const h2o_token = undefined;
+pub var H2O_TOKEN_RANGE: *const h2o_token = undefined;
 
 pub fn init() void {
     // Initialize constants.
+    H2O_TOKEN_ACCEPT_RANGES = &h2o__tokens[9];
+    H2O_TOKEN_CONTENT_RANGE = &h2o__tokens[29];
     H2O_TOKEN_CONTENT_TYPE = &h2o__tokens[31];
+    H2O_TOKEN_ETAG = &h2o__tokens[35];
+    H2O_TOKEN_IF_MODIFIED_SINCE = &h2o__tokens[44];
+    H2O_TOKEN_IF_NONE_MATCH = &h2o__tokens[45];
+    H2O_TOKEN_LAST_MODIFIED = &h2o__tokens[49];
+    H2O_TOKEN_RANGE = &h2o__tokens[59];
 
     // Verify struct sizes.
     // std.debug.print("sizes {} {}\n", .{ h2o_httpclient_ctx_size(), @sizeOf(h2o_httpclient_ctx) });
@@ -71,6 +90,7 @@ pub const H2O_SEND_STATE_FINAL = c.H2O_SEND_STATE_FINAL; // Indicates eof.
 pub const H2O_SEND_STATE_ERROR = c.H2O_SEND_STATE_ERROR;
 
 pub const h2o_generator_t = c.h2o_generator_t;
+pub const h2o_mimemap_t = c.h2o_mimemap_t;
 
 pub fn h2o_iovec_init(slice: []const u8) h2o_iovec_t {
     return .{
@@ -31,4 +31,23 @@ size_t h2o_httpclient_ctx_size() {
 
 size_t h2o_socket_size() {
 	return sizeof(h2o_socket_t);
-}
\ No newline at end of file
+}
+h2o_iovec_t h2o_get_mimetype_by_extension(h2o_mimemap_t *mimemap, const char *ext, size_t ext_len) {
+	h2o_mimemap_type_t *type = h2o_mimemap_get_type_by_extension(mimemap, h2o_iovec_init(ext, ext_len));
+	if (type == NULL || type->type != H2O_MIMEMAP_TYPE_MIMETYPE) {
+		type = h2o_mimemap_get_default_type(mimemap);
+	}
+	return type->data.mimetype;
+}
+
+// buf must have at least H2O_TIMESTR_RFC1123_LEN + 1 bytes.
+void h2o_unix_time2str_rfc1123(char *buf, int64_t secs) {
+	time_t t = (time_t)secs;
+	struct tm gmt;
+#ifdef _WIN32
+	gmtime_s(&gmt, &t);
+#else
+	gmtime_r(&t, &gmt);
+#endif
+	h2o_time2str_rfc1123(buf, &gmt);
+}
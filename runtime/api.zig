@@ -869,18 +869,28 @@ pub const cs_http = struct {
         body: []const u8,
     };
 
+    pub const ServeOptions = struct {
+        /// Number of threads accepting connections on the port. Each additional thread has its own event loop and js context
+        /// and doesn't run the main script. The handler given to setHandler is compiled again from its source on each thread,
+        /// so it can only use globals and its own arguments, not variables or imports from the script.
+        /// Connections are load balanced between threads by the OS with SO_REUSEPORT.
+        threads: u32 = 1,
+    };
+
     /// Starts a HTTP server and returns the handle.
     /// @param host
     /// @param port
-    pub fn serveHttp(rt: *RuntimeContext, host: []const u8, port: u16) !v8.Object {
+    /// @param opts
+    pub fn serveHttp(rt: *RuntimeContext, host: []const u8, port: u16, mb_opts: ?ServeOptions) !v8.Object {
         // log.debug("serving http at {s}:{}", .{host, port});
 
         // TODO: Implement "cosmic serve-http" and "cosmic serve-https" cli utilities.
+        const opts = mb_opts orelse ServeOptions{};
 
         const handle = rt.createCsHttpServerResource();
         const server = handle.ptr;
         server.init(rt);
-        try server.startHttp(host, port);
+        try server.startHttp(host, port, opts.threads);
 
         const ctx = rt.getContext();
         const js_handle = rt.http_server_class.inner.getFunction(ctx).initInstance(ctx, &.{}).?;
@@ -893,11 +903,13 @@ pub const cs_http = struct {
     /// @param port
     /// @param certPath
     /// @param keyPath
-    pub fn serveHttps(rt: *RuntimeContext, host: []const u8, port: u16, cert_path: []const u8, key_path: []const u8) Error!v8.Object {
+    /// @param opts
+    pub fn serveHttps(rt: *RuntimeContext, host: []const u8, port: u16, cert_path: []const u8, key_path: []const u8, mb_opts: ?ServeOptions) Error!v8.Object {
+        const opts = mb_opts orelse ServeOptions{};
         const handle = rt.createCsHttpServerResource();
         const server = handle.ptr;
         server.init(rt);
-        server.startHttps(host, port, cert_path, key_path) catch |err| switch (err) {
+        server.startHttps(host, port, cert_path, key_path, opts.threads) catch |err| switch (err) {
             else => {
                 log.debug("unknown error: {}", .{err});
                 return error.Unknown;
@@ -915,8 +927,18 @@ pub const cs_http = struct {
 
         /// Sets the handler for receiving requests.
         /// @param callback
-        pub fn setHandler(rt: *RuntimeContext, this: ThisResource(.CsHttpServer), handler: v8.Function) void {
-            this.res.js_handler = rt.isolate.initPersistent(v8.Function, handler);
+        pub fn setHandler(this: ThisResource(.CsHttpServer), handler: v8.Function) void {
+            this.res.setHandler(handler);
+        }
+
+        /// Serves files in a directory for request paths starting with a url prefix.
+        /// Files are served natively and never reach the handler given to setHandler.
+        /// Responses support conditional requests with ETag/Last-Modified and byte range requests.
+        /// Requests that don't match a file fall through to the handler.
+        /// @param urlPrefix
+        /// @param dirPath
+        pub fn serveStatic(this: ThisResource(.CsHttpServer), url_prefix: []const u8, dir_path: []const u8) !void {
+            try this.res.serveStatic(url_prefix, dir_path);
         }
 
         /// Request the server to close. It will gracefully shutdown in the background.
@@ -974,38 +996,101 @@ pub const cs_http = struct {
         }
     };
 
-    /// Provides an interface to the current response writer.
+    /// Provides an interface to write the response for a request.
+    /// The response can be sent at once with send/sendBytes or streamed in chunks with write/writeBytes followed by end.
+    /// If the handler returns true, the writer can still be used after the handler returns.
     pub const ResponseWriter = struct {
 
+        /// Must be called before the response is started.
         /// @param status
-        pub fn setStatus(status_code: u32) void {
-            _server.ResponseWriter.setStatus(status_code);
+        pub fn setStatus(this: *_server.RequestStream, status_code: u32) void {
+            this.setStatus(status_code);
         }
 
+        /// Must be called before the response is started.
         /// @param key
         /// @param value
-        pub fn setHeader(key: []const u8, value: []const u8) void {
-            _server.ResponseWriter.setHeader(key, value);
+        pub fn setHeader(this: *_server.RequestStream, key: []const u8, value: []const u8) void {
+            this.setHeader(key, value);
+        }
+
+        /// Sends UTF-8 text as the entire response.
+        /// @param text
+        pub fn send(this: *_server.RequestStream, text: v8.Value) void {
+            this.sendText(text);
+        }
+
+        /// Sends raw bytes as the entire response.
+        /// The buffer is sent without a copy, so it shouldn't be modified until the response is done.
+        /// @param buffer
+        pub fn sendBytes(rt: *RuntimeContext, this: *_server.RequestStream, arr: v8.Uint8Array) void {
+            const native = rt.getNativeValue(runtime.Uint8Array, arr.toValue()) catch unreachable;
+            this.sendBytes(arr, native.buf);
         }
 
-        /// Sends UTF-8 text to the response.
+        /// Writes UTF-8 text to the response without ending it.
+        /// Returns false if too much data is buffered. Wait for the onDrain callback before writing more.
         /// @param text
-        pub fn send(text: []const u8) void {
-            _server.ResponseWriter.send(text);
+        pub fn write(this: *_server.RequestStream, text: v8.Value) bool {
+            return this.writeText(text);
         }
 
-        /// Sends raw bytes to the response.
+        /// Writes raw bytes to the response without ending it.
+        /// Returns false if too much data is buffered. Wait for the onDrain callback before writing more.
+        /// The buffer may be sent without a copy, so it shouldn't be modified until the response is done.
         /// @param buffer
-        pub fn sendBytes(arr: runtime.Uint8Array) void {
-            _server.ResponseWriter.sendBytes(arr);
+        pub fn writeBytes(rt: *RuntimeContext, this: *_server.RequestStream, arr: v8.Uint8Array) bool {
+            const native = rt.getNativeValue(runtime.Uint8Array, arr.toValue()) catch unreachable;
+            return this.writeBytes(arr, native.buf);
+        }
+
+        /// Ends a response started with write or writeBytes.
+        pub fn end(this: *_server.RequestStream) void {
+            this.end();
+        }
+
+        /// Provide a callback that is invoked when the response can be written to again after write returned false.
+        /// Provide a null value to remove the callback.
+        /// @param callback
+        pub fn onDrain(rt: *RuntimeContext, this: *_server.RequestStream, mb_cb: ?v8.Function) void {
+            v8x.updateOptionalPersistent(v8.Function, rt.isolate, &this.on_drain_cb, mb_cb);
+        }
+    };
+
+    /// Streams a request body that is still being received when the handler is invoked.
+    /// Available as the request's bodyStream, in which case the request's body is null.
+    pub const RequestBody = struct {
+
+        /// Provide a callback that receives each chunk of the body as a Uint8Array and whether it's the last chunk.
+        /// The callback must be provided before the handler returns. The rest of the body is read after the handler returns.
+        /// @param callback
+        pub fn onData(rt: *RuntimeContext, this: *_server.RequestStream, mb_cb: ?v8.Function) void {
+            v8x.updateOptionalPersistent(v8.Function, rt.isolate, &this.on_data_cb, mb_cb);
+        }
+
+        /// Stops reading more of the body until unpause is called.
+        /// Useful when each chunk is handed to a slower consumer. The body is also held back while the response is waiting for onDrain.
+        pub fn pause(this: *_server.RequestStream) void {
+            this.pauseBody();
+        }
+
+        /// Continues reading the body after pause.
+        pub fn unpause(this: *_server.RequestStream) void {
+            this.unpauseBody();
         }
     };
 
     /// Holds data about the request when hosting an HTTP server.
+    /// The properties are read from the native request when they are accessed.
     pub const Request = struct {
         method: RequestMethod,
         path: []const u8,
-        data: Uint8Array,
+        /// Lowercase header names mapped to their values.
+        headers: std.StringHashMap([]const u8),
+        /// Null if there is no body or it's still being received.
+        body: ?Uint8Array,
+        /// Only set if the handler was invoked before the whole body was received.
+        bodyStream: ?RequestBody,
     };
 };
 
@@ -1174,6 +1259,26 @@ pub const cs_core = struct {
         }
     }
 
+    /// Invoke a callback repeatedly with a fixed interval in milliseconds. Returns an id that can be passed to clearTimeout.
+    /// @param interval
+    /// @param callback
+    /// @param callbackArg
+    pub fn setInterval(rt: *RuntimeContext, interval: u32, cb: v8.Function, cb_arg: ?v8.Value) u32 {
+        const p_cb = rt.isolate.initPersistent(v8.Function, cb);
+        if (cb_arg) |cb_arg_| {
+            const p_cb_arg = rt.isolate.initPersistent(v8.Value, cb_arg_);
+            return rt.timer.setInterval(interval, p_cb, p_cb_arg) catch unreachable;
+        } else {
+            return rt.timer.setInterval(interval, p_cb, null) catch unreachable;
+        }
+    }
+
+    /// Cancels a timeout or interval before it fires.
+    /// @param id
+    pub fn clearTimeout(rt: *RuntimeContext, id: u32) void {
+        rt.timer.clearTimeout(id);
+    }
+
     /// Returns the absolute path of the main script.
     pub fn getMainScriptPath(rt: *RuntimeContext) Error![]const u8 {
         if (rt.main_script_path) |path| {
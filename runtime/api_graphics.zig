@@ -18,7 +18,9 @@ const This = adapter.This;
 const ThisValue = adapter.ThisValue;
 const Handle = adapter.Handle;
 const RuntimeValue = runtime.RuntimeValue;
+const PromiseId = runtime.PromiseId;
 const v8x = @import("v8x.zig");
+const tasks = @import("tasks.zig");
 
 const log = stdx.log.scoped(.api_graphics);
 
@@ -32,6 +34,21 @@ const log = stdx.log.scoped(.api_graphics);
 /// Currently, the API is focused on 2D graphics, but there are plans to add 3D graphics utilities.
 pub const cs_graphics = struct {
 
+    const ImageLoad = struct {
+        promise_id: PromiseId,
+        g: *Graphics,
+    };
+
+    /// Reads and decodes an image file. Runs on a worker thread.
+    fn decodeImageFile(alloc: std.mem.Allocator, path: []const u8) !graphics.DecodedImage {
+        const data = std.fs.cwd().readFileAlloc(alloc, path, 30e6) catch |err| switch (err) {
+            error.FileNotFound => return error.FileNotFound,
+            else => return error.Unknown,
+        };
+        defer alloc.free(data);
+        return graphics.decodeImage(alloc, data) catch return error.InvalidFormat;
+    }
+
     /// This provides an interface to the underlying graphics handle. It has a similar API to Web Canvas.
     pub const Context = struct {
 
@@ -104,6 +121,47 @@ pub const cs_graphics = struct {
             };
         }
 
+        /// Loads an image without blocking the main loop. The file is read and decoded on a worker thread and
+        /// the pixels are uploaded over the next frames. Resolves with the image once it's decoded.
+        /// Drawing the image has no effect until its upload finishes.
+        /// Path can be absolute or relative to the cwd.
+        /// @param path
+        pub fn newImageAsync(rt: *RuntimeContext, g: *Graphics, path: []const u8) v8.Promise {
+            const DecodeTask = tasks.ClosureTask(decodeImageFile);
+            const task = DecodeTask{
+                .alloc = rt.alloc,
+                .args = .{ rt.alloc, rt.alloc.dupe(u8, path) catch unreachable },
+            };
+
+            const resolver = rt.isolate.initPersistent(v8.PromiseResolver, v8.PromiseResolver.init(rt.getContext()));
+            const promise = resolver.inner.getPromise();
+            const promise_id = rt.promises.add(resolver) catch unreachable;
+            const S = struct {
+                fn onSuccess(ctx: RuntimeValue(ImageLoad), decoded: graphics.DecodedImage) void {
+                    // Graphics was created with rt.alloc so it takes ownership of the decoded pixels.
+                    const image = ctx.inner.g.createImageAsync(decoded, .{});
+                    runtime.resolvePromise(ctx.rt, ctx.inner.promise_id, image);
+                }
+                fn onFailure(ctx: RuntimeValue(ImageLoad), err: anyerror) void {
+                    const cs_err: runtime.CsError = switch (err) {
+                        error.FileNotFound => error.FileNotFound,
+                        error.InvalidFormat => error.InvalidFormat,
+                        else => error.Unknown,
+                    };
+                    runtime.rejectPromise(ctx.rt, ctx.inner.promise_id, runtime.createPromiseError(ctx.rt, cs_err));
+                }
+            };
+            const task_ctx = RuntimeValue(ImageLoad){
+                .rt = rt,
+                .inner = .{
+                    .promise_id = promise_id,
+                    .g = g,
+                },
+            };
+            _ = rt.work_queue.addTaskWithCb(task, task_ctx, S.onSuccess, S.onFailure);
+            return promise;
+        }
+
         /// Paints a rectangle with the current fill color.
         /// @param x
         /// @param y
@@ -384,45 +384,40 @@ pub fn getJsFuncInfo(comptime param_fields: []const std.builtin.TypeInfo.StructF
     };
 }
 
-/// native_cb: fn () Param | fn (Ptr) Param
+/// native_cb: fn () Ret | fn (Ptr) Ret | fn (*RuntimeContext, Ptr) Ret
+/// Ptr is converted from this->getInternalField(0) which holds an External, same as ThisPtr params.
+/// Accessors on object templates don't have callback data so the RuntimeContext comes from the context's embedder data.
 pub fn genJsGetter(comptime native_cb: anytype) v8.AccessorNameGetterCallback {
-    const Args = stdx.meta.FnParams(@TypeOf(native_cb));
-    const HasSelf = Args.len > 0;
-    const HasSelfPtr = Args.len > 0 and comptime std.meta.trait.isSingleItemPtr(Args[0].arg_type.?);
+    const NativeFn = @TypeOf(native_cb);
+    const ArgFields = std.meta.fields(std.meta.ArgsTuple(NativeFn));
     const gen = struct {
         fn get(_: ?*const v8.Name, raw_info: ?*const v8.C_PropertyCallbackInfo) callconv(.C) void {
             const info = v8.PropertyCallbackInfo.initFromV8(raw_info);
-            const rt = stdx.ptrCastAlign(*RuntimeContext, info.getExternalValue());
-            const iso = rt.isolate;
-            const ctx = rt.context;
+            const iso = info.getIsolate();
+            const rt = stdx.ptrCastAlign(*RuntimeContext, iso.getCurrentContext().getEmbedderData(0).castTo(v8.External).get());
 
             var hscope: v8.HandleScope = undefined;
             hscope.init(iso);
             defer hscope.deinit();
 
-            const return_value = info.getReturnValue();
-            if (HasSelf) {
-                const Self = Args[0].arg_type.?;
-                const ptr = info.getThis().getInternalField(0).bitCastToU64(ctx);
-                if (ptr > 0) {
-                    if (HasSelfPtr) {
-                        const native_val = native_cb(@intToPtr(Self, ptr));
-                        return_value.setValueHandle(rt.getJsValuePtr(native_val));
-                        freeNativeValue(native_val);
+            var native_args: std.meta.ArgsTuple(NativeFn) = undefined;
+            inline for (ArgFields) |field| {
+                if (field.field_type == *RuntimeContext) {
+                    @field(native_args, field.name) = rt;
+                } else {
+                    const ptr = @ptrToInt(info.getThis().getInternalField(0).castTo(v8.External).get());
+                    if (ptr > 0) {
+                        @field(native_args, field.name) = @intToPtr(field.field_type, ptr);
                     } else {
-                        const native_val = native_cb(@intToPtr(*Self, ptr).*);
-                        return_value.setValueHandle(rt.getJsValuePtr(native_val));
-                        freeNativeValue(rt.alloc, native_val);
+                        v8x.throwErrorException(iso, "Native handle expired");
+                        return;
                     }
-                } else {
-                    v8x.throwErrorException(iso, "Handle has expired.");
-                    return;
                 }
-            } else {
-                const native_val = native_cb();
-                return_value.setValueHandle(rt.getJsValuePtr(native_val));
-                freeNativeValue(rt.alloc, native_val);
             }
+
+            const native_val = @call(.{}, native_cb, native_args);
+            info.getReturnValue().setValueHandle(rt.getJsValuePtr(native_val));
+            freeNativeValue(rt.alloc, native_val);
         }
     };
     return gen.get;
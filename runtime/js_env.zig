@@ -30,7 +30,6 @@ const work_queue = @import("work_queue.zig");
 const TaskOutput = work_queue.TaskOutput;
 const _server = @import("server.zig");
 const HttpServer = _server.HttpServer;
-const ResponseWriter = _server.ResponseWriter;
 const api = @import("api.zig");
 const cs_graphics = @import("api_graphics.zig").cs_graphics;
 const cs_graphics_pkg = @import("api_graphics.zig");
@@ -137,6 +136,7 @@ pub fn initContext(rt: *RuntimeContext, iso: v8.Isolate) v8.Context {
         ctx.setConstFuncT(proto, "popState", Context.popState);
         ctx.setConstFuncT(proto, "getViewTransform", Context.getViewTransform);
         ctx.setConstFuncT(proto, "newImage", Context.newImage);
+        ctx.setConstFuncT(proto, "newImageAsync", Context.newImageAsync);
         ctx.setConstFuncT(proto, "addTtfFont", Context.addTtfFont);
         ctx.setConstFuncT(proto, "addFallbackFont", Context.addFallbackFont);
         ctx.setConstFuncT(proto, "font", Context.font);
@@ -347,6 +347,7 @@ pub fn initContext(rt: *RuntimeContext, iso: v8.Isolate) v8.Context {
 
         const proto = server_class.getPrototypeTemplate();
         ctx.setConstFuncT(proto, "setHandler", api.cs_http.Server.setHandler);
+        ctx.setConstFuncT(proto, "serveStatic", api.cs_http.Server.serveStatic);
         ctx.setConstFuncT(proto, "requestClose", api.cs_http.Server.requestClose);
         ctx.setConstFuncT(proto, "closeAsync", api.cs_http.Server.closeAsync);
         ctx.setConstFuncT(proto, "getBindAddress", api.cs_http.Server.getBindAddress);
@@ -354,6 +355,21 @@ pub fn initContext(rt: *RuntimeContext, iso: v8.Isolate) v8.Context {
         ctx.setConstProp(http, "Server", server_class);
         rt.http_server_class = v8.Persistent(v8.FunctionTemplate).init(iso, server_class);
     }
+    {
+        // cs.http.Request
+        const constructor = iso.initFunctionTemplateDefault();
+        constructor.setClassName(iso.initStringUtf8("Request"));
+
+        // Accessors instead of data properties so a request object is created without allocating its property keys or values.
+        const obj_t = iso.initObjectTemplate(constructor);
+        ctx.setGetter(obj_t, "method", _server.RequestAccessors.getMethod);
+        ctx.setGetter(obj_t, "path", _server.RequestAccessors.getPath);
+        ctx.setGetter(obj_t, "headers", _server.RequestAccessors.getHeaders);
+        ctx.setGetter(obj_t, "body", _server.RequestAccessors.getBody);
+        ctx.setGetter(obj_t, "bodyStream", _server.RequestAccessors.getBodyStream);
+        obj_t.setInternalFieldCount(1);
+        rt.http_request = v8.Persistent(v8.ObjectTemplate).init(iso, obj_t);
+    }
     {
         // cs.http.ResponseWriter
         const constructor = iso.initFunctionTemplateDefault();
@@ -364,8 +380,25 @@ pub fn initContext(rt: *RuntimeContext, iso: v8.Isolate) v8.Context {
         ctx.setConstFuncT(obj_t, "setHeader", api.cs_http.ResponseWriter.setHeader);
         ctx.setConstFuncT(obj_t, "send", api.cs_http.ResponseWriter.send);
         ctx.setConstFuncT(obj_t, "sendBytes", api.cs_http.ResponseWriter.sendBytes);
+        ctx.setConstFuncT(obj_t, "write", api.cs_http.ResponseWriter.write);
+        ctx.setConstFuncT(obj_t, "writeBytes", api.cs_http.ResponseWriter.writeBytes);
+        ctx.setConstFuncT(obj_t, "end", api.cs_http.ResponseWriter.end);
+        ctx.setConstFuncT(obj_t, "onDrain", api.cs_http.ResponseWriter.onDrain);
+        obj_t.setInternalFieldCount(1);
         rt.http_response_writer = v8.Persistent(v8.ObjectTemplate).init(iso, obj_t);
     }
+    {
+        // cs.http.RequestBody
+        const constructor = iso.initFunctionTemplateDefault();
+        constructor.setClassName(iso.initStringUtf8("RequestBody"));
+
+        const obj_t = iso.initObjectTemplate(constructor);
+        ctx.setConstFuncT(obj_t, "onData", api.cs_http.RequestBody.onData);
+        ctx.setConstFuncT(obj_t, "pause", api.cs_http.RequestBody.pause);
+        ctx.setConstFuncT(obj_t, "unpause", api.cs_http.RequestBody.unpause);
+        obj_t.setInternalFieldCount(1);
+        rt.http_request_body = v8.Persistent(v8.ObjectTemplate).init(iso, obj_t);
+    }
     ctx.setConstProp(cs, "http", http);
 
     if (rt.is_test_env or builtin.is_test or rt.env.include_test_api) {
@@ -495,6 +528,8 @@ pub fn initContext(rt: *RuntimeContext, iso: v8.Isolate) v8.Context {
     }
     ctx.setConstFuncT(cs_core, "createRandom", api.cs_core.createRandom);
     ctx.setConstFuncT(cs_core, "setTimeout", api.cs_core.setTimeout);
+    ctx.setConstFuncT(cs_core, "setInterval", api.cs_core.setInterval);
+    ctx.setConstFuncT(cs_core, "clearTimeout", api.cs_core.clearTimeout);
     ctx.setConstFuncT(cs_core, "errCode", api.cs_core.errCode);
     ctx.setConstFuncT(cs_core, "errString", api.cs_core.errString);
     ctx.setConstFuncT(cs_core, "clearError", api.cs_core.clearError);
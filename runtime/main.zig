@@ -457,33 +457,9 @@ const http_main =
     \\    const addr = s.getBindAddress()
     \\    puts(`HTTP server started. Binded to ${addr.host}:${addr.port}.`)
     \\}
+    \\s.serveStatic('/', '.')
     \\s.setHandler((req, resp) => {
-    \\    if (req.method != 'GET') {
-    \\        return false
-    \\    }
-    \\    const path = req.path.substring(1)
-    \\    const content = cs.files.read(path)
-    \\    if (content != null) {
-    \\        resp.setStatus(200)
-    \\        if (path.endsWith('.html')) {
-    \\            resp.setHeader('content-type', 'text/html; charset=utf-8')
-    \\        } else if (path.endsWith('.css')) {
-    \\            resp.setHeader('content-type', 'text/css; charset=utf-8')
-    \\        } else if (path.endsWith('.js')) {
-    \\            resp.setHeader('content-type', 'text/javascript; charset=utf-8')
-    \\        } else if (path.endsWith('.png')) {
-    \\            resp.setHeader('content-type', 'image/png')
-    \\        } else if (path.endsWith('.ttf')) {
-    \\            resp.setHeader('content-type', 'font/ttf')
-    \\        } else {
-    \\            resp.setHeader('content-type', 'text/plain; charset=utf-8')
-    \\        }
-    \\        resp.sendBytes(content)
-    \\        puts(`GET ${req.path} [200]`)
-    \\        return true
-    \\    } else {
-    \\        puts(`GET ${req.path} [404]`)
-    \\        return false
-    \\    }
+    \\    puts(`${req.method} ${req.path} [404]`)
+    \\    return false
     \\})
     ;
\ No newline at end of file
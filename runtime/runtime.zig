@@ -31,6 +31,7 @@ const WorkQueue = work_queue.WorkQueue;
 const UvPoller = @import("uv_poller.zig").UvPoller;
 const HttpServer = @import("server.zig").HttpServer;
 const Timer = @import("timer.zig").Timer;
+const TimerBackend = @import("timer.zig").TimerBackend;
 const EventDispatcher = stdx.events.EventDispatcher;
 const NullId = stdx.ds.CompactNull(u32);
 const devmode = @import("devmode.zig");
@@ -64,7 +65,9 @@ pub const RuntimeContext = struct {
     graphics_class: v8.Persistent(v8.FunctionTemplate),
     http_response_class: v8.Persistent(v8.FunctionTemplate),
     http_server_class: v8.Persistent(v8.FunctionTemplate),
+    http_request: v8.Persistent(v8.ObjectTemplate),
     http_response_writer: v8.Persistent(v8.ObjectTemplate),
+    http_request_body: v8.Persistent(v8.ObjectTemplate),
     image_class: v8.Persistent(v8.FunctionTemplate),
     color_class: v8.Persistent(v8.FunctionTemplate),
     transform_class: v8.Persistent(v8.FunctionTemplate),
@@ -151,6 +154,9 @@ pub const RuntimeContext = struct {
     dev_mode: bool,
     dev_ctx: DevModeContext,
 
+    // Whether this runtime was started on a server worker thread to share the load of a multi-threaded http server.
+    is_server_worker: bool,
+
     event_dispatcher: EventDispatcher,
 
     // V8.
@@ -194,7 +200,9 @@ pub const RuntimeContext = struct {
             .transform_class = undefined,
             .graphics_class = undefined,
             .http_response_class = undefined,
+            .http_request = undefined,
             .http_response_writer = undefined,
+            .http_request_body = undefined,
             .http_server_class = undefined,
             .image_class = undefined,
             .handle_class = undefined,
@@ -245,6 +253,7 @@ pub const RuntimeContext = struct {
             .timer = undefined,
             .dev_mode = config.is_dev_mode,
             .dev_ctx = undefined,
+            .is_server_worker = config.is_server_worker,
             .event_dispatcher = undefined,
 
             .platform = platform_,
@@ -287,9 +296,12 @@ pub const RuntimeContext = struct {
         self.initJs();
 
         // Set up timer. Needs v8 context.
-        self.timer.init(self) catch unreachable;
+        self.timer.init(self, config.timer_backend) catch unreachable;
 
-        global = self;
+        // Server worker runtimes live on their thread's stack and exit before the main runtime.
+        if (!config.is_server_worker) {
+            global = self;
+        }
     }
 
     fn initJs(self: *Self) void {
@@ -398,7 +410,7 @@ pub const RuntimeContext = struct {
     }
 
     /// Isolate should not be entered when calling this.
-    fn deinit(self: *Self) void {
+    pub fn deinit(self: *Self) void {
         self.enter();
 
         self.str_buf.deinit();
@@ -466,7 +478,9 @@ pub const RuntimeContext = struct {
         self.graphics_class.deinit();
         self.http_response_class.deinit();
         self.http_server_class.deinit();
+        self.http_request.deinit();
         self.http_response_writer.deinit();
+        self.http_request_body.deinit();
         self.image_class.deinit();
         self.color_class.deinit();
         self.transform_class.deinit();
@@ -489,13 +503,13 @@ pub const RuntimeContext = struct {
     }
 
     /// No other v8 isolate should execute js until exit is called.
-    fn enter(self: *Self) void {
+    pub fn enter(self: *Self) void {
         self.isolate.enter();
         self.hscope.init(self.isolate);
         self.getContext().enter();
     }
 
-    fn exit(self: *Self) void {
+    pub fn exit(self: *Self) void {
         self.getContext().exit();
         self.hscope.deinit();
         self.isolate.exit();
@@ -750,7 +764,7 @@ pub const RuntimeContext = struct {
         return res;
     }
 
-    fn runMainScript(self: *Self, abs_path: []const u8) !void {
+    pub fn runMainScript(self: *Self, abs_path: []const u8) !void {
         self.main_script_path = self.alloc.dupe(u8, abs_path) catch unreachable;
 
         if (self.dev_mode) {
@@ -890,6 +904,18 @@ pub const RuntimeContext = struct {
         }
     }
 
+    /// Starts a graceful shutdown for every http server that is still active.
+    pub fn requestServersShutdown(self: *Self) void {
+        const ids = self.allocResourceIdsByTag(.CsHttpServer);
+        defer self.alloc.free(ids);
+        for (ids) |id| {
+            const handle = self.resources.getNoCheck(id);
+            if (handle.tag == .CsHttpServer and !handle.deinited) {
+                self.startDeinitResourceHandle(id);
+            }
+        }
+    }
+
     pub fn allocResourceIdsByTag(self: Self, tag: ResourceTag) []const ResourceId {
         const list = self.getResourceListId(tag);
         var cur_res = self.resources.getListHead(list).?;
@@ -1665,6 +1691,8 @@ pub const Uint8Array =  struct {
 
 var galloc: std.mem.Allocator = undefined;
 var uncaught_promise_errors: std.AutoHashMap(u32, []const u8) = undefined;
+// Server worker threads run their own isolates and can report promise rejections at the same time.
+var uncaught_promise_errors_mutex: std.Thread.Mutex = .{};
 
 fn initGlobal(alloc: std.mem.Allocator) void {
     galloc = alloc;
@@ -1687,6 +1715,9 @@ fn promiseRejectCallback(c_msg: v8.C_PromiseRejectMessage) callconv(.C) void {
     const iso = promise.toObject().getIsolate();
     const ctx = promise.toObject().getCreationContext();
 
+    uncaught_promise_errors_mutex.lock();
+    defer uncaught_promise_errors_mutex.unlock();
+
     switch (msg.getEvent()) {
         v8.PromiseRejectEvent.kPromiseRejectWithNoHandler => {
             // Record this uncaught incident since a follow up kPromiseHandlerAddedAfterReject can remove the record.
@@ -2173,7 +2204,7 @@ fn restart(rt: *RuntimeContext) !void {
 }
 
 /// Shutdown other threads gracefully before starting deinit.
-fn shutdownRuntime(rt: *RuntimeContext) void {
+pub fn shutdownRuntime(rt: *RuntimeContext) void {
     if (rt.dev_mode) {
         rt.dev_ctx.close();
     }
@@ -2440,6 +2471,8 @@ fn runIsolatedTests(rt: *RuntimeContext) void {
 pub const RuntimeConfig = struct {
     is_test_runner: bool = false,
     is_dev_mode: bool = false,
+    is_server_worker: bool = false,
+    timer_backend: TimerBackend = .Wheel,
 };
 
 /// Initialize libs, deps, globals, and the runtime assumed to be global.
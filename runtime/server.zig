@@ -8,7 +8,10 @@ const ssl = @import("openssl");
 const v8 = @import("v8");
 
 const runtime = @import("runtime.zig");
+const v8x = @import("v8x.zig");
+const StaticFiles = @import("static_files.zig").StaticFiles;
 const RuntimeContext = runtime.RuntimeContext;
+const Environment = runtime.Environment;
 const ThisResource = runtime.ThisResource;
 const PromiseId = runtime.PromiseId;
 const ResourceId = runtime.ResourceId;
@@ -26,7 +29,6 @@ pub const HttpServer = struct {
     hostconf: *h2o.h2o_hostconf,
     ctx: h2o.h2o_context,
     accept_ctx: h2o.h2o_accept_ctx,
-    generator: h2o.h2o_generator_t,
 
     // Track active socket handles to make sure we freed all uv handles.
     // This is not always the number of active connections since it's incremented the moment we allocate a uv handle.
@@ -41,10 +43,51 @@ pub const HttpServer = struct {
 
     js_handler: ?v8.Persistent(v8.Function),
 
+    // Directories served natively before requests reach the js handler.
+    static_files: StaticFiles,
+
+    // Js strings for common request methods are created once and reused for every request.
+    method_strs: [KnownMethods.len]?v8.Persistent(v8.String),
+
     https: bool,
 
     on_shutdown_cb: ?stdx.Callback(*anyopaque, *Self),
 
+    // Total number of threads accepting connections on this server's port, including the current thread.
+    num_threads: u32,
+
+    // Additional threads that each run their own uv loop, h2o context and V8 isolate.
+    // Only a server created on the main runtime owns workers.
+    workers: std.ArrayListUnmanaged(*ServerWorker),
+    // Set on a worker's server to the server that spawned the worker. Its listener joins the main listener's port.
+    main_server: ?*Self,
+    // Address that workers listen on. Only set when workers are started.
+    worker_listen: ?WorkerListen,
+    // Guards worker_handler_src, worker_handler_version and static_files.mounts while workers sync from them.
+    worker_config_mutex: std.Thread.Mutex,
+    // Source of the js handler. Workers compile it in their own isolates instead of running the main script.
+    worker_handler_src: ?[]const u8,
+    // Incremented whenever worker_handler_src changes.
+    worker_handler_version: u32,
+    // Decremented by worker threads as they exit.
+    num_running_workers: std.atomic.Atomic(u32),
+    // Held by an exiting worker while it signals worker_exit_async and decrements num_running_workers,
+    // and by the main thread when it checks for zero workers and closes worker_exit_async.
+    // This keeps a worker from signaling the handle after it was closed.
+    worker_exit_mutex: std.Thread.Mutex,
+    // Worker threads wake up this server's loop when they exit so it can finish closing.
+    worker_exit_async: uv.uv_async_t,
+    closed_worker_exit_async: bool,
+
+    const WorkerListen = struct {
+        host: []const u8,
+        port: u16,
+        cert_path: ?[]const u8,
+        key_path: ?[]const u8,
+    };
+
+    const KnownMethods = [_][]const u8{ "GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS" };
+
     // The initial state is closed and nothing happens until we do startHttp/startHttps.
     pub fn init(self: *Self, rt: *RuntimeContext) void {
         self.* = .{
@@ -56,13 +99,25 @@ pub const HttpServer = struct {
             .ctx = undefined,
             .accept_ctx = undefined,
             .js_handler = null,
-            .generator = .{ .proceed = null, .stop = null },
+            .static_files = StaticFiles.init(rt.alloc),
+            .method_strs = [_]?v8.Persistent(v8.String){null} ** KnownMethods.len,
             .closing = false,
             .closed = true,
             .socket_handles = 0,
             .closed_listen_handle = true,
             .https = false,
             .on_shutdown_cb = null,
+            .num_threads = 1,
+            .workers = .{},
+            .main_server = null,
+            .worker_listen = null,
+            .worker_config_mutex = std.Thread.Mutex{},
+            .worker_handler_src = null,
+            .worker_handler_version = 0,
+            .num_running_workers = std.atomic.Atomic(u32).init(0),
+            .worker_exit_mutex = std.Thread.Mutex{},
+            .worker_exit_async = undefined,
+            .closed_worker_exit_async = true,
         };
     }
 
@@ -87,6 +142,8 @@ pub const HttpServer = struct {
 
     /// This is just setting up the uv socket listener. Does not set up for http or https.
     /// host can be an IP address or "localhost". This does not call getaddrinfo() to resolve a hostname since most of the time it's unnecessary to do a full dns lookup.
+    /// When serving from multiple threads, every thread binds its own listener to the same port with SO_REUSEPORT
+    /// and the kernel load balances accepted sockets between them. Other servers bind without it.
     fn startListener(self: *Self, host: []const u8, port: u16) !void {
         const rt = self.rt;
 
@@ -94,7 +151,13 @@ pub const HttpServer = struct {
 
         var r: c_int = undefined;
 
-        r = uv.uv_tcp_init(rt.uv_loop, &self.listen_handle);
+        const reuse_port = self.num_threads > 1 or self.main_server != null;
+        if (reuse_port) {
+            // Create the socket upfront so the option can be set before binding.
+            r = uv.uv_tcp_init_ex(rt.uv_loop, &self.listen_handle, std.os.AF.INET);
+        } else {
+            r = uv.uv_tcp_init(rt.uv_loop, &self.listen_handle);
+        }
         uv.assertNoError(r);
         // Need to callback with handle.
         self.listen_handle.data = self;
@@ -102,6 +165,19 @@ pub const HttpServer = struct {
 
         errdefer self.requestShutdown();
 
+        if (reuse_port) {
+            if (builtin.os.tag == .windows) {
+                return error.ReusePortUnsupported;
+            }
+            var fd: std.os.fd_t = undefined;
+            r = uv.uv_fileno(@ptrCast(*uv.uv_handle_t, &self.listen_handle), &fd);
+            uv.assertNoError(r);
+            std.os.setsockopt(fd, std.os.SOL.SOCKET, std.os.SO.REUSEPORT, &std.mem.toBytes(@as(c_int, 1))) catch |err| {
+                log.debug("setsockopt SO_REUSEPORT: {}", .{err});
+                return error.ReusePortUnsupported;
+            };
+        }
+
         var addr: uv.sockaddr_in = undefined;
 
         const MaybeOwnedCstr = MaybeOwned([:0]const u8);
@@ -149,19 +225,27 @@ pub const HttpServer = struct {
             .libmemcached_receiver = null,
         };
 
-        _ = self.registerHandler("/", HttpServer.defaultHandler);
+        self.static_files.mimemap = self.hostconf.mimemap;
+        const pathconf = self.registerHandler("/", HttpServer.staticHandler);
+        // Requests that don't match a static file fall through to the js handler.
+        self.addHandler(pathconf, HttpServer.defaultHandler);
 
         self.h2o_started = true;
     }
 
     /// If an error occurs during startup, the server will request shutdown and be in a closing state.
     /// "closed" should be checked later on to ensure everything was cleaned up.
-    pub fn startHttp(self: *Self, host: []const u8, port: u16) !void {
+    /// If num_threads > 1, each additional thread binds another listener to the same port
+    /// and serves requests with the handler given to setHandler.
+    pub fn startHttp(self: *Self, host: []const u8, port: u16, num_threads: u32) !void {
+        self.num_threads = std.math.max(num_threads, 1);
         try self.startListener(host, port);
         self.startH2O();
+        self.startWorkers(host, port, null, null);
     }
 
-    pub fn startHttps(self: *Self, host: []const u8, port: u16, cert_path: []const u8, key_path: []const u8) !void {
+    pub fn startHttps(self: *Self, host: []const u8, port: u16, cert_path: []const u8, key_path: []const u8, num_threads: u32) !void {
+        self.num_threads = std.math.max(num_threads, 1);
         try self.startListener(host, port);
         self.startH2O();
 
@@ -216,6 +300,55 @@ pub const HttpServer = struct {
 
         // Accept requests using ALPN.
         h2o.h2o_ssl_register_alpn_protocols(self.accept_ctx.ssl_ctx.?, h2o.h2o_get_alpn_protocols());
+
+        // Only spawn workers once the main listener is fully set up.
+        self.startWorkers(host, port, cert_path, key_path);
+    }
+
+    /// Workers are only spawned for the server that was started with multiple threads, never for a worker's own server.
+    fn startWorkers(self: *Self, host: []const u8, port: u16, cert_path: ?[]const u8, key_path: ?[]const u8) void {
+        const rt = self.rt;
+        if (self.num_threads <= 1 or self.main_server != null or self.closing) {
+            return;
+        }
+        self.worker_listen = .{
+            .host = rt.alloc.dupe(u8, host) catch unreachable,
+            .port = port,
+            .cert_path = if (cert_path) |path| rt.alloc.dupe(u8, path) catch unreachable else null,
+            .key_path = if (key_path) |path| rt.alloc.dupe(u8, path) catch unreachable else null,
+        };
+
+        var r = uv.uv_async_init(rt.uv_loop, &self.worker_exit_async, onWorkerExit);
+        uv.assertNoError(r);
+        self.worker_exit_async.data = self;
+        self.closed_worker_exit_async = false;
+
+        var i: u32 = 1;
+        while (i < self.num_threads) : (i += 1) {
+            const worker = rt.alloc.create(ServerWorker) catch unreachable;
+            worker.init(self);
+            self.workers.append(rt.alloc, worker) catch unreachable;
+            _ = self.num_running_workers.fetchAdd(1, .SeqCst);
+            worker.thread = std.Thread.spawn(.{}, ServerWorker.run, .{worker}) catch unreachable;
+        }
+    }
+
+    fn onWorkerExit(ptr: [*c]uv.uv_async_t) callconv(.C) void {
+        const self = stdx.ptrCastAlign(*Self, ptr.*.data.?);
+        self.updateClosed();
+    }
+
+    fn onCloseWorkerExitAsync(ptr: [*c]uv.uv_handle_t) callconv(.C) void {
+        const self = stdx.ptrCastAlign(*Self, ptr.*.data.?);
+        self.closed_worker_exit_async = true;
+        // Worker threads have all exited at this point.
+        for (self.workers.items) |worker| {
+            worker.thread.join();
+            self.rt.alloc.destroy(worker);
+        }
+        self.workers.deinit(self.rt.alloc);
+        self.workers = .{};
+        self.updateClosed();
     }
 
     fn onCloseListenHandle(ptr: [*c]uv.uv_handle_t) callconv(.C) void {
@@ -228,10 +361,78 @@ pub const HttpServer = struct {
 
     fn registerHandler(self: *Self, path: [:0]const u8, onRequest: fn (handler: *h2o.h2o_handler, req: *h2o.h2o_req) callconv(.C) c_int) *h2o.h2o_pathconf {
         const pathconf = h2o.h2o_config_register_path(self.hostconf, path, 0);
+        self.addHandler(pathconf, onRequest);
+        return pathconf;
+    }
+
+    /// Handlers on the same path are invoked in the order they were added until one of them returns 0.
+    fn addHandler(self: *Self, pathconf: *h2o.h2o_pathconf, onRequest: fn (handler: *h2o.h2o_handler, req: *h2o.h2o_req) callconv(.C) c_int) void {
         var handler = @ptrCast(*H2oServerHandler, h2o.h2o_create_handler(pathconf, @sizeOf(H2oServerHandler)).?);
         handler.super.on_req = onRequest;
+        // Allows the handler to be invoked before the request body is fully received. See defaultHandler.
+        handler.super.fields.supports_request_streaming = true;
         handler.server = self;
-        return pathconf;
+    }
+
+    /// Serves files from directories mounted with serveStatic so they never enter js.
+    fn staticHandler(ptr: *h2o.h2o_handler, req: *h2o.h2o_req) callconv(.C) c_int {
+        const self = @ptrCast(*H2oServerHandler, ptr).server;
+        if (self.static_files.serve(req)) {
+            return 0;
+        }
+        return -1;
+    }
+
+    fn getMethodString(self: *Self, method: []const u8) v8.String {
+        const iso = self.rt.isolate;
+        for (KnownMethods) |known, i| {
+            if (std.mem.eql(u8, method, known)) {
+                if (self.method_strs[i] == null) {
+                    self.method_strs[i] = iso.initPersistent(v8.String, iso.initStringUtf8(known));
+                }
+                return self.method_strs[i].?.inner;
+            }
+        }
+        return iso.initStringUtf8(method);
+    }
+
+    /// Serves files in dir_path for request paths starting with url_prefix.
+    pub fn serveStatic(self: *Self, url_prefix: []const u8, dir_path: []const u8) !void {
+        {
+            self.worker_config_mutex.lock();
+            defer self.worker_config_mutex.unlock();
+            try self.static_files.mount(url_prefix, dir_path);
+        }
+        self.wakeUpWorkers();
+    }
+
+    pub fn setHandler(self: *Self, handler: v8.Function) void {
+        const rt = self.rt;
+        if (self.js_handler) |*old| {
+            old.deinit();
+        }
+        self.js_handler = rt.isolate.initPersistent(v8.Function, handler);
+        if (self.workers.items.len == 0) {
+            return;
+        }
+        const src = v8x.allocValueAsUtf8(rt.alloc, rt.isolate, rt.getContext(), handler);
+        {
+            self.worker_config_mutex.lock();
+            defer self.worker_config_mutex.unlock();
+            if (self.worker_handler_src) |old| {
+                rt.alloc.free(old);
+            }
+            self.worker_handler_src = src;
+            self.worker_handler_version += 1;
+        }
+        self.wakeUpWorkers();
+    }
+
+    /// Workers check for a new handler or static mounts when their event loop wakes up.
+    fn wakeUpWorkers(self: *Self) void {
+        for (self.workers.items) |worker| {
+            worker.wakeUp();
+        }
     }
 
     fn defaultHandler(ptr: *h2o.h2o_handler, req: *h2o.h2o_req) callconv(.C) c_int {
@@ -240,36 +441,39 @@ pub const HttpServer = struct {
         const ctx = self.rt.getContext();
 
         if (self.js_handler) |handler| {
-            const js_req = self.rt.default_obj_t.inner.initInstance(ctx);
-            const method = req.method.base[0..req.method.len];
-            _ = js_req.setValue(ctx, iso.initStringUtf8("method"), iso.initStringUtf8(method));
-            const path = req.path_normalized.base[0..req.path_normalized.len];
-            _ = js_req.setValue(ctx, iso.initStringUtf8("path"), iso.initStringUtf8(path));
-            if (req.proceed_req == null) {
-                // Already received request body.
-                if (req.entity.len > 0) {
-                    const body_buf = runtime.Uint8Array{ .buf = req.entity.base[0..req.entity.len] };
-                    const js_val = self.rt.getJsValue(body_buf);
-                    _ = js_req.setValue(ctx, iso.initStringUtf8("body"), js_val);
-                } else {
-                    _ = js_req.setValue(ctx, iso.initStringUtf8("body"), self.rt.js_null);
-                }
-            } else unreachable;
-
-            ResponseWriter.cur_req = req;
-            ResponseWriter.called_send = false;
-            ResponseWriter.cur_generator = &self.generator;
+            const stream = RequestStream.create(self, req);
 
+            // Request properties are lazy accessors on the template so nothing else is allocated unless js reads them.
+            const js_req = self.rt.http_request.inner.initInstance(ctx);
+            js_req.setInternalField(0, iso.initExternal(stream));
             const writer = self.rt.http_response_writer.inner.initInstance(ctx);
+            writer.setInternalField(0, iso.initExternal(stream));
+
+            var handled = false;
             if (handler.inner.call(ctx, self.rt.js_undefined, &.{ js_req.toValue(), writer.toValue() })) |res| {
-                // If user code returned true or called send, report as handled.
-                if (res.toBool(iso) or ResponseWriter.called_send) {
-                    return 0;
-                }
+                // If user code returned true or started the response, report as handled.
+                handled = res.toBool(iso) or stream.started;
             } else {
                 // Js exception, start shutdown.
                 self.requestShutdown();
             }
+
+            if (handled) {
+                if (!stream.ended or stream.on_data_cb != null) {
+                    // Js can keep writing the response or receiving the body after the handler returns.
+                    // The objects are expired when h2o disposes the request.
+                    stream.js_req = iso.initPersistent(v8.Object, js_req);
+                    stream.js_writer = iso.initPersistent(v8.Object, writer);
+                } else {
+                    stream.expireJs(js_req, writer);
+                }
+                if (stream.body_streaming) {
+                    stream.startBodyStream();
+                }
+                return 0;
+            } else {
+                stream.expireJs(js_req, writer);
+            }
         }
 
         // Let H2o serve default 404 not found.
@@ -325,6 +529,17 @@ pub const HttpServer = struct {
         if (!self.closed_listen_handle) {
             return;
         }
+        if (!self.closed_worker_exit_async) {
+            self.worker_exit_mutex.lock();
+            defer self.worker_exit_mutex.unlock();
+            if (self.num_running_workers.load(.SeqCst) > 0) {
+                return;
+            }
+            if (uv.uv_is_closing(@ptrCast(*uv.uv_handle_t, &self.worker_exit_async)) == 0) {
+                uv.uv_close(@ptrCast(*uv.uv_handle_t, &self.worker_exit_async), onCloseWorkerExitAsync);
+            }
+            return;
+        }
         self.closed = true;
         // Even though there aren't any more connections or a listening port,
         // h2o's graceful timeout might still be active.
@@ -338,6 +553,28 @@ pub const HttpServer = struct {
         // h2o context and config also need to be deinited.
         h2o.h2o_context_dispose(&self.ctx);
         h2o.h2o_config_dispose(&self.config);
+        self.static_files.deinit();
+        // Workers have exited so nothing reads the worker config anymore.
+        if (self.worker_listen) |listen| {
+            self.rt.alloc.free(listen.host);
+            if (listen.cert_path) |path| {
+                self.rt.alloc.free(path);
+            }
+            if (listen.key_path) |path| {
+                self.rt.alloc.free(path);
+            }
+            self.worker_listen = null;
+        }
+        if (self.worker_handler_src) |src| {
+            self.rt.alloc.free(src);
+            self.worker_handler_src = null;
+        }
+        for (self.method_strs) |*mb_str| {
+            if (mb_str.*) |*str| {
+                str.deinit();
+                mb_str.* = null;
+            }
+        }
 
         if (self.on_shutdown_cb) |cb| {
             cb.call(self);
@@ -360,6 +597,10 @@ pub const HttpServer = struct {
             uv.assertNoError(res);
         }
 
+        for (self.workers.items) |worker| {
+            worker.requestShutdown();
+        }
+
         if (!self.closed_listen_handle) {
             // NOTE: libuv does not start listeners with reuseaddr on windows since it behaves differently and isn't desirable.
             // This means the listening port may still be in a TIME_WAIT state for some time after it was "shutdown". 
@@ -370,6 +611,179 @@ pub const HttpServer = struct {
     }
 };
 
+/// Serves requests from its own thread with a separate RuntimeContext (uv loop, h2o context and V8 isolate).
+/// The main script isn't run on the worker. The worker only starts a listener on the main server's port
+/// and compiles the main server's handler source in its own isolate, so the handler can't use variables from the script.
+const ServerWorker = struct {
+    const Self = @This();
+
+    thread: std.Thread,
+
+    // Server on the main runtime that spawned this worker.
+    server: *HttpServer,
+
+    // Set once the worker's runtime is initialized and cleared before it's torn down.
+    // Used by the main thread to wake up the worker's event loop. Guarded by rt_mutex.
+    rt: ?*RuntimeContext,
+    rt_mutex: std.Thread.Mutex,
+
+    close_flag: std.atomic.Atomic(bool),
+
+    // Main server config that was last applied to the worker's server. Only accessed by the worker thread.
+    handler_version: u32,
+    num_mounts: usize,
+
+    fn init(self: *Self, server: *HttpServer) void {
+        self.* = .{
+            .thread = undefined,
+            .server = server,
+            .rt = null,
+            .rt_mutex = std.Thread.Mutex{},
+            .close_flag = std.atomic.Atomic(bool).init(false),
+            .handler_version = 0,
+            .num_mounts = 0,
+        };
+    }
+
+    /// Called from the main thread.
+    fn requestShutdown(self: *Self) void {
+        self.close_flag.store(true, .SeqCst);
+        self.wakeUp();
+    }
+
+    /// Called from the main thread.
+    fn wakeUp(self: *Self) void {
+        // Holding the lock keeps the worker from deiniting its runtime during the wakeup.
+        self.rt_mutex.lock();
+        defer self.rt_mutex.unlock();
+        if (self.rt) |rt| {
+            rt.wakeUpEventPoller();
+        }
+    }
+
+    fn startServer(self: *Self, rt: *RuntimeContext) !*HttpServer {
+        const handle = rt.createCsHttpServerResource();
+        const server = handle.ptr;
+        server.init(rt);
+        server.main_server = self.server;
+        const listen = self.server.worker_listen.?;
+        if (listen.cert_path) |cert_path| {
+            try server.startHttps(listen.host, listen.port, cert_path, listen.key_path.?, 1);
+        } else {
+            try server.startHttp(listen.host, listen.port, 1);
+        }
+        return server;
+    }
+
+    /// Applies a new handler or static mounts from the main server.
+    fn syncConfig(self: *Self, rt: *RuntimeContext, server: *HttpServer) void {
+        const main = self.server;
+        main.worker_config_mutex.lock();
+        defer main.worker_config_mutex.unlock();
+
+        const mounts = main.static_files.mounts.items;
+        while (self.num_mounts < mounts.len) : (self.num_mounts += 1) {
+            const m = mounts[self.num_mounts];
+            server.serveStatic(m.prefix, m.root) catch |err| {
+                log.debug("server worker static mount {s}: {}", .{m.root, err});
+            };
+        }
+
+        if (self.handler_version != main.worker_handler_version) {
+            self.handler_version = main.worker_handler_version;
+            const iso = rt.isolate;
+            var hscope: v8.HandleScope = undefined;
+            hscope.init(iso);
+            defer hscope.deinit();
+            if (compileHandler(rt, main.worker_handler_src.?)) |handler| {
+                server.setHandler(handler);
+            }
+        }
+    }
+
+    fn compileHandler(rt: *RuntimeContext, src: []const u8) ?v8.Function {
+        const iso = rt.isolate;
+        const ctx = rt.getContext();
+        var try_catch: v8.TryCatch = undefined;
+        try_catch.init(iso);
+        defer try_catch.deinit();
+
+        // Parenthesized so a function declaration is evaluated as an expression.
+        const expr = std.fmt.allocPrint(rt.alloc, "({s})", .{src}) catch unreachable;
+        defer rt.alloc.free(expr);
+        var origin = v8.ScriptOrigin.initDefault(iso, v8.String.initUtf8(iso, "(server handler)").toValue());
+        const script = v8.Script.compile(ctx, v8.String.initUtf8(iso, expr), origin) catch {
+            const trace = v8x.allocPrintTryCatchStackTrace(rt.alloc, iso, ctx, try_catch).?;
+            defer rt.alloc.free(trace);
+            rt.env.errorFmt("Server handler could not be compiled on a worker thread:\n{s}", .{trace});
+            return null;
+        };
+        const val = script.run(ctx) catch {
+            const trace = v8x.allocPrintTryCatchStackTrace(rt.alloc, iso, ctx, try_catch).?;
+            defer rt.alloc.free(trace);
+            rt.env.errorFmt("Server handler could not be compiled on a worker thread:\n{s}", .{trace});
+            return null;
+        };
+        if (!val.isFunction()) {
+            rt.env.errorFmt("Server handler is not a function on a worker thread.\n", .{});
+            return null;
+        }
+        return val.castTo(v8.Function);
+    }
+
+    fn setRuntime(self: *Self, rt: ?*RuntimeContext) void {
+        self.rt_mutex.lock();
+        defer self.rt_mutex.unlock();
+        self.rt = rt;
+    }
+
+    fn run(self: *Self) void {
+        const main_rt = self.server.rt;
+
+        var rt: RuntimeContext = undefined;
+        rt.init(main_rt.alloc, runtime.ensureV8Platform(), .{
+            .is_server_worker = true,
+        }, main_rt.env);
+        rt.enter();
+        self.setRuntime(&rt);
+
+        var requested_shutdown = false;
+        const server: ?*HttpServer = self.startServer(&rt) catch |err| b: {
+            log.debug("server worker listen: {}", .{err});
+            rt.requestServersShutdown();
+            requested_shutdown = true;
+            break :b null;
+        };
+
+        while (true) {
+            if (!requested_shutdown and self.close_flag.load(.SeqCst)) {
+                rt.requestServersShutdown();
+                requested_shutdown = true;
+            }
+            if (!requested_shutdown) {
+                self.syncConfig(&rt, server.?);
+            }
+            if (runtime.pollMainEventLoop(&rt)) {
+                runtime.processMainEventLoop(&rt);
+                continue;
+            } else break;
+        }
+
+        // No wakeups from the main thread can reach the runtime after this.
+        self.setRuntime(null);
+        runtime.shutdownRuntime(&rt);
+        rt.exit();
+        rt.deinit();
+
+        // Signal before decrementing so the main thread can't close worker_exit_async in between.
+        self.server.worker_exit_mutex.lock();
+        defer self.server.worker_exit_mutex.unlock();
+        const res = uv.uv_async_send(&self.server.worker_exit_async);
+        uv.assertNoError(res);
+        _ = self.server.num_running_workers.fetchSub(1, .SeqCst);
+    }
+};
+
 const H2oUvTcp = struct {
     super: uv.uv_tcp_t,
     server: *HttpServer,
@@ -381,56 +795,456 @@ const H2oServerHandler = struct {
     server: *HttpServer,
 };
 
-pub const ResponseWriter = struct {
+/// Js objects that point to native memory with an External in their first internal field
+/// report "Native handle expired" once the pointer is cleared.
+fn expireJsObject(iso: v8.Isolate, obj: v8.Object) void {
+    obj.setInternalField(0, iso.initExternal(null));
+}
+
+/// State for a single request that backs the js ResponseWriter and the request's bodyStream.
+/// Allocated from the request's memory pool and released with it when h2o disposes the request.
+/// The response can be written incrementally. Only one h2o_send is in flight at a time and bytes written in the meantime
+/// are buffered until h2o calls the generator's proceed callback. Text is encoded straight into the buffer and js byte arrays
+/// are sent from their own memory when nothing else is buffered.
+pub const RequestStream = struct {
+    const Self = @This();
+
+    /// When more than this many response bytes are buffered, write returns false and js should wait for onDrain.
+    pub const HighWaterMark = 64 * 1024;
+
+    generator: h2o.h2o_generator_t,
+    server: *HttpServer,
 
-    pub var cur_req: ?*h2o.h2o_req = null;
-    pub var cur_generator: *h2o.h2o_generator_t = undefined;
-    pub var called_send: bool = false;
+    // Null once h2o stops the response or disposes the request.
+    req: ?*h2o.h2o_req,
+
+    // Only persisted if the request outlives the js handler call.
+    js_req: ?v8.Persistent(v8.Object),
+    js_writer: ?v8.Persistent(v8.Object),
+    // Created the first time js reads bodyStream.
+    js_body: ?v8.Persistent(v8.Object),
+    // Copy of the received body created the first time js reads body. Reused by later reads.
+    js_body_buf: ?v8.Persistent(v8.Value),
+
+    on_data_cb: ?v8.Persistent(v8.Function),
+    on_drain_cb: ?v8.Persistent(v8.Function),
+
+    // Response bytes written while another send is in flight.
+    pending: std.ArrayListUnmanaged(u8),
+    // Response bytes given to h2o_send. They need to stay valid until the proceed callback.
+    // Swapped with pending on each send so both buffers reuse their capacity.
+    inflight: std.ArrayListUnmanaged(u8),
+    // Js array that h2o is sending from directly instead of inflight. Kept alive until the proceed callback.
+    inflight_js: ?v8.Persistent(v8.Uint8Array),
+    // Number of bytes in the send that's in flight.
+    inflight_len: usize,
+
+    // The handler was invoked before the whole request body was received.
+    body_streaming: bool,
+    // Js paused the body stream and the next chunk isn't requested until it's unpaused.
+    body_paused: bool,
+    // A chunk was delivered to js and h2o is waiting for proceed_req before reading the next one.
+    body_waiting: bool,
+    // Size of the chunk that proceed_req acknowledges.
+    body_unacked: usize,
+    // Js is in the onData callback. Proceeding is deferred until it returns so chunks aren't delivered reentrantly.
+    in_on_data: bool,
+
+    started: bool,
+    sending: bool,
+    ended: bool,
+    // Write returned false and js is waiting for onDrain.
+    need_drain: bool,
+
+    fn create(server: *HttpServer, req: *h2o.h2o_req) *Self {
+        const ptr = h2o.h2o_mem_alloc_shared(&req.pool, @sizeOf(Self), onDispose).?;
+        const self = stdx.ptrCastAlign(*Self, ptr);
+        self.* = .{
+            .generator = .{ .proceed = onProceed, .stop = onStop },
+            .server = server,
+            .req = req,
+            .js_req = null,
+            .js_writer = null,
+            .js_body = null,
+            .js_body_buf = null,
+            .on_data_cb = null,
+            .on_drain_cb = null,
+            .pending = .{},
+            .inflight = .{},
+            .inflight_js = null,
+            .inflight_len = 0,
+            .body_streaming = req.proceed_req != null,
+            .body_paused = false,
+            .body_waiting = false,
+            .body_unacked = 0,
+            .in_on_data = false,
+            .started = false,
+            .sending = false,
+            .ended = false,
+            .need_drain = false,
+        };
+        return self;
+    }
 
-    pub fn setStatus(status_code: u32) void {
-        if (cur_req) |req| {
+    pub fn setStatus(self: *Self, status_code: u32) void {
+        if (self.started) return;
+        if (self.req) |req| {
             req.res.status = @intCast(c_int, status_code);
             req.res.reason = getStatusReason(status_code).ptr;
         }
     }
 
-    pub fn setHeader(key: []const u8, value: []const u8) void {
-        if (cur_req) |req| {
+    pub fn setHeader(self: *Self, key: []const u8, value: []const u8) void {
+        if (self.started) return;
+        if (self.req) |req| {
             // h2o doesn't dupe the value by default.
             var value_slice = h2o.h2o_strdup(&req.pool, value.ptr, value.len);
             _ = h2o.h2o_set_header_by_str(&req.pool, &req.res.headers, key.ptr, key.len, 1, value_slice.base, value_slice.len, 1);
         }
     }
 
-    pub fn send(text: []const u8) void {
-        if (called_send) return;
-        if (cur_req) |req| {
-            h2o.h2o_start_response(req, cur_generator);
+    /// Sends js text as the entire response. Does nothing if the response was already started.
+    pub fn sendText(self: *Self, text: v8.Value) void {
+        if (self.started or !self.startWrite()) return;
+        self.appendText(text);
+        self.end();
+    }
+
+    /// Sends the bytes of a js array as the entire response. Does nothing if the response was already started.
+    pub fn sendBytes(self: *Self, arr: v8.Uint8Array, buf: []const u8) void {
+        if (self.started or !self.startWrite()) return;
+        self.ended = true;
+        self.sendFromJs(arr, buf);
+    }
+
+    /// Queues js text to be sent. The text is encoded straight into the send buffer.
+    /// Returns false if the response can't be written to or too many bytes are buffered.
+    pub fn writeText(self: *Self, text: v8.Value) bool {
+        if (!self.startWrite()) return false;
+        self.appendText(text);
+        return self.finishWrite();
+    }
+
+    /// Queues the bytes of a js array to be sent. If nothing is buffered or in flight, h2o sends them from the array
+    /// without a copy. Otherwise they are copied behind the buffered bytes.
+    /// Returns false if the response can't be written to or too many bytes are buffered.
+    pub fn writeBytes(self: *Self, arr: v8.Uint8Array, buf: []const u8) bool {
+        if (!self.startWrite()) return false;
+        if (self.sending or self.pending.items.len > 0) {
+            self.pending.appendSlice(self.server.rt.alloc, buf) catch unreachable;
+        } else {
+            self.sendFromJs(arr, buf);
+        }
+        return self.finishWrite();
+    }
+
+    /// Starts the response if needed. Returns false if the response can't be written to.
+    fn startWrite(self: *Self) bool {
+        if (self.ended) return false;
+        const req = self.req orelse return false;
+        if (!self.started) {
+            h2o.h2o_start_response(req, &self.generator);
+            self.started = true;
+        }
+        return true;
+    }
+
+    fn appendText(self: *Self, text: v8.Value) void {
+        const rt = self.server.rt;
+        var buf = self.pending.toManaged(rt.alloc);
+        _ = v8x.appendValueAsUtf8(&buf, rt.isolate, rt.getContext(), text);
+        self.pending = buf.moveToUnmanaged();
+    }
+
+    /// Sends the buffered bytes if nothing is in flight.
+    fn finishWrite(self: *Self) bool {
+        if (!self.sending) {
+            self.flush();
+        }
+        if (self.pending.items.len + self.inflight_len > HighWaterMark) {
+            self.need_drain = true;
+            return false;
+        }
+        return true;
+    }
+
+    /// Sends any buffered bytes as the final part of the response.
+    pub fn end(self: *Self) void {
+        if (self.ended) return;
+        const req = self.req orelse return;
+        if (!self.started) {
+            h2o.h2o_start_response(req, &self.generator);
+            self.started = true;
+        }
+        self.ended = true;
+        if (!self.sending) {
+            self.flush();
+        }
+    }
+
+    fn flush(self: *Self) void {
+        std.mem.swap(std.ArrayListUnmanaged(u8), &self.pending, &self.inflight);
+        self.pending.clearRetainingCapacity();
+        self.inflight_len = self.inflight.items.len;
+        var buf = h2o.h2o_iovec_init(self.inflight.items);
+        const state = if (self.ended) h2o.H2O_SEND_STATE_FINAL else h2o.H2O_SEND_STATE_IN_PROGRESS;
+        self.sending = true;
+        h2o.h2o_send(self.req.?, &buf, if (buf.len > 0) 1 else 0, state);
+    }
+
+    /// Sends from the js array's memory. Only called when nothing is buffered or in flight.
+    fn sendFromJs(self: *Self, arr: v8.Uint8Array, buf: []const u8) void {
+        self.inflight_js = self.server.rt.isolate.initPersistent(v8.Uint8Array, arr);
+        self.inflight_len = buf.len;
+        var iov = h2o.h2o_iovec_init(buf);
+        const state = if (self.ended) h2o.H2O_SEND_STATE_FINAL else h2o.H2O_SEND_STATE_IN_PROGRESS;
+        self.sending = true;
+        h2o.h2o_send(self.req.?, &iov, if (iov.len > 0) 1 else 0, state);
+    }
+
+    fn releaseInflightJs(self: *Self) void {
+        if (self.inflight_js) |*arr| {
+            arr.deinit();
+            self.inflight_js = null;
+        }
+    }
+
+    /// h2o is done with the previous send.
+    fn onProceed(generator: [*c]h2o.h2o_generator_t, _: [*c]h2o.h2o_req_t) callconv(.C) void {
+        const self = @fieldParentPtr(Self, "generator", @ptrCast(*h2o.h2o_generator_t, generator));
+        self.sending = false;
+        self.inflight.clearRetainingCapacity();
+        self.inflight_len = 0;
+        self.releaseInflightJs();
+        if (self.req == null) {
+            return;
+        }
+        if (self.pending.items.len > 0 or self.ended) {
+            self.flush();
+        }
+        if (self.need_drain and !self.ended and self.inflight_len <= HighWaterMark) {
+            self.need_drain = false;
+            if (self.on_drain_cb) |cb| {
+                const rt = self.server.rt;
+                if (cb.inner.call(rt.getContext(), rt.js_undefined, &.{}) == null) {
+                    // Js exception, start shutdown.
+                    self.server.requestShutdown();
+                    return;
+                }
+            }
+            // Reading the request body was held back while the response was full.
+            self.proceedBodyIfReady();
+        }
+    }
+
+    /// The client went away before the response was sent.
+    fn onStop(generator: [*c]h2o.h2o_generator_t, _: [*c]h2o.h2o_req_t) callconv(.C) void {
+        const self = @fieldParentPtr(Self, "generator", @ptrCast(*h2o.h2o_generator_t, generator));
+        self.req = null;
+    }
+
+    fn onDispose(ptr: ?*anyopaque) callconv(.C) void {
+        const self = stdx.ptrCastAlign(*Self, ptr.?);
+        self.req = null;
+        const iso = self.server.rt.isolate;
+        if (self.js_req) |*obj| {
+            expireJsObject(iso, obj.inner);
+            obj.deinit();
+            self.js_req = null;
+        }
+        if (self.js_writer) |*obj| {
+            expireJsObject(iso, obj.inner);
+            obj.deinit();
+            self.js_writer = null;
+        }
+        if (self.js_body) |*obj| {
+            expireJsObject(iso, obj.inner);
+            obj.deinit();
+            self.js_body = null;
+        }
+        if (self.js_body_buf) |*buf| {
+            buf.deinit();
+            self.js_body_buf = null;
+        }
+        if (self.on_data_cb) |*cb| {
+            cb.deinit();
+            self.on_data_cb = null;
+        }
+        if (self.on_drain_cb) |*cb| {
+            cb.deinit();
+            self.on_drain_cb = null;
+        }
+        self.releaseInflightJs();
+        self.pending.deinit(self.server.rt.alloc);
+        self.inflight.deinit(self.server.rt.alloc);
+    }
+
+    /// Expires the js objects when they aren't needed after the handler call.
+    fn expireJs(self: *Self, js_req: v8.Object, writer: v8.Object) void {
+        const iso = self.server.rt.isolate;
+        expireJsObject(iso, js_req);
+        expireJsObject(iso, writer);
+        if (self.js_body) |*obj| {
+            expireJsObject(iso, obj.inner);
+            obj.deinit();
+            self.js_body = null;
+        }
+        if (self.js_body_buf) |*buf| {
+            buf.deinit();
+            self.js_body_buf = null;
+        }
+    }
 
-            // Send can be async so dupe.
-            var slice = h2o.h2o_strdup(&req.pool, text.ptr, text.len);
-            h2o.h2o_send(req, &slice, 1, h2o.H2O_SEND_STATE_FINAL);
-            called_send = true;
+    /// Takes over receiving the request body from h2o.
+    /// Parts received before the handler was invoked are in req.entity. After that, each chunk is given to write_req.cb
+    /// and the protocol handler doesn't read more from the socket until proceed_req is called.
+    /// proceed_req is only called once js is ready for more: the body isn't paused and the response isn't waiting to drain.
+    /// Chunks are discarded if js didn't provide an onData callback so the connection can still make progress.
+    fn startBodyStream(self: *Self) void {
+        const req = self.req.?;
+        req.write_req.cb = onWriteReq;
+        req.write_req.ctx = self;
+        if (req.entity.len > 0) {
+            if (!self.callOnData(req.entity.base[0..req.entity.len], false)) {
+                return;
+            }
         }
+        self.body_unacked = req.entity.len;
+        self.body_waiting = true;
+        self.proceedBodyIfReady();
+    }
+
+    /// Stops requesting more of the body until unpauseBody is called.
+    pub fn pauseBody(self: *Self) void {
+        self.body_paused = true;
     }
 
-    pub fn sendBytes(arr: runtime.Uint8Array) void {
-        if (called_send) return;
-        if (cur_req) |req| {
-            h2o.h2o_start_response(req, cur_generator);
+    pub fn unpauseBody(self: *Self) void {
+        self.body_paused = false;
+        self.proceedBodyIfReady();
+    }
 
-            // Send can be async so dupe.
-            var slice = h2o.h2o_strdup(&req.pool, arr.buf.ptr, arr.buf.len);
-            h2o.h2o_send(req, &slice, 1, h2o.H2O_SEND_STATE_FINAL);
-            called_send = true;
+    fn proceedBodyIfReady(self: *Self) void {
+        if (!self.body_waiting or self.body_paused or self.in_on_data) {
+            return;
+        }
+        if (self.need_drain and !self.ended) {
+            return;
+        }
+        const req = self.req orelse return;
+        self.body_waiting = false;
+        if (req.proceed_req) |proceed| {
+            proceed(@ptrCast([*c]h2o.h2o_req_t, req), self.body_unacked, h2o.H2O_SEND_STATE_IN_PROGRESS);
+        }
+    }
+
+    fn onWriteReq(ctx: ?*anyopaque, chunk: h2o.h2o_iovec_t, is_end_stream: c_int) callconv(.C) c_int {
+        const self = stdx.ptrCastAlign(*Self, ctx.?);
+        const done = is_end_stream != 0;
+        const buf = if (chunk.len > 0) chunk.base[0..chunk.len] else "";
+        if (!self.callOnData(buf, done)) {
+            return -1;
+        }
+        if (!done) {
+            self.body_unacked = chunk.len;
+            self.body_waiting = true;
+            self.proceedBodyIfReady();
+        }
+        return 0;
+    }
+
+    /// Returns false if js threw an exception.
+    fn callOnData(self: *Self, buf: []const u8, done: bool) bool {
+        if (self.on_data_cb) |cb| {
+            const rt = self.server.rt;
+
+            // Chunks are converted to js values for the lifetime of the callback only.
+            var hscope: v8.HandleScope = undefined;
+            hscope.init(rt.isolate);
+            defer hscope.deinit();
+
+            // Copies into a new Uint8Array since h2o reuses the chunk's buffer once this returns.
+            const js_chunk = rt.getJsValue(runtime.Uint8Array{ .buf = buf });
+            const js_done = if (done) rt.js_true.toValue() else rt.js_false.toValue();
+            self.in_on_data = true;
+            defer self.in_on_data = false;
+            if (cb.inner.call(rt.getContext(), rt.js_undefined, &.{ js_chunk, js_done }) == null) {
+                // Js exception, start shutdown.
+                self.server.requestShutdown();
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/// Lazy accessors of the js request object, bound with RuntimeContext.setGetter.
+/// The object's first internal field points to the RequestStream. Properties read after h2o has disposed the request are null.
+pub const RequestAccessors = struct {
+
+    pub fn getMethod(stream: *RequestStream) ?v8.Value {
+        const req = stream.req orelse return null;
+        const method = req.method.base[0..req.method.len];
+        return stream.server.getMethodString(method).toValue();
+    }
+
+    pub fn getPath(stream: *RequestStream) ?[]const u8 {
+        const req = stream.req orelse return null;
+        return req.path_normalized.base[0..req.path_normalized.len];
+    }
+
+    /// Header names are lowercase. For repeated headers, the last value is used.
+    pub fn getHeaders(rt: *RuntimeContext, stream: *RequestStream) ?v8.Object {
+        const req = stream.req orelse return null;
+        const iso = rt.isolate;
+        const ctx = rt.getContext();
+
+        const js_headers = rt.default_obj_t.inner.initInstance(ctx);
+        var i: usize = 0;
+        while (i < req.headers.size) : (i += 1) {
+            const header = req.headers.entries[i];
+            const name = header.name.*.base[0..header.name.*.len];
+            const value = header.value.base[0..header.value.len];
+            _ = js_headers.setValue(ctx, iso.initStringUtf8(name), iso.initStringUtf8(value));
+        }
+        return js_headers;
+    }
+
+    /// A Uint8Array copy of the body, or null if there is no body or it's being streamed.
+    /// The copy is made on the first read and the same array is returned afterwards.
+    pub fn getBody(rt: *RuntimeContext, stream: *RequestStream) ?v8.Value {
+        if (stream.js_body_buf) |buf| {
+            return buf.inner;
+        }
+        const req = stream.req orelse return null;
+        if (stream.body_streaming or req.entity.len == 0) {
+            return null;
+        }
+        const body = rt.getJsValue(runtime.Uint8Array{ .buf = req.entity.base[0..req.entity.len] });
+        stream.js_body_buf = rt.isolate.initPersistent(v8.Value, body);
+        return body;
+    }
+
+    /// Only available when the handler was invoked before the whole body was received.
+    pub fn getBodyStream(rt: *RuntimeContext, stream: *RequestStream) ?v8.Object {
+        if (stream.req == null or !stream.body_streaming) {
+            return null;
+        }
+        if (stream.js_body == null) {
+            const iso = rt.isolate;
+            const js_body = rt.http_request_body.inner.initInstance(rt.getContext());
+            js_body.setInternalField(0, iso.initExternal(stream));
+            stream.js_body = iso.initPersistent(v8.Object, js_body);
         }
+        return stream.js_body.?.inner;
     }
 };
 
-fn getStatusReason(code: u32) []const u8 {
+pub fn getStatusReason(code: u32) []const u8 {
     switch (code) {
         200 => return "OK",
         201 => return "Created",
+        206 => return "Partial Content",
         301 => return "Moved Permanently",
         302 => return "Found",
         303 => return "See Other",
@@ -441,6 +1255,7 @@ fn getStatusReason(code: u32) []const u8 {
         403 => return "Forbidden",
         404 => return "Not Found",
         405 => return "Method Not Allowed",
+        416 => return "Range Not Satisfiable",
         500 => return "Internal Server Error",
         501 => return "Not Implemented",
         502 => return "Bad Gateway",
@@ -0,0 +1,600 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const t = stdx.testing;
+const builtin = @import("builtin");
+const h2o = @import("h2o");
+
+const server = @import("server.zig");
+const log = stdx.log.scoped(.static_files);
+
+/// Serves files from directories mounted on an HttpServer without entering js.
+/// Small files are read into an LRU cache bounded by total bytes and given to h2o_send directly so they're never copied into the request pool.
+/// Larger files are streamed from the open file in StreamChunkSize reads. Files aren't mmapped since a file truncated while mapped would fault the process.
+/// Cached files are revalidated with a stat at most once per RevalidateIntervalMs.
+/// Files that resolve outside of their mount's directory, eg. through a symlink, are not served.
+/// Responses include an ETag (mtime and size) and Last-Modified. Conditional requests get a 304 and a single byte range gets a 206.
+/// Multiple ranges are not supported and get the full content which is allowed by RFC 7233.
+pub const StaticFiles = struct {
+    const Self = @This();
+
+    pub const MaxCacheBytes = 64 * 1024 * 1024;
+    pub const MaxCachedFileSize = 1024 * 1024;
+    pub const RevalidateIntervalMs = 1000;
+    pub const StreamChunkSize = 64 * 1024;
+
+    alloc: std.mem.Allocator,
+    mounts: std.ArrayListUnmanaged(Mount),
+
+    // Used to look up content types by file extension. Set once h2o is started.
+    mimemap: ?*h2o.h2o_mimemap_t,
+
+    // Keys are the mount index followed by the relative path.
+    cache: std.StringHashMapUnmanaged(*FileEntry),
+    // Most recently used entry is at the head.
+    lru_head: ?*FileEntry,
+    lru_tail: ?*FileEntry,
+    cache_bytes: usize,
+
+    pub fn init(alloc: std.mem.Allocator) Self {
+        return .{
+            .alloc = alloc,
+            .mounts = .{},
+            .mimemap = null,
+            .cache = .{},
+            .lru_head = null,
+            .lru_tail = null,
+            .cache_bytes = 0,
+        };
+    }
+
+    /// Requests referencing entries must be disposed before this is called.
+    pub fn deinit(self: *Self) void {
+        while (self.lru_head) |entry| {
+            self.evict(entry);
+        }
+        self.cache.deinit(self.alloc);
+        self.cache = .{};
+        for (self.mounts.items) |*m| {
+            self.alloc.free(m.prefix);
+            self.alloc.free(m.root);
+            m.dir.close();
+        }
+        self.mounts.deinit(self.alloc);
+        self.mounts = .{};
+    }
+
+    /// Serves files in dir_path for request paths starting with url_prefix.
+    pub fn mount(self: *Self, url_prefix: []const u8, dir_path: []const u8) !void {
+        var prefix = std.ArrayList(u8).init(self.alloc);
+        errdefer prefix.deinit();
+        if (!std.mem.startsWith(u8, url_prefix, "/")) {
+            try prefix.append('/');
+        }
+        try prefix.appendSlice(url_prefix);
+        if (!std.mem.endsWith(u8, prefix.items, "/")) {
+            try prefix.append('/');
+        }
+        var dir = std.fs.cwd().openDir(dir_path, .{}) catch |err| {
+            log.debug("Failed to open static dir {s}: {}", .{dir_path, err});
+            return error.FileNotFound;
+        };
+        errdefer dir.close();
+        const root = try dir.realpathAlloc(self.alloc, ".");
+        errdefer self.alloc.free(root);
+        try self.mounts.append(self.alloc, .{
+            .prefix = prefix.toOwnedSlice(),
+            .root = root,
+            .dir = dir,
+        });
+    }
+
+    /// Returns false if the request doesn't map to a file so the next handler can process it.
+    pub fn serve(self: *Self, req: *h2o.h2o_req) bool {
+        if (self.mounts.items.len == 0) {
+            return false;
+        }
+        const method = req.method.base[0..req.method.len];
+        if (!std.mem.eql(u8, method, "GET") and !std.mem.eql(u8, method, "HEAD")) {
+            return false;
+        }
+
+        const path = req.path_normalized.base[0..req.path_normalized.len];
+        const mount_idx = self.findMount(path) orelse return false;
+        const prefix = self.mounts.items[mount_idx].prefix;
+
+        var path_buf: [std.fs.MAX_PATH_BYTES]u8 = undefined;
+        var rel: []const u8 = if (path.len >= prefix.len) path[prefix.len..] else "";
+        if (rel.len == 0 or rel[rel.len-1] == '/') {
+            rel = std.fmt.bufPrint(&path_buf, "{s}index.html", .{rel}) catch return false;
+        }
+        if (!isSafeRelPath(rel)) {
+            return false;
+        }
+
+        const entry = self.getEntry(mount_idx, rel) catch return false;
+
+        // Keeps the entry alive until h2o disposes the request since the file contents are sent without copying.
+        const ref = stdx.ptrCastAlign(*EntryRef, h2o.h2o_mem_alloc_shared(&req.pool, @sizeOf(EntryRef), EntryRef.onDispose).?);
+        ref.* = .{
+            .files = self,
+            .entry = entry,
+            .generator = .{ .proceed = EntryRef.onProceed, .stop = null },
+            .offset = 0,
+            .end = 0,
+            .buf = null,
+        };
+        entry.refs += 1;
+
+        const headers = &req.res.headers;
+        _ = h2o.h2o_add_header(&req.pool, headers, h2o.H2O_TOKEN_ETAG, null, entry.etag.ptr, entry.etag.len);
+        _ = h2o.h2o_add_header(&req.pool, headers, h2o.H2O_TOKEN_LAST_MODIFIED, null, &entry.last_modified, h2o.H2O_TIMESTR_RFC1123_LEN);
+        _ = h2o.h2o_add_header(&req.pool, headers, h2o.H2O_TOKEN_ACCEPT_RANGES, null, "bytes", "bytes".len);
+
+        if (isNotModified(req, entry)) {
+            setStatus(req, 304);
+            h2o.h2o_start_response(req, &ref.generator);
+            h2o.h2o_send(req, null, 0, h2o.H2O_SEND_STATE_FINAL);
+            return true;
+        }
+
+        _ = h2o.h2o_add_header(&req.pool, headers, h2o.H2O_TOKEN_CONTENT_TYPE, null, entry.content_type.base, entry.content_type.len);
+
+        var start: usize = 0;
+        var end: usize = entry.size;
+        if (findHeader(req, h2o.H2O_TOKEN_RANGE)) |range_header| {
+            var buf: [64]u8 = undefined;
+            switch (parseRange(range_header, entry.size)) {
+                .Range => |range| {
+                    start = range.start;
+                    end = range.end + 1;
+                    const content_range = std.fmt.bufPrint(&buf, "bytes {}-{}/{}", .{range.start, range.end, entry.size}) catch unreachable;
+                    const value = h2o.h2o_strdup(&req.pool, content_range.ptr, content_range.len);
+                    _ = h2o.h2o_add_header(&req.pool, headers, h2o.H2O_TOKEN_CONTENT_RANGE, null, value.base, value.len);
+                    setStatus(req, 206);
+                },
+                .Unsatisfiable => {
+                    const content_range = std.fmt.bufPrint(&buf, "bytes */{}", .{entry.size}) catch unreachable;
+                    const value = h2o.h2o_strdup(&req.pool, content_range.ptr, content_range.len);
+                    _ = h2o.h2o_add_header(&req.pool, headers, h2o.H2O_TOKEN_CONTENT_RANGE, null, value.base, value.len);
+                    setStatus(req, 416);
+                    req.res.content_length = 0;
+                    h2o.h2o_start_response(req, &ref.generator);
+                    h2o.h2o_send(req, null, 0, h2o.H2O_SEND_STATE_FINAL);
+                    return true;
+                },
+                .None => setStatus(req, 200),
+            }
+        } else {
+            setStatus(req, 200);
+        }
+
+        req.res.content_length = end - start;
+        h2o.h2o_start_response(req, &ref.generator);
+        if (entry.file != null) {
+            ref.offset = start;
+            ref.end = end;
+            ref.buf = self.alloc.alloc(u8, std.math.min(StreamChunkSize, end - start)) catch unreachable;
+            ref.sendNextChunk(req);
+        } else {
+            var iovec = h2o.h2o_iovec_init(entry.data[start..end]);
+            h2o.h2o_send(req, &iovec, if (end > start) 1 else 0, h2o.H2O_SEND_STATE_FINAL);
+        }
+        return true;
+    }
+
+    /// Longest matching prefix. A path without the prefix's trailing slash also matches.
+    fn findMount(self: Self, path: []const u8) ?usize {
+        var res: ?usize = null;
+        var res_len: usize = 0;
+        for (self.mounts.items) |m, i| {
+            const matches = std.mem.startsWith(u8, path, m.prefix) or std.mem.eql(u8, path, m.prefix[0..m.prefix.len-1]);
+            if (matches and (res == null or m.prefix.len > res_len)) {
+                res = i;
+                res_len = m.prefix.len;
+            }
+        }
+        return res;
+    }
+
+    fn getEntry(self: *Self, mount_idx: usize, rel: []const u8) !*FileEntry {
+        var key_buf: [std.fs.MAX_PATH_BYTES + 16]u8 = undefined;
+        const key = try std.fmt.bufPrint(&key_buf, "{}:{s}", .{mount_idx, rel});
+
+        const now = std.time.milliTimestamp();
+        if (self.cache.get(key)) |entry| {
+            if (now - entry.checked_at < RevalidateIntervalMs) {
+                self.touch(entry);
+                return entry;
+            }
+            const file = self.openFile(mount_idx, rel) catch {
+                self.evict(entry);
+                return error.FileNotFound;
+            };
+            defer file.close();
+            const stat = try file.stat();
+            if (stat.mtime == entry.mtime and stat.size == entry.size) {
+                entry.checked_at = now;
+                self.touch(entry);
+                return entry;
+            }
+            // File changed.
+            self.evict(entry);
+        }
+
+        const entry = try self.openEntry(mount_idx, rel, key);
+        entry.checked_at = now;
+        if (entry.file == null) {
+            self.insert(entry);
+        }
+        return entry;
+    }
+
+    /// Opens a file in the mount. Fails if the opened file resolves outside of the mount's directory.
+    /// The resolved path is read from the open handle so a symlink can't be swapped in between checking and opening.
+    fn openFile(self: *Self, mount_idx: usize, rel: []const u8) !std.fs.File {
+        const m = self.mounts.items[mount_idx];
+        const file = m.dir.openFile(rel, .{}) catch return error.FileNotFound;
+        errdefer file.close();
+        var path_buf: [std.fs.MAX_PATH_BYTES]u8 = undefined;
+        const real_path = std.os.getFdPath(file.handle, &path_buf) catch return error.FileNotFound;
+        if (!isPathInDir(real_path, m.root)) {
+            log.debug("Static file {s} resolves outside of {s}", .{rel, m.root});
+            return error.FileNotFound;
+        }
+        return file;
+    }
+
+    fn openEntry(self: *Self, mount_idx: usize, rel: []const u8, key: []const u8) !*FileEntry {
+        const file = try self.openFile(mount_idx, rel);
+        var keep_file = false;
+        defer if (!keep_file) file.close();
+        const stat = try file.stat();
+        if (stat.kind != .File) {
+            return error.FileNotFound;
+        }
+
+        const entry = try self.alloc.create(FileEntry);
+        errdefer self.alloc.destroy(entry);
+        entry.* = .{
+            .key = try self.alloc.dupe(u8, key),
+            .data = &.{},
+            .file = null,
+            .size = @intCast(usize, stat.size),
+            .mtime = stat.mtime,
+            .etag = undefined,
+            .etag_buf = undefined,
+            .last_modified = undefined,
+            .content_type = undefined,
+            .refs = 0,
+            .cached = false,
+            .checked_at = 0,
+            .prev = null,
+            .next = null,
+        };
+        errdefer self.alloc.free(entry.key);
+
+        if (stat.size > MaxCachedFileSize) {
+            // Streamed from the file for each request.
+            entry.file = file;
+            keep_file = true;
+        } else if (stat.size > 0) {
+            const buf = try self.alloc.alloc(u8, stat.size);
+            errdefer self.alloc.free(buf);
+            // The file may have been truncated since the stat. Only serve what was read; the size mismatch reloads it on the next revalidation.
+            entry.size = try file.readAll(buf);
+            entry.data = buf;
+        }
+
+        const mtime_secs = @intCast(i64, @divFloor(stat.mtime, std.time.ns_per_s));
+        entry.etag = std.fmt.bufPrint(&entry.etag_buf, "\"{x}-{x}\"", .{mtime_secs, entry.size}) catch unreachable;
+        h2o.h2o_unix_time2str_rfc1123(&entry.last_modified, mtime_secs);
+
+        const ext = std.fs.path.extension(rel);
+        const ext_name = if (ext.len > 0) ext[1..] else ext;
+        entry.content_type = h2o.h2o_get_mimetype_by_extension(self.mimemap, ext_name.ptr, ext_name.len);
+        return entry;
+    }
+
+    fn insert(self: *Self, entry: *FileEntry) void {
+        while (self.cache_bytes + entry.data.len > MaxCacheBytes) {
+            self.evict(self.lru_tail orelse break);
+        }
+        self.cache.put(self.alloc, entry.key, entry) catch unreachable;
+        entry.cached = true;
+        self.cache_bytes += entry.data.len;
+        self.pushFront(entry);
+    }
+
+    /// Removes the entry from the cache. The file contents are kept until the last request using them is disposed.
+    fn evict(self: *Self, entry: *FileEntry) void {
+        _ = self.cache.remove(entry.key);
+        self.unlink(entry);
+        entry.cached = false;
+        self.cache_bytes -= entry.data.len;
+        if (entry.refs == 0) {
+            self.destroyEntry(entry);
+        }
+    }
+
+    fn release(self: *Self, entry: *FileEntry) void {
+        entry.refs -= 1;
+        if (entry.refs == 0 and !entry.cached) {
+            self.destroyEntry(entry);
+        }
+    }
+
+    fn destroyEntry(self: *Self, entry: *FileEntry) void {
+        if (entry.file) |file| {
+            file.close();
+        }
+        self.alloc.free(entry.data);
+        self.alloc.free(entry.key);
+        self.alloc.destroy(entry);
+    }
+
+    fn touch(self: *Self, entry: *FileEntry) void {
+        if (self.lru_head == entry) {
+            return;
+        }
+        self.unlink(entry);
+        self.pushFront(entry);
+    }
+
+    fn pushFront(self: *Self, entry: *FileEntry) void {
+        entry.prev = null;
+        entry.next = self.lru_head;
+        if (self.lru_head) |head| {
+            head.prev = entry;
+        } else {
+            self.lru_tail = entry;
+        }
+        self.lru_head = entry;
+    }
+
+    fn unlink(self: *Self, entry: *FileEntry) void {
+        if (entry.prev) |prev| {
+            prev.next = entry.next;
+        } else if (self.lru_head == entry) {
+            self.lru_head = entry.next;
+        }
+        if (entry.next) |next| {
+            next.prev = entry.prev;
+        } else if (self.lru_tail == entry) {
+            self.lru_tail = entry.prev;
+        }
+        entry.prev = null;
+        entry.next = null;
+    }
+};
+
+const Mount = struct {
+    // Always starts and ends with '/'.
+    prefix: []const u8,
+    // Real path of dir. Opened files must resolve inside it.
+    root: []const u8,
+    dir: std.fs.Dir,
+};
+
+const FileEntry = struct {
+    key: []const u8,
+    // Contents of files up to MaxCachedFileSize.
+    data: []const u8,
+    // Larger files are kept open and streamed.
+    file: ?std.fs.File,
+    size: usize,
+    mtime: i128,
+
+    etag: []const u8,
+    etag_buf: [48]u8,
+    last_modified: [h2o.H2O_TIMESTR_RFC1123_LEN + 1]u8,
+    content_type: h2o.h2o_iovec_t,
+
+    // Number of requests still sending this entry.
+    refs: u32,
+    cached: bool,
+    // Last time in ms the file was checked for changes.
+    checked_at: i64,
+
+    prev: ?*FileEntry,
+    next: ?*FileEntry,
+};
+
+/// Allocated from the request's pool.
+const EntryRef = struct {
+    files: *StaticFiles,
+    entry: *FileEntry,
+    // Cached entries are sent at once. Streamed entries send the next chunk from the proceed callback.
+    generator: h2o.h2o_generator_t,
+
+    // Next file offset and the exclusive end of the response when streaming.
+    offset: usize,
+    end: usize,
+    // Holds the chunk being sent until h2o calls proceed.
+    buf: ?[]u8,
+
+    fn sendNextChunk(self: *EntryRef, req: *h2o.h2o_req) void {
+        const file = self.entry.file.?;
+        const buf = self.buf.?;
+        const len = std.math.min(buf.len, self.end - self.offset);
+        const num_read = file.preadAll(buf[0..len], self.offset) catch 0;
+        self.offset += num_read;
+        var iovec = h2o.h2o_iovec_init(buf[0..num_read]);
+        var state = h2o.H2O_SEND_STATE_IN_PROGRESS;
+        if (num_read < len) {
+            // The file was truncated or failed to read. Abort since the content length was already sent.
+            state = h2o.H2O_SEND_STATE_ERROR;
+        } else if (self.offset == self.end) {
+            state = h2o.H2O_SEND_STATE_FINAL;
+        }
+        h2o.h2o_send(req, &iovec, if (num_read > 0) 1 else 0, state);
+    }
+
+    fn onProceed(generator: [*c]h2o.h2o_generator_t, req: [*c]h2o.h2o_req_t) callconv(.C) void {
+        const self = @fieldParentPtr(EntryRef, "generator", @ptrCast(*h2o.h2o_generator_t, generator));
+        self.sendNextChunk(@ptrCast(*h2o.h2o_req, req));
+    }
+
+    fn onDispose(ptr: ?*anyopaque) callconv(.C) void {
+        const self = stdx.ptrCastAlign(*EntryRef, ptr.?);
+        if (self.buf) |buf| {
+            self.files.alloc.free(buf);
+        }
+        self.files.release(self.entry);
+    }
+};
+
+fn setStatus(req: *h2o.h2o_req, status_code: u32) void {
+    req.res.status = @intCast(c_int, status_code);
+    req.res.reason = server.getStatusReason(status_code).ptr;
+}
+
+fn findHeader(req: *h2o.h2o_req, token: *const h2o.h2o_token) ?[]const u8 {
+    const idx = h2o.h2o_find_header(&req.headers, token, -1);
+    if (idx == -1) {
+        return null;
+    }
+    const value = req.headers.entries[@intCast(usize, idx)].value;
+    return value.base[0..value.len];
+}
+
+fn isNotModified(req: *h2o.h2o_req, entry: *const FileEntry) bool {
+    if (findHeader(req, h2o.H2O_TOKEN_IF_NONE_MATCH)) |val| {
+        // If-None-Match takes precedence over If-Modified-Since.
+        return std.mem.eql(u8, val, "*") or std.mem.indexOf(u8, val, entry.etag) != null;
+    }
+    if (findHeader(req, h2o.H2O_TOKEN_IF_MODIFIED_SINCE)) |val| {
+        // Clients send back the Last-Modified value so an exact match is enough.
+        return std.mem.eql(u8, val, entry.last_modified[0..h2o.H2O_TIMESTR_RFC1123_LEN]);
+    }
+    return false;
+}
+
+/// Whether path is dir or inside it. Both should be real paths.
+fn isPathInDir(path: []const u8, dir: []const u8) bool {
+    if (!std.mem.startsWith(u8, path, dir)) {
+        return false;
+    }
+    if (path.len == dir.len or std.fs.path.isSep(dir[dir.len-1])) {
+        return true;
+    }
+    return std.fs.path.isSep(path[dir.len]);
+}
+
+/// h2o already normalizes "." and ".." out of the path, but reject them anyway since the path is used to open files.
+fn isSafeRelPath(path: []const u8) bool {
+    if (std.mem.indexOfScalar(u8, path, 0) != null or std.mem.indexOfScalar(u8, path, '\\') != null) {
+        return false;
+    }
+    if (path.len > 0 and path[0] == '/') {
+        return false;
+    }
+    var iter = std.mem.split(u8, path, "/");
+    while (iter.next()) |part| {
+        if (std.mem.eql(u8, part, "..")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const ByteRange = struct {
+    start: usize,
+    // Inclusive.
+    end: usize,
+};
+
+const RangeResult = union(enum) {
+    /// No usable range. Respond with the full content.
+    None: void,
+    Range: ByteRange,
+    Unsatisfiable: void,
+};
+
+/// Parses a Range header with a single byte range.
+fn parseRange(header: []const u8, size: usize) RangeResult {
+    const Prefix = "bytes=";
+    if (!std.mem.startsWith(u8, header, Prefix)) {
+        return .None;
+    }
+    const spec = std.mem.trim(u8, header[Prefix.len..], " ");
+    if (std.mem.indexOfScalar(u8, spec, ',') != null) {
+        return .None;
+    }
+    const dash = std.mem.indexOfScalar(u8, spec, '-') orelse return .None;
+    const first = std.mem.trim(u8, spec[0..dash], " ");
+    const last = std.mem.trim(u8, spec[dash+1..], " ");
+    if (first.len == 0) {
+        // Suffix range.
+        const len = std.fmt.parseInt(usize, last, 10) catch return .None;
+        if (len == 0 or size == 0) {
+            return .Unsatisfiable;
+        }
+        return .{ .Range = .{ .start = size - std.math.min(len, size), .end = size - 1 } };
+    }
+    const start = std.fmt.parseInt(usize, first, 10) catch return .None;
+    if (start >= size) {
+        return .Unsatisfiable;
+    }
+    var end = size - 1;
+    if (last.len > 0) {
+        const last_pos = std.fmt.parseInt(usize, last, 10) catch return .None;
+        if (last_pos < start) {
+            return .None;
+        }
+        end = std.math.min(last_pos, size - 1);
+    }
+    return .{ .Range = .{ .start = start, .end = end } };
+}
+
+test "parseRange" {
+    try t.eq(parseRange("bytes=0-4", 10), .{ .Range = .{ .start = 0, .end = 4 } });
+    try t.eq(parseRange("bytes=5-", 10), .{ .Range = .{ .start = 5, .end = 9 } });
+    try t.eq(parseRange("bytes=5-100", 10), .{ .Range = .{ .start = 5, .end = 9 } });
+    try t.eq(parseRange("bytes=-3", 10), .{ .Range = .{ .start = 7, .end = 9 } });
+    try t.eq(parseRange("bytes=-30", 10), .{ .Range = .{ .start = 0, .end = 9 } });
+    try t.eq(parseRange("bytes=10-", 10), .Unsatisfiable);
+    try t.eq(parseRange("bytes=-0", 10), .Unsatisfiable);
+    try t.eq(parseRange("bytes=4-2", 10), .None);
+    try t.eq(parseRange("bytes=0-1,4-5", 10), .None);
+    try t.eq(parseRange("items=0-1", 10), .None);
+    try t.eq(parseRange("bytes=a-1", 10), .None);
+}
+
+test "isSafeRelPath" {
+    try t.eq(isSafeRelPath("index.html"), true);
+    try t.eq(isSafeRelPath("assets/logo.png"), true);
+    try t.eq(isSafeRelPath("../secret"), false);
+    try t.eq(isSafeRelPath("assets/../../secret"), false);
+    try t.eq(isSafeRelPath("/etc/passwd"), false);
+}
+
+test "isPathInDir" {
+    try t.eq(isPathInDir("/srv/public/index.html", "/srv/public"), true);
+    try t.eq(isPathInDir("/srv/public", "/srv/public"), true);
+    try t.eq(isPathInDir("/srv/public2/index.html", "/srv/public"), false);
+    try t.eq(isPathInDir("/srv/secret.txt", "/srv/public"), false);
+    try t.eq(isPathInDir("/index.html", "/"), true);
+}
+
+test "StaticFiles doesn't serve files that resolve outside of the mount" {
+    if (builtin.os.tag == .windows) {
+        // Creating symlinks needs extra privileges.
+        return error.SkipZigTest;
+    }
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    try tmp.dir.makeDir("public");
+    try tmp.dir.writeFile("secret.txt", "secret");
+    try tmp.dir.writeFile("public/index.html", "index");
+    try tmp.dir.symLink("../secret.txt", "public/secret.txt", .{});
+
+    var files = StaticFiles.init(t.alloc);
+    defer files.deinit();
+    var path_buf: [std.fs.MAX_PATH_BYTES]u8 = undefined;
+    const path = try std.fmt.bufPrint(&path_buf, "zig-cache/tmp/{s}/public", .{tmp.sub_path});
+    try files.mount("/static", path);
+
+    const file = try files.openFile(0, "index.html");
+    file.close();
+    try t.expectError(files.openFile(0, "secret.txt"), error.FileNotFound);
+}
@@ -0,0 +1,91 @@
+const std = @import("std");
+
+const timer = @import("timer.zig");
+const HeapQueue = timer.HeapQueue;
+const WheelQueue = timer.WheelQueue;
+const EntryRef = timer.EntryRef;
+
+// Compares the heap and timing wheel backends of the runtime Timer.
+// Each round inserts N timeouts spread over a minute, cancels half of them like idle connection timeouts that were reset,
+// and then expires the rest the way the event loop would by waking up at each peekNext.
+// Run with: zig build run -Dpath="runtime/timer.bench.zig" -Dnet -Doptimize=ReleaseFast
+
+const TimerCounts = [_]u32{ 1_000, 10_000, 100_000, 1_000_000 };
+const MaxTimeoutMs = 60_000;
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const alloc = gpa.allocator();
+
+    std.debug.print("{s:>8} {s:>6} {s:>14} {s:>14} {s:>14} {s:>8}\n", .{ "timers", "queue", "insert (ns/op)", "cancel (ns/op)", "expire (ns/op)", "wakeups" });
+    for (TimerCounts) |n| {
+        const heap_res = try run(HeapQueue, alloc, n);
+        printResult("heap", n, heap_res);
+        const wheel_res = try run(WheelQueue, alloc, n);
+        printResult("wheel", n, wheel_res);
+    }
+}
+
+const Result = struct {
+    insert_ns: u64,
+    cancel_ns: u64,
+    expire_ns: u64,
+    wakeups: u32,
+};
+
+fn printResult(name: []const u8, n: u32, res: Result) void {
+    const num = @intToFloat(f64, n);
+    std.debug.print("{:>8} {s:>6} {d:>14.1} {d:>14.1} {d:>14.1} {:>8}\n", .{
+        n,
+        name,
+        @intToFloat(f64, res.insert_ns) / num,
+        @intToFloat(f64, res.cancel_ns) / (num / 2),
+        @intToFloat(f64, res.expire_ns) / (num / 2),
+        res.wakeups,
+    });
+}
+
+fn run(comptime Queue: type, alloc: std.mem.Allocator, n: u32) !Result {
+    var queue = Queue.init(alloc);
+    defer queue.deinit();
+
+    var prng = std.rand.DefaultPrng.init(0);
+    const rand = prng.random();
+
+    const refs = try alloc.alloc(u32, n);
+    defer alloc.free(refs);
+
+    var out = std.ArrayList(EntryRef).init(alloc);
+    defer out.deinit();
+
+    var res: Result = undefined;
+    var watch = try std.time.Timer.start();
+    var i: u32 = 0;
+    while (i < n) : (i += 1) {
+        const timeout = rand.intRangeAtMost(u32, 1, MaxTimeoutMs);
+        refs[i] = try queue.add(timeout, .{ .id = i, .seq = i });
+    }
+    res.insert_ns = watch.lap();
+
+    i = 0;
+    while (i < n) : (i += 2) {
+        queue.remove(refs[i]);
+    }
+    res.cancel_ns = watch.lap();
+
+    var num_expired: usize = 0;
+    res.wakeups = 0;
+    while (queue.peekNext()) |next| {
+        try queue.popExpired(next, &out);
+        num_expired += out.items.len;
+        out.clearRetainingCapacity();
+        res.wakeups += 1;
+    }
+    res.expire_ns = watch.lap();
+
+    if (num_expired != n / 2) {
+        std.debug.panic("expected {} expired timers, got {}", .{ n / 2, num_expired });
+    }
+    return res;
+}
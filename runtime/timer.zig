@@ -9,22 +9,32 @@ const EventDispatcher = stdx.events.EventDispatcher;
 
 const log = stdx.log.scoped(.timer);
 
+pub const TimerBackend = enum {
+    /// Binary min-heap of timeout groups. O(log n) insert and lazy cancel.
+    Heap,
+    /// Hierarchical timing wheel. O(1) insert and cancel.
+    Wheel,
+};
+
 /// High performance timer to handle large amounts of timers and callbacks.
-/// A binary min-heap is used to track the next closest timeout.
-/// A hashmap is used to lookup group nodes by timeout value.
-/// Each group node has timeouts clamped to the same millisecond with a singly linked list.
+/// Timer entries have stable ids that are returned to user code for clearTimeout.
+/// The next closest timeout is tracked by either a HeapQueue or a WheelQueue.
+/// The uv timer is only restarted if a new timeout is before the currently scheduled one.
 pub const Timer = struct {
     const Self = @This();
 
     alloc: std.mem.Allocator,
     timer: *uv.uv_timer_t,
     watch: std.time.Timer,
-    heap: std.PriorityQueue(u32, void, compare),
+    queue: TimerQueue,
 
-    // Keys are in milliseconds relative to the watch start time. (This avoids having to update the timeout.)
-    map: std.AutoHashMap(u32, GroupNode),
+    entries: stdx.ds.PooledHandleList(u32, Entry),
+
+    // Incremented for each new entry so a fired ref can be checked against an entry that reused its id.
+    next_seq: u32,
 
-    ll_buf: stdx.ds.PooledHandleSLLBuffer(u32, Node),
+    // Temporary buffer for refs that expired in processExpired.
+    fired: std.ArrayList(EntryRef),
 
     // Relative timeout in ms from watch start time that is currently set for the uv timer.
     // If a new timeout is set at or past this value, we don't need to reset the timer.
@@ -37,7 +47,7 @@ pub const Timer = struct {
     dispatcher: EventDispatcher,
 
     /// RuntimeContext must already have inited uv_loop.
-    pub fn init(self: *Self, rt: *RuntimeContext) !void {
+    pub fn init(self: *Self, rt: *RuntimeContext, backend: TimerBackend) !void {
         const alloc = rt.alloc;
         const timer = alloc.create(uv.uv_timer_t) catch unreachable;
         var res = uv.uv_timer_init(rt.uv_loop, timer);
@@ -46,10 +56,11 @@ pub const Timer = struct {
         self.* = .{
             .alloc = alloc,
             .timer = timer,
-            .heap = std.PriorityQueue(u32, void, compare).init(alloc, {}),
+            .queue = TimerQueue.init(alloc, backend),
             .watch = try std.time.Timer.start(),
-            .map = std.AutoHashMap(u32, GroupNode).init(alloc),
-            .ll_buf = stdx.ds.PooledHandleSLLBuffer(u32, Node).init(alloc),
+            .entries = stdx.ds.PooledHandleList(u32, Entry).init(alloc),
+            .next_seq = 0,
+            .fired = std.ArrayList(EntryRef).init(alloc),
             .active_timeout = std.math.maxInt(u32),
             .ctx = rt.context,
             .receiver = rt.global.toValue(),
@@ -66,129 +77,350 @@ pub const Timer = struct {
     /// Should be called after close and closing uv events have been processed.
     pub fn deinit(self: *Self) void {
         self.alloc.destroy(self.timer);
-        self.heap.deinit();
-        self.map.deinit();
-        self.ll_buf.deinit();
+        self.queue.deinit();
+        self.entries.deinit();
+        self.fired.deinit();
     }
 
     fn onTimeout(ptr: [*c]uv.uv_timer_t) callconv(.C) void {
         const timer = @ptrCast(*uv.uv_timer_t, ptr);
         const self = stdx.ptrCastAlign(*Self, timer.data);
-        self.processNext();
+        self.processExpired();
+    }
+
+    fn nowMs(self: *Self) u32 {
+        return @intCast(u32, self.watch.read() / std.time.ns_per_ms);
     }
 
     pub fn setTimeout(self: *Self, timeout_ms: u32, cb: v8.Persistent(v8.Function), cb_arg: ?v8.Persistent(v8.Value)) !u32 {
-        const now = @floatToInt(u32, @intToFloat(f32, self.watch.read()) / 1e6);
-        const abs_ms = now + timeout_ms;
+        return self.addEntry(timeout_ms, 0, cb, cb_arg);
+    }
+
+    /// An interval of 0 is clamped to 1ms so the callback can't starve the event loop.
+    pub fn setInterval(self: *Self, interval_ms: u32, cb: v8.Persistent(v8.Function), cb_arg: ?v8.Persistent(v8.Value)) !u32 {
+        const interval = std.math.max(interval_ms, 1);
+        return self.addEntry(interval, interval, cb, cb_arg);
+    }
+
+    /// Cancels a timeout or interval. Unknown or already fired ids are ignored.
+    pub fn clearTimeout(self: *Self, id: u32) void {
+        if (!self.entries.has(id)) {
+            return;
+        }
+        const entry = self.entries.getPtrNoCheck(id);
+        if (entry.queued) {
+            self.queue.remove(entry.queue_ref);
+        }
+        self.deinitEntry(id);
+    }
+
+    fn addEntry(self: *Self, timeout_ms: u32, interval_ms: u32, cb: v8.Persistent(v8.Function), cb_arg: ?v8.Persistent(v8.Value)) !u32 {
+        const seq = self.next_seq;
+        self.next_seq +%= 1;
+        const id = try self.entries.add(.{
+            .cb = cb,
+            .cb_arg = cb_arg,
+            .seq = seq,
+            .timeout = undefined,
+            .interval_ms = interval_ms,
+            .queue_ref = undefined,
+            .queued = false,
+        });
+        errdefer self.entries.remove(id);
+        try self.queueEntry(id, self.nowMs(), timeout_ms);
+        return id;
+    }
+
+    fn queueEntry(self: *Self, id: u32, now: u32, timeout_ms: u32) !void {
+        const entry = self.entries.getPtrNoCheck(id);
+        const abs_ms = now +| timeout_ms;
+        entry.timeout = abs_ms;
+        entry.queue_ref = try self.queue.add(abs_ms, .{ .id = id, .seq = entry.seq });
+        entry.queued = true;
+
+        // Check if we need to start the uv timer.
+        if (abs_ms < self.active_timeout) {
+            self.dispatcher.startTimer(self.timer, timeout_ms, onTimeout);
+            self.active_timeout = abs_ms;
+        }
+    }
+
+    fn deinitEntry(self: *Self, id: u32) void {
+        var entry = self.entries.getPtrNoCheck(id);
+        entry.cb.deinit();
+        if (entry.cb_arg) |*cb_arg| {
+            cb_arg.deinit();
+        }
+        self.entries.remove(id);
+    }
+
+    fn isValidRef(self: *Self, ref: EntryRef) bool {
+        return self.entries.has(ref.id) and self.entries.getNoCheck(ref.id).seq == ref.seq;
+    }
+
+    pub fn peekNext(self: *Self) ?u32 {
+        return self.queue.peekNext();
+    }
+
+    /// Invokes callbacks for all timeouts that have expired and schedules the uv timer for the next one.
+    pub fn processExpired(self: *Self) void {
+        const now = self.nowMs();
+        self.fired.clearRetainingCapacity();
+        self.queue.popExpired(now, &self.fired) catch unreachable;
+        // Fire in timeout order and then insertion order.
+        std.sort.sort(EntryRef, self.fired.items, self, firedLessThan);
+
+        const ctx = self.ctx.inner;
+        for (self.fired.items) |ref| {
+            // A previous callback could have cleared this entry.
+            if (!self.isValidRef(ref)) {
+                continue;
+            }
+            const entry = self.entries.getPtrNoCheck(ref.id);
+            entry.queued = false;
+            const cb = entry.cb;
+            if (entry.cb_arg) |cb_arg| {
+                _ = cb.inner.call(ctx, self.receiver, &.{ cb_arg.inner });
+            } else {
+                _ = cb.inner.call(ctx, self.receiver, &.{});
+            }
+            // The callback could have cleared this entry or added entries which invalidates the pointer.
+            if (!self.isValidRef(ref)) {
+                continue;
+            }
+            const interval_ms = self.entries.getNoCheck(ref.id).interval_ms;
+            if (interval_ms > 0) {
+                self.queueEntry(ref.id, now, interval_ms) catch unreachable;
+            } else {
+                self.deinitEntry(ref.id);
+            }
+        }
 
-        const entry = try self.map.getOrPut(abs_ms);
+        // Schedule the next timeout.
+        if (self.queue.peekNext()) |next_timeout| {
+            const rel_timeout = next_timeout -| self.nowMs();
+            self.dispatcher.startTimer(self.timer, rel_timeout, onTimeout);
+            self.active_timeout = next_timeout;
+        } else {
+            self.active_timeout = std.math.maxInt(u32);
+        }
+    }
+
+    fn firedLessThan(self: *Self, a: EntryRef, b: EntryRef) bool {
+        const a_timeout = self.entries.getNoCheck(a.id).timeout;
+        const b_timeout = self.entries.getNoCheck(b.id).timeout;
+        if (a_timeout == b_timeout) {
+            return a.seq < b.seq;
+        } else return a_timeout < b_timeout;
+    }
+};
+
+const TimerQueue = union(TimerBackend) {
+    Heap: HeapQueue,
+    Wheel: WheelQueue,
+
+    fn init(alloc: std.mem.Allocator, backend: TimerBackend) TimerQueue {
+        return switch (backend) {
+            .Heap => .{ .Heap = HeapQueue.init(alloc) },
+            .Wheel => .{ .Wheel = WheelQueue.init(alloc) },
+        };
+    }
+
+    fn deinit(self: *TimerQueue) void {
+        switch (self.*) {
+            .Heap => |*q| q.deinit(),
+            .Wheel => |*q| q.deinit(),
+        }
+    }
+
+    fn add(self: *TimerQueue, timeout: u32, ref: EntryRef) !u32 {
+        return switch (self.*) {
+            .Heap => |*q| q.add(timeout, ref),
+            .Wheel => |*q| q.add(timeout, ref),
+        };
+    }
+
+    fn remove(self: *TimerQueue, queue_ref: u32) void {
+        switch (self.*) {
+            .Heap => |*q| q.remove(queue_ref),
+            .Wheel => |*q| q.remove(queue_ref),
+        }
+    }
+
+    fn peekNext(self: *TimerQueue) ?u32 {
+        return switch (self.*) {
+            .Heap => |*q| q.peekNext(),
+            .Wheel => |*q| q.peekNext(),
+        };
+    }
+
+    fn popExpired(self: *TimerQueue, now: u32, out: *std.ArrayList(EntryRef)) !void {
+        switch (self.*) {
+            .Heap => |*q| try q.popExpired(now, out),
+            .Wheel => |*q| try q.popExpired(now, out),
+        }
+    }
+};
+
+/// Refers to a Timer entry. Since entry ids are reused, the seq is also checked before the entry is fired.
+pub const EntryRef = struct {
+    id: u32,
+    seq: u32,
+};
+
+/// A binary min-heap is used to track the next closest timeout.
+/// A hashmap is used to lookup group nodes by timeout value.
+/// Each group node has timeouts clamped to the same millisecond with a singly linked list.
+/// Nodes can't be unlinked from a singly linked list so removed nodes are only marked and skipped when their group expires.
+pub const HeapQueue = struct {
+    heap: std.PriorityQueue(u32, void, compare),
+
+    // Keys are in milliseconds relative to the watch start time. (This avoids having to update the timeout.)
+    map: std.AutoHashMap(u32, GroupNode),
+
+    ll_buf: stdx.ds.PooledHandleSLLBuffer(u32, EntryRef),
+
+    pub fn init(alloc: std.mem.Allocator) HeapQueue {
+        return .{
+            .heap = std.PriorityQueue(u32, void, compare).init(alloc, {}),
+            .map = std.AutoHashMap(u32, GroupNode).init(alloc),
+            .ll_buf = stdx.ds.PooledHandleSLLBuffer(u32, EntryRef).init(alloc),
+        };
+    }
+
+    pub fn deinit(self: *HeapQueue) void {
+        self.heap.deinit();
+        self.map.deinit();
+        self.ll_buf.deinit();
+    }
+
+    /// Returns the node id.
+    pub fn add(self: *HeapQueue, timeout: u32, ref: EntryRef) !u32 {
+        const entry = try self.map.getOrPut(timeout);
         if (!entry.found_existing) {
-            const head = try self.ll_buf.add(.{
-                .cb = cb,
-                .cb_arg = cb_arg,
-            });
+            const head = try self.ll_buf.add(ref);
             entry.value_ptr.* = .{
-                .timeout = abs_ms,
+                .timeout = timeout,
                 .head = head,
                 .last = head,
             };
-            try self.heap.add(abs_ms);
-
-            // Check if we need to start the uv timer.
-            if (abs_ms < self.active_timeout) {
-                self.dispatcher.startTimer(self.timer, timeout_ms, onTimeout);
-                self.active_timeout = abs_ms;
-            }
-
+            try self.heap.add(timeout);
             return head;
         } else {
             // Append to the last node in the list.
-            const new = try self.ll_buf.insertAfter(entry.value_ptr.last, .{
-                .cb = cb,
-                .cb_arg = cb_arg,
-            });
+            const new = try self.ll_buf.insertAfter(entry.value_ptr.last, ref);
             entry.value_ptr.last = new;
             return new;
         }
     }
 
-    pub fn peekNext(self: *Self) ?u32 {
-        return self.heap.peek();
+    pub fn remove(self: *HeapQueue, node_id: u32) void {
+        self.ll_buf.getPtrNoCheck(node_id).id = Null;
     }
 
-    pub fn processNext(self: *Self) void {
-        // Pop the next timeout.
-        const timeout = self.heap.remove();
-        const group = self.map.get(timeout).?;
-
-        const ctx = self.ctx.inner;
+    pub fn peekNext(self: *HeapQueue) ?u32 {
+        return self.heap.peek();
+    }
 
-        // Invoke each callback in order and deinit them.
-        var cur = group.head;
-        while (cur != Null) {
-            var node = self.ll_buf.getNodeNoCheck(cur);
-            if (node.data.cb_arg) |*cb_arg| {
-                _ = node.data.cb.inner.call(ctx, self.receiver, &.{ cb_arg.inner });
-                cb_arg.deinit();
-            } else {
-                _ = node.data.cb.inner.call(ctx, self.receiver, &.{});
+    pub fn popExpired(self: *HeapQueue, now: u32, out: *std.ArrayList(EntryRef)) !void {
+        while (self.heap.peek()) |timeout| {
+            if (timeout > now) {
+                break;
+            }
+            _ = self.heap.remove();
+            const group = self.map.get(timeout).?;
+            var cur = group.head;
+            while (cur != Null) {
+                const node = self.ll_buf.getNodeNoCheck(cur);
+                if (node.data.id != Null) {
+                    try out.append(node.data);
+                }
+                self.ll_buf.removeAssumeNoPrev(cur) catch unreachable;
+                cur = node.next;
             }
-            node.data.cb.deinit();
-            self.ll_buf.removeAssumeNoPrev(cur) catch unreachable;
-            cur = node.next;
+            // Remove this GroupNode.
+            if (!self.map.remove(timeout)) unreachable;
         }
+    }
+};
 
-        // Remove this GroupNode.
-        if (!self.map.remove(timeout)) unreachable;
+/// Timeouts are kept in a hierarchical timing wheel with a 1ms tick.
+/// peekNext can return the start of a higher level slot before the actual timeout so the uv timer wakes up
+/// to cascade timers down. A timeout is cascaded at most once per level.
+pub const WheelQueue = struct {
+    wheel: stdx.ds.TimerWheel(EntryRef),
 
-        // TODO: Consider processing next timeouts that have already expired.
+    pub fn init(alloc: std.mem.Allocator) WheelQueue {
+        return .{
+            .wheel = stdx.ds.TimerWheel(EntryRef).init(alloc, 0),
+        };
+    }
 
-        // Schedule the next timeout.
-        if (self.heap.len > 0) {
-            const next_timeout = self.peekNext().?;
-            const now = @floatToInt(u32, @intToFloat(f32, self.watch.read()) / 1e6);
-            var rel_timeout: u32 = undefined;
-            if (next_timeout < now) {
-                rel_timeout = 0;
-            } else {
-                rel_timeout = next_timeout - now;
-            }
+    pub fn deinit(self: *WheelQueue) void {
+        self.wheel.deinit();
+    }
 
-            self.dispatcher.startTimer(self.timer, rel_timeout, onTimeout);
-            self.active_timeout = next_timeout;
-        } else {
-            self.active_timeout = std.math.maxInt(u32);
-        }
+    /// Returns the wheel node id.
+    pub fn add(self: *WheelQueue, timeout: u32, ref: EntryRef) !u32 {
+        return self.wheel.add(timeout, ref);
+    }
+
+    pub fn remove(self: *WheelQueue, node_id: u32) void {
+        self.wheel.remove(node_id);
+    }
+
+    pub fn peekNext(self: *WheelQueue) ?u32 {
+        if (self.wheel.nextTick()) |tick| {
+            return @intCast(u32, std.math.min(tick, std.math.maxInt(u32)));
+        } else return null;
+    }
+
+    pub fn popExpired(self: *WheelQueue, now: u32, out: *std.ArrayList(EntryRef)) !void {
+        try self.wheel.advance(now, out);
     }
 };
 
+fn testQueue(comptime Queue: type) !void {
+    var queue = Queue.init(t.alloc);
+    defer queue.deinit();
+
+    var out = std.ArrayList(EntryRef).init(t.alloc);
+    defer out.deinit();
+
+    _ = try queue.add(100, .{ .id = 0, .seq = 0 });
+    _ = try queue.add(200, .{ .id = 1, .seq = 1 });
+    _ = try queue.add(0, .{ .id = 2, .seq = 2 });
+    _ = try queue.add(0, .{ .id = 3, .seq = 3 });
+    const removed = try queue.add(300, .{ .id = 4, .seq = 4 });
+    _ = try queue.add(300, .{ .id = 5, .seq = 5 });
+    queue.remove(removed);
+
+    try t.eq(queue.peekNext().?, 0);
+    try queue.popExpired(0, &out);
+    try t.eq(out.items.len, 2);
+    try t.eq(out.items[0].id, 2);
+    try t.eq(out.items[1].id, 3);
+
+    out.clearRetainingCapacity();
+    try queue.popExpired(250, &out);
+    try t.eq(out.items.len, 2);
+    try t.eq(out.items[0].id, 0);
+    try t.eq(out.items[1].id, 1);
+
+    out.clearRetainingCapacity();
+    try queue.popExpired(300, &out);
+    try t.eq(out.items.len, 1);
+    try t.eq(out.items[0].id, 5);
+    try t.eq(queue.peekNext(), null);
+}
+
 // This does not test the libuv mechanism.
-test "Timer" {
-    var rt: RuntimeContext = undefined;
-    rt.alloc = t.alloc;
-
-    var timer: Timer = undefined;
-    try timer.init(&rt);
-    defer timer.deinit();
-
-    const cb: v8.Persistent(v8.Function) = undefined;
-    _ = try timer.setTimeout(100, cb, null);
-    _ = try timer.setTimeout(200, cb, null);
-    _ = try timer.setTimeout(0, cb, null);
-    _ = try timer.setTimeout(0, cb, null);
-    _ = try timer.setTimeout(300, cb, null);
-    _ = try timer.setTimeout(300, cb, null);
-
-    const timeout = timer.peekNext().?;
-    try t.eq(timeout, 0);
-    timer.processNext();
-    try t.eq(timer.peekNext().?, 100);
-    timer.processNext();
-    try t.eq(timer.peekNext().?, 200);
-    timer.processNext();
-    try t.eq(timer.peekNext().?, 300);
-    timer.processNext();
-    try t.eq(timer.peekNext(), null);
+test "HeapQueue" {
+    try testQueue(HeapQueue);
+}
+
+test "WheelQueue" {
+    try testQueue(WheelQueue);
 }
 
 // Assume no duplicate nodes since timeouts will be grouped together.
@@ -207,7 +439,15 @@ const GroupNode = struct {
     last: u32,
 };
 
-const Node = struct {
+const Entry = struct {
     cb: v8.Persistent(v8.Function),
     cb_arg: ?v8.Persistent(v8.Value),
+    seq: u32,
+    // Absolute timeout in ms relative to the watch start time.
+    timeout: u32,
+    // Nonzero for setInterval.
+    interval_ms: u32,
+    // Node id in the timer queue.
+    queue_ref: u32,
+    queued: bool,
 };
@@ -0,0 +1,222 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const ds = stdx.ds;
+const uv = @import("uv");
+
+const work_queue = @import("work_queue.zig");
+const WorkQueue = work_queue.WorkQueue;
+const TaskResult = work_queue.TaskResult;
+
+// Compares task throughput of WorkQueue against the previous single global queue design.
+// Run with: zig build run -Dpath="runtime/work_queue.bench.zig" -Dnet -Doptimize=ReleaseFast
+
+const NumTasks = 200_000;
+const TaskSpins = 200;
+const WorkerCounts = [_]u32{ 1, 2, 4, 8, 16, 32 };
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const alloc = gpa.allocator();
+
+    var loop: uv.uv_loop_t = undefined;
+    _ = uv.uv_loop_init(&loop);
+    defer _ = uv.uv_loop_close(&loop);
+
+    std.debug.print("tasks: {}, spins per task: {}\n", .{ NumTasks, TaskSpins });
+    std.debug.print("{s:>8} {s:>16} {s:>16}\n", .{ "workers", "global (task/s)", "stealing (task/s)" });
+    for (WorkerCounts) |num_workers| {
+        const global_rate = runGlobalQueue(alloc, num_workers);
+        const stealing_rate = runWorkQueue(alloc, &loop, num_workers);
+        std.debug.print("{:>8} {d:>16.0} {d:>16.0}\n", .{ num_workers, global_rate, stealing_rate });
+    }
+}
+
+const SpinTask = struct {
+    spins: u32,
+    res: u64 = 0,
+
+    pub fn process(self: *SpinTask) !TaskResult {
+        var i: u32 = 0;
+        var acc: u64 = 0;
+        while (i < self.spins) : (i += 1) {
+            acc = acc *% 31 +% i;
+        }
+        std.mem.doNotOptimizeAway(acc);
+        self.res = acc;
+        return TaskResult.Success;
+    }
+
+    pub fn deinit(self: *SpinTask) void {
+        _ = self;
+    }
+};
+
+const Counter = struct {
+    num_done: *u32,
+};
+
+fn onSuccess(ctx: Counter, res: u64) void {
+    _ = res;
+    ctx.num_done.* += 1;
+}
+
+fn onFailure(ctx: Counter, err: anyerror) void {
+    _ = ctx;
+    stdx.panicFmt("unexpected error: {}", .{err});
+}
+
+fn runWorkQueue(alloc: std.mem.Allocator, loop: *uv.uv_loop_t, num_workers: u32) f64 {
+    var done_notify: std.Thread.ResetEvent = undefined;
+    done_notify.reset();
+
+    var queue = WorkQueue.init(alloc, loop, &done_notify);
+    var i: u32 = 0;
+    while (i < num_workers) : (i += 1) {
+        queue.createAndRunWorker();
+    }
+
+    var num_done: u32 = 0;
+    var timer = std.time.Timer.start() catch unreachable;
+    i = 0;
+    while (i < NumTasks) : (i += 1) {
+        _ = queue.addTaskWithCb(SpinTask{ .spins = TaskSpins }, Counter{ .num_done = &num_done }, onSuccess, onFailure);
+    }
+    while (queue.hasUnfinishedTasks()) {
+        done_notify.wait();
+        done_notify.reset();
+        queue.processDone();
+    }
+    const elapsed = timer.read();
+
+    for (queue.workers.items) |worker| {
+        worker.close_flag.store(true, .Release);
+        worker.wakeup.set();
+    }
+    for (queue.workers.items) |worker| {
+        while (worker.close_flag.load(.Acquire)) {}
+    }
+    queue.deinit();
+    return @intToFloat(f64, num_done) / (@intToFloat(f64, elapsed) / 1e9);
+}
+
+/// Replica of the previous WorkQueue: one global ready queue, a heap allocated node per task,
+/// a locked task lookup and every worker is woken up for each task.
+const GlobalQueue = struct {
+    alloc: std.mem.Allocator,
+    tasks_mutex: std.Thread.Mutex,
+    tasks: ds.PooledHandleList(u32, *SpinTask),
+    ready: std.atomic.Queue(u32),
+    done: std.atomic.Queue(u32),
+    done_notify: std.Thread.ResetEvent,
+    workers: std.ArrayList(*GlobalWorker),
+
+    fn addTask(self: *GlobalQueue, task: SpinTask) void {
+        const dupe = self.alloc.create(SpinTask) catch unreachable;
+        dupe.* = task;
+        var id: u32 = undefined;
+        {
+            self.tasks_mutex.lock();
+            defer self.tasks_mutex.unlock();
+            id = self.tasks.add(dupe) catch unreachable;
+        }
+        const node = self.alloc.create(std.atomic.Queue(u32).Node) catch unreachable;
+        node.data = id;
+        self.ready.put(node);
+        for (self.workers.items) |worker| {
+            worker.wakeup.set();
+        }
+    }
+
+    fn processDone(self: *GlobalQueue) u32 {
+        var num_done: u32 = 0;
+        while (self.done.get()) |n| {
+            self.tasks_mutex.lock();
+            defer self.tasks_mutex.unlock();
+            self.alloc.destroy(self.tasks.getNoCheck(n.data));
+            self.tasks.remove(n.data);
+            self.alloc.destroy(n);
+            num_done += 1;
+        }
+        return num_done;
+    }
+};
+
+const GlobalWorker = struct {
+    queue: *GlobalQueue,
+    thread: std.Thread,
+    wakeup: std.Thread.ResetEvent,
+    close_flag: std.atomic.Atomic(bool),
+
+    fn loop(self: *GlobalWorker) void {
+        while (!self.close_flag.load(.Acquire)) {
+            while (self.queue.ready.get()) |n| {
+                const id = n.data;
+                self.queue.alloc.destroy(n);
+                var task: *SpinTask = undefined;
+                {
+                    self.queue.tasks_mutex.lock();
+                    defer self.queue.tasks_mutex.unlock();
+                    task = self.queue.tasks.getNoCheck(id);
+                }
+                _ = task.process() catch unreachable;
+                const res_node = self.queue.alloc.create(std.atomic.Queue(u32).Node) catch unreachable;
+                res_node.data = id;
+                self.queue.done.put(res_node);
+                self.queue.done_notify.set();
+            }
+            self.wakeup.wait();
+            self.wakeup.reset();
+        }
+    }
+};
+
+fn runGlobalQueue(alloc: std.mem.Allocator, num_workers: u32) f64 {
+    var queue = GlobalQueue{
+        .alloc = alloc,
+        .tasks_mutex = .{},
+        .tasks = ds.PooledHandleList(u32, *SpinTask).init(alloc),
+        .ready = std.atomic.Queue(u32).init(),
+        .done = std.atomic.Queue(u32).init(),
+        .done_notify = undefined,
+        .workers = std.ArrayList(*GlobalWorker).init(alloc),
+    };
+    queue.done_notify.reset();
+    defer queue.tasks.deinit();
+    defer queue.workers.deinit();
+
+    var i: u32 = 0;
+    while (i < num_workers) : (i += 1) {
+        const worker = alloc.create(GlobalWorker) catch unreachable;
+        worker.* = .{
+            .queue = &queue,
+            .thread = undefined,
+            .wakeup = undefined,
+            .close_flag = std.atomic.Atomic(bool).init(false),
+        };
+        worker.wakeup.reset();
+        queue.workers.append(worker) catch unreachable;
+        worker.thread = std.Thread.spawn(.{}, GlobalWorker.loop, .{worker}) catch unreachable;
+    }
+
+    var num_done: u32 = 0;
+    var timer = std.time.Timer.start() catch unreachable;
+    i = 0;
+    while (i < NumTasks) : (i += 1) {
+        queue.addTask(.{ .spins = TaskSpins });
+    }
+    while (num_done < NumTasks) {
+        queue.done_notify.wait();
+        queue.done_notify.reset();
+        num_done += queue.processDone();
+    }
+    const elapsed = timer.read();
+
+    for (queue.workers.items) |worker| {
+        worker.close_flag.store(true, .Release);
+        worker.wakeup.set();
+        worker.thread.join();
+        alloc.destroy(worker);
+    }
+    return @intToFloat(f64, num_done) / (@intToFloat(f64, elapsed) / 1e9);
+}
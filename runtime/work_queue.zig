@@ -2,32 +2,66 @@ const std = @import("std");
 const stdx = @import("stdx");
 const ds = stdx.ds;
 const log = stdx.log.scoped(.work_queue);
+const t = stdx.testing;
 const builtin = @import("builtin");
 const uv = @import("uv");
 const CsError = @import("runtime.zig").CsError;
 
+/// Max number of workers. Reserved upfront so workers can read the worker list without locking.
+pub const MaxWorkers = 64;
+
+/// Capacity of each worker's local deque.
+const LocalQueueSize = 256;
+
+/// Max number of tasks a worker moves from the injector into its local deque at once.
+const InjectorBatchSize = 32;
+
+/// Tasks and callback contexts that fit in this many bytes are stored inside the task node instead of on the heap.
+const InlineTaskSize = 192;
+
+/// Number of nodes allocated at once when the node pool is empty.
+const TaskNodeChunkSize = 64;
+
+/// Slots of finished tasks are only reused once this many are free,
+/// so later tasks can still depend on a recently finished task and see whether it failed.
+/// Depending on a task whose slot was reused fails since it's no longer known whether that task failed.
+const MinFreeTaskSlots = 256;
+
 pub const WorkQueue = struct {
     const Self = @This();
 
     alloc: std.mem.Allocator,
-    tasks_mutex: std.Thread.Mutex,
-    tasks: ds.PooledHandleList(TaskId, TaskInfo),
+
+    // Task nodes are only acquired and released by the main thread.
+    node_pool: TaskNodePool,
+
+    // Maps task ids to their nodes so later tasks can depend on them.
+    // Only accessed by the main thread.
+    tasks: TaskTable,
 
     // Allocate the worker on the heap for now so the worker thread doesn't have to query for it.
+    // Capacity is reserved for MaxWorkers at init so other workers can steal without a lock.
     workers: std.ArrayList(*Worker),
+    num_workers: std.atomic.Atomic(u32),
 
-    // Tasks in the ready queue can be picked up for work; their parent tasks have already completed.
-    ready: std.atomic.Queue(TaskId),
+    // Tasks submitted by the main thread are first put into the injector.
+    // Workers take them out in batches and move them into their own local deques where they can be stolen by idle workers.
+    // Tasks in the injector can be picked up for work; their parent tasks have already completed.
+    injector: Injector,
 
-    // Done queue holds tasks that have completed but haven't taken post steps (invoking callbacks and resolving deps)
+    // Done stack holds tasks that have completed but haven't taken post steps (invoking callbacks and resolving deps)
     // This let's the main thread process them all without needing thread locks.
-    done: std.atomic.Queue(TaskResultInfo),
+    done: DoneStack,
 
     // When workers have processed a task and added to done, wakeup event is set.
     // Must refer to the same memory address.
     done_notify: *std.Thread.ResetEvent,
 
-    /// A task isn't finished until it's been taken from the ready queue, processed by a worker, moved to done, 
+    // Workers that are waiting for new tasks. Only one is woken up for each submitted task.
+    idle_mutex: std.Thread.Mutex,
+    idle_workers: std.ArrayListUnmanaged(*Worker),
+
+    /// A task isn't finished until it's been taken from a queue, processed by a worker, moved to done,
     /// and post-processed by the main thread again.
     num_unfinished_tasks: u32,
 
@@ -37,12 +71,15 @@ pub const WorkQueue = struct {
     pub fn init(alloc: std.mem.Allocator, uv_loop: *uv.uv_loop_t, done_notify: *std.Thread.ResetEvent) Self {
         var new = Self{
             .alloc = alloc,
-            .tasks_mutex = std.Thread.Mutex{},
-            .tasks = ds.PooledHandleList(TaskId, TaskInfo).init(alloc),
-            .ready = std.atomic.Queue(TaskId).init(),
-            .done = std.atomic.Queue(TaskResultInfo).init(),
-            .workers = std.ArrayList(*Worker).init(alloc),
+            .node_pool = TaskNodePool.init(alloc),
+            .tasks = TaskTable.init(alloc),
+            .injector = Injector.init(),
+            .done = DoneStack.init(),
+            .workers = std.ArrayList(*Worker).initCapacity(alloc, MaxWorkers) catch unreachable,
+            .num_workers = std.atomic.Atomic(u32).init(0),
             .done_notify = done_notify,
+            .idle_mutex = std.Thread.Mutex{},
+            .idle_workers = std.ArrayListUnmanaged(*Worker).initCapacity(alloc, MaxWorkers) catch unreachable,
             .uv_loop = uv_loop,
             .num_unfinished_tasks = 0,
         };
@@ -50,29 +87,22 @@ pub const WorkQueue = struct {
     }
 
     pub fn deinit(self: *Self) void {
-        // Consume the tasks.
-        while (self.done.get()) |n| {
-            self.alloc.destroy(n);
-        }
-        while (self.ready.get()) |n| {
-            self.alloc.destroy(n);
-        }
-
-        {
-            self.tasks_mutex.lock();
-            defer self.tasks_mutex.unlock();
-            var iter = self.tasks.iterator();
-            while (iter.next()) |task| {
-                task.deinit(self.alloc);
+        // Deinit any tasks that never finished.
+        var iter = self.node_pool.iterator();
+        while (iter.next()) |node| {
+            if (node.in_use) {
+                node.info.deinit(self.alloc);
             }
-            self.tasks.deinit();
         }
+        self.node_pool.deinit();
+        self.tasks.deinit();
 
         for (self.workers.items) |worker| {
             worker.deinit();
             self.alloc.destroy(worker);
         }
         self.workers.deinit();
+        self.idle_workers.deinit(self.alloc);
     }
 
     /// Should only be called by the main thread.
@@ -80,65 +110,147 @@ pub const WorkQueue = struct {
         return self.num_unfinished_tasks > 0;
     }
 
-    fn getTaskInfo(self: *Self, id: TaskId) TaskInfo {
-        self.tasks_mutex.lock();
-        defer self.tasks_mutex.unlock();
-        return self.tasks.getNoCheck(id);
-    }
-
     pub fn createAndRunWorker(self: *Self) void {
+        if (self.workers.items.len == MaxWorkers) {
+            stdx.panicFmt("Exceeded max workers: {}", .{MaxWorkers});
+        }
         const worker = self.alloc.create(Worker) catch unreachable;
-        worker.init(self);
-        self.workers.append(worker) catch unreachable;
+        worker.init(self, @intCast(u32, self.workers.items.len));
+        self.workers.appendAssumeCapacity(worker);
+        self.num_workers.store(@intCast(u32, self.workers.items.len), .Release);
         const thread = std.Thread.spawn(.{}, Worker.loop, .{worker}) catch unreachable;
         worker.thread = thread;
     }
 
+    /// Adds a task without callbacks. Useful for intermediate steps in a task graph.
+    /// The task only becomes ready once every task in deps has finished.
+    pub fn addTask(self: *Self, task: anytype, deps: []const TaskId) TaskId {
+        const Task = @TypeOf(task);
+        const Storage = TaskStorage(Task, void);
+
+        const node = self.node_pool.acquire();
+        const storage = if (Storage.IsInline) stdx.ptrCastAlign(*Storage, &node.inline_buf) else self.alloc.create(Storage) catch unreachable;
+        storage.* = .{
+            .task = task,
+            .ctx = {},
+        };
+        node.info = TaskInfo.init(Task, storage);
+        return self.submitNode(node, deps);
+    }
+
     pub fn addTaskWithCb(self: *Self,
         task: anytype,
         ctx: anytype,
         comptime success_cb: fn (@TypeOf(ctx), TaskOutput(@TypeOf(task))) void,
         comptime failure_cb: fn (@TypeOf(ctx), anyerror) void,
-    ) void {
-        self.num_unfinished_tasks += 1;
+    ) TaskId {
+        return self.addTaskWithCbAndDeps(task, ctx, success_cb, failure_cb, &.{});
+    }
 
+    /// The task only becomes ready once every task in deps has finished.
+    /// Deps that already finished are satisfied, but resolveDep is only invoked for deps that finish after the task is added.
+    /// The task fails with error.DependencyExpired if a dep finished so long ago that its outcome was dropped.
+    /// Any id returned by the WorkQueue during the same main thread tick is still unfinished since tasks are only finished in processDone.
+    /// If a dep fails, the task is not processed and finishes with error.DependencyFailed.
+    pub fn addTaskWithCbAndDeps(self: *Self,
+        task: anytype,
+        ctx: anytype,
+        comptime success_cb: fn (@TypeOf(ctx), TaskOutput(@TypeOf(task))) void,
+        comptime failure_cb: fn (@TypeOf(ctx), anyerror) void,
+        deps: []const TaskId,
+    ) TaskId {
         const Task = @TypeOf(task);
-        const task_dupe = self.alloc.create(Task) catch unreachable;
-        task_dupe.* = task;
-
-        const ctx_dupe = self.alloc.create(@TypeOf(ctx)) catch unreachable;
-        ctx_dupe.* = ctx;
+        const Context = @TypeOf(ctx);
+        const Storage = TaskStorage(Task, Context);
+
+        const node = self.node_pool.acquire();
+        const storage = if (Storage.IsInline) stdx.ptrCastAlign(*Storage, &node.inline_buf) else self.alloc.create(Storage) catch unreachable;
+        storage.* = .{
+            .task = task,
+            .ctx = ctx,
+        };
+        node.info = TaskInfo.initWithCb(Task, Context, storage, success_cb, failure_cb);
+        return self.submitNode(node, deps);
+    }
 
-        const task_info = TaskInfo.initWithCb(Task, task_dupe, ctx_dupe, success_cb, failure_cb);
-        var task_id: TaskId = undefined;
-        {
-            self.tasks_mutex.lock();
-            defer self.tasks_mutex.unlock();
-            task_id = self.tasks.add(task_info) catch unreachable;
+    fn submitNode(self: *Self, node: *TaskNode, deps: []const TaskId) TaskId {
+        self.num_unfinished_tasks += 1;
+        node.id = self.tasks.add(node);
+        node.num_pending_deps = 0;
+        node.dep_err = null;
+        for (deps) |dep_id| {
+            switch (self.tasks.getState(dep_id)) {
+                .Unfinished => |dep| {
+                    dep.dependents.append(self.alloc, node) catch unreachable;
+                    node.num_pending_deps += 1;
+                },
+                .Failed => node.dep_err = error.DependencyFailed,
+                .Expired => {
+                    if (node.dep_err == null) {
+                        node.dep_err = error.DependencyExpired;
+                    }
+                },
+                .Succeeded => {},
+            }
+        }
+        if (node.num_pending_deps == 0) {
+            if (node.dep_err) |err| {
+                // Fail through the done stack so callbacks are still only invoked from processDone.
+                node.result = .{ .Failure = err };
+                self.addTaskResult(node);
+            } else {
+                self.addReadyTaskAndNotify(node);
+            }
         }
+        return node.id;
+    }
 
-        self.addReadyTaskAndNotify(task_id);
+    fn addReadyTaskAndNotify(self: *Self, node: *TaskNode) void {
+        self.injector.push(node);
+        self.wakeOneWorker();
     }
 
-    fn addReadyTaskAndNotify(self: *Self, task_id: TaskId) void {
-        const task_node = self.alloc.create(std.atomic.Queue(TaskId).Node) catch unreachable;
-        task_node.data = task_id;
+    /// Wakes up an idle worker if there is one. Busy workers will check the queues again before going idle.
+    fn wakeOneWorker(self: *Self) void {
+        var worker: ?*Worker = null;
+        {
+            self.idle_mutex.lock();
+            defer self.idle_mutex.unlock();
+            worker = self.idle_workers.popOrNull();
+            if (worker) |w| {
+                w.idle = false;
+            }
+        }
+        if (worker) |w| {
+            w.wakeup.set();
+        }
+    }
 
-        self.ready.put(task_node);
+    fn markWorkerIdle(self: *Self, worker: *Worker) void {
+        self.idle_mutex.lock();
+        defer self.idle_mutex.unlock();
+        worker.idle = true;
+        self.idle_workers.appendAssumeCapacity(worker);
+    }
 
-        for (self.workers.items) |worker| {
-            worker.wakeup.set();
+    fn unmarkWorkerIdle(self: *Self, worker: *Worker) void {
+        self.idle_mutex.lock();
+        defer self.idle_mutex.unlock();
+        if (worker.idle) {
+            worker.idle = false;
+            for (self.idle_workers.items) |it, i| {
+                if (it == worker) {
+                    _ = self.idle_workers.swapRemove(i);
+                    break;
+                }
+            }
         }
     }
 
     /// Workers submit their results through this method.
-    fn addTaskResult(self: *Self, res: TaskResultInfo) void {
+    fn addTaskResult(self: *Self, node: *TaskNode) void {
         // log.debug("task done processing", .{});
-
-        // TODO: Ensure allocator is thread safe or use our own array list with lock.
-        const res_node = self.alloc.create(std.atomic.Queue(TaskResultInfo).Node) catch unreachable;
-        res_node.data = res;
-        self.done.put(res_node);
+        self.done.push(node);
 
         // Notify that we have done tasks.
         self.done_notify.set();
@@ -146,48 +258,72 @@ pub const WorkQueue = struct {
 
     /// Should be called by the main thread to process done and dispatch subsequent tasks.
     pub fn processDone(self: *Self) void {
-        while (self.done.get()) |n| {
+        var cur = self.done.popAll();
+        while (cur) |node| {
             // log.debug("processed done task", .{});
-            const task_id = n.data.task_id;
-
-            // We don't need to acquire the tasks lock here since only the main thread (same thread) can modify it.
-            const task_info = self.tasks.getNoCheck(task_id);
-            switch (n.data.result) {
-                .Success => {
-                    if (task_info.has_cb) {
-                        task_info.invokeSuccessCallback();
-                    }
-                    task_info.deinit(self.alloc);
-                },
-                .Failure => |res| {
-                    if (task_info.has_cb) {
-                        task_info.invokeFailureCallback(res);
-                    }
-                    task_info.deinit(self.alloc);
-                },
-                .Requeue => |res| {
-                    // TODO: Allocate into dense array.
-                    const handle = self.alloc.create(TaskTimer) catch unreachable;
-                    handle.super.data = self;
-
-                    _ = uv.uv_timer_init(self.uv_loop, &handle.super);
-                    _ = uv.uv_timer_start(&handle.super, onTaskTimer, res.delay_ms, 0);
-                },
+            cur = node.next;
+
+            if (node.result == .Requeue) {
+                // The task is still unfinished until it's processed again.
+                // TODO: Allocate into dense array.
+                const handle = self.alloc.create(TaskTimer) catch unreachable;
+                handle.super.data = self;
+                handle.node = node;
+
+                _ = uv.uv_timer_init(self.uv_loop, &handle.super);
+                _ = uv.uv_timer_start(&handle.super, onTaskTimer, node.result.Requeue.delay_ms, 0);
+                continue;
             }
-            self.alloc.destroy(n);
+            self.finishTask(node);
+        }
+    }
 
-            self.tasks_mutex.lock();
-            defer self.tasks_mutex.unlock();
-            self.tasks.remove(task_id);
+    /// Invokes callbacks, resolves dependents and releases the task.
+    fn finishTask(self: *Self, node: *TaskNode) void {
+        switch (node.result) {
+            .Success => {
+                if (node.info.has_cb) {
+                    node.info.invokeSuccessCallback();
+                }
+            },
+            .Failure => |err| {
+                if (node.info.has_cb) {
+                    node.info.invokeFailureCallback(err);
+                }
+            },
+            .Requeue => unreachable,
+        }
 
-            self.num_unfinished_tasks -= 1;
+        for (node.dependents.items) |dependent| {
+            if (node.result == .Success) {
+                dependent.info.task.resolveDep(node.info.task);
+            } else {
+                dependent.dep_err = error.DependencyFailed;
+            }
+            dependent.num_pending_deps -= 1;
+            if (dependent.num_pending_deps == 0) {
+                if (dependent.dep_err) |err| {
+                    // Skip processing and fail the dependent along with its own dependents.
+                    dependent.result = .{ .Failure = err };
+                    self.finishTask(dependent);
+                } else {
+                    self.addReadyTaskAndNotify(dependent);
+                }
+            }
         }
+        node.dependents.clearRetainingCapacity();
+
+        node.info.deinit(self.alloc);
+        self.tasks.finish(node.id, node.result == .Failure);
+        self.node_pool.release(node);
+
+        self.num_unfinished_tasks -= 1;
     }
 
     fn onTaskTimer(ptr: [*c]uv.uv_timer_t) callconv(.C) void {
         const timer = @ptrCast(*TaskTimer, ptr);
         const self = stdx.ptrCastAlign(*Self, timer.super.data);
-        self.addReadyTaskAndNotify(timer.task_id);
+        self.addReadyTaskAndNotify(timer.node);
         uv.uv_close(@ptrCast(*uv.uv_handle_t, ptr), onCloseTaskTimer);
     }
 
@@ -200,7 +336,91 @@ pub const WorkQueue = struct {
 
 const TaskTimer = struct {
     super: uv.uv_timer_t,
-    task_id: TaskId,
+    node: *TaskNode,
+};
+
+/// The generation distinguishes a finished task from a newer task that reuses its slot.
+pub const TaskId = struct {
+    idx: u32,
+    gen: u32,
+};
+
+const TaskState = union(enum) {
+    Unfinished: *TaskNode,
+    Succeeded: void,
+    Failed: void,
+    // The task finished and its slot has since been reused so its outcome is no longer known.
+    Expired: void,
+};
+
+/// Slots for submitted tasks indexed by TaskId.idx. A slot keeps the outcome of its last task after it finishes.
+/// Only accessed by the main thread.
+const TaskTable = struct {
+    const Self = @This();
+
+    alloc: std.mem.Allocator,
+    slots: std.ArrayListUnmanaged(TaskSlot),
+    // Reused in the order they were freed.
+    free_slots: std.fifo.LinearFifo(u32, .Dynamic),
+
+    const TaskSlot = struct {
+        gen: u32,
+        // Null once the task has finished.
+        node: ?*TaskNode,
+        failed: bool,
+    };
+
+    fn init(alloc: std.mem.Allocator) Self {
+        return .{
+            .alloc = alloc,
+            .slots = .{},
+            .free_slots = std.fifo.LinearFifo(u32, .Dynamic).init(alloc),
+        };
+    }
+
+    fn deinit(self: *Self) void {
+        self.slots.deinit(self.alloc);
+        self.free_slots.deinit();
+    }
+
+    fn add(self: *Self, node: *TaskNode) TaskId {
+        if (self.free_slots.readableLength() > MinFreeTaskSlots) {
+            const idx = self.free_slots.readItem().?;
+            const slot = &self.slots.items[idx];
+            slot.gen +%= 1;
+            slot.node = node;
+            slot.failed = false;
+            return .{ .idx = idx, .gen = slot.gen };
+        }
+        const idx = @intCast(u32, self.slots.items.len);
+        self.slots.append(self.alloc, .{
+            .gen = 0,
+            .node = node,
+            .failed = false,
+        }) catch unreachable;
+        return .{ .idx = idx, .gen = 0 };
+    }
+
+    fn finish(self: *Self, id: TaskId, failed: bool) void {
+        const slot = &self.slots.items[id.idx];
+        slot.node = null;
+        slot.failed = failed;
+        self.free_slots.writeItem(id.idx) catch unreachable;
+    }
+
+    fn getState(self: Self, id: TaskId) TaskState {
+        if (id.idx >= self.slots.items.len) {
+            stdx.panicFmt("Invalid task id: {}", .{id});
+        }
+        const slot = self.slots.items[id.idx];
+        if (slot.gen != id.gen) {
+            return .Expired;
+        }
+        if (slot.node) |node| {
+            return .{ .Unfinished = node };
+        }
+        return if (slot.failed) .Failed else .Succeeded;
+    }
 };
 
 pub fn TaskOutput(comptime Task: type) type {
@@ -212,7 +432,203 @@ pub fn TaskOutput(comptime Task: type) type {
     }
 }
 
+/// Holds the task and callback context together. Stored inline in the TaskNode if it fits.
+fn TaskStorage(comptime Task: type, comptime Context: type) type {
+    return struct {
+        const IsInline = @sizeOf(@This()) <= InlineTaskSize and @alignOf(@This()) <= 16;
+
+        task: Task,
+        ctx: Context,
+    };
+}
+
+/// A submitted task travels through the injector, a worker's local deque, and the done stack as the same node.
+/// The next link is reused by whichever intrusive list currently holds the node.
+const TaskNode = struct {
+    next: ?*TaskNode,
+    id: TaskId,
+    info: TaskInfo,
+    result: TaskResult,
+    in_use: bool,
+
+    // Task graph state, only accessed by the main thread.
+    // The node's capacity for dependents is kept when it's released back to the pool.
+    dependents: std.ArrayListUnmanaged(*TaskNode),
+    num_pending_deps: u32,
+    dep_err: ?anyerror,
+
+    inline_buf: [InlineTaskSize]u8 align(16),
+};
+
+/// Pool of task nodes so that submitting a task doesn't need to allocate once the pool is warmed up.
+/// Only accessed by the main thread.
+const TaskNodePool = struct {
+    const Self = @This();
+
+    alloc: std.mem.Allocator,
+    chunks: std.ArrayListUnmanaged([]TaskNode),
+    free: ?*TaskNode,
+
+    fn init(alloc: std.mem.Allocator) Self {
+        return .{
+            .alloc = alloc,
+            .chunks = .{},
+            .free = null,
+        };
+    }
+
+    fn deinit(self: *Self) void {
+        for (self.chunks.items) |chunk| {
+            for (chunk) |*node| {
+                node.dependents.deinit(self.alloc);
+            }
+            self.alloc.free(chunk);
+        }
+        self.chunks.deinit(self.alloc);
+    }
+
+    fn acquire(self: *Self) *TaskNode {
+        if (self.free == null) {
+            const chunk = self.alloc.alloc(TaskNode, TaskNodeChunkSize) catch unreachable;
+            self.chunks.append(self.alloc, chunk) catch unreachable;
+            for (chunk) |*node| {
+                node.in_use = false;
+                node.dependents = .{};
+                node.next = self.free;
+                self.free = node;
+            }
+        }
+        const node = self.free.?;
+        self.free = node.next;
+        node.next = null;
+        node.in_use = true;
+        return node;
+    }
+
+    fn release(self: *Self, node: *TaskNode) void {
+        node.in_use = false;
+        node.next = self.free;
+        self.free = node;
+    }
+
+    fn iterator(self: *Self) Iterator {
+        return .{
+            .pool = self,
+            .chunk_idx = 0,
+            .node_idx = 0,
+        };
+    }
+
+    const Iterator = struct {
+        pool: *TaskNodePool,
+        chunk_idx: u32,
+        node_idx: u32,
+
+        fn next(self: *Iterator) ?*TaskNode {
+            if (self.chunk_idx == self.pool.chunks.items.len) {
+                return null;
+            }
+            const node = &self.pool.chunks.items[self.chunk_idx][self.node_idx];
+            self.node_idx += 1;
+            if (self.node_idx == TaskNodeChunkSize) {
+                self.node_idx = 0;
+                self.chunk_idx += 1;
+            }
+            return node;
+        }
+    };
+};
+
+/// FIFO of submitted tasks. The lock is only held to link or unlink nodes and workers take nodes out in batches.
+const Injector = struct {
+    const Self = @This();
+
+    mutex: std.Thread.Mutex,
+    head: ?*TaskNode,
+    tail: ?*TaskNode,
+    len: std.atomic.Atomic(u32),
+
+    fn init() Self {
+        return .{
+            .mutex = std.Thread.Mutex{},
+            .head = null,
+            .tail = null,
+            .len = std.atomic.Atomic(u32).init(0),
+        };
+    }
+
+    fn push(self: *Self, node: *TaskNode) void {
+        node.next = null;
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (self.tail) |tail| {
+            tail.next = node;
+        } else {
+            self.head = node;
+        }
+        self.tail = node;
+        _ = self.len.fetchAdd(1, .Release);
+    }
+
+    /// Returns the first task and moves up to InjectorBatchSize more into the local deque.
+    fn popBatch(self: *Self, local: *ds.WorkStealingDeque(*TaskNode)) ?*TaskNode {
+        // Skip the lock when there is nothing to take.
+        if (self.len.load(.Acquire) == 0) {
+            return null;
+        }
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        const first = self.head orelse return null;
+        self.head = first.next;
+        var num_taken: u32 = 1;
+        while (num_taken <= InjectorBatchSize) : (num_taken += 1) {
+            const node = self.head orelse break;
+            local.push(node) catch break;
+            self.head = node.next;
+        }
+        if (self.head == null) {
+            self.tail = null;
+        }
+        _ = self.len.fetchSub(num_taken, .Release);
+        return first;
+    }
+};
+
+/// Lock-free stack that any worker can push to. The main thread takes the whole stack at once.
+const DoneStack = struct {
+    const Self = @This();
+
+    head: std.atomic.Atomic(?*TaskNode),
+
+    fn init() Self {
+        return .{
+            .head = std.atomic.Atomic(?*TaskNode).init(null),
+        };
+    }
+
+    fn push(self: *Self, node: *TaskNode) void {
+        var head = self.head.load(.Monotonic);
+        while (true) {
+            node.next = head;
+            head = self.head.tryCompareAndSwap(head, node, .Release, .Monotonic) orelse return;
+        }
+    }
+
+    /// Returns the done nodes in the order they were completed.
+    fn popAll(self: *Self) ?*TaskNode {
+        var cur = self.head.swap(null, .Acquire);
+        var reversed: ?*TaskNode = null;
+        while (cur) |node| {
+            cur = node.next;
+            node.next = reversed;
+            reversed = node;
+        }
+        return reversed;
+    }
+};
+
 // A thread is tied to a worker which simply requests the next task to work on.
+// Workers first look in their local deque, then the injector, and finally steal from other workers.
 const Worker = struct {
     const Self = @This();
 
@@ -220,15 +636,29 @@ const Worker = struct {
 
     queue: *WorkQueue,
 
+    id: u32,
+
+    local: ds.WorkStealingDeque(*TaskNode),
+
     wakeup: std.Thread.ResetEvent,
 
+    // Guarded by WorkQueue.idle_mutex.
+    idle: bool,
+
+    // Used to pick a random victim to steal from.
+    rand: std.rand.DefaultPrng,
+
     close_flag: std.atomic.Atomic(bool),
 
-    fn init(self: *Self, queue: *WorkQueue) void {
+    fn init(self: *Self, queue: *WorkQueue, id: u32) void {
         self.* = .{
             .thread = undefined,
             .queue = queue,
+            .id = id,
+            .local = ds.WorkStealingDeque(*TaskNode).init(queue.alloc, LocalQueueSize) catch unreachable,
             .wakeup = undefined,
+            .idle = false,
+            .rand = std.rand.DefaultPrng.init(id),
             .close_flag = std.atomic.Atomic(bool).init(false),
         };
         self.wakeup.reset();
@@ -236,6 +666,54 @@ const Worker = struct {
 
     fn deinit(self: *Self) void {
         self.thread.detach();
+        self.local.deinit();
+    }
+
+    fn findTask(self: *Self) ?*TaskNode {
+        if (self.local.pop()) |node| {
+            return node;
+        }
+        if (self.queue.injector.popBatch(&self.local)) |node| {
+            if (self.local.size() > 0) {
+                // There is more work than this worker can do right now, let another worker steal from us.
+                self.queue.wakeOneWorker();
+            }
+            return node;
+        }
+        return self.steal();
+    }
+
+    fn steal(self: *Self) ?*TaskNode {
+        const num_workers = self.queue.num_workers.load(.Acquire);
+        if (num_workers <= 1) {
+            return null;
+        }
+        const start = self.rand.random().uintLessThan(u32, num_workers);
+        var i: u32 = 0;
+        while (i < num_workers) : (i += 1) {
+            const victim = self.queue.workers.items.ptr[(start + i) % num_workers];
+            if (victim == self) {
+                continue;
+            }
+            while (true) {
+                switch (victim.local.steal()) {
+                    .Item => |node| return node,
+                    .Retry => continue,
+                    .Empty => break,
+                }
+            }
+        }
+        return null;
+    }
+
+    fn process(self: *Self, node: *TaskNode) void {
+        // log.debug("Worker on thread: {} received work", .{std.Thread.getCurrentId()});
+        if (node.info.task.process()) |res| {
+            node.result = res;
+        } else |err| {
+            node.result = .{ .Failure = err };
+        }
+        self.queue.addTaskResult(node);
     }
 
     fn loop(self: *Self) void {
@@ -244,28 +722,23 @@ const Worker = struct {
                 break;
             }
 
-            while (self.queue.ready.get()) |n| {
-                // log.debug("Worker on thread: {} received work", .{std.Thread.getCurrentId()});
-                const task_id = n.data;
-                self.queue.alloc.destroy(n);
-
-                const task_info = self.queue.getTaskInfo(task_id);
-
-                if (task_info.task.process()) |res| {
-                    self.queue.addTaskResult(.{
-                        .task_id = task_id,
-                        .result = res,
-                    });
-                } else |err| {
-                    self.queue.addTaskResult(.{
-                        .task_id = task_id,
-                        .result = .{ .Failure = err },
-                    });
-                }
+            if (self.findTask()) |node| {
+                self.process(node);
+                continue;
             }
+
+            // Register as idle before checking the queues one more time so a task added in between still wakes us up.
+            self.queue.markWorkerIdle(self);
+            if (self.findTask()) |node| {
+                self.queue.unmarkWorkerIdle(self);
+                self.process(node);
+                continue;
+            }
+
             // Wait until the next task is added.
             self.wakeup.wait();
             self.wakeup.reset();
+            self.queue.unmarkWorkerIdle(self);
         }
 
         // Reuse flag to indicate the thread is done.
@@ -273,8 +746,6 @@ const Worker = struct {
     }
 };
 
-const TaskId = u32;
-
 const TaskInfo = struct {
     const Self = @This();
 
@@ -288,11 +759,11 @@ const TaskInfo = struct {
 
     has_cb: bool,
 
-    fn initWithCb(comptime TaskImpl: type, task_ptr: *TaskImpl, ctx_ptr: anytype,
-        comptime success_cb: fn (std.meta.Child(@TypeOf(ctx_ptr)), TaskOutput(TaskImpl)) void,
-        comptime failure_cb: fn (std.meta.Child(@TypeOf(ctx_ptr)), anyerror) void,
+    fn initWithCb(comptime TaskImpl: type, comptime Context: type, storage: *TaskStorage(TaskImpl, Context),
+        comptime success_cb: fn (Context, TaskOutput(TaskImpl)) void,
+        comptime failure_cb: fn (Context, anyerror) void,
     ) Self {
-        const Context = std.meta.Child(@TypeOf(ctx_ptr));
+        const Storage = TaskStorage(TaskImpl, Context);
         const gen = struct {
             fn success_cb(_ctx_ptr: *anyopaque, ptr: *anyopaque) void {
                 const ctx = stdx.ptrCastAlign(*Context, _ctx_ptr);
@@ -312,15 +783,15 @@ const TaskInfo = struct {
 
             fn deinit(self: Self, alloc: std.mem.Allocator) void {
                 self.task.deinit();
-                const orig_ptr = stdx.ptrCastAlign(*TaskImpl, self.task.ptr);
-                alloc.destroy(orig_ptr);
-                const orig_ctx_ptr = stdx.ptrCastAlign(*Context, self.cb_ctx_ptr);
-                alloc.destroy(orig_ctx_ptr);
+                if (!Storage.IsInline) {
+                    const orig_ptr = stdx.ptrCastAlign(*TaskImpl, self.task.ptr);
+                    alloc.destroy(@fieldParentPtr(Storage, "task", orig_ptr));
+                }
             }
         };
         return .{
-            .task = TaskIface.init(task_ptr),
-            .cb_ctx_ptr = ctx_ptr,
+            .task = TaskIface.init(&storage.task),
+            .cb_ctx_ptr = &storage.ctx,
             .success_cb = gen.success_cb,
             .failure_cb = gen.failure_cb,
             .deinit_fn = gen.deinit,
@@ -328,6 +799,27 @@ const TaskInfo = struct {
         };
     }
 
+    fn init(comptime TaskImpl: type, storage: *TaskStorage(TaskImpl, void)) Self {
+        const Storage = TaskStorage(TaskImpl, void);
+        const gen = struct {
+            fn deinit(self: Self, alloc: std.mem.Allocator) void {
+                self.task.deinit();
+                if (!Storage.IsInline) {
+                    const orig_ptr = stdx.ptrCastAlign(*TaskImpl, self.task.ptr);
+                    alloc.destroy(@fieldParentPtr(Storage, "task", orig_ptr));
+                }
+            }
+        };
+        return .{
+            .task = TaskIface.init(&storage.task),
+            .cb_ctx_ptr = undefined,
+            .success_cb = undefined,
+            .failure_cb = undefined,
+            .deinit_fn = gen.deinit,
+            .has_cb = false,
+        };
+    }
+
     fn deinit(self: Self, alloc: std.mem.Allocator) void {
         self.deinit_fn(self, alloc);
     }
@@ -346,6 +838,8 @@ const TaskIface = struct {
     const VTable = struct {
         process: fn (ptr: *anyopaque) anyerror!TaskResult,
         deinit: fn (ptr: *anyopaque) void,
+        resolve_dep: ?fn (ptr: *anyopaque, dep: TaskDep) void,
+        type_name: []const u8,
     };
 
     ptr: *anyopaque,
@@ -359,6 +853,8 @@ const TaskIface = struct {
             const vtable = VTable{
                 .process = _process,
                 .deinit = _deinit,
+                .resolve_dep = if (@hasDecl(Impl, "resolveDep")) _resolveDep else null,
+                .type_name = @typeName(Impl),
             };
             fn _process(ptr: *anyopaque) anyerror!TaskResult {
                 const self = stdx.ptrCastAlign(ImplPtr, ptr);
@@ -368,6 +864,10 @@ const TaskIface = struct {
                 const self = stdx.ptrCastAlign(ImplPtr, ptr);
                 return @call(.{ .modifier = .always_inline }, Impl.deinit, .{ self });
             }
+            fn _resolveDep(ptr: *anyopaque, dep: TaskDep) void {
+                const self = stdx.ptrCastAlign(ImplPtr, ptr);
+                return @call(.{ .modifier = .always_inline }, Impl.resolveDep, .{ self, dep });
+            }
         };
         return .{
             .ptr = impl_ptr,
@@ -382,11 +882,37 @@ const TaskIface = struct {
     fn deinit(self: Self) void {
         self.vtable.deinit(self.ptr);
     }
+
+    /// Hands a successfully processed dep to the task if it implements resolveDep.
+    fn resolveDep(self: Self, dep: Self) void {
+        if (self.vtable.resolve_dep) |resolve_dep| {
+            resolve_dep(self.ptr, .{
+                .ptr = dep.ptr,
+                .type_name = dep.vtable.type_name,
+            });
+        }
+    }
 };
 
-const TaskResultInfo = struct {
-    task_id: TaskId,
-    result: TaskResult,
+/// A finished dependency passed to a dependent task's resolveDep on the main thread before the dependent is queued.
+/// The dep is deinited afterwards so the dependent should take ownership of any result it needs,
+/// eg. `const read = dep.cast(ReadFileTask); self.data = read.res; read.res = null;`
+pub const TaskDep = struct {
+    ptr: *anyopaque,
+    type_name: []const u8,
+
+    pub fn is(self: TaskDep, comptime Task: type) bool {
+        return std.mem.eql(u8, self.type_name, @typeName(Task));
+    }
+
+    pub fn cast(self: TaskDep, comptime Task: type) *Task {
+        if (builtin.mode == .Debug) {
+            if (!self.is(Task)) {
+                stdx.panicFmt("Expected dep {s}, got {s}", .{ @typeName(Task), self.type_name });
+            }
+        }
+        return stdx.ptrCastAlign(*Task, self.ptr);
+    }
 };
 
 pub const TaskResult = union(enum) {
@@ -399,4 +925,151 @@ pub const TaskResult = union(enum) {
     Requeue: struct {
         delay_ms: u32
     },
-};
\ No newline at end of file
+};
+
+const TestTask = struct {
+    order: *std.atomic.Atomic(u32),
+    fail: bool = false,
+    // Order in which the task was processed.
+    res: u32 = 0,
+
+    pub fn process(self: *TestTask) !TaskResult {
+        if (self.fail) {
+            return error.TestFailed;
+        }
+        self.res = self.order.fetchAdd(1, .SeqCst);
+        return TaskResult.Success;
+    }
+
+    pub fn deinit(self: *TestTask) void {
+        _ = self;
+    }
+};
+
+const TestResults = struct {
+    order: [5]?u32 = .{ null, null, null, null, null },
+    err: [5]?anyerror = .{ null, null, null, null, null },
+};
+
+const TestCtx = struct {
+    results: *TestResults,
+    idx: u32,
+
+    fn onSuccess(self: TestCtx, res: u32) void {
+        self.results.order[self.idx] = res;
+    }
+
+    fn onFailure(self: TestCtx, err: anyerror) void {
+        self.results.err[self.idx] = err;
+    }
+};
+
+fn runTestQueue(queue: *WorkQueue, done_notify: *std.Thread.ResetEvent) void {
+    while (queue.hasUnfinishedTasks()) {
+        done_notify.wait();
+        done_notify.reset();
+        queue.processDone();
+    }
+}
+
+fn stopTestWorkers(queue: *WorkQueue) void {
+    for (queue.workers.items) |worker| {
+        worker.close_flag.store(true, .Release);
+        worker.wakeup.set();
+    }
+    for (queue.workers.items) |worker| {
+        while (worker.close_flag.load(.Acquire)) {}
+    }
+}
+
+test "WorkQueue runs dependents after their deps" {
+    var loop: uv.uv_loop_t = undefined;
+    _ = uv.uv_loop_init(&loop);
+    defer _ = uv.uv_loop_close(&loop);
+    var done_notify: std.Thread.ResetEvent = undefined;
+    done_notify.reset();
+
+    var queue = WorkQueue.init(t.alloc, &loop, &done_notify);
+    defer queue.deinit();
+    queue.createAndRunWorker();
+    queue.createAndRunWorker();
+    defer stopTestWorkers(&queue);
+
+    var order = std.atomic.Atomic(u32).init(0);
+    var results = TestResults{};
+    const a = queue.addTaskWithCbAndDeps(TestTask{ .order = &order }, TestCtx{ .results = &results, .idx = 0 }, TestCtx.onSuccess, TestCtx.onFailure, &.{});
+    const b = queue.addTaskWithCbAndDeps(TestTask{ .order = &order }, TestCtx{ .results = &results, .idx = 1 }, TestCtx.onSuccess, TestCtx.onFailure, &.{ a });
+    _ = queue.addTaskWithCbAndDeps(TestTask{ .order = &order }, TestCtx{ .results = &results, .idx = 2 }, TestCtx.onSuccess, TestCtx.onFailure, &.{ b, a });
+    runTestQueue(&queue, &done_notify);
+
+    try t.eq(results.order[0].?, 0);
+    try t.eq(results.order[1].?, 1);
+    try t.eq(results.order[2].?, 2);
+
+    // A dep that already finished successfully is satisfied.
+    _ = queue.addTaskWithCbAndDeps(TestTask{ .order = &order }, TestCtx{ .results = &results, .idx = 3 }, TestCtx.onSuccess, TestCtx.onFailure, &.{ a });
+    runTestQueue(&queue, &done_notify);
+    try t.eq(results.order[3].?, 3);
+    try t.eq(results.err[3], null);
+}
+
+test "WorkQueue fails dependents of a failed task" {
+    var loop: uv.uv_loop_t = undefined;
+    _ = uv.uv_loop_init(&loop);
+    defer _ = uv.uv_loop_close(&loop);
+    var done_notify: std.Thread.ResetEvent = undefined;
+    done_notify.reset();
+
+    var queue = WorkQueue.init(t.alloc, &loop, &done_notify);
+    defer queue.deinit();
+    queue.createAndRunWorker();
+    defer stopTestWorkers(&queue);
+
+    var order = std.atomic.Atomic(u32).init(0);
+    var results = TestResults{};
+    const a = queue.addTaskWithCbAndDeps(TestTask{ .order = &order, .fail = true }, TestCtx{ .results = &results, .idx = 0 }, TestCtx.onSuccess, TestCtx.onFailure, &.{});
+    const b = queue.addTaskWithCbAndDeps(TestTask{ .order = &order }, TestCtx{ .results = &results, .idx = 1 }, TestCtx.onSuccess, TestCtx.onFailure, &.{ a });
+    _ = queue.addTaskWithCbAndDeps(TestTask{ .order = &order }, TestCtx{ .results = &results, .idx = 2 }, TestCtx.onSuccess, TestCtx.onFailure, &.{ b });
+    runTestQueue(&queue, &done_notify);
+
+    try t.eq(results.err[0].?, error.TestFailed);
+    try t.eq(results.err[1].?, error.DependencyFailed);
+    try t.eq(results.err[2].?, error.DependencyFailed);
+    // Dependents of the failed task are never processed.
+    try t.eq(order.load(.SeqCst), 0);
+
+    // A dep that already failed fails the new task from processDone.
+    _ = queue.addTaskWithCbAndDeps(TestTask{ .order = &order }, TestCtx{ .results = &results, .idx = 3 }, TestCtx.onSuccess, TestCtx.onFailure, &.{ a });
+    try t.eq(results.err[3], null);
+    runTestQueue(&queue, &done_notify);
+    try t.eq(results.err[3].?, error.DependencyFailed);
+    try t.eq(results.order[3], null);
+
+    // Once the failed dep's slot is reused, its outcome is unknown and the new task fails instead of running.
+    queue.tasks.slots.items[a.idx].gen +%= 1;
+    _ = queue.addTaskWithCbAndDeps(TestTask{ .order = &order }, TestCtx{ .results = &results, .idx = 4 }, TestCtx.onSuccess, TestCtx.onFailure, &.{ a });
+    runTestQueue(&queue, &done_notify);
+    try t.eq(results.err[4].?, error.DependencyExpired);
+    try t.eq(results.order[4], null);
+}
+
+test "TaskTable reused slots don't match old ids" {
+    var table = TaskTable.init(t.alloc);
+    defer table.deinit();
+
+    var node: TaskNode = undefined;
+    const first = table.add(&node);
+    table.finish(first, true);
+    try t.expect(table.getState(first) == .Failed);
+
+    // Fill the free list until the first slot is reused.
+    var i: u32 = 0;
+    while (i < MinFreeTaskSlots) : (i += 1) {
+        table.finish(table.add(&node), false);
+    }
+    const reused = table.add(&node);
+    try t.eq(reused.idx, first.idx);
+    try t.eq(reused.gen, first.gen + 1);
+    try t.expect(table.getState(first) == .Expired);
+    try t.expect(table.getState(reused) == .Unfinished);
+}
@@ -25,6 +25,8 @@ const linked_list = @import("linked_list.zig");
 pub const SinglyLinkedList = linked_list.SinglyLinkedList;
 pub const SLLUnmanaged = linked_list.SLLUnmanaged;
 pub const Stack = @import("stack.zig").Stack;
+pub const WorkStealingDeque = @import("work_stealing_deque.zig").WorkStealingDeque;
+pub const TimerWheel = @import("timer_wheel.zig").TimerWheel;
 
 // std.StringHashMap except key is duped and managed.
 pub fn OwnedKeyStringHashMap(comptime T: type) type {
@@ -0,0 +1,325 @@
+const std = @import("std");
+const stdx = @import("../stdx.zig");
+const t = stdx.testing;
+const ds = stdx.ds;
+
+const Null = ds.CompactNull(u32);
+
+/// Hierarchical timing wheel with O(1) insert and cancel.
+/// There are NumLevels levels of 64 slots. A slot at level n spans 64^n ticks, so a timer is placed at the level
+/// of the highest 6 bit digit where its expiration differs from the current tick. When the current tick reaches a
+/// slot at a higher level, its timers are cascaded down to lower levels until they land in level 0 and expire.
+/// Each level keeps an occupancy bitmask so finding the next non empty slot is a count trailing zeros.
+/// Timers past the range of the top level are kept in an overflow list and reinserted when the top level rolls over.
+/// Timers are nodes of intrusive doubly linked lists in a pooled buffer, so the returned id stays valid until the timer expires or is removed.
+pub fn TimerWheel(comptime T: type) type {
+    return struct {
+        nodes: ds.PooledHandleList(u32, Node),
+
+        /// Level n slot i is at index n * SlotsPerLevel + i. The last list is the overflow list.
+        lists: [NumLevels * SlotsPerLevel + 1]List,
+        occupied: [NumLevels]u64,
+
+        /// Current tick. Timers expiring at or before this tick have already been returned from advance.
+        now: u64,
+
+        const TimerWheelT = @This();
+
+        pub const NumLevels = 6;
+        pub const SlotsPerLevel = 64;
+        const LevelBits = 6;
+        const OverflowList = NumLevels * SlotsPerLevel;
+        /// Number of ticks spanned by the wheel.
+        const Range: u64 = 1 << (LevelBits * NumLevels);
+
+        const Node = struct {
+            expires: u64,
+            prev: u32,
+            next: u32,
+            list: u16,
+            data: T,
+        };
+
+        const List = struct {
+            head: u32,
+            tail: u32,
+        };
+
+        pub fn init(alloc: std.mem.Allocator, now: u64) TimerWheelT {
+            return .{
+                .nodes = ds.PooledHandleList(u32, Node).init(alloc),
+                .lists = [_]List{.{ .head = Null, .tail = Null }} ** (NumLevels * SlotsPerLevel + 1),
+                .occupied = [_]u64{0} ** NumLevels,
+                .now = now,
+            };
+        }
+
+        pub fn deinit(self: *TimerWheelT) void {
+            self.nodes.deinit();
+        }
+
+        pub fn size(self: TimerWheelT) usize {
+            return self.nodes.size();
+        }
+
+        /// Expirations before the current tick will be returned from the next advance.
+        pub fn add(self: *TimerWheelT, expires: u64, data: T) !u32 {
+            const id = try self.nodes.add(.{
+                .expires = @max(expires, self.now),
+                .prev = Null,
+                .next = Null,
+                .list = undefined,
+                .data = data,
+            });
+            self.link(id);
+            return id;
+        }
+
+        pub fn remove(self: *TimerWheelT, id: u32) void {
+            self.unlink(id);
+            self.nodes.remove(id);
+        }
+
+        pub fn has(self: TimerWheelT, id: u32) bool {
+            return self.nodes.has(id);
+        }
+
+        pub fn getNoCheck(self: TimerWheelT, id: u32) T {
+            return self.nodes.getNoCheck(id).data;
+        }
+
+        pub fn getExpiresNoCheck(self: TimerWheelT, id: u32) u64 {
+            return self.nodes.getNoCheck(id).expires;
+        }
+
+        /// Returns a tick that the caller should advance to next. This is the exact expiration if the next timer
+        /// is in level 0, otherwise it's the start of the next occupied slot which is never later than the next expiration.
+        pub fn nextTick(self: TimerWheelT) ?u64 {
+            var level: u32 = 0;
+            while (level < NumLevels) : (level += 1) {
+                if (self.nextSlot(level)) |slot| {
+                    return self.slotStart(level, slot);
+                }
+            }
+            if (self.lists[OverflowList].head != Null) {
+                return (self.now & ~(Range - 1)) + Range;
+            }
+            return null;
+        }
+
+        /// Moves the current tick forward and appends the data of expired timers to `out` in expiration order.
+        /// Expired timers are removed from the wheel.
+        pub fn advance(self: *TimerWheelT, now: u64, out: *std.ArrayList(T)) !void {
+            while (true) {
+                var found = false;
+                var level: u32 = 0;
+                while (level < NumLevels) : (level += 1) {
+                    if (self.nextSlot(level)) |slot| {
+                        const start = self.slotStart(level, slot);
+                        if (start > now) {
+                            break;
+                        }
+                        self.now = start;
+                        const list_idx = level * SlotsPerLevel + slot;
+                        var cur = self.lists[list_idx].head;
+                        self.lists[list_idx] = .{ .head = Null, .tail = Null };
+                        self.occupied[level] &= ~(@as(u64, 1) << @intCast(u6, slot));
+                        if (level == 0) {
+                            try out.ensureUnusedCapacity(self.countList(cur));
+                            while (cur != Null) {
+                                const node = self.nodes.getNoCheck(cur);
+                                out.appendAssumeCapacity(node.data);
+                                self.nodes.remove(cur);
+                                cur = node.next;
+                            }
+                        } else {
+                            // Cascade down. Nodes expiring at the slot start go directly into level 0.
+                            while (cur != Null) {
+                                const next = self.nodes.getNoCheck(cur).next;
+                                self.link(cur);
+                                cur = next;
+                            }
+                        }
+                        found = true;
+                        break;
+                    }
+                }
+                if (found) {
+                    continue;
+                }
+                // Nothing left in the wheel before `now`.
+                const top_end = (self.now & ~(Range - 1)) + Range;
+                if (self.lists[OverflowList].head != Null and top_end <= now) {
+                    self.now = top_end;
+                    var cur = self.lists[OverflowList].head;
+                    self.lists[OverflowList] = .{ .head = Null, .tail = Null };
+                    while (cur != Null) {
+                        const next = self.nodes.getNoCheck(cur).next;
+                        self.link(cur);
+                        cur = next;
+                    }
+                    continue;
+                }
+                self.now = @max(self.now, now);
+                return;
+            }
+        }
+
+        fn countList(self: TimerWheelT, head: u32) usize {
+            var res: usize = 0;
+            var cur = head;
+            while (cur != Null) {
+                res += 1;
+                cur = self.nodes.getNoCheck(cur).next;
+            }
+            return res;
+        }
+
+        /// Timers at a level are always in the current block of the level above it,
+        /// so only slots at or after the current tick's digit can be occupied.
+        fn nextSlot(self: TimerWheelT, level: u32) ?u32 {
+            const digit = @intCast(u6, (self.now >> @intCast(u6, level * LevelBits)) & (SlotsPerLevel - 1));
+            const mask = self.occupied[level] & (~@as(u64, 0) << digit);
+            if (mask == 0) {
+                return null;
+            }
+            return @ctz(mask);
+        }
+
+        fn slotStart(self: TimerWheelT, level: u32, slot: u32) u64 {
+            const shift = @intCast(u6, level * LevelBits);
+            const block_mask = (@as(u64, SlotsPerLevel) << shift) - 1;
+            const start = (self.now & ~block_mask) | (@as(u64, slot) << shift);
+            // The slot containing the current tick starts at the current tick.
+            return @max(start, self.now);
+        }
+
+        fn link(self: *TimerWheelT, id: u32) void {
+            const node = self.nodes.getPtrNoCheck(id);
+            const diff = node.expires ^ self.now;
+            var list_idx: u32 = undefined;
+            if (diff >= Range) {
+                list_idx = OverflowList;
+            } else {
+                const level: u32 = if (diff == 0) 0 else (63 - @clz(diff)) / LevelBits;
+                const slot = @intCast(u32, (node.expires >> @intCast(u6, level * LevelBits)) & (SlotsPerLevel - 1));
+                list_idx = level * SlotsPerLevel + slot;
+                self.occupied[level] |= @as(u64, 1) << @intCast(u6, slot);
+            }
+            node.list = @intCast(u16, list_idx);
+            node.next = Null;
+            const list = &self.lists[list_idx];
+            node.prev = list.tail;
+            if (list.tail != Null) {
+                self.nodes.getPtrNoCheck(list.tail).next = id;
+            } else {
+                list.head = id;
+            }
+            list.tail = id;
+        }
+
+        fn unlink(self: *TimerWheelT, id: u32) void {
+            const node = self.nodes.getNoCheck(id);
+            const list = &self.lists[node.list];
+            if (node.prev != Null) {
+                self.nodes.getPtrNoCheck(node.prev).next = node.next;
+            } else {
+                list.head = node.next;
+            }
+            if (node.next != Null) {
+                self.nodes.getPtrNoCheck(node.next).prev = node.prev;
+            } else {
+                list.tail = node.prev;
+            }
+            if (list.head == Null and node.list != OverflowList) {
+                const level = node.list / SlotsPerLevel;
+                const slot = node.list % SlotsPerLevel;
+                self.occupied[level] &= ~(@as(u64, 1) << @intCast(u6, slot));
+            }
+        }
+    };
+}
+
+test "TimerWheel expires in order" {
+    var wheel = TimerWheel(u32).init(t.alloc, 0);
+    defer wheel.deinit();
+
+    _ = try wheel.add(100, 100);
+    _ = try wheel.add(5000, 5000);
+    _ = try wheel.add(0, 0);
+    _ = try wheel.add(70, 70);
+    _ = try wheel.add(5000, 5001);
+    _ = try wheel.add(300000, 300000);
+
+    var out = std.ArrayList(u32).init(t.alloc);
+    defer out.deinit();
+
+    try wheel.advance(69, &out);
+    try t.eqSlice(u32, out.items, &.{0});
+    out.clearRetainingCapacity();
+
+    try wheel.advance(5000, &out);
+    try t.eqSlice(u32, out.items, &.{ 70, 100, 5000, 5001 });
+    out.clearRetainingCapacity();
+    try t.eq(wheel.size(), 1);
+
+    try wheel.advance(299999, &out);
+    try t.eq(out.items.len, 0);
+    try wheel.advance(300000, &out);
+    try t.eqSlice(u32, out.items, &.{300000});
+    try t.eq(wheel.size(), 0);
+    try t.eq(wheel.nextTick(), null);
+}
+
+test "TimerWheel remove" {
+    var wheel = TimerWheel(u32).init(t.alloc, 0);
+    defer wheel.deinit();
+
+    const a = try wheel.add(10, 1);
+    const b = try wheel.add(10, 2);
+    _ = try wheel.add(10, 3);
+    const d = try wheel.add(100000, 4);
+    wheel.remove(b);
+    wheel.remove(d);
+    try t.eq(wheel.has(a), true);
+    try t.eq(wheel.has(b), false);
+    try t.eq(wheel.nextTick().?, 10);
+
+    var out = std.ArrayList(u32).init(t.alloc);
+    defer out.deinit();
+    try wheel.advance(1000000, &out);
+    try t.eqSlice(u32, out.items, &.{ 1, 3 });
+
+    wheel.remove(try wheel.add(1000001, 5));
+    try t.eq(wheel.nextTick(), null);
+}
+
+test "TimerWheel nextTick never passes the next expiration" {
+    var wheel = TimerWheel(u32).init(t.alloc, 1000);
+    defer wheel.deinit();
+
+    _ = try wheel.add(1000 + 64 * 64 + 7, 1);
+    var out = std.ArrayList(u32).init(t.alloc);
+    defer out.deinit();
+    while (wheel.nextTick()) |tick| {
+        try t.expect(tick <= 1000 + 64 * 64 + 7);
+        try wheel.advance(tick, &out);
+    }
+    try t.eqSlice(u32, out.items, &.{1});
+    try t.eq(wheel.now, 1000 + 64 * 64 + 7);
+}
+
+test "TimerWheel overflow" {
+    const Wheel = TimerWheel(u32);
+    var wheel = Wheel.init(t.alloc, 0);
+    defer wheel.deinit();
+
+    _ = try wheel.add(Wheel.Range + 5, 1);
+    _ = try wheel.add(3, 0);
+    var out = std.ArrayList(u32).init(t.alloc);
+    defer out.deinit();
+    try wheel.advance(Wheel.Range + 4, &out);
+    try t.eqSlice(u32, out.items, &.{0});
+    try wheel.advance(Wheel.Range + 5, &out);
+    try t.eqSlice(u32, out.items, &.{ 0, 1 });
+}
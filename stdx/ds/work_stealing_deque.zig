@@ -0,0 +1,174 @@
+const std = @import("std");
+const stdx = @import("../stdx.zig");
+const t = stdx.testing;
+
+/// Bounded Chase-Lev work stealing deque.
+/// The owner thread pushes and pops from the bottom while any other thread can steal from the top.
+/// Based on "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al. 2013).
+/// The buffer has a fixed power of two capacity so it never needs to be reclaimed while thieves are reading it.
+/// When the deque is full, push returns error.Full and the caller is expected to keep the item elsewhere.
+/// T must fit in a machine word so that slots can be loaded and stored atomically.
+pub fn WorkStealingDeque(comptime T: type) type {
+    if (@sizeOf(T) > @sizeOf(usize)) {
+        @compileError("Item type must fit in a machine word.");
+    }
+    return struct {
+        alloc: std.mem.Allocator,
+        buf: []T,
+        mask: isize,
+
+        top: std.atomic.Atomic(isize) align(std.atomic.cache_line),
+        bottom: std.atomic.Atomic(isize) align(std.atomic.cache_line),
+
+        const WorkStealingDequeT = @This();
+
+        pub const StealResult = union(enum) {
+            Empty: void,
+            /// Lost a race with another thief or the owner. The caller can retry.
+            Retry: void,
+            Item: T,
+        };
+
+        /// Capacity is rounded up to the next power of two.
+        pub fn init(alloc: std.mem.Allocator, capacity: usize) !WorkStealingDequeT {
+            const cap = std.math.ceilPowerOfTwo(usize, @max(capacity, 2)) catch unreachable;
+            return .{
+                .alloc = alloc,
+                .buf = try alloc.alloc(T, cap),
+                .mask = @intCast(isize, cap - 1),
+                .top = std.atomic.Atomic(isize).init(0),
+                .bottom = std.atomic.Atomic(isize).init(0),
+            };
+        }
+
+        pub fn deinit(self: *WorkStealingDequeT) void {
+            self.alloc.free(self.buf);
+        }
+
+        pub fn capacity(self: WorkStealingDequeT) usize {
+            return self.buf.len;
+        }
+
+        /// Approximate since other threads can be stealing at the same time.
+        pub fn size(self: *const WorkStealingDequeT) usize {
+            const b = self.bottom.load(.Monotonic);
+            const top = self.top.load(.Monotonic);
+            return if (b > top) @intCast(usize, b - top) else 0;
+        }
+
+        /// Only the owner thread can push.
+        pub fn push(self: *WorkStealingDequeT, item: T) !void {
+            const b = self.bottom.load(.Monotonic);
+            const top = self.top.load(.Acquire);
+            if (b - top > self.mask) {
+                return error.Full;
+            }
+            @atomicStore(T, &self.buf[@intCast(usize, b & self.mask)], item, .Monotonic);
+            @fence(.Release);
+            self.bottom.store(b + 1, .Monotonic);
+        }
+
+        /// Only the owner thread can pop. Returns items in LIFO order.
+        pub fn pop(self: *WorkStealingDequeT) ?T {
+            const b = self.bottom.load(.Monotonic) - 1;
+            self.bottom.store(b, .Monotonic);
+            @fence(.SeqCst);
+            const top = self.top.load(.Monotonic);
+            if (top <= b) {
+                const item = @atomicLoad(T, &self.buf[@intCast(usize, b & self.mask)], .Monotonic);
+                if (top == b) {
+                    // Last item, race against thieves.
+                    defer self.bottom.store(b + 1, .Monotonic);
+                    if (self.top.compareAndSwap(top, top + 1, .SeqCst, .Monotonic) != null) {
+                        return null;
+                    }
+                }
+                return item;
+            } else {
+                self.bottom.store(b + 1, .Monotonic);
+                return null;
+            }
+        }
+
+        /// Can be called from any thread. Returns items in FIFO order.
+        pub fn steal(self: *WorkStealingDequeT) StealResult {
+            const top = self.top.load(.Acquire);
+            @fence(.SeqCst);
+            const b = self.bottom.load(.Acquire);
+            if (top < b) {
+                const item = @atomicLoad(T, &self.buf[@intCast(usize, top & self.mask)], .Monotonic);
+                if (self.top.compareAndSwap(top, top + 1, .SeqCst, .Monotonic) != null) {
+                    return .Retry;
+                }
+                return .{ .Item = item };
+            }
+            return .Empty;
+        }
+    };
+}
+
+test "WorkStealingDeque owner push/pop is LIFO and steal is FIFO" {
+    var deque = try WorkStealingDeque(u32).init(t.alloc, 4);
+    defer deque.deinit();
+
+    try deque.push(1);
+    try deque.push(2);
+    try deque.push(3);
+    try t.eq(deque.size(), 3);
+    try t.eq(deque.pop().?, 3);
+    try t.eq(deque.steal().Item, 1);
+    try t.eq(deque.pop().?, 2);
+    try t.eq(deque.pop(), null);
+    try t.eq(deque.steal(), .Empty);
+}
+
+test "WorkStealingDeque push returns error.Full" {
+    var deque = try WorkStealingDeque(u32).init(t.alloc, 3);
+    defer deque.deinit();
+
+    try t.eq(deque.capacity(), 4);
+    var i: u32 = 0;
+    while (i < 4) : (i += 1) {
+        try deque.push(i);
+    }
+    try t.expectError(deque.push(4), error.Full);
+    _ = deque.steal();
+    try deque.push(4);
+}
+
+test "WorkStealingDeque concurrent steal" {
+    const NumItems = 10000;
+    const NumThieves = 4;
+    var deque = try WorkStealingDeque(u32).init(t.alloc, NumItems);
+    defer deque.deinit();
+
+    var sum = std.atomic.Atomic(u64).init(0);
+    const S = struct {
+        fn thief(deque_: *WorkStealingDeque(u32), sum_: *std.atomic.Atomic(u64)) void {
+            while (true) {
+                switch (deque_.steal()) {
+                    .Item => |item| _ = sum_.fetchAdd(item, .Monotonic),
+                    .Retry => continue,
+                    .Empty => return,
+                }
+            }
+        }
+    };
+
+    var i: u32 = 1;
+    while (i <= NumItems) : (i += 1) {
+        try deque.push(i);
+    }
+    var threads: [NumThieves]std.Thread = undefined;
+    for (&threads) |*thread| {
+        thread.* = try std.Thread.spawn(.{}, S.thief, .{ &deque, &sum });
+    }
+    // Owner pops concurrently.
+    while (deque.pop()) |item| {
+        _ = sum.fetchAdd(item, .Monotonic);
+    }
+    for (threads) |thread| {
+        thread.join();
+    }
+    try t.eq(sum.load(.Monotonic), NumItems * (NumItems + 1) / 2);
+}
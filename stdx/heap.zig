@@ -601,11 +601,16 @@ test "WasmDefaultAllocator.growMemory large allocation/free." {
     }
 }
 
+/// Tracks memory and the number of calls made to the child allocator.
+/// Counts can be reset with `resetCounts` at the start of a frame to get the number of allocations made in the frame.
 pub const TraceAllocator = struct {
     allocMem: usize,
     freedMem: usize,
     resizeMem: usize,
     peakMem: usize,
+    numAllocs: u32,
+    numResizes: u32,
+    numFrees: u32,
     child: std.mem.Allocator,
 
     const vtable = std.mem.Allocator.VTable{
@@ -620,6 +625,9 @@ pub const TraceAllocator = struct {
             .freedMem = 0,
             .resizeMem = 0,
             .peakMem = 0,
+            .numAllocs = 0,
+            .numResizes = 0,
+            .numFrees = 0,
             .child = child,
         };
     }
@@ -635,16 +643,22 @@ pub const TraceAllocator = struct {
         };
     }
 
+    pub fn resetCounts(self: *TraceAllocator) void {
+        self.numAllocs = 0;
+        self.numResizes = 0;
+        self.numFrees = 0;
+    }
+
     fn alloc(
         ptr: *anyopaque,
         len: usize,
-        alignment: u29,
-        len_align: u29,
+        log2_align: u8,
         ret_addr: usize,
-    ) std.mem.Allocator.Error![]u8 {
+    ) ?[*]u8 {
         const self = @ptrCast(*TraceAllocator, @alignCast(@sizeOf(usize), ptr));
-        const res = try self.child.rawAlloc(len, alignment, len_align, ret_addr);
-        self.allocMem += res.len;
+        const res = self.child.rawAlloc(len, log2_align, ret_addr) orelse return null;
+        self.numAllocs += 1;
+        self.allocMem += len;
         if (self.allocMem - self.freedMem > self.peakMem) {
             self.peakMem = self.allocMem - self.freedMem;
         }
@@ -654,35 +668,57 @@ pub const TraceAllocator = struct {
     fn resize(
         ptr: *anyopaque,
         buf: []u8,
-        buf_align: u29,
+        log2_align: u8,
         new_len: usize,
-        len_align: u29,
         ret_addr: usize,
-    ) ?usize {
+    ) bool {
         const self = @ptrCast(*TraceAllocator, @alignCast(@sizeOf(usize), ptr));
-        if (self.child.rawResize(buf, buf_align, new_len, len_align, ret_addr)) |newSize| {
-            if (newSize > buf.len) {
-                self.resizeMem += newSize - buf.len;
+        if (self.child.rawResize(buf, log2_align, new_len, ret_addr)) {
+            self.numResizes += 1;
+            if (new_len > buf.len) {
+                self.resizeMem += new_len - buf.len;
             }
-            return newSize;
-        } else return null;
+            return true;
+        } else return false;
     }
 
     fn free(
         ptr: *anyopaque,
         buf: []u8,
-        buf_align: u29,
+        log2_align: u8,
         ret_addr: usize,
     ) void {
         const self = @ptrCast(*TraceAllocator, @alignCast(@sizeOf(usize), ptr));
-        self.child.rawFree(buf, buf_align, ret_addr);
+        self.child.rawFree(buf, log2_align, ret_addr);
+        self.numFrees += 1;
         self.freedMem += buf.len;
     }
 
-    fn dump(self: TraceAllocator) void {
-        log.info("alloc: {}", .{self.allocMem});
-        log.info("freed: {}", .{self.freedMem});
+    pub fn dump(self: TraceAllocator) void {
+        log.info("alloc: {} ({} calls)", .{self.allocMem, self.numAllocs});
+        log.info("freed: {} ({} calls)", .{self.freedMem, self.numFrees});
         log.info("peak: {}", .{self.peakMem});
-        log.info("resize: {}", .{self.resizeMem});
+        log.info("resize: {} ({} calls)", .{self.resizeMem, self.numResizes});
     }
-};
\ No newline at end of file
+};
+
+test "TraceAllocator" {
+    var trace: TraceAllocator = undefined;
+    trace.init(t.alloc);
+    defer trace.deinit();
+    const alloc = trace.allocator();
+
+    const a = try alloc.alloc(u8, 16);
+    const b = try alloc.alloc(u8, 32);
+    alloc.free(a);
+    try t.eq(trace.numAllocs, 2);
+    try t.eq(trace.numFrees, 1);
+    try t.eq(trace.peakMem, 48);
+
+    // Counts restart while memory totals are kept.
+    trace.resetCounts();
+    alloc.free(b);
+    try t.eq(trace.numAllocs, 0);
+    try t.eq(trace.numFrees, 1);
+    try t.eq(trace.freedMem, 48);
+}
@@ -1,4 +1,6 @@
 const std = @import("std");
+const stdx = @import("../stdx.zig");
+const t = stdx.testing;
 
 pub const Rect = struct {
     x: f32,
@@ -67,4 +69,26 @@ pub const BBox = struct {
     pub fn containsPt(self: BBox, x: f32, y: f32) bool {
         return x >= self.min_x and x <= self.max_x and y >= self.min_y and y <= self.max_y;
     }
+
+    pub fn encloseBBox(self: *BBox, other: BBox) void {
+        self.min_x = @min(self.min_x, other.min_x);
+        self.min_y = @min(self.min_y, other.min_y);
+        self.max_x = @max(self.max_x, other.max_x);
+        self.max_y = @max(self.max_y, other.max_y);
+    }
+
+    /// Boxes that only share an edge don't intersect.
+    pub fn intersects(self: BBox, other: BBox) bool {
+        return self.min_x < other.max_x and other.min_x < self.max_x and self.min_y < other.max_y and other.min_y < self.max_y;
+    }
 };
+
+test "BBox.intersects" {
+    const a = BBox.init(0, 0, 10, 10);
+    try t.eq(a.intersects(BBox.init(5, 5, 15, 15)), true);
+    try t.eq(a.intersects(BBox.init(2, 2, 3, 3)), true);
+    try t.eq(a.intersects(BBox.init(20, 0, 30, 10)), false);
+    try t.eq(a.intersects(BBox.init(0, 20, 10, 30)), false);
+    // Shared edge.
+    try t.eq(a.intersects(BBox.init(10, 0, 20, 10)), false);
+}
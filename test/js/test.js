@@ -450,6 +450,59 @@ testIsolated('cs.http.serveHttp', async () => {
             resp.setHeader('content-type', 'text/plain; charset=utf-8')
             resp.send(str)
             return true
+        } else if (req.path == '/body' && req.method == 'POST') {
+            // The body is only copied once.
+            resp.send(`${req.body === req.body}`)
+            return true
+        } else if (req.path == '/headers' && req.method == 'GET') {
+            resp.setStatus(200)
+            resp.send(req.headers['x-test'])
+            return true
+        } else if (req.path == '/stream' && req.method == 'GET') {
+            resp.setStatus(200)
+            resp.setHeader('content-type', 'text/plain; charset=utf-8')
+            resp.write('Hello ')
+            resp.writeBytes(new Uint8Array([102, 114, 111, 109, 32]))
+            // Finish the response after the handler returns.
+            setTimeout(0, () => {
+                resp.write('stream!')
+                resp.end()
+            })
+            return true
+        } else if (req.path == '/upload' && req.method == 'POST') {
+            if (req.bodyStream == null) {
+                resp.send(`${req.body.length}`)
+                return true
+            }
+            // Pause after each chunk and only ask for more once the chunk is consumed.
+            let len = 0
+            const body = req.bodyStream
+            body.onData((chunk, done) => {
+                len += chunk.length
+                if (done) {
+                    resp.send(`${len}`)
+                } else {
+                    body.pause()
+                    setTimeout(0, () => body.unpause())
+                }
+            })
+            return true
+        } else if (req.path == '/large' && req.method == 'GET') {
+            resp.setStatus(200)
+            const chunk = 'x'.repeat(16 * 1024)
+            let remaining = 64
+            const writeMore = () => {
+                while (remaining > 0) {
+                    remaining -= 1
+                    if (!resp.write(chunk)) {
+                        return
+                    }
+                }
+                resp.end()
+            }
+            resp.onDrain(writeMore)
+            writeMore()
+            return true
         }
     })
 
@@ -464,12 +517,59 @@ testIsolated('cs.http.serveHttp', async () => {
 
         // Post.
         eq(await cs.http.postAsync('http://127.0.0.1:3000/hello', 'my message'), 'my message')
+
+        eq(await cs.http.postAsync('http://127.0.0.1:3000/body', 'my message'), 'true')
+
+        // Request headers.
+        resp = await cs.http.requestAsync('http://127.0.0.1:3000/headers', { headers: { 'x-test': 'foo' } })
+        eq(resp.text(), 'foo')
+
+        // Chunked response.
+        eq(await cs.http.getAsync('http://127.0.0.1:3000/stream'), 'Hello from stream!')
+
+        // Streamed request body.
+        eq(await cs.http.postAsync('http://127.0.0.1:3000/upload', 'x'.repeat(1024 * 1024)), `${1024 * 1024}`)
+
+        // Response larger than the high water mark is written as it drains.
+        eq((await cs.http.getAsync('http://127.0.0.1:3000/large')).length, 64 * 16 * 1024)
     } finally {
         await s.closeAsync()
     }
     // return new Promise(() => {})
 })
 
+testIsolated('cs.http.Server.serveStatic', async () => {
+    const s = cs.http.serveHttp('127.0.0.1', 3002)
+    s.serveStatic('/static', './test/assets')
+    s.setHandler((req, resp) => {
+        resp.setStatus(200)
+        resp.send('from handler')
+        return true
+    })
+
+    try {
+        let resp = await cs.http.requestAsync('http://127.0.0.1:3002/static/style.css')
+        eq(resp.status, 200)
+        eq(resp.getHeader('content-type'), 'text/css')
+        contains(resp.text(), 'background-color: white;')
+        const etag = resp.getHeader('etag')
+
+        // Conditional request.
+        resp = await cs.http.requestAsync('http://127.0.0.1:3002/static/style.css', { headers: { 'if-none-match': etag } })
+        eq(resp.status, 304)
+
+        // Range request.
+        resp = await cs.http.requestAsync('http://127.0.0.1:3002/static/style.css', { headers: { 'range': 'bytes=0-3' } })
+        eq(resp.status, 206)
+        eq(resp.text(), 'body')
+
+        // Missing files fall through to the handler.
+        eq(await cs.http.getAsync('http://127.0.0.1:3002/static/missing.css'), 'from handler')
+    } finally {
+        await s.closeAsync()
+    }
+})
+
 testIsolated('cs.http.serveHttps', async () => {
     // Use a different port for each test since listening sockets can remain in TIME_WAIT and on Windows reuseaddr is not used.
     const s = cs.http.serveHttps('127.0.0.1', 3001, './test/assets/localhost.crt', './test/assets/localhost.key')
@@ -563,6 +663,40 @@ testIsolated('setTimeout: callback this is global by default', async () => {
     await p
 })
 
+testIsolated('clearTimeout', async () => {
+    let resolve
+    const p = new Promise(r => resolve = r)
+    const res = []
+    const id = setTimeout(10, () => res.push(1))
+    setTimeout(0, () => res.push(2))
+    setTimeout(20, () => {
+        res.push(3)
+        resolve()
+    })
+    clearTimeout(id)
+    // Clearing an unknown or fired id is ignored.
+    clearTimeout(id)
+    await p
+    eq(res, [2, 3])
+})
+
+testIsolated('setInterval', async () => {
+    let resolve
+    const p = new Promise(r => resolve = r)
+    let count = 0
+    const id = setInterval(5, (arg) => {
+        eq(arg, 123)
+        count += 1
+        if (count == 3) {
+            clearTimeout(id)
+            // Wait past another interval to make sure it stopped.
+            setTimeout(20, resolve)
+        }
+    }, 123)
+    await p
+    eq(count, 3)
+})
+
 if (getOs() == Os.macos) {
     test('getOsVersion', () => {
         assert(getOsVersion().startsWith('macos'), 'Os version prefix')
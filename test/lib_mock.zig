@@ -63,6 +63,14 @@ export fn glUniformMatrix4fv() void {}
 export fn glGetUniformLocation() void {}
 export fn glUniform1i() void {}
 export fn glBufferData() void {}
+export fn glMapBufferRange() void {}
+export fn glUnmapBuffer() void {}
+export fn glBufferStorage() void {}
+export fn glFenceSync() void {}
+export fn glClientWaitSync() void {}
+export fn glDeleteSync() void {}
+export fn glDrawElementsBaseVertex() void {}
+export fn SDL_GL_ExtensionSupported() void {}
 export fn glDrawElements() void {}
 export fn glTexSubImage2D() void {}
 export fn glScissor() void {}
@@ -598,5 +606,6 @@ export fn SDL_FreeCursor() void {}
 export fn SDL_CreateSystemCursor() void {}
 
 export fn stbi_set_flip_vertically_on_load() void {}
+export fn stbi_set_flip_vertically_on_load_thread() void {}
 export fn glFrontFace() void {}
 export fn glCheckFramebufferStatus() void {}
\ No newline at end of file
@@ -0,0 +1,23 @@
+// HTTP server with a handler that does as little as possible to measure the cost of dispatching a request into js.
+// Run with: cosmic test/load-test/cs-http-empty-handler-server.js [read-props=0]
+// With read-props=1, the handler also reads the request's method and path.
+// Measure with: k6 run -q --vus 64 --duration 15s -e THREADS=1 test/load-test/k6-http-threads-load-test.js
+
+const args = getCliArgs()
+const scriptIdx = args.findIndex(arg => arg.endsWith('cs-http-empty-handler-server.js'))
+const readProps = args[scriptIdx + 1] == '1'
+
+const s = cs.http.serveHttp('127.0.0.1', 3000)
+if (readProps) {
+    s.setHandler((req, resp) => {
+        if (req.method == 'GET' && req.path == '/foo') {
+            resp.send('')
+            return true
+        }
+    })
+} else {
+    s.setHandler((req, resp) => {
+        resp.send('')
+        return true
+    })
+}
@@ -0,0 +1,17 @@
+// HTTP server used by run-http-threads-load-test.sh to measure scaling across threads.
+// Run with: cosmic test/load-test/cs-http-threads-server.js [threads=1]
+// Each additional thread only compiles the handler in its own js context, so it can't use variables from this script.
+
+const args = getCliArgs()
+const scriptIdx = args.findIndex(arg => arg.endsWith('cs-http-threads-server.js'))
+const threads = parseInt(args[scriptIdx + 1] ?? '1')
+
+const s = cs.http.serveHttp('127.0.0.1', 3000, { threads: threads })
+s.setHandler((req, resp) => {
+    if (req.path == '/foo') {
+        resp.setStatus(200)
+        resp.setHeader('content-type', 'text/plain; charset=utf-8')
+        resp.send('foo from server')
+        return true
+    }
+})
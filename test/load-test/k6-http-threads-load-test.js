@@ -0,0 +1,27 @@
+import http from 'k6/http'
+import { check } from 'k6'
+
+// Load test for cs-http-threads-server.js. Prints req/s and p99 latency for a single run.
+// Run with: k6 run -q --vus 64 --duration 15s -e THREADS=4 test/load-test/k6-http-threads-load-test.js
+// Use run-http-threads-load-test.sh to run with a growing number of server threads.
+
+export const options = {
+    summaryTrendStats: ['avg', 'p(50)', 'p(99)', 'max'],
+}
+
+export default function () {
+    const res = http.get('http://127.0.0.1:3000/foo')
+    check(res, {
+        'check /foo status': (res) => res.status === 200,
+    })
+}
+
+export function handleSummary(data) {
+    const threads = __ENV.THREADS || '?'
+    const rate = data.metrics.http_reqs.values.rate
+    const p99 = data.metrics.http_req_duration.values['p(99)']
+    const failed = data.metrics.http_req_failed.values.rate
+    return {
+        stdout: `threads=${threads} req/s=${rate.toFixed(0)} p99=${p99.toFixed(2)}ms failed=${(failed * 100).toFixed(2)}%\n`,
+    }
+}
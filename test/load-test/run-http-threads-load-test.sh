@@ -0,0 +1,18 @@
+#!/bin/sh
+# Measures req/s and p99 latency of cosmic's http server as the number of server threads grows.
+# Requires k6 and a release build of cosmic (zig build cosmic -Doptimize=ReleaseFast), defaults to cosmic on the PATH.
+# Run from the repo root with: sh test/load-test/run-http-threads-load-test.sh [path-to-cosmic] [vus] [duration]
+
+COSMIC=${1:-cosmic}
+VUS=${2:-64}
+DURATION=${3:-15s}
+
+for THREADS in 1 2 4 8 16 32; do
+    $COSMIC test/load-test/cs-http-threads-server.js $THREADS &
+    SERVER_PID=$!
+    # Wait for the server to bind.
+    sleep 1
+    k6 run -q --vus $VUS --duration $DURATION -e THREADS=$THREADS test/load-test/k6-http-threads-load-test.js
+    kill -INT $SERVER_PID
+    wait $SERVER_PID 2>/dev/null
+done
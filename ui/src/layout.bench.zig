@@ -0,0 +1,96 @@
+const std = @import("std");
+const stdx = @import("stdx");
+const platform = @import("platform");
+const graphics = @import("graphics");
+const ui = @import("ui");
+const u = ui.widgets;
+
+// Updates a tree of 10k nodes where only one label changes each frame and compares the full layout against cached layouts.
+// The build and diff steps are included in the timings since they run in both cases.
+// Also reports the allocator calls made per update. Frame props, styles and frame lists come from the build arenas
+// so once the arenas have grown only the allocations outside the build phase are left.
+// Needs a window since text is measured with the gpu font cache.
+// Run with: zig build run -Dpath="ui/src/layout.bench.zig" -Dgraphics -Doptimize=ReleaseFast
+
+/// Each row is a Padding and a Text node.
+const NumRows = 5000;
+const NumFrames = 100;
+
+const App = struct {
+    frame: u32,
+};
+
+fn buildRoot(app: *App, c: *ui.BuildContext) ui.FramePtr {
+    return c.build(u.ColumnT, .{
+        .children = c.range(NumRows, app, buildRow),
+    });
+}
+
+fn buildRow(app: *App, c: *ui.BuildContext, i: u32) ui.FramePtr {
+    // Only the first label changes.
+    const text = if (i == 0) c.fmt("frame {}", .{app.frame}) catch stdx.fatal() else ui.SlicePtr(u8).initStatic("label");
+    return u.Padding(.{ .padding = 2 },
+        u.Text(.{ .text = text }),
+    );
+}
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    var trace: stdx.heap.TraceAllocator = undefined;
+    trace.init(gpa.allocator());
+    defer trace.deinit();
+    const alloc = trace.allocator();
+
+    var win = try platform.Window.init(alloc, .{
+        .title = "layout bench",
+        .width = 800,
+        .height = 600,
+    });
+    defer win.deinit();
+    var renderer: graphics.WindowRenderer = undefined;
+    try renderer.init(alloc, &win);
+    defer renderer.deinit(alloc);
+    const g = renderer.getGraphics();
+
+    std.debug.print("nodes: {}, frames: {}\n", .{ NumRows * 2, NumFrames });
+    std.debug.print("{s:>10} {s:>12} {s:>10} {s:>14} {s:>14} {s:>14}\n", .{ "layout", "us/update", "speedup", "allocs/update", "resizes/update", "frees/update" });
+    // Counts are printed right after each run since the next run resets them.
+    const base_us = try runUpdates(alloc, &trace, g, false);
+    printRow("full", base_us, 1.0, &trace);
+    const us = try runUpdates(alloc, &trace, g, true);
+    printRow("cached", us, base_us / us, &trace);
+}
+
+fn printRow(name: []const u8, us: f64, speedup: f64, trace: *stdx.heap.TraceAllocator) void {
+    std.debug.print("{s:>10} {d:>12.3} {d:>10.2} {d:>14.1} {d:>14.1} {d:>14.1}\n", .{
+        name,
+        us,
+        speedup,
+        @intToFloat(f64, trace.numAllocs) / NumFrames,
+        @intToFloat(f64, trace.numResizes) / NumFrames,
+        @intToFloat(f64, trace.numFrees) / NumFrames,
+    });
+}
+
+fn runUpdates(alloc: std.mem.Allocator, trace: *stdx.heap.TraceAllocator, g: *graphics.Graphics, cache: bool) !f64 {
+    var mod: ui.Module = undefined;
+    mod.init(alloc, g);
+    defer mod.deinit();
+    mod.setLayoutCaching(cache);
+
+    var app = App{ .frame = 0 };
+
+    // The first updates create the nodes and grow both build arenas.
+    try mod.update(0, &app, buildRoot, 800, 600);
+    try mod.update(16, &app, buildRoot, 800, 600);
+
+    trace.resetCounts();
+    var timer = try std.time.Timer.start();
+    var i: u32 = 0;
+    while (i < NumFrames) : (i += 1) {
+        app.frame += 1;
+        try mod.update(16, &app, buildRoot, 800, 600);
+    }
+    return @intToFloat(f64, timer.read()) / NumFrames / 1e3;
+}
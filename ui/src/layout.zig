@@ -1,3 +1,4 @@
+const std = @import("std");
 const graphics = @import("graphics");
 const ui = @import("ui.zig");
 const module = @import("module.zig");
@@ -163,77 +164,64 @@ pub const LayoutContext = struct {
 
     /// Computes the layout for a node with a maximum size.
     pub fn computeLayoutWithMax(self: *LayoutContext, node: *ui.Node, max_width: f32, max_height: f32) LayoutSize {
-        // Creates another context on the stack so the caller can continue to use their context.
-        var child_ctx = LayoutContext{
-            .mod = self.mod,
-            .common = &self.mod.common.ctx,
-            .gctx = self.gctx,
-            .cstr = .{
-                .min_width = 0,
-                .min_height = 0,
-                .max_width = max_width,
-                .max_height = max_height,
-            },
-            .node = node,
-        };
-        return node.vtable.layout(node.widget, &child_ctx);
+        return self.computeNodeLayout(node, .{
+            .min_width = 0,
+            .min_height = 0,
+            .max_width = max_width,
+            .max_height = max_height,
+        });
     }
 
     /// Computes the layout for a node that prefers an exact size.
     pub fn computeLayoutExact(self: *LayoutContext, node: *ui.Node, width: f32, height: f32) LayoutSize {
-        var child_ctx = LayoutContext{
-            .mod = self.mod,
-            .common = &self.mod.common.ctx,
-            .gctx = self.gctx,
-            .cstr = .{
-                .min_width = width,
-                .min_height = height,
-                .max_width = width,
-                .max_height = height,
-            },
-            .node = node,
-        };
-        return node.vtable.layout(node.widget, &child_ctx);
+        return self.computeNodeLayout(node, .{
+            .min_width = width,
+            .min_height = height,
+            .max_width = width,
+            .max_height = height,
+        });
     }
 
     /// Computes the layout for a node with given size constraints.
     pub fn computeLayout(self: *LayoutContext, node: *ui.Node, min_width: f32, min_height: f32, max_width: f32, max_height: f32) LayoutSize {
-        var child_ctx = LayoutContext{
-            .mod = self.mod,
-            .common  = &self.mod.common.ctx,
-            .gctx = self.gctx,
-            .cstr = .{
-                .min_width = min_width,
-                .min_height = min_height,
-                .max_width = max_width,
-                .max_height = max_height,
-            },
-            .node = node,
-        };
-        return node.vtable.layout(node.widget, &child_ctx);
+        return self.computeNodeLayout(node, .{
+            .min_width = min_width,
+            .min_height = min_height,
+            .max_width = max_width,
+            .max_height = max_height,
+        });
     }
 
     /// Computes the layout for a node with given size constraints.
     pub fn computeLayout2(self: *LayoutContext, node: *ui.Node, cstr: SizeConstraints) LayoutSize {
-        var child_ctx = LayoutContext{
-            .mod = self.mod,
-            .common  = &self.mod.common.ctx,
-            .gctx = self.gctx,
-            .cstr = cstr,
-            .node = node,
-        };
-        return node.vtable.layout(node.widget, &child_ctx);
+        return self.computeNodeLayout(node, cstr);
     }
 
     pub fn computeLayoutInherit(self: *LayoutContext, node: *ui.Node) LayoutSize {
+        return self.computeNodeLayout(node, self.cstr);
+    }
+
+    /// Returns the node's last result if it isn't dirty and receives the same constraints. Otherwise, the node's layout is computed and cached.
+    /// A clean node's children keep the layouts that were set by the last compute so the whole subtree is skipped.
+    fn computeNodeLayout(self: *LayoutContext, node: *ui.Node, cstr: SizeConstraints) LayoutSize {
+        if (self.mod.layout_cache and !node.hasState(ui.NodeStateMasks.layout_dirty) and std.meta.eql(node.layout_cstr, cstr)) {
+            return node.layout_size;
+        }
+        // Cleared before the compute so a widget can keep itself dirty.
+        node.clearStateMask(ui.NodeStateMasks.layout_dirty);
+
+        // Creates another context on the stack so the caller can continue to use their context.
         var child_ctx = LayoutContext{
             .mod = self.mod,
-            .common  = &self.mod.common.ctx,
+            .common = &self.mod.common.ctx,
             .gctx = self.gctx,
-            .cstr = self.cstr,
+            .cstr = cstr,
             .node = node,
         };
-        return node.vtable.layout(node.widget, &child_ctx);
+        const size = node.vtable.layout(node.widget, &child_ctx);
+        node.layout_cstr = cstr;
+        node.layout_size = size;
+        return size;
     }
 
     pub fn setLayout2(self: *LayoutContext, node: *ui.Node, x: f32, y: f32, width: f32, height: f32) void {
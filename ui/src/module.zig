@@ -122,9 +122,15 @@ fn updateWidgetStyle(comptime Widget: type, mod: *Module, node: *ui.Node, frame:
                 new.* = computed;
                 mod.common.node_computed_styles.put(mod.alloc, node, new) catch fatal();
                 node.setStateMask(ui.NodeStateMasks.computed_style);
+                node.markDirty();
+                node.markLayoutDirty();
             } else {
                 const existing = stdx.ptrCastAlign(*Style, mod.common.node_computed_styles.get(node).?);
-                existing.* = computed;
+                if (!std.meta.eql(existing.*, computed)) {
+                    existing.* = computed;
+                    node.markDirty();
+                    node.markLayoutDirty();
+                }
             }
             return;
         }
@@ -145,9 +151,15 @@ fn updateWidgetStyle(comptime Widget: type, mod: *Module, node: *ui.Node, frame:
             new.* = computed;
             mod.common.node_computed_styles.put(mod.alloc, node, new) catch fatal();
             node.setStateMask(ui.NodeStateMasks.computed_style);
+            node.markDirty();
+            node.markLayoutDirty();
         } else {
             const existing = stdx.ptrCastAlign(*Style, mod.common.node_computed_styles.get(node).?);
-            existing.* = computed;
+            if (!std.meta.eql(existing.*, computed)) {
+                existing.* = computed;
+                node.markDirty();
+                node.markLayoutDirty();
+            }
         }
     } else {
         // Remove computed.
@@ -156,10 +168,71 @@ fn updateWidgetStyle(comptime Widget: type, mod: *Module, node: *ui.Node, frame:
             mod.alloc.destroy(existing);
             _ = mod.common.node_computed_styles.remove(node);
             node.clearStateMask(ui.NodeStateMasks.computed_style);
+            node.markDirty();
+            node.markLayoutDirty();
         }
     }
 }
 
+/// Compares props to decide whether a node's draws need to be recorded again.
+/// Functions are equal if they call the same function with the same context. Closures are equal only if they're the same closure.
+/// Single pointers are always considered changed since what they point to could have changed in place.
+/// Child frames are diffed separately so they're considered equal.
+fn propsEql(comptime T: type, a: T, b: T) bool {
+    if (T == ui.FramePtr or T == ui.FrameListPtr) {
+        return true;
+    }
+    switch (@typeInfo(T)) {
+        .Struct => |info| {
+            if (@hasDecl(T, "Function")) {
+                return functionEql(a, b);
+            } else if (@hasDecl(T, "SlicePtr")) {
+                const Slice = @TypeOf(a.slice());
+                return propsEql(Slice, a.slice(), b.slice());
+            }
+            inline for (info.fields) |field| {
+                if (!propsEql(field.type, @field(a, field.name), @field(b, field.name))) {
+                    return false;
+                }
+            }
+            return true;
+        },
+        .Optional => |info| {
+            if (a == null or b == null) {
+                return a == null and b == null;
+            }
+            return propsEql(info.child, a.?, b.?);
+        },
+        .Pointer => |info| {
+            if (info.size == .Slice) {
+                if (info.child == u8) {
+                    return std.mem.eql(u8, a, b);
+                }
+                return a.ptr == b.ptr and a.len == b.len;
+            }
+            return false;
+        },
+        .Union => |info| {
+            if (info.tag_type == null) {
+                return std.mem.eql(u8, std.mem.asBytes(&a), std.mem.asBytes(&b));
+            }
+            return std.meta.eql(a, b);
+        },
+        else => return std.meta.eql(a, b),
+    }
+}
+
+fn functionEql(a: anytype, b: @TypeOf(a)) bool {
+    if (a.funcT != b.funcT) {
+        return false;
+    }
+    return switch (a.funcT) {
+        .none => true,
+        .free => a.inner.free.ctx == b.inner.free.ctx and a.inner.free.callFn == b.inner.free.callFn and a.inner.free.userFn == b.inner.free.userFn,
+        .closure => a.inner.closure.capturePtr == b.inner.closure.capturePtr and a.inner.closure.userFnPtr == b.inner.closure.userFnPtr,
+    };
+}
+
 /// Generates the vtable for a Widget.
 pub fn GenWidgetVTable(comptime Widget: type) *const ui.WidgetVTable {
     const gen = struct {
@@ -229,6 +302,11 @@ pub fn GenWidgetVTable(comptime Widget: type) *const ui.WidgetVTable {
                         widget.prePropsUpdate(ctx, props);
                     }
 
+                    // A node created without props has no previous props to compare.
+                    if (node.frame.isNull() or !propsEql(Props, widget.props.*, props.*)) {
+                        node.markDirty();
+                        node.markLayoutDirty();
+                    }
                     widget.props = props;
                     // Update ref counts.
                     ctx.handleFrameUpdate(node.frame, framePtr);
@@ -290,6 +368,22 @@ pub fn GenWidgetVTable(comptime Widget: type) *const ui.WidgetVTable {
                     log.debug("render {}", .{node.abs_bounds});
                 }
             }
+            if (ctx.retained) {
+                // Children are left out of their parent's recording.
+                const owner = ui_render.pauseRecording(ctx, node, parent_abs_x, parent_abs_y);
+                defer ui_render.resumeRecording(ctx, owner);
+                if (ui_render.replayNode(node, ctx)) {
+                    return;
+                }
+                ui_render.beginNodeRecording(node, ctx);
+                defer ui_render.endNodeRecording(node, ctx);
+                renderWidget(node, ctx);
+            } else {
+                renderWidget(node, ctx);
+            }
+        }
+
+        fn renderWidget(node: *ui.Node, ctx: *RenderContext) void {
             if (@hasDecl(Widget, "renderCustom")) {
                 if (comptime !stdx.meta.hasFunctionSignature(fn (*Widget, *RenderContext) void, @TypeOf(Widget.renderCustom))) {
                     @compileError("Invalid renderCustom function: " ++ @typeName(@TypeOf(Widget.renderCustom)) ++ " Widget: " ++ @typeName(Widget));
@@ -410,7 +504,7 @@ pub fn GenWidgetVTable(comptime Widget: type) *const ui.WidgetVTable {
                 if (frame.style) |ptr| {
                     if (frame.style_is_owned) {
                         const style = stdx.ptrCastAlign(*const UserStyle, ptr);
-                        mod.build_ctx.dynamic_alloc.destroy(style);
+                        mod.build_ctx.arena_alloc.destroy(style);
                     }
                 }
             }
@@ -429,10 +523,10 @@ pub fn GenWidgetVTable(comptime Widget: type) *const ui.WidgetVTable {
                         } else if (@typeInfo(field.type) == .Struct and @hasDecl(field.type, "SlicePtr")) {
                             @field(props, field.name).destroy();
                         } else if (@typeInfo(field.type) == .Struct and @hasDecl(field.type, "Function")) {
-                            @field(props, field.name).deinit(mod.build_ctx.dynamic_alloc);
+                            @field(props, field.name).deinit(mod.build_ctx.arena_alloc);
                         }
                     }
-                    mod.build_ctx.dynamic_alloc.destroy(props);
+                    mod.build_ctx.arena_alloc.destroy(props);
                 }
             }
         }
@@ -496,6 +590,12 @@ pub const Module = struct {
     common: ModuleCommon,
 
     text_measure_batch_buf: std.ArrayList(*graphics.TextMeasure),
+    /// Graphics.font_gen and dpr ceil the kept text measures were measured with.
+    text_measure_font_gen: u32,
+    text_measure_dpr_ceil: u8,
+
+    /// Whether clean nodes reuse their last layout. See LayoutContext.computeNodeLayout.
+    layout_cache: bool,
 
     debug_dump_after_num_updates: if (builtin.mode == .Debug) ?u32 else void,
     trace: if (builtin.mode == .Debug) std.ArrayListUnmanaged(Trace) else void,
@@ -519,11 +619,14 @@ pub const Module = struct {
             .mod_ctx = ModuleContext.init(self),
             .common = undefined,
             .text_measure_batch_buf = std.ArrayList(*graphics.TextMeasure).init(alloc),
+            .text_measure_font_gen = g.font_gen,
+            .text_measure_dpr_ceil = g.getDprCeil(),
+            .layout_cache = false,
             .debug_dump_after_num_updates = undefined,
             .trace = undefined,
         };
         self.common.init(alloc, self, g);
-        self.build_ctx.init(alloc, alloc, self);
+        self.build_ctx.init(alloc, self);
         self.render_ctx = RenderContext.init(&self.common.ctx, g);
         self.update_ctx = .{
             .common = &self.common.ctx,
@@ -655,6 +758,7 @@ pub const Module = struct {
             if (self.common.focused_onblur) |on_blur| {
                 on_blur(self.common.focused_widget.?, &self.common.ctx);
             }
+            self.common.focused_widget.?.markSubtreeDirty();
             self.common.focused_widget = null;
             self.common.focused_onblur = null;
             self.common.focused_onpaste = null;
@@ -700,6 +804,7 @@ pub const Module = struct {
             if (self.common.focused_onblur) |on_blur| {
                 on_blur(self.common.focused_widget.?, &self.common.ctx);
             }
+            self.common.focused_widget.?.markSubtreeDirty();
             self.common.focused_widget = null;
             self.common.focused_onblur = null;
             self.common.focused_onpaste = null;
@@ -966,6 +1071,9 @@ pub const Module = struct {
         // Remove nodes marked for removal.
         self.common.removeNodes();
 
+        // Frames from two builds ago are no longer referenced once removed nodes are destroyed.
+        self.build_ctx.beginBuild();
+
         // TODO: check if we have to update
 
         defer {
@@ -1004,20 +1112,41 @@ pub const Module = struct {
         try self.updateRoot(root_id);
 
         // Before computing layout, perform batched measure text.
-        // Widgets can still explicitly measure text so the purpose of this is to act as a placeholder for future work to speed up text measurements.
+        // Results are kept across updates so only measures that had their text or font changed are measured again.
+        // Everything is measured again after the fallback fonts or the dpr changed.
+        // Widgets can still explicitly measure text.
+        const g = self.common.g;
+        const remeasure_all = g.font_gen != self.text_measure_font_gen or g.getDprCeil() != self.text_measure_dpr_ceil;
+        self.text_measure_font_gen = g.font_gen;
+        self.text_measure_dpr_ceil = g.getDprCeil();
         self.text_measure_batch_buf.clearRetainingCapacity();
         var iter = self.common.text_measures.iterator();
         while (iter.nextPtr()) |measure| {
-            self.text_measure_batch_buf.append(&measure.measure) catch unreachable;
+            if (measure.needs_measure or remeasure_all) {
+                self.text_measure_batch_buf.append(&measure.measure) catch unreachable;
+                measure.needs_measure = false;
+            }
+        }
+        if (self.text_measure_batch_buf.items.len > 0) {
+            self.common.g.measureTextBatch(self.text_measure_batch_buf.items);
         }
-        self.common.g.measureTextBatch(self.text_measure_batch_buf.items);
 
         // Compute layout only after all widgets/nodes exist since
         // only the Widget knows how to compute it's layout and that could depend on state and nested child nodes.
         // The goal here is to perform layout in linear time, more specifically pre and post visits to each node.
+        // Subtrees that haven't changed since the last update reuse their cached layout.
         if (self.root_node != null) {
-            const size = self.layout_ctx.computeLayout(self.root_node.?, 0, 0, layout_size.width, layout_size.height);
-            self.layout_ctx.setLayout(self.root_node.?, ui.Layout.init(0, 0, size.width, size.height));
+            const root = self.root_node.?;
+            const prev_layout = root.layout;
+            // Cached layouts used the old measures.
+            const layout_cache = self.layout_cache;
+            self.layout_cache = layout_cache and !remeasure_all;
+            const size = self.layout_ctx.computeLayout(root, 0, 0, layout_size.width, layout_size.height);
+            self.layout_cache = layout_cache;
+            self.layout_ctx.setLayout(root, ui.Layout.init(0, 0, size.width, size.height));
+            if (prev_layout.width != size.width or prev_layout.height != size.height) {
+                root.markDirty();
+            }
         }
 
         // Run logic that needs to happen after layout.
@@ -1069,6 +1198,42 @@ pub const Module = struct {
         ui_render.render(self);
     }
 
+    /// When enabled, nodes whose props, style and constraints didn't change reuse their last layout.
+    /// Widgets whose layout depends on state outside their props need to call Node.markLayoutDirty.
+    /// Disabled by default, which lays out the whole tree every update.
+    pub fn setLayoutCaching(self: *Module, enabled: bool) void {
+        self.layout_cache = enabled;
+    }
+
+    /// When enabled, nodes that haven't changed are drawn from their previous draws instead of running their render functions.
+    /// A node is changed when its props, style, children or bounds change, or when one of its event handlers fires.
+    /// Widgets that change during render (eg. animations) need to call RenderContext.markDirty.
+    pub fn setRetainedRendering(self: *Module, retained: bool) void {
+        self.render_ctx.retained = retained;
+    }
+
+    /// With retained rendering, returns false if the last rendered frame would be drawn again.
+    /// An app can then skip the render and present the previous frame. Intended to be checked after `update`.
+    pub fn needsRender(self: *Module) bool {
+        if (!self.render_ctx.retained) {
+            return true;
+        }
+        const root = self.root_node orelse return true;
+        if (root.hasState(ui.NodeStateMasks.subtree_dirty)) {
+            return true;
+        }
+        // Placeholder glyphs and images that are still uploading are replaced once they're ready.
+        return self.common.g.hasPendingGlyphs() or self.common.g.hasPendingImageUploads();
+    }
+
+    /// Returns the bounds of the nodes that were drawn differently in the last render or null if every node was replayed.
+    /// Only tracked with retained rendering. Useful when rendering into a target that persists across frames.
+    pub fn getDamageBounds(self: Module) ?stdx.math.BBox {
+        if (self.render_ctx.has_damage) {
+            return self.render_ctx.damage;
+        } else return null;
+    }
+
     /// Assumes the widget and the frame represent the same instance,
     /// so the widget is updated with the frame's props.
     /// Recursively update children.
@@ -1215,6 +1380,9 @@ pub const Module = struct {
                     parent.children.items[child_idx] = existing_node.?;
                     // Mark this node as used so it doesn't get removed later.
                     existing_node.?.setStateMask(ui.NodeStateMasks.diff_used);
+                    // Child order changed.
+                    parent.markDirty();
+                    parent.markLayoutDirty();
                 }
             } else {
                 if (parent.children.items.len == child_idx) {
@@ -1275,6 +1443,8 @@ pub const Module = struct {
 
         if (node.parent != null) {
             _ = node.parent.?.key_to_child.remove(node.key);
+            node.parent.?.markDirty();
+            node.parent.?.markLayoutDirty();
         }
         self.destroyNode(node);
     }
@@ -1341,6 +1511,10 @@ pub const Module = struct {
         // Destroy widget state/props after firing any cleanup events. eg. hover end event.
         widget_vtable.destroy(self.mod_ctx.mod, node);
 
+        if (node.render_cache) |cache| {
+            cache.deinit();
+            self.alloc.destroy(cache);
+        }
         node.deinit();
 
         self.common.to_remove_nodes.append(self.alloc, node) catch fatal();
@@ -1389,7 +1563,10 @@ pub const Module = struct {
 
         if (parent != null) {
             parent.?.key_to_child.put(key, new_node) catch unreachable;
+            parent.?.markDirty();
         }
+        new_node.markDirty();
+        new_node.markLayoutDirty();
 
         self.init_ctx.prepareForNode(new_node);
         const new_widget = widget_vtable.create(self, new_node, frame_ptr, frame);
@@ -1508,15 +1685,43 @@ pub const RenderContext = struct {
     // Current node.
     node: *ui.Node,
 
+    /// Whether nodes are drawn from their recordings when they aren't dirty.
+    retained: bool,
+
+    /// Node that is currently recording its draws.
+    rec_node: ?*ui.Node,
+
+    /// Bounds of the nodes that were recorded again in the last render.
+    damage: stdx.math.BBox,
+    has_damage: bool,
+
     fn init(common: *CommonContext, gctx: *graphics.Graphics) RenderContext {
         return .{
             .gctx = gctx,
             .common = common,
             .node = undefined,
             .delta_ms = 0,
+            .retained = false,
+            .rec_node = null,
+            .damage = stdx.math.BBox.initZero(),
+            .has_damage = false,
         };
     }
 
+    /// Requests the current node to render again next frame. Needed for state that changes during render. eg. Animations.
+    pub inline fn markDirty(self: *RenderContext) void {
+        self.node.markDirty();
+    }
+
+    pub fn addDamage(self: *RenderContext, bounds: stdx.math.BBox) void {
+        if (self.has_damage) {
+            self.damage.encloseBBox(bounds);
+        } else {
+            self.damage = bounds;
+            self.has_damage = true;
+        }
+    }
+
     pub inline fn strokeBBoxInward(self: *RenderContext, bounds: stdx.math.BBox) void {
         self.gctx.strokeRectBoundsInward(bounds.min_x, bounds.min_y, bounds.max_x, bounds.max_y);
     }
@@ -1986,8 +2191,10 @@ pub const CommonContext = struct {
                 if (self.common.focused_onblur) |on_blur| {
                     on_blur(focused_widget, self);
                 }
+                focused_widget.markSubtreeDirty();
             }
         }
+        node.markSubtreeDirty();
         self.common.focused_widget = node;
         self.common.focused_onblur = opts.onBlur;
         self.common.focused_onpaste = opts.onPaste;
@@ -2833,6 +3040,8 @@ fn SubscriberRet(comptime T: type, comptime Return: type) type {
 
         fn handleEvent(self: Self, ctx: *ui.EventContext, e: T) Return {
             ctx.node = self.node;
+            // Handlers can change widget state that isn't in props.
+            self.node.markSubtreeDirty();
             return self.closure.call(.{
                 ui.Event(T){
                     .ctx = ctx,
@@ -2854,6 +3063,7 @@ const HoverChangeSubscriber = struct {
 
     fn handleEvent(self: HoverChangeSubscriber, node: *ui.Node, e: ui.HoverChangeEvent) void {
         e.ctx.node = node;
+        node.markSubtreeDirty();
         self.closure.call(.{ e });
     }
 
@@ -2875,6 +3085,7 @@ fn Subscriber2(comptime T: type) type {
 
         fn handleEvent(self: Self, node: *ui.Node, e: T) void {
             e.ctx.node = node;
+            node.markSubtreeDirty();
             self.closure.call(.{ e });
         }
 
@@ -2895,6 +3106,7 @@ fn Subscriber(comptime T: type) type {
 
         fn handleEvent(self: Self, ctx: *ui.EventContext, e: T) void {
             ctx.node = self.node;
+            self.node.markSubtreeDirty();
             self.closure.call(.{
                 ui.Event(T){
                     .ctx = ctx,
@@ -2938,6 +3150,99 @@ const TestModule = struct {
     }
 };
 
+test "propsEql" {
+    const Props = struct {
+        text: ?[]const u8 = null,
+        size: f32 = 10,
+        child: ui.FramePtr = .{},
+    };
+    var buf = "abc".*;
+    try t.eq(propsEql(Props, .{ .text = "abc" }, .{ .text = &buf }), true);
+    try t.eq(propsEql(Props, .{ .text = "abc" }, .{ .text = "abd" }), false);
+    try t.eq(propsEql(Props, .{ .text = "abc" }, .{}), false);
+    try t.eq(propsEql(Props, .{ .size = 10 }, .{ .size = 12 }), false);
+    try t.eq(propsEql(Props, .{ .child = ui.FramePtr.init(1) }, .{ .child = ui.FramePtr.init(2) }), true);
+
+    // Single pointers could point to data that changed in place.
+    var val: u32 = 0;
+    const PtrProps = struct {
+        ptr: *const u32,
+    };
+    try t.eq(propsEql(PtrProps, .{ .ptr = &val }, .{ .ptr = &val }), false);
+}
+
+test "Changed function props mark the node dirty." {
+    const Ctx = struct {
+        fn onRender(_: *u32, _: u32) void {}
+        fn onRenderOther(_: *u32, _: u32) void {}
+    };
+    const A = struct {
+        props: *const struct {
+            onRender: stdx.Function(fn (u32) void) = .{},
+        },
+    };
+    const S = struct {
+        which: u32 = 0,
+        ctx_a: u32 = 0,
+        ctx_b: u32 = 0,
+        fn bootstrap(self: *@This(), c: *BuildContext) ui.FramePtr {
+            return c.build(A, .{
+                .id = .root,
+                .onRender = switch (self.which) {
+                    0 => c.funcExt(&self.ctx_a, Ctx.onRender),
+                    1 => c.funcExt(&self.ctx_b, Ctx.onRender),
+                    2 => c.funcExt(&self.ctx_b, Ctx.onRenderOther),
+                    else => c.closure(&self.ctx_b, Ctx.onRender),
+                },
+            });
+        }
+    };
+    var mod: TestModule = undefined;
+    mod.init();
+    defer mod.deinit();
+    mod.mod.setRetainedRendering(true);
+
+    var s = S{};
+    try mod.preUpdate(&s, S.bootstrap);
+    const node = mod.getNodeByTag(.root).?;
+    // Clears the states up to the root like a render would.
+    const R = struct {
+        fn clearDirty(node_: *ui.Node) void {
+            var cur: ?*ui.Node = node_;
+            while (cur) |n| {
+                n.clearStateMask(ui.NodeStateMasks.render_dirty | ui.NodeStateMasks.subtree_dirty);
+                cur = n.parent;
+            }
+        }
+    };
+
+    // Same function and context.
+    R.clearDirty(node);
+    try mod.preUpdate(&s, S.bootstrap);
+    try t.eq(node.hasState(ui.NodeStateMasks.render_dirty), false);
+    try t.eq(mod.mod.needsRender(), false);
+
+    // Different context.
+    s.which = 1;
+    try mod.preUpdate(&s, S.bootstrap);
+    try t.eq(node.hasState(ui.NodeStateMasks.render_dirty), true);
+    try t.eq(mod.mod.needsRender(), true);
+
+    // Different function.
+    R.clearDirty(node);
+    s.which = 2;
+    try mod.preUpdate(&s, S.bootstrap);
+    try t.eq(node.hasState(ui.NodeStateMasks.render_dirty), true);
+
+    // A closure is created every build so it's always changed.
+    R.clearDirty(node);
+    s.which = 3;
+    try mod.preUpdate(&s, S.bootstrap);
+    R.clearDirty(node);
+    try mod.preUpdate(&s, S.bootstrap);
+    try t.eq(node.hasState(ui.NodeStateMasks.render_dirty), true);
+}
+
 test "Node removal also removes the children." {
     const A = struct {
         props: *const struct {
@@ -3317,6 +3622,157 @@ test "Diff matches child with key." {
     }
 }
 
+test "Layout is only recomputed for changed nodes." {
+    const Counter = struct {
+        var num_layouts: u32 = 0;
+    };
+    const A = struct {
+        props: *const struct {
+            val: u32,
+        },
+        pub fn layout(_: *@This(), c: *ui.LayoutContext) ui.LayoutSize {
+            Counter.num_layouts += 1;
+            return c.getSizeConstraints().getMinLayoutSize();
+        }
+    };
+    const B = struct {
+        props: *const struct {
+            children: ui.FrameListPtr,
+        },
+        fn build(self: *@This(), c: *BuildContext) ui.FramePtr {
+            return c.fragment(self.props.children.dupe());
+        }
+    };
+    const S = struct {
+        fn bootstrap(val: *u32, c: *BuildContext) ui.FramePtr {
+            return c.build(B, .{
+                .children = c.list(&.{
+                    c.build(A, .{ .val = val.* }),
+                    c.build(A, .{ .val = 0 }),
+                }),
+            });
+        }
+    };
+    var mod: TestModule = undefined;
+    mod.init();
+    defer mod.deinit();
+    mod.mod.setLayoutCaching(true);
+
+    var val: u32 = 0;
+    try mod.preUpdate(&val, S.bootstrap);
+    try t.eq(Counter.num_layouts, 2);
+
+    // Nothing changed.
+    try mod.preUpdate(&val, S.bootstrap);
+    try t.eq(Counter.num_layouts, 2);
+
+    // Only the first child's props changed.
+    val = 1;
+    try mod.preUpdate(&val, S.bootstrap);
+    try t.eq(Counter.num_layouts, 3);
+
+    // Parent constraints changed.
+    mod.size = ui.LayoutSize.init(400, 300);
+    try mod.preUpdate(&val, S.bootstrap);
+    try t.eq(Counter.num_layouts, 5);
+}
+
+test "Only changed text measures are batched." {
+    const A = struct {
+        props: *const struct {
+            text: []const u8,
+        },
+        measure_id: ui.TextMeasureId,
+        pub fn init(self: *@This(), c: *ui.InitContext) void {
+            self.measure_id = c.createTextMeasure(c.getDefaultFontGroup(), 12);
+        }
+        pub fn deinit(self: *@This(), c: *ui.DeinitContext) void {
+            c.common.destroyTextMeasure(self.measure_id);
+        }
+        fn build(self: *@This(), c: *BuildContext) ui.FramePtr {
+            const measure = c.common.getTextMeasure(self.measure_id);
+            if (!std.mem.eql(u8, measure.measure.text, self.props.text)) {
+                measure.setText(self.props.text);
+            }
+            return .{};
+        }
+    };
+    const B = struct {
+        props: *const struct {
+            children: ui.FrameListPtr,
+        },
+        fn build(self: *@This(), c: *BuildContext) ui.FramePtr {
+            return c.fragment(self.props.children.dupe());
+        }
+    };
+    const S = struct {
+        fn bootstrap(text: *[]const u8, c: *BuildContext) ui.FramePtr {
+            return c.build(B, .{
+                .children = c.list(&.{
+                    c.build(A, .{ .text = text.* }),
+                    c.build(A, .{ .text = "label" }),
+                }),
+            });
+        }
+    };
+    var mod: TestModule = undefined;
+    mod.init();
+    defer mod.deinit();
+
+    var text: []const u8 = "label";
+    try mod.preUpdate(&text, S.bootstrap);
+    try t.eq(mod.mod.text_measure_batch_buf.items.len, 2);
+
+    // Nothing changed.
+    try mod.preUpdate(&text, S.bootstrap);
+    try t.eq(mod.mod.text_measure_batch_buf.items.len, 0);
+
+    text = "changed";
+    try mod.preUpdate(&text, S.bootstrap);
+    try t.eq(mod.mod.text_measure_batch_buf.items.len, 1);
+}
+
+test "VirtualList only builds rows around the viewport." {
+    const Row = struct {};
+    const S = struct {
+        fn bootstrap(num_built: *u32, c: *BuildContext) ui.FramePtr {
+            return u.ScrollVirtualList(.{
+                .num_items = 100000,
+                .item_height = 20,
+                .overscan = 4,
+                .buildItem = c.funcExt(num_built, buildItem),
+            });
+        }
+        fn buildItem(num_built: *u32, c: *BuildContext, _: u32) ui.FramePtr {
+            num_built.* += 1;
+            return c.build(Row, .{});
+        }
+    };
+    var mod: TestModule = undefined;
+    mod.init();
+    defer mod.deinit();
+
+    // Only the overscan rows before the first layout.
+    var num_built: u32 = 0;
+    try mod.preUpdate(&num_built, S.bootstrap);
+    try t.eq(num_built, 9);
+
+    // Fills the 600 high viewport.
+    num_built = 0;
+    try mod.preUpdate(&num_built, S.bootstrap);
+    try t.eq(num_built, 39);
+    const list = mod.getRoot().?.findChild(u.VirtualListT).?;
+    try t.eq(list.node.numChildren(), 39);
+
+    // Scrolling reuses the same number of nodes.
+    mod.getRoot().?.findChild(u.ScrollViewT).?.getWidget().scroll_y = 20000;
+    num_built = 0;
+    try mod.preUpdate(&num_built, S.bootstrap);
+    try t.eq(num_built, 39);
+    try t.eq(list.getWidget().first_idx, 996);
+    try t.eq(list.node.numChildren(), 39);
+}
+
 test "Props memory should still be valid at node destroy time." {
     // Arena allocations should survive for two update cycles. 
     // If not, a tree diff that destroys nodes will have invalidated props memory which is undesirable since
@@ -3496,6 +3952,7 @@ const IntervalSession = struct {
 
     fn call(self: *IntervalSession, ctx: *ui.EventContext) void {
         ctx.node = self.node;
+        self.node.markSubtreeDirty();
         self.closure.call(.{
             ui.IntervalEvent{
                 .progress_ms = self.progress_ms,
@@ -1,4 +1,7 @@
+const std = @import("std");
 const stdx = @import("stdx");
+const fatal = stdx.fatal;
+const graphics = @import("graphics");
 
 const ui = @import("ui.zig");
 const Module = ui.Module;
@@ -8,8 +11,10 @@ const log = stdx.log.scoped(.render);
 
 /// Renders the widgets from the root.
 pub fn render(mod: *Module) void {
-    // TODO: Implement render tree to speed up redraws.
     // TODO: Implement draw lists.
+    mod.render_ctx.has_damage = false;
+    mod.render_ctx.damage = stdx.math.BBox.initZero();
+    mod.render_ctx.rec_node = null;
     mod.root_node.?.vtable.render(mod.root_node.?, &mod.render_ctx, 0, 0);
 }
 
@@ -17,4 +22,110 @@ pub inline fn defaultRenderChildren(node: *Node, ctx: *ui.RenderContext) void {
     for (node.children.items) |it| {
         it.vtable.render(it, ctx, node.abs_bounds.min_x, node.abs_bounds.min_y);
     }
-}
\ No newline at end of file
+}
+
+/// Retained draws of a node. Children are not part of the recording, instead a mark remembers where each child was rendered
+/// so replaying the node can render it's children in between and a dirty child doesn't invalidate it's ancestors.
+pub const RenderCache = struct {
+    rec: graphics.DrawRecording,
+    child_marks: std.ArrayListUnmanaged(ChildMark),
+    /// Abs bounds of the node when it was recorded.
+    bounds: stdx.math.BBox,
+    recorded: bool,
+
+    pub fn init(alloc: std.mem.Allocator) RenderCache {
+        return .{
+            .rec = graphics.DrawRecording.init(alloc),
+            .child_marks = .{},
+            .bounds = stdx.math.BBox.initZero(),
+            .recorded = false,
+        };
+    }
+
+    pub fn deinit(self: *RenderCache) void {
+        self.child_marks.deinit(self.rec.alloc);
+        self.rec.deinit();
+    }
+};
+
+const ChildMark = struct {
+    /// Number of recorded batches before the child.
+    batch_idx: u32,
+    node: *Node,
+    parent_abs_x: f32,
+    parent_abs_y: f32,
+};
+
+/// Pauses the recording of the node that is rendering the child and returns it so it can be resumed afterwards.
+pub fn pauseRecording(ctx: *ui.RenderContext, child: *Node, parent_abs_x: f32, parent_abs_y: f32) ?*Node {
+    const owner = ctx.rec_node orelse return null;
+    ctx.gctx.endRecording();
+    const cache = owner.render_cache.?;
+    cache.child_marks.append(cache.rec.alloc, .{
+        .batch_idx = cache.rec.numBatches(),
+        .node = child,
+        .parent_abs_x = parent_abs_x,
+        .parent_abs_y = parent_abs_y,
+    }) catch fatal();
+    ctx.rec_node = null;
+    return owner;
+}
+
+pub fn resumeRecording(ctx: *ui.RenderContext, owner: ?*Node) void {
+    if (owner) |node| {
+        ctx.gctx.resumeRecording(&node.render_cache.?.rec);
+        ctx.rec_node = node;
+    }
+}
+
+/// Draws the node from it's recording and renders it's children at their marks.
+/// Returns false if the node needs to render again.
+pub fn replayNode(node: *Node, ctx: *ui.RenderContext) bool {
+    node.clearStateMask(ui.NodeStateMasks.subtree_dirty);
+    const cache = node.render_cache orelse return false;
+    if (node.hasState(ui.NodeStateMasks.render_dirty) or !cache.recorded) {
+        return false;
+    }
+    if (!std.meta.eql(cache.bounds, node.abs_bounds) or !ctx.gctx.canReplayRecording(&cache.rec)) {
+        return false;
+    }
+    ctx.node = node;
+    var batch_idx: u32 = 0;
+    for (cache.child_marks.items) |mark| {
+        if (mark.batch_idx > batch_idx) {
+            ctx.gctx.replayRecording(&cache.rec, batch_idx, mark.batch_idx);
+            batch_idx = mark.batch_idx;
+        }
+        mark.node.vtable.render(mark.node, ctx, mark.parent_abs_x, mark.parent_abs_y);
+    }
+    if (cache.rec.numBatches() > batch_idx) {
+        ctx.gctx.replayRecording(&cache.rec, batch_idx, cache.rec.numBatches());
+    }
+    return true;
+}
+
+pub fn beginNodeRecording(node: *Node, ctx: *ui.RenderContext) void {
+    const cache = node.render_cache orelse b: {
+        const new = ctx.common.alloc.create(RenderCache) catch fatal();
+        new.* = RenderCache.init(ctx.common.alloc);
+        node.render_cache = new;
+        break :b new;
+    };
+    cache.child_marks.clearRetainingCapacity();
+    node.clearStateMask(ui.NodeStateMasks.render_dirty);
+    ctx.gctx.beginRecording(&cache.rec);
+    ctx.rec_node = node;
+}
+
+/// Ends the node's recording and adds the old and new bounds to the frame's damage.
+pub fn endNodeRecording(node: *Node, ctx: *ui.RenderContext) void {
+    ctx.gctx.endRecording();
+    ctx.rec_node = null;
+    const cache = node.render_cache.?;
+    if (cache.recorded) {
+        ctx.addDamage(cache.bounds);
+    }
+    ctx.addDamage(node.abs_bounds);
+    cache.bounds = node.abs_bounds;
+    cache.recorded = true;
+}
@@ -2,6 +2,8 @@ const graphics = @import("graphics");
 const FontGroupId = graphics.font.FontGroupId;
 const TextMetrics = graphics.TextMetrics;
 
+/// Measured in a batch before layout. The result is kept until the text or font is changed with setText or setFont,
+/// or until the fallback fonts or the dpr change.
 pub const TextMeasure = struct {
     const Self = @This();
 
@@ -11,7 +11,15 @@ const log = stdx.log.scoped(.build);
 
 pub const BuildContext = struct {
     alloc: std.mem.Allocator,
+
+    /// Bump allocator for data that only lives for a build: frame props and styles, frame list nodes, node binds and closures.
+    /// Freeing is a no-op and the memory is reclaimed when the arena is reset. See `beginBuild`.
     arena_alloc: std.mem.Allocator,
+
+    /// Double buffered since frames retained by nodes are only released when the nodes receive new frames in the next build.
+    arenas: [2]std.heap.ArenaAllocator,
+    arena_idx: u1,
+
     mod: *ui.Module,
     common: *ui.CommonContext,
 
@@ -23,9 +31,6 @@ pub const BuildContext = struct {
     // Linked list nodes buffer with a list of refcounted list heads.
     frame_lists: stdx.ds.RcPooledHandleList(ui.FrameListId, stdx.ds.SLLUnmanaged(ui.FramePtr)),
 
-    /// Allocator for dynamic data that aren't organized in an array list but should still be close together in memory.
-    dynamic_alloc: std.mem.Allocator,
-
     /// Temporary frame id buffer.
     frameid_buf: std.ArrayListUnmanaged(ui.FramePtr),
 
@@ -35,11 +40,15 @@ pub const BuildContext = struct {
     // Current Frame used. Must use id since pointer could be invalidated.
     frame_id: ui.FrameId,
 
-    pub fn init(self: *BuildContext, alloc: std.mem.Allocator, arena_alloc: std.mem.Allocator, mod: *ui.Module) void {
+    pub fn init(self: *BuildContext, alloc: std.mem.Allocator, mod: *ui.Module) void {
         self.* = .{
             .alloc = alloc,
-            .dynamic_alloc = alloc,
-            .arena_alloc = arena_alloc,
+            .arena_alloc = undefined,
+            .arenas = .{
+                std.heap.ArenaAllocator.init(alloc),
+                std.heap.ArenaAllocator.init(alloc),
+            },
+            .arena_idx = 0,
             .mod = mod,
             .common = &mod.common.ctx,
             .frames = stdx.ds.RcPooledHandleList(ui.FrameId, ui.Frame).init(alloc),
@@ -48,6 +57,7 @@ pub const BuildContext = struct {
             .node = undefined,
             .frame_id = undefined,
         };
+        self.arena_alloc = self.arenas[0].allocator();
     }
 
     pub fn deinit(self: *BuildContext) void {
@@ -66,6 +76,16 @@ pub const BuildContext = struct {
         self.frames.deinit();
         self.frame_lists.deinit();
         self.frameid_buf.deinit(self.alloc);
+        self.arenas[0].deinit();
+        self.arenas[1].deinit();
+    }
+
+    /// Switches to the arena used two builds ago and resets it. Frames from the previous build are still retained by nodes
+    /// until they are updated, so that arena is left intact. Must be called after nodes marked for removal are destroyed.
+    pub fn beginBuild(self: *BuildContext) void {
+        self.arena_idx +%= 1;
+        _ = self.arenas[self.arena_idx].reset(.retain_capacity);
+        self.arena_alloc = self.arenas[self.arena_idx].allocator();
     }
 
     /// Creates a closure in arena buffer, and returns an iface.
@@ -75,7 +95,7 @@ pub const BuildContext = struct {
             @compileError("Expected first param to be: " ++ @typeName(@TypeOf(ctx)));
         }
         const InnerFn = stdx.meta.FnAfterFirstParam(@TypeOf(user_fn));
-        const c = stdx.Closure(@TypeOf(ctx), InnerFn).init(self.dynamic_alloc, ctx, user_fn).iface();
+        const c = stdx.Closure(@TypeOf(ctx), InnerFn).init(self.arena_alloc, ctx, user_fn).iface();
         return Function(InnerFn).initClosureIface(c);
     }
 
@@ -128,7 +148,7 @@ pub const BuildContext = struct {
         while (i < count) : (i += 1) {
             const frame_ptr = build_fn(ctx, self, @intCast(u32, i));
             if (frame_ptr.isPresent()) {
-                last = slist.insertAfterOrHead(self.alloc, last, frame_ptr) catch fatal();
+                last = slist.insertAfterOrHead(self.arena_alloc, last, frame_ptr) catch fatal();
                 act_count += 1;
             }
         }
@@ -146,9 +166,9 @@ pub const BuildContext = struct {
         self.node = node;
     }
 
-    /// Uses arena allocator to format text.
+    /// Formatted text is ref counted and can outlive the build so it isn't allocated from the arena.
     pub fn fmt(self: *BuildContext, comptime format: []const u8, args: anytype) !ui.SlicePtr(u8) {
-        const slice = try std.fmt.allocPrint(self.arena_alloc, format, args);
+        const slice = try std.fmt.allocPrint(self.alloc, format, args);
         return try self.common.common.initRcSlice(u8, slice);
     }
 
@@ -203,7 +223,7 @@ pub const BuildContext = struct {
             const slist = self.frame_lists.getPtrNoCheck(id);
             while (slist.head) |node| {
                 node.data.destroy();
-                _ = slist.removeHead(self.dynamic_alloc);
+                _ = slist.removeHead(self.arena_alloc);
             }
         }
         if (builtin.mode == .Debug) {
@@ -256,7 +276,7 @@ pub const BuildContext = struct {
         if (IsSlice or IsArray) {
             for (frame_ptrs) |ptr| {
                 if (ptr.isPresent()) {
-                    last = slist.insertAfterOrHead(self.dynamic_alloc, last, ptr) catch fatal();
+                    last = slist.insertAfterOrHead(self.arena_alloc, last, ptr) catch fatal();
                 }
             }
         } else {
@@ -297,7 +317,7 @@ pub const BuildContext = struct {
             const UserStyle = ui.WidgetUserStyle(Widget);
             const PropsStyle = @TypeOf(build_props.style);
             if (PropsStyle == UserStyle) {
-                const dupe = self.dynamic_alloc.create(UserStyle) catch fatal();
+                const dupe = self.arena_alloc.create(UserStyle) catch fatal();
                 dupe.* = build_props.style;
                 style = dupe;
             } else if (PropsStyle == *UserStyle) {
@@ -313,7 +333,7 @@ pub const BuildContext = struct {
 
         const HasProps = comptime module.WidgetHasProps(Widget);
         var props_ptr: ?*anyopaque = if (HasProps) b: {
-            const dupe = self.dynamic_alloc.create(ui.WidgetProps(Widget)) catch fatal();
+            const dupe = self.arena_alloc.create(ui.WidgetProps(Widget)) catch fatal();
             dupe.* = props.?.*;
             break :b dupe;
         } else null;
@@ -5,6 +5,7 @@ const fatal = stdx.fatal;
 const Vec2 = stdx.math.Vec2;
 
 const ui = @import("ui.zig");
+const ui_render = @import("render.zig");
 const log = stdx.log.scoped(.widget);
 
 /// Id can be an enum literal that is given a unique id at comptime.
@@ -151,6 +152,12 @@ pub const NodeStateMasks = struct {
     pub const user_style: u8 = 0b00001000;
     /// Node has a computed style. If true, the erased Style pointer can be accessed from the module map.
     pub const computed_style: u8 = 0b00010000;
+    /// The node's draws need to be recorded again. Only used with retained rendering.
+    pub const render_dirty: u8 = 0b00100000;
+    /// The node or one of it's descendants has render_dirty set.
+    pub const subtree_dirty: u8 = 0b01000000;
+    /// The node's cached layout can't be reused. Also set on the node's ancestors.
+    pub const layout_dirty: u8 = 0b10000000;
 };
 
 pub const EventHandlerMasks = struct {
@@ -192,6 +199,10 @@ pub const Node = struct {
     /// x, y are relative to the parent's position.
     layout: ui.Layout,
 
+    /// Constraints and result of the last computed layout. Reused while the node isn't layout_dirty and receives the same constraints.
+    layout_cstr: ui.SizeConstraints,
+    layout_size: ui.LayoutSize,
+
     /// Absolute bounds of the node is computed when traversing the render tree.
     abs_bounds: stdx.math.BBox,
 
@@ -218,6 +229,9 @@ pub const Node = struct {
 
     has_widget_id: bool,
 
+    /// Recorded draws of the node excluding it's children. Only created with retained rendering.
+    render_cache: ?*ui_render.RenderCache,
+
     debug: if (builtin.mode == .Debug) bool else void,
 
     pub fn init(self: *Node, alloc: std.mem.Allocator, vtable: *const WidgetVTable, parent: ?*Node, key: WidgetKey, widget: *anyopaque) void {
@@ -231,6 +245,8 @@ pub const Node = struct {
             .children = std.ArrayList(*Node).init(alloc),
             .child_event_ordering = undefined,
             .layout = undefined,
+            .layout_cstr = undefined,
+            .layout_size = undefined,
             .abs_bounds = stdx.math.BBox.initZero(),
             .key_to_child = std.AutoHashMap(WidgetKey, *Node).init(alloc),
             // .theme_id = NullId,
@@ -239,6 +255,7 @@ pub const Node = struct {
             .has_child_event_ordering = false,
             .id = undefined,
             .has_widget_id = false,
+            .render_cache = null,
             .debug = if (builtin.mode == .Debug) false else {},
         };
     }
@@ -338,6 +355,41 @@ pub const Node = struct {
         return self.state_mask & mask > 0;
     }
 
+    /// Marks the node's draws to be recorded again and flags the path up to the root so the next frame visits it.
+    pub fn markDirty(self: *Node) void {
+        self.setStateMask(NodeStateMasks.render_dirty);
+        var cur: ?*Node = self;
+        while (cur) |node| {
+            node.setStateMask(NodeStateMasks.subtree_dirty);
+            cur = node.parent;
+        }
+    }
+
+    /// Marks the node and all it's descendants dirty and invalidates the node's layout.
+    /// Used when a widget's state can change outside of it's props. (eg. From an event handler.)
+    pub fn markSubtreeDirty(self: *Node) void {
+        self.markDirty();
+        markChildrenDirty(self);
+        self.markLayoutDirty();
+    }
+
+    fn markChildrenDirty(node: *Node) void {
+        for (node.children.items) |child| {
+            child.setStateMask(NodeStateMasks.render_dirty | NodeStateMasks.subtree_dirty);
+            markChildrenDirty(child);
+        }
+    }
+
+    /// Invalidates the cached layout of the node and it's ancestors so they are computed again in the next update.
+    /// A widget whose layout depends on something other than it's props, children and constraints can call this during layout to skip caching.
+    pub fn markLayoutDirty(self: *Node) void {
+        var cur: ?*Node = self;
+        while (cur) |node| {
+            node.setStateMask(NodeStateMasks.layout_dirty);
+            cur = node.parent;
+        }
+    }
+
     pub fn dumpPath(self: Node) void {
         log.debug("{s} {}", .{self.vtable.name, self.children.items.len});
         if (self.parent) |parent| {
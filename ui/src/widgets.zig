@@ -74,6 +74,10 @@ const list = @import("widgets/list.zig");
 pub const List = list.List;
 pub const ScrollListT = list.ScrollList;
 pub const ScrollList = genBuildWithChildren(ScrollListT);
+pub const VirtualListT = list.VirtualList;
+pub const VirtualList = genBuildWithNoChild(VirtualListT);
+pub const ScrollVirtualListT = list.ScrollVirtualList;
+pub const ScrollVirtualList = genBuildWithNoChild(ScrollVirtualListT);
 const menu = @import("widgets/menu.zig");
 pub const MenuT = menu.Menu;
 pub const Menu = genBuildWithChildren(MenuT);
@@ -158,4 +158,226 @@ pub const List = struct {
             g.strokeRectBounds(child.abs_bounds.min_x, child.abs_bounds.min_y, bounds.max_x, child.abs_bounds.max_y);
         }
     }
-};
\ No newline at end of file
+};
+
+/// VirtualList inside a ScrollView.
+pub const ScrollVirtualList = struct {
+    props: *const struct {
+        num_items: u32 = 0,
+        item_height: f32 = 20,
+        estimate_height: bool = false,
+        overscan: u32 = 4,
+        buildItem: stdx.Function(fn (*ui.BuildContext, idx: u32) ui.FramePtr) = .{},
+        bg_color: Color = Color.White,
+    },
+
+    pub fn build(self: *ScrollVirtualList, c: *ui.BuildContext) ui.FramePtr {
+        const sv_style = w.ScrollViewStyle{
+            .bgColor = self.props.bg_color,
+        };
+        return w.ScrollView(.{
+            .enable_hscroll = false,
+            .style = sv_style },
+            w.Stretch(.{ .method = .Width },
+                c.build(VirtualList, .{
+                    .num_items = self.props.num_items,
+                    .item_height = self.props.item_height,
+                    .estimate_height = self.props.estimate_height,
+                    .overscan = self.props.overscan,
+                    // Forward instead of sharing the function since each frame owns it's props.
+                    .buildItem = c.funcExt(self, buildItem),
+                    .bg_color = self.props.bg_color,
+                }),
+            ),
+        );
+    }
+
+    fn buildItem(self: *ScrollVirtualList, c: *ui.BuildContext, idx: u32) ui.FramePtr {
+        return self.props.buildItem.call(.{ c, idx });
+    }
+};
+
+/// Lays out `num_items` rows in a column but only builds the rows in the viewport of the nearest ScrollView ancestor
+/// and `overscan` rows above and below it. Rows that aren't built only take up space so the scroll height stays correct
+/// and memory doesn't grow with the number of items.
+/// Row frames are keyed by their position in the built window so existing nodes are reused for other items as the list scrolls.
+/// A row widget with state should derive it from it's props since it can be given a different item.
+pub const VirtualList = struct {
+    props: *const struct {
+        num_items: u32 = 0,
+
+        /// Height of each row. Rows are laid out with exactly this height unless estimate_height is true.
+        /// A height that isn't positive has no window to compute so every row is built.
+        item_height: f32 = 20,
+
+        /// Use item_height as an estimate for rows that aren't built. Built rows take the height of their layout.
+        estimate_height: bool = false,
+
+        /// Number of rows built above and below the viewport.
+        overscan: u32 = 4,
+
+        buildItem: stdx.Function(fn (*ui.BuildContext, idx: u32) ui.FramePtr) = .{},
+        bg_color: Color = Color.White,
+    },
+
+    node: *ui.Node,
+
+    /// Provides the viewport. If there is no ScrollView, the list's own height is used.
+    sv_node: ?*ui.Node,
+
+    /// Items in [first_idx, first_idx + num_built) are built.
+    first_idx: u32,
+    num_built: u32,
+
+    /// Total height of the built rows from the last layout.
+    built_height: f32,
+
+    /// Shortest built row from the last layout. Used to size the window when heights are estimated.
+    min_row_height: f32,
+
+    laid_out: bool,
+
+    pub fn init(self: *VirtualList, c: *ui.InitContext) void {
+        self.node = c.node;
+        self.sv_node = null;
+        var cur = c.node.parent;
+        while (cur) |node| {
+            if (node.vtable == ui.GenWidgetVTable(w.ScrollViewT)) {
+                self.sv_node = node;
+                break;
+            }
+            cur = node.parent;
+        }
+        self.first_idx = 0;
+        self.num_built = 0;
+        self.built_height = 0;
+        self.min_row_height = 0;
+        self.laid_out = false;
+    }
+
+    pub fn build(self: *VirtualList, c: *ui.BuildContext) ui.FramePtr {
+        const S = struct {
+            fn buildRow(self_: *VirtualList, c_: *ui.BuildContext, i: u32) ui.FramePtr {
+                return self_.props.buildItem.call(.{ c_, self_.first_idx + i });
+            }
+        };
+        var window = self.computeWindow();
+        if (self.props.buildItem.isNull()) {
+            window.count = 0;
+        }
+        if (window.first != self.first_idx or window.count != self.num_built) {
+            // Rows are positioned from first_idx and may be given different items.
+            self.node.markLayoutDirty();
+            self.node.markDirty();
+            self.first_idx = window.first;
+            self.num_built = window.count;
+        }
+        if (self.num_built == 0) {
+            return .{};
+        }
+        return c.fragment(c.range(self.num_built, self, S.buildRow));
+    }
+
+    const Window = struct {
+        first: u32,
+        count: u32,
+    };
+
+    /// Determines the rows to build from the viewport of the last layout.
+    /// Before the first layout only the overscan rows are built. Rendering then requests another update to fill the viewport.
+    fn computeWindow(self: *VirtualList) Window {
+        const num_items = self.props.num_items;
+        const item_height = self.props.item_height;
+        // Dividing by a zero height would convert inf/nan to an index.
+        if (!(item_height > 0)) {
+            return .{ .first = 0, .count = num_items };
+        }
+        var view_top: f32 = 0;
+        var view_height: f32 = 0;
+        if (self.laid_out) {
+            if (self.sv_node) |sv_node| {
+                // Offset of the list in the ScrollView's content. The content itself is positioned by the scroll offset
+                // which is read from the ScrollView since it can change from events after the last layout.
+                var y: f32 = 0;
+                var cur = self.node;
+                while (cur.parent != sv_node) {
+                    y += cur.layout.y;
+                    cur = cur.parent.?;
+                }
+                view_top = sv_node.getWidget(w.ScrollViewT).scroll_y - y;
+                view_height = sv_node.layout.height;
+            } else {
+                view_height = self.node.layout.height;
+            }
+        }
+        var first: u32 = 0;
+        if (view_top > 0) {
+            first = @floatToInt(u32, @min(view_top / item_height, @intToFloat(f32, num_items)));
+        }
+        first = @min(first -| self.props.overscan, num_items);
+
+        // Shorter rows than estimated need more rows to fill the viewport.
+        var step = item_height;
+        if (self.props.estimate_height and self.min_row_height > 0) {
+            step = @min(step, self.min_row_height);
+        }
+        const num_visible = @floatToInt(u32, @ceil(view_height / step));
+        return .{
+            .first = first,
+            .count = @min(num_visible + self.props.overscan * 2 + 1, num_items - first),
+        };
+    }
+
+    /// Whether the built rows cover the viewport.
+    fn coversViewport(self: *VirtualList) bool {
+        const sv_node = self.sv_node orelse return true;
+        const view_top = sv_node.abs_bounds.min_y - self.node.abs_bounds.min_y;
+        const view_bottom = view_top + sv_node.layout.height;
+        const built_top = @intToFloat(f32, self.first_idx) * self.props.item_height;
+        const built_bottom = built_top + self.built_height;
+        const covers_top = self.first_idx == 0 or built_top <= view_top;
+        const covers_bottom = self.first_idx + self.num_built >= self.props.num_items or built_bottom >= view_bottom;
+        return covers_top and covers_bottom;
+    }
+
+    pub fn layout(self: *VirtualList, c: *ui.LayoutContext) ui.LayoutSize {
+        const node = c.getNode();
+        const cstr = c.getSizeConstraints();
+        const item_height = self.props.item_height;
+        const start_y = @intToFloat(f32, self.first_idx) * item_height;
+        var cur_y = start_y;
+        var max_width: f32 = 0;
+        var min_row_height: f32 = 0;
+        for (node.children.items, 0..) |child, i| {
+            const child_size = if (self.props.estimate_height)
+                c.computeLayoutWithMax(child, cstr.max_width, ui.ExpandedHeight)
+            else
+                c.computeLayout(child, 0, item_height, cstr.max_width, item_height);
+            c.setLayout(child, ui.Layout.init(0, cur_y, child_size.width, child_size.height));
+            cur_y += child_size.height;
+            if (child_size.width > max_width) {
+                max_width = child_size.width;
+            }
+            if (i == 0 or child_size.height < min_row_height) {
+                min_row_height = child_size.height;
+            }
+        }
+        self.built_height = cur_y - start_y;
+        self.min_row_height = min_row_height;
+        self.laid_out = true;
+
+        const num_after = self.props.num_items - @min(self.first_idx + @intCast(u32, node.children.items.len), self.props.num_items);
+        var res = ui.LayoutSize.init(max_width, cur_y + @intToFloat(f32, num_after) * item_height);
+        res.growToMin(cstr);
+        return res;
+    }
+
+    pub fn render(self: *VirtualList, c: *ui.RenderContext) void {
+        c.gctx.setFillColor(self.props.bg_color);
+        c.fillBBox(c.getAbsBounds());
+        if (!self.coversViewport()) {
+            // Scrolled past the built rows after the last build.
+            c.markDirty();
+        }
+    }
+};
@@ -477,6 +477,8 @@ pub const PopoverOverlay = struct {
 
             // Source widget layout should already be computed.
             const src_abs_bounds = self.props.src_node.computeAbsBounds();
+            // The source widget can move without this node changing so the layout isn't cached.
+            c.node.markLayoutDirty();
 
             // Position relative to source widget. 
             switch (self.props.placement) {
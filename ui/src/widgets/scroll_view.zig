@@ -183,6 +183,7 @@ pub const ScrollView = struct {
 
     pub fn scrollToBottomAfterLayout(self: *ScrollView) void {
         self.scroll_to_bottom_after_layout = true;
+        self.node.markLayoutDirty();
     }
 
     fn checkScroll(self: *ScrollView) void {
@@ -211,6 +212,7 @@ pub const ScrollView = struct {
             it.layout.y = -scroll_y;
         }
         self.computeEffScrollDims(node.layout.width, node.layout.height);
+        node.markDirty();
     }
 
     /// Take up the same amount of space as it's child and respects parent's constraints.
@@ -68,6 +68,10 @@ pub const Switch = struct {
 
         g.setFillColor(Color.White);
         self.anim.step(c.delta_ms);
+        if (self.anim.t < 1) {
+            // Keep rendering until the animation finishes.
+            c.markDirty();
+        }
         var offset_x: f32 = undefined;
         if (self.is_set) {
             offset_x = self.anim.t * (Width - InnerPadding * 2 - InnerRadius * 2);